@@ -10,7 +10,10 @@ public class Project_FZ5 : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "ProceduralMeshComponent" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] {  });
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json", "ReplicationGraph", "Chaos", "GeometryCollectionEngine", "RHI" });
+
+		// The dedicated server has no camera, input mapping, debug drawing nor materials on the sliced pieces.
+		PublicDefinitions.Add("FZ5_WITH_CLIENT_VISUALS=" + (Target.Type == TargetType.Server ? "0" : "1"));
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
@@ -2,5 +2,62 @@
 
 #include "Project_FZ5.h"
 #include "Modules/ModuleManager.h"
+#include "Containers/Ticker.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CoreDelegates.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Project_FZ5, "Project_FZ5" );
+#if !UE_BUILD_SHIPPING
+UE_TRACE_CHANNEL_DEFINE(FZ5Channel);
+#endif
+
+DEFINE_LOG_CATEGORY(LogFZ5);
+
+LLM_DEFINE_TAG(FZ5);
+LLM_DEFINE_TAG(FZ5_SourceGeometry, TEXT("SourceGeometry"), TEXT("FZ5"));
+LLM_DEFINE_TAG(FZ5_FragmentGeometry, TEXT("FragmentGeometry"), TEXT("FZ5"));
+LLM_DEFINE_TAG(FZ5_CapGeometry, TEXT("CapGeometry"), TEXT("FZ5"));
+LLM_DEFINE_TAG(FZ5_Collision, TEXT("Collision"), TEXT("FZ5"));
+LLM_DEFINE_TAG(FZ5_Physics, TEXT("Physics"), TEXT("FZ5"));
+
+static TAutoConsoleVariable<float> CVarIdleMemoryDelay(
+	TEXT("fz5.Boot.IdleMemoryDelay"),
+	30.f,
+	TEXT("Seconds after boot at which the idle memory is logged, 0 to never log it."));
+
+/* Logs how long the process took to boot and the memory it holds once idle, to size the match instances per host. */
+class FProject_FZ5Module : public FDefaultGameModuleImpl
+{
+	FDelegateHandle InitCompleteHandle;
+
+	static void LogMemory(const TCHAR* When)
+	{
+		const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+		UE_LOG(LogFZ5, Display, TEXT("%s: %.2f s since start, %.1f MB used, %.1f MB peak"), When, FPlatformTime::Seconds() - GStartTime,
+			MemoryStats.UsedPhysical / (1024.0 * 1024.0), MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0));
+	}
+
+public:
+	virtual void StartupModule() override
+	{
+		InitCompleteHandle = FCoreDelegates::OnFEngineLoopInitComplete.AddLambda([]()
+		{
+			LogMemory(TEXT("Boot"));
+
+			const float Delay = CVarIdleMemoryDelay.GetValueOnGameThread();
+			if (Delay <= 0.f) return;
+
+			FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([](float)
+			{
+				LogMemory(TEXT("Idle"));
+				return false;
+			}), Delay);
+		});
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FCoreDelegates::OnFEngineLoopInitComplete.Remove(InitCompleteHandle);
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FProject_FZ5Module, Project_FZ5, "Project_FZ5" );
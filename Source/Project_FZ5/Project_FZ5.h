@@ -3,4 +3,33 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "HAL/LowLevelMemTracker.h"
 
+DECLARE_STATS_GROUP(TEXT("FZ5"), STATGROUP_FZ5, STATCAT_Advanced);
+
+PROJECT_FZ5_API DECLARE_LOG_CATEGORY_EXTERN(LogFZ5, Log, All);
+
+// Set by the build rules, off for the dedicated server target.
+#ifndef FZ5_WITH_CLIENT_VISUALS
+#define FZ5_WITH_CLIENT_VISUALS 1
+#endif
+
+// Low level memory tags of the slicing, under FZ5 in the LLM stats and Insights when run with -llm.
+LLM_DECLARE_TAG_API(FZ5_SourceGeometry, PROJECT_FZ5_API);
+LLM_DECLARE_TAG_API(FZ5_FragmentGeometry, PROJECT_FZ5_API);
+LLM_DECLARE_TAG_API(FZ5_CapGeometry, PROJECT_FZ5_API);
+LLM_DECLARE_TAG_API(FZ5_Collision, PROJECT_FZ5_API);
+LLM_DECLARE_TAG_API(FZ5_Physics, PROJECT_FZ5_API);
+
+#if !UE_BUILD_SHIPPING
+UE_TRACE_CHANNEL_EXTERN(FZ5Channel, PROJECT_FZ5_API);
+
+// Time a scope both in the stats system and as a CPU event on the FZ5 Insights channel, STAT_FZ5_Name must be declared.
+#define FZ5_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_FZ5_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(FZ5_##Name, FZ5Channel)
+#else
+#define FZ5_SCOPE(Name)
+#endif
@@ -0,0 +1,629 @@
+#include "S_BenchmarkCommandlet.h"
+#include "S_Player.h"
+#include "S_BotSubsystem.h"
+#include "S_SlicedMesh.h"
+#include "S_SliceIndex.h"
+#include "S_SliceProxies.h"
+#include "S_SliceSubsystem.h"
+#include "S_SliceReplication.h"
+#include "S_FragmentSubsystem.h"
+#include "S_RenderBudget.h"
+#include "Project_FZ5.h"
+#include "Engine/Engine.h"
+#include "GeometryCollection/GeometryCollectionObject.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectIterator.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+
+double FS_BenchmarkResult::GetPercentile(double Percent) const
+{
+	if (FrameTimes.Num() == 0) return 0.0;
+
+	TArray<double> Sorted = FrameTimes;
+	Sorted.Sort();
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Percent / 100.0 * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+	return Sorted[Index];
+}
+
+US_BenchmarkCommandlet::US_BenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 US_BenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 GridSize = 6;
+	int32 MaxPlanes = 4;
+	int32 NumWaves = 4;
+	int32 FramesPerWave = 30;
+	int32 NumPlayers = 16;
+	int32 PlayerFrames = 600;
+	int32 NumBots = 1000;
+	int32 BotFrames = 600;
+	int32 RenderFragments = 2000;
+	int32 RenderFrames = 600;
+	float RenderTargetMs = 4.f;
+	int32 NumProps = 5000;
+	int32 PropFrames = 120;
+	float Tolerance = 10.f;
+	FString OutputDir = FPaths::ProjectSavedDir() / TEXT("Benchmark");
+	FString BaselineFile;
+	FString PlayerClassPath;
+	FString FractureMeshPath;
+	FString FractureCollectionPath;
+
+	FParse::Value(*Params, TEXT("Grid="), GridSize);
+	FParse::Value(*Params, TEXT("MaxPlanes="), MaxPlanes);
+	FParse::Value(*Params, TEXT("Waves="), NumWaves);
+	FParse::Value(*Params, TEXT("FramesPerWave="), FramesPerWave);
+	FParse::Value(*Params, TEXT("Players="), NumPlayers);
+	FParse::Value(*Params, TEXT("PlayerFrames="), PlayerFrames);
+	FParse::Value(*Params, TEXT("Bots="), NumBots);
+	FParse::Value(*Params, TEXT("BotFrames="), BotFrames);
+	FParse::Value(*Params, TEXT("RenderFragments="), RenderFragments);
+	FParse::Value(*Params, TEXT("RenderFrames="), RenderFrames);
+	FParse::Value(*Params, TEXT("RenderTargetMs="), RenderTargetMs);
+	FParse::Value(*Params, TEXT("Props="), NumProps);
+	FParse::Value(*Params, TEXT("PropFrames="), PropFrames);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("Output="), OutputDir);
+	FParse::Value(*Params, TEXT("Baseline="), BaselineFile);
+	FParse::Value(*Params, TEXT("PlayerClass="), PlayerClassPath);
+	FParse::Value(*Params, TEXT("FractureMesh="), FractureMeshPath);
+	FParse::Value(*Params, TEXT("FractureCollection="), FractureCollectionPath);
+
+	TSubclassOf<AS_Player> PlayerClass = AS_Player::StaticClass();
+	if (!PlayerClassPath.IsEmpty())
+	{
+		PlayerClass = LoadClass<AS_Player>(nullptr, *PlayerClassPath);
+		if (!PlayerClass)
+		{
+			UE_LOG(LogFZ5, Error, TEXT("Benchmark: cannot load player class %s"), *PlayerClassPath);
+			return 1;
+		}
+	}
+
+	TArray<FS_BenchmarkResult> Results;
+	for (int32 NumPlanes = 1; NumPlanes <= FMath::Clamp(MaxPlanes, 1, FS_SliceKernel::MaxPlanes); NumPlanes++)
+	{
+		Results.Add(RunSlicing(FMath::Max(1, GridSize), NumPlanes, FMath::Max(1, NumWaves), FMath::Max(1, FramesPerWave)));
+	}
+
+	// The same prop cut at runtime then broken from its pre-fractured collection, with the same planes.
+	if (!FractureMeshPath.IsEmpty() || !FractureCollectionPath.IsEmpty())
+	{
+		UStaticMesh* FractureMesh = LoadObject<UStaticMesh>(nullptr, *FractureMeshPath);
+		UGeometryCollection* FractureCollection = LoadObject<UGeometryCollection>(nullptr, *FractureCollectionPath);
+		if (!FractureMesh || !FractureCollection)
+		{
+			UE_LOG(LogFZ5, Error, TEXT("Benchmark: cannot load the fracture mesh %s or collection %s"), *FractureMeshPath, *FractureCollectionPath);
+			return 1;
+		}
+
+		const int32 NumPlanes = FMath::Clamp(MaxPlanes, 1, FS_SliceKernel::MaxPlanes);
+		Results.Add(RunSlicing(FMath::Max(1, GridSize), NumPlanes, FMath::Max(1, NumWaves), FMath::Max(1, FramesPerWave), FractureMesh));
+		Results.Add(RunSlicing(FMath::Max(1, GridSize), NumPlanes, FMath::Max(1, NumWaves), FMath::Max(1, FramesPerWave), FractureMesh, FractureCollection));
+	}
+
+	if (NumPlayers > 0)
+		Results.Add(RunPlayers(NumPlayers, FMath::Max(1, PlayerFrames), PlayerClass));
+
+	if (NumBots > 0)
+		Results.Add(RunBots(NumBots, FMath::Max(1, BotFrames), PlayerClass));
+
+	if (RenderFragments > 0)
+		Results.Add(RunRenderBudget(RenderFragments, FMath::Max(1, RenderFrames), RenderTargetMs));
+
+	if (NumProps > 0)
+	{
+		Results.Add(RunProxies(NumProps, FMath::Max(1, PropFrames), false));
+		Results.Add(RunProxies(NumProps, FMath::Max(1, PropFrames), true));
+	}
+
+	for (const FS_BenchmarkResult& Result : Results)
+	{
+		UE_LOG(LogFZ5, Display, TEXT("%s: frame p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, %d slices at %.3f ms, %.1f bits/slice event, %.1f KB/min, %.1f bots/ms, memory %+.1f MB, peak %.1f MB"),
+			*Result.Name, Result.GetPercentile(50.0), Result.GetPercentile(95.0), Result.GetPercentile(99.0), Result.Slices, Result.GetMsPerSlice(),
+			Result.GetBitsPerSliceEvent(), Result.GetNetKBPerMinute(), Result.GetBotsPerMs(),
+			((double)Result.EndMemory - (double)Result.StartMemory) / (1024.0 * 1024.0), Result.PeakMemory / (1024.0 * 1024.0));
+	}
+
+	WriteResults(Results, OutputDir);
+
+	if (!BaselineFile.IsEmpty() && CompareWithBaseline(Results, BaselineFile, Tolerance) > 0) return 1;
+	return 0;
+}
+
+UWorld* US_BenchmarkCommandlet::CreateWorld() const
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("FZ5Benchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	const FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+
+	// A wide floor for the pieces and the players to land on.
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube"));
+	if (AStaticMeshActor* Floor = World->SpawnActor<AStaticMeshActor>(FVector(0.f, 0.f, -50.f), FRotator::ZeroRotator))
+	{
+		Floor->GetStaticMeshComponent()->SetMobility(EComponentMobility::Movable);
+		Floor->GetStaticMeshComponent()->SetStaticMesh(Cube);
+		Floor->SetActorScale3D(FVector(200.f, 200.f, 1.f));
+	}
+
+	return World;
+}
+
+void US_BenchmarkCommandlet::DestroyWorld(UWorld* World) const
+{
+	World->BeginTearingDown();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+void US_BenchmarkCommandlet::RunFrame(UWorld* World, FS_BenchmarkResult& Result, TFunctionRef<void()> Script) const
+{
+	const double StartTime = FPlatformTime::Seconds();
+	Script();
+	World->Tick(LEVELTICK_All, FrameDeltaTime);
+	GFrameCounter++;
+	Result.FrameTimes.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	Result.SimulatedSeconds += FrameDeltaTime;
+
+	if (const US_SliceSubsystem* SliceSubsystem = World->GetSubsystem<US_SliceSubsystem>())
+	{
+		Result.Slices += SliceSubsystem->GetFrameStats().Committed;
+		Result.SliceMs += SliceSubsystem->GetFrameStats().CommitTime * 1000.0;
+	}
+
+	// Counted even in a standalone world, as if a client were connected.
+	if (const US_SliceReplication* SliceReplication = World->GetSubsystem<US_SliceReplication>())
+	{
+		const FS_SliceNetStats& NetStats = SliceReplication->GetStats();
+		Result.NetEvents = NetStats.Events;
+		Result.NetEventBits = NetStats.EventBits;
+		Result.NetBits = NetStats.GetTotalBits();
+	}
+
+	if (const US_BotSubsystem* BotSubsystem = World->GetSubsystem<US_BotSubsystem>())
+	{
+		Result.BotSteps += BotSubsystem->GetLastSimulatedBots();
+		Result.BotMs += BotSubsystem->GetLastSimulationTime() * 1000.0;
+	}
+
+	const uint64 UsedMemory = FPlatformMemory::GetStats().UsedPhysical;
+	if (Result.StartMemory == 0) Result.StartMemory = UsedMemory;
+	Result.EndMemory = UsedMemory;
+	Result.PeakMemory = FMath::Max(Result.PeakMemory, UsedMemory);
+}
+
+FS_BenchmarkResult US_BenchmarkCommandlet::RunSlicing(int32 GridSize, int32 NumPlanes, int32 NumWaves, int32 FramesPerWave, UStaticMesh* Mesh, UGeometryCollection* Collection) const
+{
+	FS_BenchmarkResult Result;
+	Result.Name = FString::Printf(TEXT("Slicing_%dx%d_%dPlanes"), GridSize, GridSize, NumPlanes);
+	if (Mesh) Result.Name = FString::Printf(TEXT("%s_%s_%dx%d_%dPlanes"), Collection ? TEXT("Fracture") : TEXT("Slice"), *Mesh->GetName(), GridSize, GridSize, NumPlanes);
+
+	UWorld* World = CreateWorld();
+	US_SliceIndex* SliceIndex = World->GetSubsystem<US_SliceIndex>();
+	US_SliceProxies* SliceProxies = World->GetSubsystem<US_SliceProxies>();
+
+	const float Spacing = 300.f;
+	TArray<FVector> Centers;
+	for (int32 X = 0; X < GridSize; X++)
+	{
+		for (int32 Y = 0; Y < GridSize; Y++)
+		{
+			const FVector Center((X - GridSize * 0.5f) * Spacing, (Y - GridSize * 0.5f) * Spacing, 50.f);
+
+			// The prop is set before BeginPlay, which hands it to an instanced batch or registers its static mesh in the slice index.
+			AS_SlicedMesh* Sliceable = World->SpawnActorDeferred<AS_SlicedMesh>(AS_SlicedMesh::StaticClass(), FTransform(Center), nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			if (!Sliceable) continue;
+
+			if (Mesh) Sliceable->FindComponentByClass<UStaticMeshComponent>()->SetStaticMesh(Mesh);
+			Sliceable->SetFractureCollection(Collection);
+			Sliceable->FinishSpawning(FTransform(Center));
+			Centers.Add(Center);
+		}
+	}
+
+	// The same planes on every run, so the results can be compared.
+	FRandomStream Random(NumPlanes);
+	TArray<FPlane> Planes;
+	TArray<UPrimitiveComponent*> Candidates;
+
+	auto SliceWave = [&]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		for (const FVector& Center : Centers)
+		{
+			Planes.Reset();
+			for (int32 PlaneIndex = 0; PlaneIndex < NumPlanes; PlaneIndex++)
+			{
+				Planes.Emplace(Center + Random.GetUnitVector() * 10.f, Random.GetUnitVector());
+			}
+
+			// Every piece still around the cell is cut, the fragments of the previous waves included.
+			Candidates.Reset();
+			const FBox Region = FBox::BuildAABB(Center, FVector(Spacing * 0.5f));
+			for (const FPlane& Plane : Planes)
+			{
+				if (SliceProxies) SliceProxies->PromoteAlong(Region, Plane);
+				SliceIndex->QueryPlane(Region, Plane, Candidates);
+			}
+
+			for (UPrimitiveComponent* Component : TSet<UPrimitiveComponent*>(Candidates))
+			{
+				AS_SlicedMesh* Sliceable = AS_SlicedMesh::FromComponent(Component);
+				if (!Sliceable) continue;
+
+				if (NumPlanes == 1)
+					Sliceable->Slice(Component, Planes[0].GetOrigin(), Planes[0].GetNormal());
+				else
+					Sliceable->SliceMulti(Component, Planes);
+
+				// Geometry collections break right away, there is no commit to count.
+				if (Collection) Result.Slices++;
+			}
+		}
+
+		Result.SliceMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	};
+
+	for (int32 Wave = 0; Wave < NumWaves; Wave++)
+	{
+		for (int32 Frame = 0; Frame < FramesPerWave; Frame++)
+		{
+			RunFrame(World, Result, [&]()
+			{
+				if (Frame == 0 && SliceIndex) SliceWave();
+			});
+		}
+	}
+
+	DestroyWorld(World);
+	return Result;
+}
+
+FS_BenchmarkResult US_BenchmarkCommandlet::RunProxies(int32 NumProps, int32 NumFrames, bool bInstanced) const
+{
+	FS_BenchmarkResult Result;
+	Result.Name = FString::Printf(TEXT("Props_%d_%s"), NumProps, bInstanced ? TEXT("Instanced") : TEXT("Actors"));
+
+	// Read by every sliceable as it registers its components.
+	IConsoleVariable* ProxiesEnabled = IConsoleManager::Get().FindConsoleVariable(TEXT("fz5.Proxies.Enabled"));
+	const int32 WasEnabled = ProxiesEnabled ? ProxiesEnabled->GetInt() : 1;
+	if (ProxiesEnabled) ProxiesEnabled->Set(bInstanced ? 1 : 0, ECVF_SetByCode);
+
+	UWorld* World = CreateWorld();
+	const int32 Side = FMath::CeilToInt(FMath::Sqrt((float)NumProps));
+
+	// The first frame stands for the level load, the next ones for the cost of the props standing around.
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		RunFrame(World, Result, [&]()
+		{
+			if (Frame > 0) return;
+
+			for (int32 Index = 0; Index < NumProps; Index++)
+			{
+				const FVector Location((Index % Side - Side * 0.5f) * 150.f, (Index / Side - Side * 0.5f) * 150.f, 50.f);
+				World->SpawnActor<AS_SlicedMesh>(AS_SlicedMesh::StaticClass(), FTransform(Location));
+			}
+		});
+	}
+
+	int32 NumPrimitives = 0;
+	for (TObjectIterator<UPrimitiveComponent> It; It; ++It)
+	{
+		if (It->GetWorld() == World && It->IsRegistered()) NumPrimitives++;
+	}
+
+	const US_SliceProxies* SliceProxies = World->GetSubsystem<US_SliceProxies>();
+	UE_LOG(LogFZ5, Display, TEXT("%s: spawned in %.3f ms, %d registered primitives, %d batches"),
+		*Result.Name, Result.FrameTimes[0], NumPrimitives, SliceProxies ? SliceProxies->GetNumBatches() : 0);
+
+	DestroyWorld(World);
+	if (ProxiesEnabled) ProxiesEnabled->Set(WasEnabled, ECVF_SetByCode);
+	return Result;
+}
+
+FS_BenchmarkResult US_BenchmarkCommandlet::RunPlayers(int32 NumPlayers, int32 NumFrames, TSubclassOf<AS_Player> PlayerClass) const
+{
+	FS_BenchmarkResult Result;
+	Result.Name = FString::Printf(TEXT("Players_%d"), NumPlayers);
+
+	UWorld* World = CreateWorld();
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube"));
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	auto SpawnWall = [&](const FVector& Location, const FRotator& Rotation, const FVector& Scale)
+	{
+		if (AStaticMeshActor* Wall = World->SpawnActor<AStaticMeshActor>(Location, Rotation, SpawnParameters))
+		{
+			Wall->GetStaticMeshComponent()->SetMobility(EComponentMobility::Movable);
+			Wall->GetStaticMeshComponent()->SetStaticMesh(Cube);
+			Wall->SetActorScale3D(Scale);
+		}
+	};
+
+	// Each player runs along its own lane, between a side wall closing in on it and an end wall.
+	const float LaneSpacing = 600.f;
+	TArray<AS_Player*> Players;
+	TArray<FVector> Starts;
+	for (int32 PlayerIndex = 0; PlayerIndex < NumPlayers; PlayerIndex++)
+	{
+		const float LaneY = PlayerIndex * LaneSpacing;
+		SpawnWall(FVector(480.f, LaneY - 170.f, 200.f), FRotator(0.f, 15.f, 0.f), FVector(10.f, 0.2f, 4.f));
+		SpawnWall(FVector(1100.f, LaneY, 200.f), FRotator::ZeroRotator, FVector(0.2f, 3.f, 4.f));
+
+		const FVector Start(0.f, LaneY, 100.f);
+		AS_Player* Player = World->SpawnActor<AS_Player>(PlayerClass, Start, FRotator::ZeroRotator, SpawnParameters);
+		if (!Player) continue;
+
+		if (Player->GetClass() == AS_Player::StaticClass()) ApplyDefaultTuning(Player);
+		Player->SpawnDefaultController();
+		Player->MoveStart();
+
+		Players.Add(Player);
+		Starts.Add(Start);
+	}
+
+	// Staggered so the players do not all dash, jump and attack on the same frame.
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		RunFrame(World, Result, [&]()
+		{
+			for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); PlayerIndex++)
+			{
+				AS_Player* Player = Players[PlayerIndex];
+				if (!IsValid(Player) || !Player->GetController()) continue;
+
+				const int32 Step = (Frame + PlayerIndex * 7) % 120;
+				if (Step == 0 && (Frame + PlayerIndex * 7) % 360 == 0)
+					Player->SetActorLocationAndRotation(Starts[PlayerIndex], FRotator::ZeroRotator, false, nullptr, ETeleportType::TeleportPhysics);
+
+				Player->Move(FInputActionValue(FVector2D(0.f, 1.f)));
+
+				if (Step == 10) Player->Dash(FInputActionValue(true));
+				else if (Step == 40 || Step == 90) Player->JumpButton(FInputActionValue(true));
+				else if (Step == 70) Player->Attack(FInputActionValue(true));
+			}
+		});
+	}
+
+	DestroyWorld(World);
+	return Result;
+}
+
+FS_BenchmarkResult US_BenchmarkCommandlet::RunBots(int32 NumBots, int32 NumFrames, TSubclassOf<AS_Player> BotClass) const
+{
+	FS_BenchmarkResult Result;
+	Result.Name = FString::Printf(TEXT("Bots_%d"), NumBots);
+
+	UWorld* World = CreateWorld();
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube"));
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Walls scattered over the floor for the bots to run along, climb and turn away from.
+	FRandomStream Random(NumBots);
+	for (int32 WallIndex = 0; WallIndex < 64; WallIndex++)
+	{
+		const FVector Location(Random.FRandRange(-6000.f, 6000.f), Random.FRandRange(-6000.f, 6000.f), 200.f);
+		if (AStaticMeshActor* Wall = World->SpawnActor<AStaticMeshActor>(Location, FRotator(0.f, Random.FRandRange(0.f, 180.f), 0.f), SpawnParameters))
+		{
+			Wall->GetStaticMeshComponent()->SetMobility(EComponentMobility::Movable);
+			Wall->GetStaticMeshComponent()->SetStaticMesh(Cube);
+			Wall->SetActorScale3D(FVector(8.f, 0.2f, 4.f));
+		}
+	}
+
+	if (US_BotSubsystem* BotSubsystem = World->GetSubsystem<US_BotSubsystem>())
+	{
+		BotSubsystem->SpawnBots(NumBots, FVector::ZeroVector, 6000.f, BotClass);
+
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			RunFrame(World, Result, []() {});
+		}
+	}
+
+	DestroyWorld(World);
+	return Result;
+}
+
+FS_BenchmarkResult US_BenchmarkCommandlet::RunRenderBudget(int32 NumFragments, int32 NumFrames, float TargetGpuMs) const
+{
+	FS_BenchmarkResult Result;
+	Result.Name = FString::Printf(TEXT("RenderBudget_%d"), NumFragments);
+
+	struct FS_SyntheticFragment
+	{
+		FVector Location;
+		float Radius;
+		int32 NumTriangles;
+	};
+
+	FRandomStream Random(NumFragments);
+	TArray<FS_SyntheticFragment> Fragments;
+	for (int32 Index = 0; Index < NumFragments; Index++)
+	{
+		const float Radius = Random.FRandRange(2.f, 60.f);
+		Fragments.Add({ Random.GetUnitVector() * Random.FRandRange(0.f, 5000.f), Radius, (int32)(Radius * Radius * 0.5f) + 12 });
+	}
+
+	FS_RenderBudget Budget;
+	Budget.TargetGpuMs = TargetGpuMs;
+	const float HalfFov = FMath::DegreesToRadians(45.f);
+
+	// Two microseconds per draw and one per thousand triangles, shadows draw them again and Lumen adds half of it.
+	auto GetFragmentMs = [](const FS_SyntheticFragment& Fragment, const FS_RenderDecision& Decision)
+	{
+		if (!Decision.bVisible) return 0.0;
+		const double Triangles = Decision.bSimplified ? Fragment.NumTriangles / 8.0 : Fragment.NumTriangles;
+		return Triangles * 0.001 * 0.001 * (1.0 + (Decision.bCastShadow ? 1.0 : 0.0) + (Decision.bAffectLumen ? 0.5 : 0.0)) + 0.002;
+	};
+
+	int32 NumCulled = 0;
+	int32 NumSimplified = 0;
+	double GpuMs = 0.0;
+	double DecideMs = 0.0;
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		const float Angle = Frame * FrameDeltaTime * 0.5f;
+		const FVector ViewLocation(FMath::Cos(Angle) * 6000.f, FMath::Sin(Angle) * 6000.f, 500.f);
+
+		// The time of the previous frame drives this one, as the GPU time read in game does.
+		Budget.Adapt(GpuMs, FrameDeltaTime);
+		const FS_RenderThresholds Thresholds = Budget.GetThresholds();
+
+		const double StartTime = FPlatformTime::Seconds();
+		GpuMs = 0.0;
+		NumCulled = 0;
+		NumSimplified = 0;
+		for (const FS_SyntheticFragment& Fragment : Fragments)
+		{
+			FS_RenderFragment RenderFragment;
+			RenderFragment.ScreenSize = FS_RenderBudget::GetScreenSize(Fragment.Radius, FVector::Dist(ViewLocation, Fragment.Location), HalfFov);
+			RenderFragment.Volume = FMath::Cube(Fragment.Radius * 2.f / UE_SQRT_3);
+			RenderFragment.NumTriangles = Fragment.NumTriangles;
+
+			const FS_RenderDecision Decision = FS_RenderBudget::Decide(RenderFragment, Thresholds);
+			GpuMs += GetFragmentMs(Fragment, Decision);
+			NumCulled += Decision.bVisible ? 0 : 1;
+			NumSimplified += Decision.bSimplified ? 1 : 0;
+		}
+
+		DecideMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		Result.FrameTimes.Add(GpuMs);
+	}
+
+	UE_LOG(LogFZ5, Display, TEXT("%s: last frame %.3f ms of modelled GPU time for a %.3f ms target, thresholds scaled by %.2f, %d culled and %d simplified, %.3f ms deciding per frame"),
+		*Result.Name, GpuMs, TargetGpuMs, Budget.Scale, NumCulled, NumSimplified, DecideMs / NumFrames);
+	return Result;
+}
+
+void US_BenchmarkCommandlet::ApplyDefaultTuning(AS_Player* Player)
+{
+	Player->DashCooldown = 1.f;
+	Player->ParryCooldown = 1.f;
+	Player->ShootCooldown = 0.3f;
+	Player->SlashCooldown = 0.5f;
+	Player->DashingTime = 0.2f;
+	Player->ParryingTime = 0.3f;
+	Player->ShootingTime = 0.1f;
+	Player->SlashingTime = 0.2f;
+	Player->ShootCheckDistance = 5000.f;
+	Player->DashSpeed = 3000.f;
+	Player->Deceleration = 2048.f;
+	Player->SlideDeceleration = 500.f;
+	Player->WallCheckDistance = 100.f;
+	Player->MaxWallRunTime = 1.5f;
+	Player->MaxWallClimbTime = 1.f;
+	Player->WallJumpTime = 0.3f;
+	Player->WallForce = 1000.f;
+	Player->ApplyMovementTuning();
+}
+
+void US_BenchmarkCommandlet::WriteResults(const TArray<FS_BenchmarkResult>& Results, const FString& OutputDir)
+{
+	FString Csv = TEXT("Scenario,Frames,FrameP50Ms,FrameP95Ms,FrameP99Ms,Slices,MsPerSlice,BitsPerSliceEvent,NetKBPerMinute,BotsPerMs,MemoryDeltaMB,PeakMemoryMB\n");
+	TArray<TSharedPtr<FJsonValue>> Scenarios;
+
+	for (const FS_BenchmarkResult& Result : Results)
+	{
+		const double MemoryDelta = ((double)Result.EndMemory - (double)Result.StartMemory) / (1024.0 * 1024.0);
+		const double PeakMemory = Result.PeakMemory / (1024.0 * 1024.0);
+
+		Csv += FString::Printf(TEXT("%s,%d,%.4f,%.4f,%.4f,%d,%.4f,%.1f,%.2f,%.2f,%.2f,%.2f\n"), *Result.Name, Result.FrameTimes.Num(),
+			Result.GetPercentile(50.0), Result.GetPercentile(95.0), Result.GetPercentile(99.0), Result.Slices, Result.GetMsPerSlice(),
+			Result.GetBitsPerSliceEvent(), Result.GetNetKBPerMinute(), Result.GetBotsPerMs(), MemoryDelta, PeakMemory);
+
+		TSharedRef<FJsonObject> Scenario = MakeShared<FJsonObject>();
+		Scenario->SetStringField(TEXT("Scenario"), Result.Name);
+		Scenario->SetNumberField(TEXT("Frames"), Result.FrameTimes.Num());
+		Scenario->SetNumberField(TEXT("FrameP50Ms"), Result.GetPercentile(50.0));
+		Scenario->SetNumberField(TEXT("FrameP95Ms"), Result.GetPercentile(95.0));
+		Scenario->SetNumberField(TEXT("FrameP99Ms"), Result.GetPercentile(99.0));
+		Scenario->SetNumberField(TEXT("Slices"), Result.Slices);
+		Scenario->SetNumberField(TEXT("MsPerSlice"), Result.GetMsPerSlice());
+		Scenario->SetNumberField(TEXT("BitsPerSliceEvent"), Result.GetBitsPerSliceEvent());
+		Scenario->SetNumberField(TEXT("NetKBPerMinute"), Result.GetNetKBPerMinute());
+		Scenario->SetNumberField(TEXT("BotsPerMs"), Result.GetBotsPerMs());
+		Scenario->SetNumberField(TEXT("MemoryDeltaMB"), MemoryDelta);
+		Scenario->SetNumberField(TEXT("PeakMemoryMB"), PeakMemory);
+		Scenarios.Add(MakeShared<FJsonValueObject>(Scenario));
+	}
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetArrayField(TEXT("Scenarios"), Scenarios);
+
+	FString Json;
+	FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Json));
+
+	FFileHelper::SaveStringToFile(Csv, *(OutputDir / TEXT("Benchmark.csv")));
+	FFileHelper::SaveStringToFile(Json, *(OutputDir / TEXT("Benchmark.json")));
+	UE_LOG(LogFZ5, Display, TEXT("Benchmark results written to %s"), *OutputDir);
+}
+
+int32 US_BenchmarkCommandlet::CompareWithBaseline(const TArray<FS_BenchmarkResult>& Results, const FString& BaselineFile, float Tolerance)
+{
+	FString Json;
+	TSharedPtr<FJsonObject> Root;
+	if (!FFileHelper::LoadFileToString(Json, *BaselineFile) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root)
+	{
+		UE_LOG(LogFZ5, Error, TEXT("Benchmark: cannot read baseline %s"), *BaselineFile);
+		return 1;
+	}
+
+	TMap<FString, TSharedPtr<FJsonObject>> Baselines;
+	for (const TSharedPtr<FJsonValue>& Value : Root->GetArrayField(TEXT("Scenarios")))
+	{
+		const TSharedPtr<FJsonObject>& Scenario = Value->AsObject();
+		if (Scenario) Baselines.Add(Scenario->GetStringField(TEXT("Scenario")), Scenario);
+	}
+
+	// The median frame and the cost of a slice are compared, the tails are too noisy to gate on.
+	const double Limit = 1.0 + Tolerance / 100.0;
+	int32 NumRegressions = 0;
+	for (const FS_BenchmarkResult& Result : Results)
+	{
+		const TSharedPtr<FJsonObject>* Baseline = Baselines.Find(Result.Name);
+		if (!Baseline) continue;
+
+		auto Check = [&](const TCHAR* Field, double Value)
+		{
+			const double BaselineValue = (*Baseline)->GetNumberField(Field);
+			if (BaselineValue <= 0.0 || Value <= BaselineValue * Limit) return;
+
+			UE_LOG(LogFZ5, Error, TEXT("Benchmark: %s %s is %.3f, %.1f%% slower than the baseline %.3f"),
+				*Result.Name, Field, Value, (Value / BaselineValue - 1.0) * 100.0, BaselineValue);
+			NumRegressions++;
+		};
+
+		Check(TEXT("FrameP50Ms"), Result.GetPercentile(50.0));
+		Check(TEXT("MsPerSlice"), Result.GetMsPerSlice());
+	}
+
+	return NumRegressions;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "S_BenchmarkCommandlet.generated.h"
+
+class AS_Player;
+class UStaticMesh;
+class UGeometryCollection;
+
+/* Measurements of one benchmark scenario. */
+struct FS_BenchmarkResult
+{
+	FString Name;
+
+	// Game thread milliseconds of every frame, scripted actions included.
+	TArray<double> FrameTimes;
+
+	// Committed slices, or cuts of geometry collections, and the game thread time spent requesting and committing them.
+	int32 Slices = 0;
+	double SliceMs = 0.0;
+
+	// Physical memory used by the process, sampled every frame.
+	uint64 StartMemory = 0;
+	uint64 EndMemory = 0;
+	uint64 PeakMemory = 0;
+
+	// Bot steps of the bot subsystem and the time spent stepping them.
+	int64 BotSteps = 0;
+	double BotMs = 0.0;
+
+	// What slice replication would send for the scenario, slice events and fragment snapshots.
+	int32 NetEvents = 0;
+	int64 NetEventBits = 0;
+	int64 NetBits = 0;
+	double SimulatedSeconds = 0.0;
+
+	double GetPercentile(double Percent) const;
+	double GetMsPerSlice() const { return Slices > 0 ? SliceMs / Slices : 0.0; }
+	double GetBotsPerMs() const { return BotMs > 0.0 ? BotSteps / BotMs : 0.0; }
+	double GetBitsPerSliceEvent() const { return NetEvents > 0 ? (double)NetEventBits / NetEvents : 0.0; }
+	double GetNetKBPerMinute() const { return SimulatedSeconds > 0.0 ? NetBits / 8.0 / 1024.0 * 60.0 / SimulatedSeconds : 0.0; }
+};
+
+/*
+ * Scripted slicing and movement scenarios run headless, each in a fresh world with a fixed time step.
+ * UnrealEditor-Cmd Project_FZ5.uproject -run=S_Benchmark -nullrhi -unattended
+ *   [-Grid=6] [-MaxPlanes=4] [-Waves=4] [-FramesPerWave=30] [-Players=16] [-PlayerFrames=600] [-PlayerClass=/Game/...]
+ *   [-Bots=1000] [-BotFrames=600] [-RenderFragments=2000] [-RenderFrames=600] [-RenderTargetMs=4] [-Props=5000] [-PropFrames=120]
+ *   [-FractureMesh=/Game/... -FractureCollection=/Game/Fracture/...]
+ *   [-Output=Dir] [-Baseline=File.json] [-Tolerance=10]
+ * With a fracture mesh and its geometry collection, the same prop is also run sliced then fractured.
+ * Writes Benchmark.csv and Benchmark.json, and fails when a scenario is more than Tolerance percent slower than the baseline.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_BenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+	static constexpr float FrameDeltaTime = 1.f / 60.f;
+
+	UWorld* CreateWorld() const;
+	void DestroyWorld(UWorld* World) const;
+	void RunFrame(UWorld* World, FS_BenchmarkResult& Result, TFunctionRef<void()> Script) const;
+
+	/*
+	 * Grid of sliceables cut by waves of NumPlanes planes, the fragments of a wave being cut again by the next ones.
+	 * The sliceables show Mesh rather than the default cube when set, and break from Collection rather than slicing when set.
+	 */
+	FS_BenchmarkResult RunSlicing(int32 GridSize, int32 NumPlanes, int32 NumWaves, int32 FramesPerWave, UStaticMesh* Mesh = nullptr, UGeometryCollection* Collection = nullptr) const;
+
+	/* Players running the dash, wall run and wall climb state machine along walled lanes. */
+	FS_BenchmarkResult RunPlayers(int32 NumPlayers, int32 NumFrames, TSubclassOf<AS_Player> PlayerClass) const;
+
+	/* Bots of the bot subsystem wandering among walls, none of them promoted as no player is around. */
+	FS_BenchmarkResult RunBots(int32 NumBots, int32 NumFrames, TSubclassOf<AS_Player> BotClass) const;
+
+	/*
+	 * Fragments scattered around an orbiting view run through the render budget, without a world nor a GPU. The frame
+	 * times are the GPU cost modelled from the decisions, the budget adapting its thresholds to bring them under TargetGpuMs.
+	 */
+	FS_BenchmarkResult RunRenderBudget(int32 NumFragments, int32 NumFrames, float TargetGpuMs) const;
+
+	/* Untouched sliceables spawned on the first frame, drawn through instanced batches or by their own static mesh. */
+	FS_BenchmarkResult RunProxies(int32 NumProps, int32 NumFrames, bool bInstanced) const;
+
+	/* The tuning of the player blueprint, for when the native class is simulated. */
+	static void ApplyDefaultTuning(AS_Player* Player);
+
+	static void WriteResults(const TArray<FS_BenchmarkResult>& Results, const FString& OutputDir);
+
+	/* Number of scenarios slower than the baseline by more than Tolerance percent. */
+	static int32 CompareWithBaseline(const TArray<FS_BenchmarkResult>& Results, const FString& BaselineFile, float Tolerance);
+
+public:
+	US_BenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,550 @@
+#include "S_BotSubsystem.h"
+#include "S_Player.h"
+#include "S_MovementComponent.h"
+#include "Project_FZ5.h"
+#include "Async/ParallelFor.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Bot simulation"), STAT_FZ5_BotSimulation, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Bot actors"), STAT_FZ5_BotActors, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots"), STAT_FZ5_Bots, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Promoted bots"), STAT_FZ5_PromotedBots, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<int32> CVarBotsParallel(
+	TEXT("fz5.Bots.Parallel"),
+	1,
+	TEXT("Step the bots on worker threads, 0 to step them on the game thread."));
+
+static TAutoConsoleVariable<float> CVarBotsPromoteRadius(
+	TEXT("fz5.Bots.PromoteRadius"),
+	3000.f,
+	TEXT("Distance to a player under which a bot becomes a full character."));
+
+static TAutoConsoleVariable<float> CVarBotsDemoteRadius(
+	TEXT("fz5.Bots.DemoteRadius"),
+	4000.f,
+	TEXT("Distance to every player over which a promoted bot goes back to the arrays."));
+
+static TAutoConsoleVariable<int32> CVarBotsMaxPromoted(
+	TEXT("fz5.Bots.MaxPromoted"),
+	16,
+	TEXT("Maximum number of bots promoted to full characters at once."));
+
+static TAutoConsoleVariable<float> CVarBotsPromotionInterval(
+	TEXT("fz5.Bots.PromotionInterval"),
+	0.25f,
+	TEXT("Seconds between two checks of which bots are near a player."));
+
+
+void FS_BotTuning::ReadFrom(TSubclassOf<AS_Player> BotClass)
+{
+	// The native class has no tuning of its own, the values above stand for the blueprint ones.
+	if (!BotClass || BotClass == AS_Player::StaticClass()) return;
+
+	const AS_Player* Defaults = BotClass->GetDefaultObject<AS_Player>();
+	DashSpeed = Defaults->DashSpeed;
+	DashTime = Defaults->DashingTime;
+	DashCooldown = Defaults->DashCooldown;
+	SlashTime = Defaults->SlashingTime;
+	SlashCooldown = Defaults->SlashCooldown;
+	WallCheckDistance = Defaults->WallCheckDistance;
+	MaxWallRunTime = Defaults->MaxWallRunTime;
+	MaxWallClimbTime = Defaults->MaxWallClimbTime;
+	WallJumpTime = Defaults->WallJumpTime;
+	WallForce = Defaults->WallForce;
+
+	if (const US_MovementComponent* Movement = Cast<US_MovementComponent>(Defaults->GetCharacterMovement()))
+	{
+		WallRunSpeed = Movement->WallRunSpeed;
+		WallClimbSpeed = Movement->WallClimbSpeed;
+		WallResetJumpSpeed = Movement->WallResetJumpSpeed;
+		MaxWalkSpeed = Movement->MaxWalkSpeed;
+		MaxAcceleration = Movement->MaxAcceleration;
+		AirControl = Movement->AirControl;
+		JumpZVelocity = Movement->JumpZVelocity;
+		GravityScale = Movement->GravityScale;
+		Mass = Movement->Mass;
+		Deceleration = Movement->BrakingDecelerationWalking;
+	}
+
+	if (Defaults->Deceleration > 0.f)
+		Deceleration = Defaults->Deceleration;
+
+	if (const UCapsuleComponent* Capsule = Defaults->GetCapsuleComponent())
+		HalfHeight = Capsule->GetUnscaledCapsuleHalfHeight();
+}
+
+void FS_BotTuning::ApplyTo(AS_Player* Player) const
+{
+	Player->DashSpeed = DashSpeed;
+	Player->DashingTime = DashTime;
+	Player->DashCooldown = DashCooldown;
+	Player->SlashingTime = SlashTime;
+	Player->SlashCooldown = SlashCooldown;
+	Player->Deceleration = Deceleration;
+	Player->WallCheckDistance = WallCheckDistance;
+	Player->MaxWallRunTime = MaxWallRunTime;
+	Player->MaxWallClimbTime = MaxWallClimbTime;
+	Player->WallJumpTime = WallJumpTime;
+	Player->WallForce = WallForce;
+	Player->ApplyMovementTuning();
+}
+
+void US_BotSubsystem::Deinitialize()
+{
+	RemoveBots();
+
+	Super::Deinitialize();
+}
+
+TStatId US_BotSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_BotSubsystem, STATGROUP_Tickables);
+}
+
+void US_BotSubsystem::SpawnBots(int32 Count, const FVector& Center, float Radius, TSubclassOf<AS_Player> InBotClass)
+{
+	if (Count <= 0) return;
+
+	if (InBotClass != BotClass || Locations.Num() == 0)
+	{
+		BotClass = InBotClass ? InBotClass : TSubclassOf<AS_Player>(AS_Player::StaticClass());
+		Tuning = FS_BotTuning();
+		Tuning.ReadFrom(BotClass);
+		Tuning.GravityZ = GetWorld()->GetGravityZ() * Tuning.GravityScale;
+	}
+
+	const int32 First = Locations.Num();
+	const int32 NewNum = First + Count;
+	Locations.Reserve(NewNum);
+
+	for (int32 Index = First; Index < NewNum; Index++)
+	{
+		// Seeded by index so a run can be compared with the previous ones.
+		FRandomStream Random(Index);
+		const FVector Home = Center + FVector(Random.GetUnitVector2D() * Random.FRandRange(0.f, Radius), 0.f);
+
+		FHitResult Hit;
+		const float GroundHeight = TraceBot(Home + FVector(0.f, 0.f, 1000.f), Home - FVector(0.f, 0.f, 5000.f), Hit) ? Hit.ImpactPoint.Z : Center.Z;
+
+		Locations.Add(FVector(Home.X, Home.Y, GroundHeight + Tuning.HalfHeight));
+		Velocities.Add(FVector::ZeroVector);
+		Yaws.Add(Random.FRandRange(-180.f, 180.f));
+		GroundHeights.Add(GroundHeight);
+		States.Add(NEUTRAL);
+		StateTimes.Add(0.f);
+		WallJumpTimes.Add(0.f);
+		DashDirections.Add(FVector::ForwardVector);
+		WallNormals.Add(FVector::ZeroVector);
+		LastWallNormals.Add(FVector::ZeroVector);
+		WallResets.Add(false);
+		Cooldowns.AddDefaulted();
+		Homes.Add(Home);
+		Targets.Add(Home);
+		ThinkTimes.Add(Random.FRand());
+		Intents.Add(0);
+		Randoms.Add(Random);
+		Actors.Add(nullptr);
+	}
+
+	SET_DWORD_STAT(STAT_FZ5_Bots, Locations.Num());
+}
+
+void US_BotSubsystem::RemoveBots()
+{
+	for (int32 Index = 0; Index < Actors.Num(); Index++)
+	{
+		if (Actors[Index]) Demote(Index);
+	}
+
+	Locations.Empty();
+	Velocities.Empty();
+	Yaws.Empty();
+	GroundHeights.Empty();
+	States.Empty();
+	StateTimes.Empty();
+	WallJumpTimes.Empty();
+	DashDirections.Empty();
+	WallNormals.Empty();
+	LastWallNormals.Empty();
+	WallResets.Empty();
+	Cooldowns.Empty();
+	Homes.Empty();
+	Targets.Empty();
+	ThinkTimes.Empty();
+	Intents.Empty();
+	Randoms.Empty();
+	Actors.Empty();
+	NumPromoted = 0;
+
+	SET_DWORD_STAT(STAT_FZ5_Bots, 0);
+	SET_DWORD_STAT(STAT_FZ5_PromotedBots, 0);
+}
+
+bool US_BotSubsystem::TraceBot(const FVector& Start, const FVector& End, FHitResult& OutHit) const
+{
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(FZ5BotTrace), false);
+	return GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, Params);
+}
+
+void US_BotSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Locations.Num() == 0) return;
+
+	const double StartTime = FPlatformTime::Seconds();
+	{
+		FZ5_SCOPE(BotSimulation);
+
+		const float Now = GetWorld()->GetTimeSeconds();
+		const EParallelForFlags Flags = CVarBotsParallel.GetValueOnGameThread() ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+		ParallelFor(TEXT("FZ5Bots"), Locations.Num(), 64, [this, DeltaTime, Now](int32 Index)
+		{
+			SimulateBot(Index, DeltaTime, Now);
+		}, Flags);
+	}
+	LastSimulatedBots = Locations.Num();
+	LastSimulationTime = FPlatformTime::Seconds() - StartTime;
+
+	DriveActors();
+
+	PromotionTime -= DeltaTime;
+	if (PromotionTime <= 0.f)
+	{
+		PromotionTime = CVarBotsPromotionInterval.GetValueOnGameThread();
+		UpdatePromotion();
+	}
+}
+#pragma region SIMULATION...
+void US_BotSubsystem::SimulateBot(int32 Index, float DeltaTime, float Now)
+{
+	FVector& Location = Locations[Index];
+	FRandomStream& Random = Randoms[Index];
+
+	// A new goal once in a while, and a few actions drawn at the same time.
+	Intents[Index] = 0;
+	ThinkTimes[Index] -= DeltaTime;
+	if (ThinkTimes[Index] <= 0.f)
+	{
+		ThinkTimes[Index] = Random.FRandRange(0.3f, 1.2f);
+
+		FHitResult Hit;
+		const FVector Ahead = (Targets[Index] - Location).GetSafeNormal2D() * Tuning.WallCheckDistance * 2.f;
+		if (FVector::DistSquared2D(Targets[Index], Location) < FMath::Square(100.f) || TraceBot(Location, Location + Ahead, Hit))
+			Targets[Index] = Homes[Index] + FVector(Random.GetUnitVector2D() * Random.FRandRange(500.f, 2000.f), 0.f);
+
+		if (Random.FRand() < 0.3f) Intents[Index] |= Intent_Dash;
+		if (Random.FRand() < 0.3f) Intents[Index] |= Intent_Jump;
+		if (Random.FRand() < 0.2f) Intents[Index] |= Intent_Attack;
+
+		// The ground under the bot, walls and ledges included.
+		if (!Actors[Index] && TraceBot(Location, Location - FVector(0.f, 0.f, 5000.f), Hit))
+			GroundHeights[Index] = Hit.ImpactPoint.Z;
+	}
+
+	const FVector MoveDir = (Targets[Index] - Location).GetSafeNormal2D();
+	if (!MoveDir.IsZero()) Yaws[Index] = MoveDir.Rotation().Yaw;
+
+	// The actor of a promoted bot acts on the intents on the game thread.
+	if (!Actors[Index])
+		StepMovement(Index, DeltaTime, Now, MoveDir);
+}
+
+void US_BotSubsystem::StepMovement(int32 Index, float DeltaTime, float Now, const FVector& MoveDir)
+{
+	FVector& Location = Locations[Index];
+	FVector& Velocity = Velocities[Index];
+	uint8& BotState = States[Index];
+	float& StateTime = StateTimes[Index];
+	FVector& WallNormal = WallNormals[Index];
+	FS_CooldownTable& Cooldown = Cooldowns[Index];
+	const uint8 Intent = Intents[Index];
+
+	const FVector Forward = FRotator(0.f, Yaws[Index], 0.f).Vector();
+	const FVector Right = FVector::CrossProduct(FVector::UpVector, Forward);
+	const float GroundZ = GroundHeights[Index] + Tuning.HalfHeight;
+	const bool bGrounded = Location.Z <= GroundZ + 1.f && Velocity.Z <= 0.f;
+	const bool bOnWall = BotState == WALLRUN || BotState == WALLCLIMB;
+	WallJumpTimes[Index] = FMath::Max(0.f, WallJumpTimes[Index] - DeltaTime);
+
+	// The same rules as US_MovementComponent, on line traces from the center of the bot.
+	FHitResult Hit;
+	auto FindRunWall = [&]() -> bool
+	{
+		if (!TraceBot(Location, Location - Right * Tuning.WallCheckDistance, Hit) && !TraceBot(Location, Location + Right * Tuning.WallCheckDistance, Hit))
+			return false;
+
+		const float Dot = FVector::DotProduct(Hit.ImpactNormal, Forward);
+		return Hit.ImpactNormal != LastWallNormals[Index] && Dot < -0.1f && Dot > -0.7f;
+	};
+	auto FindClimbWall = [&]() -> bool
+	{
+		return TraceBot(Location, Location + Forward * Tuning.WallCheckDistance, Hit) && FVector::DotProduct(Hit.ImpactNormal, Forward) <= -0.7f;
+	};
+
+	if (Intent & Intent_Attack && Cooldown.IsActionReady(SLASH, Now))
+	{
+		Cooldown.StartAction(SLASH, Now, Tuning.SlashTime, Tuning.SlashCooldown);
+		Cooldown.ResetState(DASH);
+		if (bOnWall) BotState = NEUTRAL;
+	}
+
+	if (Intent & Intent_Jump)
+	{
+		if (bOnWall || (WallResets[Index] && FindClimbWall()))
+		{
+			if (!bOnWall) WallNormal = Hit.ImpactNormal;
+
+			if (WallResets[Index]) Velocity = FVector::UpVector * Tuning.WallResetJumpSpeed;
+			else Velocity.Z = 0.f;
+
+			Velocity += (WallNormal + FVector::UpVector).GetSafeNormal() * Tuning.WallForce / Tuning.Mass;
+			LastWallNormals[Index] = WallNormal;
+			WallResets[Index] = false;
+			WallJumpTimes[Index] = Tuning.WallJumpTime;
+			BotState = NEUTRAL;
+			Cooldown.LockState(DASH);
+			Cooldown.ReleaseState(DASH, Now, Tuning.WallJumpTime);
+		}
+		else if (!MoveDir.IsZero() && FindRunWall())
+		{
+			WallNormal = Hit.ImpactNormal;
+			StateTime = Tuning.MaxWallRunTime;
+			WallResets[Index] = false;
+			BotState = WALLRUN;
+			Cooldown.ResetState(DASH);
+		}
+		else if (!MoveDir.IsZero() && bGrounded && FindClimbWall())
+		{
+			WallNormal = Hit.ImpactNormal;
+			StateTime = Tuning.MaxWallClimbTime;
+			WallResets[Index] = false;
+			BotState = WALLCLIMB;
+		}
+		else if (bGrounded)
+		{
+			Velocity.Z = Tuning.JumpZVelocity;
+		}
+	}
+
+	if (Intent & Intent_Dash && BotState != DASH && Cooldown.IsStateReady(DASH, Now))
+	{
+		if (WallJumpTimes[Index] > 0.f)
+		{
+			WallResets[Index] = true;
+			WallJumpTimes[Index] = 0.f;
+		}
+
+		DashDirections[Index] = MoveDir.IsZero() ? Forward : MoveDir;
+		StateTime = Tuning.DashTime;
+		Velocity.Z = 0.f;
+		BotState = DASH;
+		Cooldown.LockState(DASH);
+	}
+
+	const float Gravity = Tuning.GravityZ * DeltaTime;
+	switch (BotState)
+	{
+	case DASH:
+		Velocity = DashDirections[Index] * Tuning.DashSpeed + FVector::UpVector * (bGrounded ? 0.f : Velocity.Z + Gravity);
+		StateTime -= DeltaTime;
+		if (StateTime <= 0.f)
+		{
+			BotState = NEUTRAL;
+			Cooldown.ReleaseState(DASH, Now, Tuning.DashCooldown);
+		}
+		break;
+
+	case WALLRUN:
+		StateTime -= DeltaTime;
+		if (StateTime <= 0.f || !FindRunWall())
+		{
+			LastWallNormals[Index] = WallNormal;
+			BotState = NEUTRAL;
+			break;
+		}
+		else
+		{
+			WallNormal = Hit.ImpactNormal;
+			FVector Along = FVector::CrossProduct(WallNormal, FVector::UpVector).GetSafeNormal();
+			if (FVector::DotProduct(Along, Forward) < 0.f) Along = -Along;
+
+			const float Speed = FMath::Max(Tuning.WallRunSpeed, Velocity.Size2D());
+			Velocity = Along * Speed + FVector::UpVector * FMath::Max(0.f, Velocity.Z + Gravity);
+		}
+		break;
+
+	case WALLCLIMB:
+		StateTime -= DeltaTime;
+		if (StateTime <= 0.f || !FindClimbWall())
+		{
+			BotState = NEUTRAL;
+			break;
+		}
+
+		WallNormal = Hit.ImpactNormal;
+		Velocity = FVector::UpVector * Tuning.WallClimbSpeed;
+		break;
+
+	default:
+	{
+		// Walking toward the goal, with little control in the air.
+		const FVector Horizontal(Velocity.X, Velocity.Y, 0.f);
+		const FVector Wanted = MoveDir * Tuning.MaxWalkSpeed;
+		const float MaxChange = (bGrounded ? (MoveDir.IsZero() ? Tuning.Deceleration : Tuning.MaxAcceleration) : Tuning.MaxAcceleration * Tuning.AirControl) * DeltaTime;
+		const FVector NewHorizontal = Horizontal + (Wanted - Horizontal).GetClampedToMaxSize(MaxChange);
+		Velocity = FVector(NewHorizontal.X, NewHorizontal.Y, bGrounded ? FMath::Max(0.f, Velocity.Z) : Velocity.Z + Gravity);
+		break;
+	}
+	}
+
+	Location += Velocity * DeltaTime;
+
+	if (Location.Z < GroundZ)
+	{
+		// Landed, which frees the last wall and the wall jump granted by a dash.
+		Location.Z = GroundZ;
+		Velocity.Z = 0.f;
+		LastWallNormals[Index] = FVector::UpVector;
+		WallResets[Index] = false;
+		if (BotState == WALLRUN || BotState == WALLCLIMB) BotState = NEUTRAL;
+	}
+}
+#pragma endregion
+
+#pragma region PROMOTION...
+void US_BotSubsystem::DriveActors()
+{
+	if (NumPromoted == 0) return;
+
+	FZ5_SCOPE(BotActors);
+
+	for (int32 Index = 0; Index < Actors.Num(); Index++)
+	{
+		AS_Player* Actor = Actors[Index];
+		if (!Actor) continue;
+
+		if (!IsValid(Actor) || !Actor->GetController())
+		{
+			Actors[Index] = nullptr;
+			NumPromoted--;
+			continue;
+		}
+
+		// Through the input handlers, so the actor goes through the same checks as a player.
+		Actor->GetController()->SetControlRotation(FRotator(0.f, Yaws[Index], 0.f));
+		if (!(Targets[Index] - Locations[Index]).IsNearlyZero(100.f))
+			Actor->Move(FInputActionValue(FVector2D(0.f, 1.f)));
+
+		if (Intents[Index] & Intent_Dash) Actor->Dash(FInputActionValue(true));
+		if (Intents[Index] & Intent_Jump) Actor->JumpButton(FInputActionValue(true));
+		if (Intents[Index] & Intent_Attack) Actor->Attack(FInputActionValue(true));
+
+		Locations[Index] = Actor->GetActorLocation();
+		Velocities[Index] = Actor->GetVelocity();
+	}
+
+	SET_DWORD_STAT(STAT_FZ5_PromotedBots, NumPromoted);
+}
+
+void US_BotSubsystem::UpdatePromotion()
+{
+	TArray<FVector> PlayerLocations;
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		if (const APawn* Pawn = Iterator->Get() ? Iterator->Get()->GetPawn() : nullptr)
+			PlayerLocations.Add(Pawn->GetActorLocation());
+	}
+
+	const float PromoteRadiusSquared = FMath::Square(CVarBotsPromoteRadius.GetValueOnGameThread());
+	const float DemoteRadiusSquared = FMath::Square(FMath::Max(CVarBotsDemoteRadius.GetValueOnGameThread(), CVarBotsPromoteRadius.GetValueOnGameThread()));
+	const int32 MaxPromoted = CVarBotsMaxPromoted.GetValueOnGameThread();
+
+	for (int32 Index = 0; Index < Locations.Num(); Index++)
+	{
+		float ClosestSquared = MAX_flt;
+		for (const FVector& PlayerLocation : PlayerLocations)
+		{
+			ClosestSquared = FMath::Min(ClosestSquared, (float)FVector::DistSquared(Locations[Index], PlayerLocation));
+		}
+
+		if (Actors[Index] && ClosestSquared > DemoteRadiusSquared)
+			Demote(Index);
+		else if (!Actors[Index] && ClosestSquared < PromoteRadiusSquared && NumPromoted < MaxPromoted)
+			Promote(Index);
+	}
+
+	SET_DWORD_STAT(STAT_FZ5_PromotedBots, NumPromoted);
+}
+
+void US_BotSubsystem::Promote(int32 Index)
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	AS_Player* Actor = GetWorld()->SpawnActor<AS_Player>(BotClass, Locations[Index], FRotator(0.f, Yaws[Index], 0.f), SpawnParameters);
+	if (!Actor) return;
+
+	if (BotClass == AS_Player::StaticClass()) Tuning.ApplyTo(Actor);
+	Actor->SpawnDefaultController();
+	Actor->MoveStart();
+	Actor->GetCharacterMovement()->Velocity = Velocities[Index];
+
+	Actors[Index] = Actor;
+	NumPromoted++;
+}
+
+void US_BotSubsystem::Demote(int32 Index)
+{
+	AS_Player* Actor = Actors[Index];
+	Actors[Index] = nullptr;
+	NumPromoted--;
+
+	if (!IsValid(Actor)) return;
+
+	// The arrays carry on from where the actor is, in the air or on the ground.
+	Locations[Index] = Actor->GetActorLocation();
+	Velocities[Index] = Actor->GetVelocity();
+	States[Index] = NEUTRAL;
+
+	if (AController* Controller = Actor->GetController())
+		Controller->Destroy();
+	Actor->Destroy();
+}
+#pragma endregion
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs SpawnBotsCommand(
+	TEXT("fz5.Bots.Spawn"),
+	TEXT("Add bots around the first player, moving as the given player class. Arguments: [Count=100] [Radius=5000] [Class=/Game/...]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		US_BotSubsystem* BotSubsystem = World ? World->GetSubsystem<US_BotSubsystem>() : nullptr;
+		if (!BotSubsystem) return;
+
+		const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100;
+		const float Radius = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 5000.f;
+		TSubclassOf<AS_Player> BotClass = Args.Num() > 2 ? LoadClass<AS_Player>(nullptr, *Args[2]) : nullptr;
+
+		const APlayerController* PlayerController = World->GetFirstPlayerController();
+		const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		if (!BotClass && Pawn) BotClass = Cast<AS_Player>(Pawn) ? Pawn->GetClass() : nullptr;
+
+		BotSubsystem->SpawnBots(Count, Pawn ? Pawn->GetActorLocation() : FVector::ZeroVector, Radius, BotClass);
+		UE_LOG(LogFZ5, Display, TEXT("%d bots, %d promoted"), BotSubsystem->GetNumBots(), BotSubsystem->GetNumPromoted());
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs RemoveBotsCommand(
+	TEXT("fz5.Bots.Remove"),
+	TEXT("Remove every bot."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (US_BotSubsystem* BotSubsystem = World ? World->GetSubsystem<US_BotSubsystem>() : nullptr)
+			BotSubsystem->RemoveBots();
+	}));
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_CooldownTable.h"
+#include "S_BotSubsystem.generated.h"
+
+class AS_Player;
+
+/* The tuning of AS_Player the bots move with, read from the defaults of the bot class. */
+struct FS_BotTuning
+{
+	float DashSpeed = 3000.f;
+	float DashTime = 0.2f;
+	float DashCooldown = 1.f;
+	float SlashTime = 0.2f;
+	float SlashCooldown = 0.5f;
+	float Deceleration = 2048.f;
+	float WallCheckDistance = 100.f;
+	float MaxWallRunTime = 1.5f;
+	float MaxWallClimbTime = 1.f;
+	float WallRunSpeed = 600.f;
+	float WallClimbSpeed = 600.f;
+	float WallJumpTime = 0.3f;
+	float WallForce = 1000.f;
+	float WallResetJumpSpeed = 600.f;
+
+	// Character movement and capsule.
+	float MaxWalkSpeed = 600.f;
+	float MaxAcceleration = 2048.f;
+	float AirControl = 0.05f;
+	float JumpZVelocity = 420.f;
+	float GravityScale = 1.f;
+	float GravityZ = -980.f;
+	float Mass = 100.f;
+	float HalfHeight = 88.f;
+
+	void ReadFrom(TSubclassOf<AS_Player> BotClass);
+
+	/* Give a native AS_Player, which has no tuning of its own, the values above. */
+	void ApplyTo(AS_Player* Player) const;
+};
+
+/*
+ * Bots run by the player state machine on contiguous arrays, one element per bot in each, stepped in parallel.
+ * Bots near a player are promoted to a full AS_Player actor driven by the same decisions, and demoted when far again.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_BotSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	enum EIntent : uint8 { Intent_Dash = 1 << 0, Intent_Jump = 1 << 1, Intent_Attack = 1 << 2 };
+
+	TSubclassOf<AS_Player> BotClass;
+	FS_BotTuning Tuning;
+
+	// Movement.
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	TArray<float> Yaws;
+	TArray<float> GroundHeights;
+
+	// State machine, State values, with the time left in the dash, wall run or wall climb.
+	TArray<uint8> States;
+	TArray<float> StateTimes;
+	TArray<float> WallJumpTimes;
+	TArray<FVector> DashDirections;
+	TArray<FVector> WallNormals;
+	TArray<FVector> LastWallNormals;
+	TArray<bool> WallResets;
+	TArray<FS_CooldownTable> Cooldowns;
+
+	// Decisions.
+	TArray<FVector> Homes;
+	TArray<FVector> Targets;
+	TArray<float> ThinkTimes;
+	TArray<uint8> Intents;
+	TArray<FRandomStream> Randoms;
+
+	/* Actor of each promoted bot, null while the bot is simulated here. */
+	UPROPERTY(Transient)
+	TArray<AS_Player*> Actors;
+
+	float PromotionTime = 0.f;
+	int32 NumPromoted = 0;
+
+	int32 LastSimulatedBots = 0;
+	double LastSimulationTime = 0.0;
+
+	bool TraceBot(const FVector& Start, const FVector& End, FHitResult& OutHit) const;
+
+	/* Decide where to go and what to do, then step the state machine unless the bot is promoted. */
+	void SimulateBot(int32 Index, float DeltaTime, float Now);
+	void StepMovement(int32 Index, float DeltaTime, float Now, const FVector& MoveDir);
+
+	/* Feed the decisions to the promoted actors and read back where they went. */
+	void DriveActors();
+
+	void UpdatePromotion();
+	void Promote(int32 Index);
+	void Demote(int32 Index);
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Add Count bots wandering around Center, moving as BotClass does. */
+	void SpawnBots(int32 Count, const FVector& Center, float Radius, TSubclassOf<AS_Player> InBotClass);
+	void RemoveBots();
+
+	int32 GetNumBots() const { return Locations.Num(); }
+	int32 GetNumPromoted() const { return NumPromoted; }
+
+	/* Bots stepped by the last tick and the time it took, promoted ones included. */
+	int32 GetLastSimulatedBots() const { return LastSimulatedBots; }
+	double GetLastSimulationTime() const { return LastSimulationTime; }
+};
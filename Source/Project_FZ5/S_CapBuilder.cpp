@@ -0,0 +1,583 @@
+#include "S_CapBuilder.h"
+
+
+namespace
+{
+	/* Sweep order, from top to bottom and left to right on the same height. */
+	bool IsAbove(const FVector2D& A, const FVector2D& B)
+	{
+		return A.Y > B.Y || (A.Y == B.Y && A.X < B.X);
+	}
+
+	/* Positive when A, B, C turn counterclockwise. */
+	double Orient(const FVector2D& A, const FVector2D& B, const FVector2D& C)
+	{
+		return (B.X - A.X) * (C.Y - A.Y) - (B.Y - A.Y) * (C.X - A.X);
+	}
+
+	/* X of the edge between A and B at height Y. */
+	double EdgeXAt(const FVector2D& A, const FVector2D& B, double Y)
+	{
+		if (A.Y == B.Y) return FMath::Max(A.X, B.X);
+		return A.X + (B.X - A.X) * (Y - A.Y) / (B.Y - A.Y);
+	}
+
+	void AddTriangle(TArrayView<const FVector2D> Points, int32 A, int32 B, int32 C, TArray<uint32>& OutTriangles)
+	{
+		const double Area = Orient(Points[A], Points[B], Points[C]);
+		if (Area == 0.0) return;
+		if (Area < 0.0) Swap(B, C);
+
+		OutTriangles.Add(A);
+		OutTriangles.Add(B);
+		OutTriangles.Add(C);
+	}
+
+	/* Stack triangulation of a y-monotone polygon given counterclockwise. */
+	void TriangulateMonotone(TArrayView<const FVector2D> Points, TArrayView<const int32> Polygon, TArray<uint32>& OutTriangles)
+	{
+		const int32 Num = Polygon.Num();
+		if (Num < 3) return;
+		if (Num == 3)
+		{
+			AddTriangle(Points, Polygon[0], Polygon[1], Polygon[2], OutTriangles);
+			return;
+		}
+
+		int32 Top = 0;
+		for (int32 Index = 1; Index < Num; Index++)
+		{
+			if (IsAbove(Points[Polygon[Index]], Points[Polygon[Top]])) Top = Index;
+		}
+
+		// Going forward from the top runs down the left chain, going backward down the right one. Merge them by height.
+		TArray<TPair<int32, bool>, TInlineAllocator<64>> Sorted;
+		Sorted.Reserve(Num);
+		Sorted.Emplace(Polygon[Top], true);
+		int32 Left = (Top + 1) % Num;
+		int32 Right = (Top + Num - 1) % Num;
+		while (Sorted.Num() < Num)
+		{
+			if (Left == Right || IsAbove(Points[Polygon[Left]], Points[Polygon[Right]]))
+			{
+				Sorted.Emplace(Polygon[Left], true);
+				Left = (Left + 1) % Num;
+			}
+			else
+			{
+				Sorted.Emplace(Polygon[Right], false);
+				Right = (Right + Num - 1) % Num;
+			}
+		}
+
+		TArray<TPair<int32, bool>, TInlineAllocator<64>> Stack;
+		Stack.Add(Sorted[0]);
+		Stack.Add(Sorted[1]);
+
+		for (int32 Index = 2; Index < Num - 1; Index++)
+		{
+			const TPair<int32, bool> Vertex = Sorted[Index];
+			if (Vertex.Value != Stack.Last().Value)
+			{
+				// Across the polygon, every vertex on the stack sees this one.
+				for (int32 StackIndex = 0; StackIndex + 1 < Stack.Num(); StackIndex++)
+					AddTriangle(Points, Vertex.Key, Stack[StackIndex].Key, Stack[StackIndex + 1].Key, OutTriangles);
+
+				const TPair<int32, bool> Previous = Stack.Last();
+				Stack.Reset();
+				Stack.Add(Previous);
+				Stack.Add(Vertex);
+				continue;
+			}
+
+			// Along the same chain, only the vertices past a convex corner are seen.
+			TPair<int32, bool> Last = Stack.Pop(false);
+			while (Stack.Num() > 0)
+			{
+				const double Turn = Orient(Points[Stack.Last().Key], Points[Last.Key], Points[Vertex.Key]);
+				if (Vertex.Value ? Turn <= 0.0 : Turn >= 0.0) break;
+
+				AddTriangle(Points, Vertex.Key, Last.Key, Stack.Last().Key, OutTriangles);
+				Last = Stack.Pop(false);
+			}
+			Stack.Add(Last);
+			Stack.Add(Vertex);
+		}
+
+		const int32 Bottom = Sorted.Last().Key;
+		for (int32 StackIndex = 0; StackIndex + 1 < Stack.Num(); StackIndex++)
+			AddTriangle(Points, Bottom, Stack[StackIndex].Key, Stack[StackIndex + 1].Key, OutTriangles);
+	}
+
+	/* Drop the loop vertices closer than Tolerance to the segment between their neighbours, a loop keeps three at least. */
+	void SimplifyLoops(TArrayView<const FVector2D> Points, double Tolerance, TArray<int32>& LoopVertices, TArray<int32>& LoopStarts)
+	{
+		TArray<int32> Kept;
+		Kept.Reserve(LoopVertices.Num());
+		for (int32 Loop = 0; Loop < LoopStarts.Num(); Loop++)
+		{
+			const int32 First = LoopStarts[Loop];
+			const int32 End = Loop + 1 < LoopStarts.Num() ? LoopStarts[Loop + 1] : LoopVertices.Num();
+			const int32 KeptStart = Kept.Num();
+			for (int32 Index = First; Index < End; Index++)
+			{
+				if (Kept.Num() - KeptStart + End - Index <= 3)
+				{
+					Kept.Add(LoopVertices[Index]);
+					continue;
+				}
+
+				const FVector2D& Previous = Points[Kept.Num() > KeptStart ? Kept.Last() : LoopVertices[End - 1]];
+				const FVector2D& Next = Points[Index + 1 < End ? LoopVertices[Index + 1] : Kept[KeptStart]];
+				const FVector2D& Point = Points[LoopVertices[Index]];
+
+				const FVector2D Segment = Next - Previous;
+				const double LengthSquared = Segment.SizeSquared();
+				const double Alpha = LengthSquared > 0.0 ? FMath::Clamp(((Point - Previous) | Segment) / LengthSquared, 0.0, 1.0) : 0.0;
+				if (FVector2D::DistSquared(Point, Previous + Segment * Alpha) > Tolerance * Tolerance)
+					Kept.Add(LoopVertices[Index]);
+			}
+			LoopStarts[Loop] = KeptStart;
+		}
+		LoopVertices = MoveTemp(Kept);
+	}
+
+	/* Ear clipping of a polygon without holes, the same as the engine slicing. */
+	bool TriangulatePoly(TArray<uint32>& OutTris, const TArray<FProcMeshVertex>& PolyVerts, int32 VertBase, const FVector3f& PolyNormal)
+	{
+		const int32 NumVerts = PolyVerts.Num() - VertBase;
+		if (NumVerts < 3) return false;
+
+		const int32 TriBase = OutTris.Num();
+
+		TArray<int32, TInlineAllocator<64>> VertIndices;
+		VertIndices.SetNumUninitialized(NumVerts);
+		for (int32 VertIndex = 0; VertIndex < NumVerts; VertIndex++)
+		{
+			VertIndices[VertIndex] = VertBase + VertIndex;
+		}
+
+		while (VertIndices.Num() >= 3)
+		{
+			bool bFoundEar = false;
+			for (int32 EarVertexIndex = 0; EarVertexIndex < VertIndices.Num(); EarVertexIndex++)
+			{
+				const int32 AIndex = (EarVertexIndex == 0) ? VertIndices.Num() - 1 : EarVertexIndex - 1;
+				const int32 BIndex = EarVertexIndex;
+				const int32 CIndex = (EarVertexIndex + 1) % VertIndices.Num();
+
+				const FVector3f A = (FVector3f)PolyVerts[VertIndices[AIndex]].Position;
+				const FVector3f B = (FVector3f)PolyVerts[VertIndices[BIndex]].Position;
+				const FVector3f C = (FVector3f)PolyVerts[VertIndices[CIndex]].Position;
+
+				// Skip reflex vertices.
+				if ((((B - A) ^ (C - A)) | PolyNormal) > 0.f) continue;
+
+				bool bFoundVertInside = false;
+				for (int32 VertexIndex = 0; VertexIndex < VertIndices.Num() && !bFoundVertInside; VertexIndex++)
+				{
+					if (VertexIndex == AIndex || VertexIndex == BIndex || VertexIndex == CIndex) continue;
+
+					// Barycentric test of the remaining vertices against the ear.
+					const FVector3f P = (FVector3f)PolyVerts[VertIndices[VertexIndex]].Position;
+					const FVector3f N0 = (B - A) ^ (P - A);
+					const FVector3f N1 = (C - B) ^ (P - B);
+					const FVector3f N2 = (A - C) ^ (P - C);
+					bFoundVertInside = (N0 | N1) > 0.f && (N1 | N2) > 0.f;
+				}
+
+				if (!bFoundVertInside)
+				{
+					OutTris.Add(VertIndices[AIndex]);
+					OutTris.Add(VertIndices[CIndex]);
+					OutTris.Add(VertIndices[BIndex]);
+					VertIndices.RemoveAt(EarVertexIndex);
+					bFoundEar = true;
+					break;
+				}
+			}
+
+			if (!bFoundEar)
+			{
+				OutTris.SetNum(TriBase);
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+bool FS_CapBuilder::Build(TArrayView<const FUtilEdge3D> Edges, const FPlane& Plane, float UVScale, FProcMeshSection& OutCap, float SimplifyTolerance)
+{
+	const FVector Normal = Plane.GetNormal();
+	FVector AxisX, AxisY;
+	Normal.FindBestAxisVectors(AxisX, AxisY);
+	AxisY = Normal ^ AxisX;
+
+	// Weld the end points on a grid of the tolerance, each vertex linking to the two edges it closes.
+	TMap<FIntPoint, int32> Welded;
+	Welded.Reserve(Edges.Num());
+	TArray<FVector2D> Points;
+	TArray<FIntPoint> Links;
+	Points.Reserve(Edges.Num());
+	Links.Reserve(Edges.Num());
+
+	auto Weld = [&](const FVector& Position)
+	{
+		const FVector2D Point(Position | AxisX, Position | AxisY);
+		const FIntPoint Key(FMath::RoundToInt(Point.X / WeldTolerance), FMath::RoundToInt(Point.Y / WeldTolerance));
+		int32& Index = Welded.FindOrAdd(Key, INDEX_NONE);
+		if (Index == INDEX_NONE)
+		{
+			Index = Points.Add(Point);
+			Links.Emplace(INDEX_NONE, INDEX_NONE);
+		}
+		return Index;
+	};
+
+	// A third edge on a vertex is left out, the loops it belongs to stay open.
+	auto Link = [&Links](int32 From, int32 To)
+	{
+		FIntPoint& Link = Links[From];
+		if (Link.X == INDEX_NONE) Link.X = To;
+		else if (Link.Y == INDEX_NONE && Link.X != To) Link.Y = To;
+	};
+
+	for (const FUtilEdge3D& Edge : Edges)
+	{
+		const int32 A = Weld(Edge.V0);
+		const int32 B = Weld(Edge.V1);
+		if (A == B) continue;
+		Link(A, B);
+		Link(B, A);
+	}
+
+	// Walk the closed loops, open chains are dropped.
+	TArray<int32> LoopVertices;
+	TArray<int32> LoopStarts;
+	LoopVertices.Reserve(Points.Num());
+	TBitArray<> Visited(false, Points.Num());
+	for (int32 Start = 0; Start < Points.Num(); Start++)
+	{
+		if (Visited[Start] || Links[Start].Y == INDEX_NONE) continue;
+
+		const int32 LoopStart = LoopVertices.Num();
+		bool bClosed = false;
+		for (int32 Previous = INDEX_NONE, Current = Start;;)
+		{
+			Visited[Current] = true;
+			LoopVertices.Add(Current);
+
+			const int32 Next = Links[Current].X != Previous ? Links[Current].X : Links[Current].Y;
+			if (Next == Start)
+			{
+				bClosed = true;
+				break;
+			}
+			if (Next == INDEX_NONE || Visited[Next]) break;
+
+			Previous = Current;
+			Current = Next;
+		}
+
+		if (!bClosed || LoopVertices.Num() - LoopStart < 3)
+		{
+			LoopVertices.SetNum(LoopStart, false);
+			continue;
+		}
+		LoopStarts.Add(LoopStart);
+	}
+
+	if (LoopStarts.Num() == 0) return false;
+	if (SimplifyTolerance > 0.f) SimplifyLoops(Points, SimplifyTolerance, LoopVertices, LoopStarts);
+	LoopStarts.Add(LoopVertices.Num());
+	const int32 NumLoops = LoopStarts.Num() - 1;
+
+	TArray<FVector2D> LoopPoints;
+	LoopPoints.SetNumUninitialized(LoopVertices.Num());
+	for (int32 Index = 0; Index < LoopVertices.Num(); Index++)
+	{
+		LoopPoints[Index] = Points[LoopVertices[Index]];
+	}
+
+	TArray<double> Areas;
+	TArray<FBox2D> Bounds;
+	Areas.SetNumZeroed(NumLoops);
+	Bounds.Init(FBox2D(ForceInit), NumLoops);
+	for (int32 Loop = 0; Loop < NumLoops; Loop++)
+	{
+		for (int32 Index = LoopStarts[Loop]; Index < LoopStarts[Loop + 1]; Index++)
+		{
+			const int32 NextIndex = Index + 1 < LoopStarts[Loop + 1] ? Index + 1 : LoopStarts[Loop];
+			Areas[Loop] += LoopPoints[Index] ^ LoopPoints[NextIndex];
+			Bounds[Loop] += LoopPoints[Index];
+		}
+	}
+
+	// Loops inside an odd number of others are holes and run clockwise, the others counterclockwise.
+	TArray<int32> Next;
+	Next.SetNumUninitialized(LoopPoints.Num());
+	for (int32 Loop = 0; Loop < NumLoops; Loop++)
+	{
+		const FVector2D& Point = LoopPoints[LoopStarts[Loop]];
+		int32 Depth = 0;
+		for (int32 Other = 0; Other < NumLoops; Other++)
+		{
+			if (Other == Loop || !Bounds[Other].IsInside(Point)) continue;
+
+			bool bInside = false;
+			for (int32 Index = LoopStarts[Other], PrevIndex = LoopStarts[Other + 1] - 1; Index < LoopStarts[Other + 1]; PrevIndex = Index++)
+			{
+				const FVector2D& A = LoopPoints[Index];
+				const FVector2D& B = LoopPoints[PrevIndex];
+				if ((A.Y > Point.Y) != (B.Y > Point.Y) && Point.X < A.X + (B.X - A.X) * (Point.Y - A.Y) / (B.Y - A.Y))
+					bInside = !bInside;
+			}
+			Depth += bInside ? 1 : 0;
+		}
+
+		const bool bReverse = (Areas[Loop] > 0.0) == (Depth % 2 == 1);
+		const int32 First = LoopStarts[Loop];
+		const int32 Last = LoopStarts[Loop + 1] - 1;
+		for (int32 Index = First; Index <= Last; Index++)
+		{
+			if (bReverse) Next[Index] = Index > First ? Index - 1 : Last;
+			else Next[Index] = Index < Last ? Index + 1 : First;
+		}
+	}
+
+	TArray<uint32> Triangles;
+	if (!Triangulate(LoopPoints, Next, Triangles)) return false;
+
+	const FVector Origin = Normal * Plane.W;
+	const FVector3f CapNormal = (FVector3f)-Normal;
+	const FProcMeshTangent CapTangent(AxisX, false);
+	const float InvUVScale = 1.f / FMath::Max(UVScale, KINDA_SMALL_NUMBER);
+
+	const int32 VertexBase = OutCap.ProcVertexBuffer.Num();
+	OutCap.ProcVertexBuffer.Reserve(VertexBase + LoopPoints.Num());
+	for (const FVector2D& Point : LoopPoints)
+	{
+		FProcMeshVertex& Vertex = OutCap.ProcVertexBuffer.AddDefaulted_GetRef();
+		Vertex.Position = Origin + AxisX * Point.X + AxisY * Point.Y;
+		Vertex.Normal = (FVector)CapNormal;
+		Vertex.Tangent = CapTangent;
+		Vertex.Color = FColor::White;
+		Vertex.UV0 = Point * InvUVScale;
+		OutCap.SectionLocalBox += Vertex.Position;
+	}
+
+	// Counterclockwise around the plane normal is clockwise seen from the back, the side the cap faces.
+	OutCap.ProcIndexBuffer.Reserve(OutCap.ProcIndexBuffer.Num() + Triangles.Num());
+	for (int32 Index = 0; Index + 2 < Triangles.Num(); Index += 3)
+	{
+		OutCap.ProcIndexBuffer.Add(VertexBase + Triangles[Index]);
+		OutCap.ProcIndexBuffer.Add(VertexBase + Triangles[Index + 2]);
+		OutCap.ProcIndexBuffer.Add(VertexBase + Triangles[Index + 1]);
+	}
+
+	return true;
+}
+
+bool FS_CapBuilder::Triangulate(TArrayView<const FVector2D> Points, TArrayView<const int32> Next, TArray<uint32>& OutTriangles)
+{
+	const int32 NumPoints = Points.Num();
+	if (NumPoints < 3) return false;
+
+	TArray<int32> Prev;
+	Prev.SetNumUninitialized(NumPoints);
+	for (int32 Vertex = 0; Vertex < NumPoints; Vertex++)
+	{
+		Prev[Next[Vertex]] = Vertex;
+	}
+
+	TArray<int32> Order;
+	Order.SetNumUninitialized(NumPoints);
+	for (int32 Vertex = 0; Vertex < NumPoints; Vertex++)
+	{
+		Order[Vertex] = Vertex;
+	}
+	Order.Sort([&Points](int32 A, int32 B) { return IsAbove(Points[A], Points[B]); });
+
+	// Edges are named after the vertex they start from. The sweep status holds the edges with the region on their
+	// right, sorted from left to right, in an array small enough for its moves to cost less than a tree.
+	TArray<int32> Status;
+	TArray<int32> Helpers;
+	TArray<bool> IsMerge;
+	Helpers.Init(INDEX_NONE, NumPoints);
+	IsMerge.Init(false, NumPoints);
+	TArray<FIntPoint> Diagonals;
+
+	auto FindLeftEdge = [&](const FVector2D& Point)
+	{
+		int32 Low = 0;
+		int32 High = Status.Num();
+		while (Low < High)
+		{
+			const int32 Middle = (Low + High) / 2;
+			const int32 Edge = Status[Middle];
+			if (EdgeXAt(Points[Edge], Points[Next[Edge]], Point.Y) <= Point.X) Low = Middle + 1;
+			else High = Middle;
+		}
+		return Low;
+	};
+
+	auto InsertEdge = [&](int32 Edge)
+	{
+		Status.Insert(Edge, FindLeftEdge(Points[Edge]));
+		Helpers[Edge] = Edge;
+	};
+
+	auto RemoveEdge = [&](int32 Edge, int32 Vertex)
+	{
+		if (Helpers[Edge] != INDEX_NONE && IsMerge[Helpers[Edge]]) Diagonals.Emplace(Vertex, Helpers[Edge]);
+		Status.RemoveSingle(Edge);
+	};
+
+	// Connect the vertex to the helper of the edge on its left when that is a merge vertex, and take its place.
+	auto ConnectLeft = [&](int32 Vertex, bool bAlways)
+	{
+		const int32 Position = FindLeftEdge(Points[Vertex]) - 1;
+		if (!Status.IsValidIndex(Position)) return false;
+
+		const int32 Edge = Status[Position];
+		if (bAlways || IsMerge[Helpers[Edge]]) Diagonals.Emplace(Vertex, Helpers[Edge]);
+		Helpers[Edge] = Vertex;
+		return true;
+	};
+
+	for (const int32 Vertex : Order)
+	{
+		const FVector2D& Point = Points[Vertex];
+		const bool bPrevBelow = IsAbove(Point, Points[Prev[Vertex]]);
+		const bool bNextBelow = IsAbove(Point, Points[Next[Vertex]]);
+		const bool bConvex = Orient(Points[Prev[Vertex]], Point, Points[Next[Vertex]]) > 0.0;
+
+		if (bPrevBelow && bNextBelow)
+		{
+			// Start of a region, or split of one, which must reach up to the last vertex seen on its left.
+			if (!bConvex && !ConnectLeft(Vertex, true)) return false;
+			InsertEdge(Vertex);
+		}
+		else if (!bPrevBelow && !bNextBelow)
+		{
+			// End of a region, or merge of two, which a later vertex must reach down to.
+			RemoveEdge(Prev[Vertex], Vertex);
+			if (!bConvex)
+			{
+				IsMerge[Vertex] = true;
+				if (!ConnectLeft(Vertex, false)) return false;
+			}
+		}
+		else if (bNextBelow)
+		{
+			// Going down the left side of the region.
+			RemoveEdge(Prev[Vertex], Vertex);
+			InsertEdge(Vertex);
+		}
+		else if (!ConnectLeft(Vertex, false))
+		{
+			return false;
+		}
+	}
+
+	// Half edges of the boundary and both ways along the diagonals, grouped by the vertex they leave.
+	TArray<FIntPoint> HalfEdges;
+	HalfEdges.Reserve(NumPoints + Diagonals.Num() * 2);
+	for (int32 Vertex = 0; Vertex < NumPoints; Vertex++)
+	{
+		HalfEdges.Emplace(Vertex, Next[Vertex]);
+	}
+	for (const FIntPoint& Diagonal : Diagonals)
+	{
+		HalfEdges.Emplace(Diagonal.X, Diagonal.Y);
+		HalfEdges.Emplace(Diagonal.Y, Diagonal.X);
+	}
+
+	TArray<int32> Offsets;
+	Offsets.SetNumZeroed(NumPoints + 1);
+	for (const FIntPoint& HalfEdge : HalfEdges) Offsets[HalfEdge.X + 1]++;
+	for (int32 Vertex = 0; Vertex < NumPoints; Vertex++) Offsets[Vertex + 1] += Offsets[Vertex];
+
+	TArray<int32> Outgoing;
+	Outgoing.SetNumUninitialized(HalfEdges.Num());
+	{
+		TArray<int32> Fill = Offsets;
+		for (int32 HalfEdge = 0; HalfEdge < HalfEdges.Num(); HalfEdge++) Outgoing[Fill[HalfEdges[HalfEdge].X]++] = HalfEdge;
+	}
+
+	// The face on the left of a half edge goes on with the edge making the sharpest turn to its right.
+	auto NextHalfEdge = [&](int32 HalfEdge)
+	{
+		const int32 From = HalfEdges[HalfEdge].X;
+		const int32 To = HalfEdges[HalfEdge].Y;
+		const FVector2D Back = Points[From] - Points[To];
+
+		int32 Best = INDEX_NONE;
+		double BestAngle = MAX_dbl;
+		for (int32 Slot = Offsets[To]; Slot < Offsets[To + 1]; Slot++)
+		{
+			const int32 Candidate = Outgoing[Slot];
+			const FVector2D Direction = Points[HalfEdges[Candidate].Y] - Points[To];
+			double Angle = FMath::Atan2(Direction ^ Back, Direction | Back);
+			if (Angle <= 0.0) Angle += 2.0 * UE_DOUBLE_PI;
+			if (Angle < BestAngle)
+			{
+				BestAngle = Angle;
+				Best = Candidate;
+			}
+		}
+		return Best;
+	};
+
+	TBitArray<> Used(false, HalfEdges.Num());
+	TArray<int32, TInlineAllocator<64>> Polygon;
+	for (int32 First = 0; First < HalfEdges.Num(); First++)
+	{
+		if (Used[First]) continue;
+
+		Polygon.Reset();
+		for (int32 HalfEdge = First; HalfEdge != First || Polygon.Num() == 0; HalfEdge = NextHalfEdge(HalfEdge))
+		{
+			if (HalfEdge == INDEX_NONE || Used[HalfEdge]) return false;
+			Used[HalfEdge] = true;
+			Polygon.Add(HalfEdges[HalfEdge].X);
+		}
+
+		TriangulateMonotone(Points, Polygon, OutTriangles);
+	}
+
+	return true;
+}
+
+void FS_CapBuilder::BuildWithGeomTools(const TArray<FUtilEdge3D>& Edges, const FPlane& Plane, float UVScale, FProcMeshSection& OutCap)
+{
+	// Project the cut edges on the plane and find the closed polygons they form.
+	TArray<FUtilEdge2D> Edges2D;
+	FUtilPoly2DSet PolySet;
+	FGeomTools::ProjectEdges(Edges2D, PolySet.PolyToWorld, Edges, Plane);
+	FGeomTools::Buildpolys(PolySet.Polys, Edges2D);
+
+	const FVector3f PolyNormal = (FVector3f)-PolySet.PolyToWorld.GetUnitAxis(EAxis::Z);
+	const FProcMeshTangent PolyTangent(PolySet.PolyToWorld.GetUnitAxis(EAxis::X), false);
+
+	for (FUtilPoly2D& Poly : PolySet.Polys)
+	{
+		FGeomTools::GeneratePlanarTilingPolyUVs(Poly, UVScale);
+
+		const int32 PolyVertBase = OutCap.ProcVertexBuffer.Num();
+		for (const FUtilVertex2D& InVertex : Poly.Verts)
+		{
+			FProcMeshVertex& NewVert = OutCap.ProcVertexBuffer.AddDefaulted_GetRef();
+			NewVert.Position = PolySet.PolyToWorld.TransformPosition(FVector(InVertex.Pos.X, InVertex.Pos.Y, 0.f));
+			NewVert.Normal = (FVector)PolyNormal;
+			NewVert.Tangent = PolyTangent;
+			NewVert.Color = InVertex.Color;
+			NewVert.UV0 = InVertex.UV;
+			OutCap.SectionLocalBox += NewVert.Position;
+		}
+
+		TriangulatePoly(OutCap.ProcIndexBuffer, OutCap.ProcVertexBuffer, PolyVertBase, PolyNormal);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GeomTools.h"
+#include "ProceduralMeshComponent.h"
+
+/*
+ * Cap of a planar cross-section, free of any UObject access. The cut edges are chained into loops through a hash of
+ * their end points, loops inside an odd number of others are holes, and the filled region is split into y-monotone
+ * polygons by a plane sweep before each of them is triangulated in linear time.
+ */
+struct FS_CapBuilder
+{
+	// Distance under which two cut points are the same vertex of the cross-section.
+	static constexpr float WeldTolerance = 0.01f;
+
+	/*
+	 * Append the cap of the loops formed by Edges on Plane to OutCap, facing the back of the plane, with UVs projected
+	 * on the plane at UVScale cm per tile. Returns false, with OutCap untouched, when no loop closes or the loops cross.
+	 * Points of the loops closer than SimplifyTolerance to the line between their neighbours are left out.
+	 */
+	static bool Build(TArrayView<const FUtilEdge3D> Edges, const FPlane& Plane, float UVScale, FProcMeshSection& OutCap, float SimplifyTolerance = 0.f);
+
+	/* The same cap built with FGeomTools and ear clipping like SliceProceduralMesh does, without holes. */
+	static void BuildWithGeomTools(const TArray<FUtilEdge3D>& Edges, const FPlane& Plane, float UVScale, FProcMeshSection& OutCap);
+
+	/*
+	 * Counterclockwise triangles, as indices into Points, of the region bounded by the loops Next walks, the region
+	 * being on the left of every edge. Returns false when the loops cross.
+	 */
+	static bool Triangulate(TArrayView<const FVector2D> Points, TArrayView<const int32> Next, TArray<uint32>& OutTriangles);
+};
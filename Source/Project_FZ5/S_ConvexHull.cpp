@@ -0,0 +1,216 @@
+#include "S_ConvexHull.h"
+
+
+namespace
+{
+	/* Triangle of the hull being built, facing outward, with the points it still has to swallow. */
+	struct FS_HullFace
+	{
+		int32 Vertices[3];
+		FVector Normal;
+		FVector::FReal Offset;
+		TArray<int32> Outside;
+		bool bRemoved = false;
+
+		FVector::FReal Distance(const FVector& Point) const { return FVector::DotProduct(Normal, Point) - Offset; }
+	};
+
+	FS_HullFace MakeFace(TArrayView<const FVector> Points, int32 A, int32 B, int32 C)
+	{
+		FS_HullFace Face;
+		Face.Vertices[0] = A;
+		Face.Vertices[1] = B;
+		Face.Vertices[2] = C;
+		Face.Normal = ((Points[B] - Points[A]) ^ (Points[C] - Points[A])).GetSafeNormal();
+		Face.Offset = FVector::DotProduct(Face.Normal, Points[A]);
+		return Face;
+	}
+
+	// Give every point to the first new face it is in front of, points behind all of them are inside the hull.
+	void AssignOutside(TArrayView<const FVector> Points, TArray<FS_HullFace>& Faces, int32 FirstFace, const TArray<int32>& Candidates, FVector::FReal Epsilon)
+	{
+		for (const int32 PointIndex : Candidates)
+		{
+			for (int32 FaceIndex = FirstFace; FaceIndex < Faces.Num(); FaceIndex++)
+			{
+				if (Faces[FaceIndex].Distance(Points[PointIndex]) > Epsilon)
+				{
+					Faces[FaceIndex].Outside.Add(PointIndex);
+					break;
+				}
+			}
+		}
+	}
+}
+
+bool FS_ConvexHull::Build(TArrayView<const FVector> Points, TArray<FVector>& OutVertices, int32 MaxVertices)
+{
+	OutVertices.Reset();
+
+	const int32 NumPoints = Points.Num();
+	if (NumPoints < 4) return false;
+
+	// The tolerance follows the size of the cloud, so the hull behaves the same at any scale.
+	const FBox Bounds(Points.GetData(), NumPoints);
+	const FVector::FReal Epsilon = FMath::Max(Bounds.GetExtent().GetMax(), (FVector::FReal)1.0) * 1e-5;
+
+	// Start from the two most distant extreme points.
+	int32 Extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int32 PointIndex = 1; PointIndex < NumPoints; PointIndex++)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (Points[PointIndex][Axis] < Points[Extremes[Axis * 2]][Axis]) Extremes[Axis * 2] = PointIndex;
+			if (Points[PointIndex][Axis] > Points[Extremes[Axis * 2 + 1]][Axis]) Extremes[Axis * 2 + 1] = PointIndex;
+		}
+	}
+
+	int32 I0 = 0, I1 = 0;
+	FVector::FReal BestDistance = 0.0;
+	for (int32 A = 0; A < 6; A++)
+	{
+		for (int32 B = A + 1; B < 6; B++)
+		{
+			const FVector::FReal Distance = FVector::DistSquared(Points[Extremes[A]], Points[Extremes[B]]);
+			if (Distance > BestDistance)
+			{
+				BestDistance = Distance;
+				I0 = Extremes[A];
+				I1 = Extremes[B];
+			}
+		}
+	}
+	if (BestDistance <= Epsilon * Epsilon) return false;
+
+	// Then the point farthest from their line, and the one farthest from the plane of the three.
+	const FVector LineDirection = (Points[I1] - Points[I0]).GetSafeNormal();
+	int32 I2 = INDEX_NONE;
+	BestDistance = Epsilon;
+	for (int32 PointIndex = 0; PointIndex < NumPoints; PointIndex++)
+	{
+		const FVector::FReal Distance = ((Points[PointIndex] - Points[I0]) ^ LineDirection).Size();
+		if (Distance > BestDistance)
+		{
+			BestDistance = Distance;
+			I2 = PointIndex;
+		}
+	}
+	if (I2 == INDEX_NONE) return false;
+
+	const FVector PlaneNormal = ((Points[I1] - Points[I0]) ^ (Points[I2] - Points[I0])).GetSafeNormal();
+	int32 I3 = INDEX_NONE;
+	BestDistance = Epsilon;
+	for (int32 PointIndex = 0; PointIndex < NumPoints; PointIndex++)
+	{
+		const FVector::FReal Distance = FMath::Abs(FVector::DotProduct(Points[PointIndex] - Points[I0], PlaneNormal));
+		if (Distance > BestDistance)
+		{
+			BestDistance = Distance;
+			I3 = PointIndex;
+		}
+	}
+	if (I3 == INDEX_NONE) return false;
+
+	// Make the faces of the tetrahedron look away from the vertex they miss.
+	TArray<FS_HullFace> Faces;
+	const int32 Simplex[4] = { I0, I1, I2, I3 };
+	for (int32 Missing = 0; Missing < 4; Missing++)
+	{
+		int32 Corners[3];
+		int32 NumCorners = 0;
+		for (int32 Corner = 0; Corner < 4; Corner++)
+		{
+			if (Corner != Missing) Corners[NumCorners++] = Simplex[Corner];
+		}
+
+		FS_HullFace Face = MakeFace(Points, Corners[0], Corners[1], Corners[2]);
+		if (Face.Distance(Points[Simplex[Missing]]) > 0.0) Face = MakeFace(Points, Corners[0], Corners[2], Corners[1]);
+		Faces.Add(MoveTemp(Face));
+	}
+
+	TArray<int32> Candidates;
+	Candidates.Reserve(NumPoints);
+	for (int32 PointIndex = 0; PointIndex < NumPoints; PointIndex++)
+	{
+		if (PointIndex != I0 && PointIndex != I1 && PointIndex != I2 && PointIndex != I3) Candidates.Add(PointIndex);
+	}
+	AssignOutside(Points, Faces, 0, Candidates, Epsilon);
+
+	TArray<TPair<int32, int32>> VisibleEdges;
+	TArray<TPair<int32, int32>> Horizon;
+	int32 NumVertices = 4;
+
+	while (MaxVertices <= 0 || NumVertices < MaxVertices)
+	{
+		// Grow the hull towards the point the farthest out of it.
+		int32 EyeIndex = INDEX_NONE;
+		BestDistance = Epsilon;
+		for (const FS_HullFace& Face : Faces)
+		{
+			for (const int32 PointIndex : Face.Outside)
+			{
+				const FVector::FReal Distance = Face.Distance(Points[PointIndex]);
+				if (Distance > BestDistance)
+				{
+					BestDistance = Distance;
+					EyeIndex = PointIndex;
+				}
+			}
+		}
+		if (EyeIndex == INDEX_NONE) break;
+
+		// Every face the point sees is removed, their border is the horizon the new faces are built on.
+		const FVector& Eye = Points[EyeIndex];
+		VisibleEdges.Reset();
+		Candidates.Reset();
+		for (FS_HullFace& Face : Faces)
+		{
+			if (Face.Distance(Eye) <= Epsilon) continue;
+
+			Face.bRemoved = true;
+			for (int32 Edge = 0; Edge < 3; Edge++)
+			{
+				VisibleEdges.Emplace(Face.Vertices[Edge], Face.Vertices[(Edge + 1) % 3]);
+			}
+			for (const int32 PointIndex : Face.Outside)
+			{
+				if (PointIndex != EyeIndex) Candidates.Add(PointIndex);
+			}
+		}
+
+		Horizon.Reset();
+		for (const TPair<int32, int32>& Edge : VisibleEdges)
+		{
+			if (!VisibleEdges.Contains(TPair<int32, int32>(Edge.Value, Edge.Key))) Horizon.Add(Edge);
+		}
+
+		Faces.RemoveAllSwap([](const FS_HullFace& Face) { return Face.bRemoved; });
+
+		const int32 FirstNewFace = Faces.Num();
+		for (const TPair<int32, int32>& Edge : Horizon)
+		{
+			Faces.Add(MakeFace(Points, Edge.Key, Edge.Value, EyeIndex));
+		}
+		AssignOutside(Points, Faces, FirstNewFace, Candidates, Epsilon);
+
+		NumVertices++;
+	}
+
+	// Only the points still used by a face are vertices of the hull.
+	TArray<int32> VertexIndices;
+	VertexIndices.Reserve(NumVertices);
+	for (const FS_HullFace& Face : Faces)
+	{
+		for (const int32 VertexIndex : Face.Vertices)
+		{
+			VertexIndices.AddUnique(VertexIndex);
+		}
+	}
+
+	OutVertices.Reserve(VertexIndices.Num());
+	for (const int32 VertexIndex : VertexIndices)
+	{
+		OutVertices.Add(Points[VertexIndex]);
+	}
+	return true;
+}
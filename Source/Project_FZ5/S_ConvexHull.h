@@ -0,0 +1,14 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/* Quickhull over a point cloud, free of any UObject access so it can run on worker threads. */
+struct FS_ConvexHull
+{
+	/*
+	 * Vertices of the convex hull of Points. With a positive MaxVertices the hull stops growing at that many vertices,
+	 * the farthest points being added first so the result is the best inner approximation quickhull can give.
+	 * Returns false when the cloud is too small or flat to span a volume.
+	 */
+	static bool Build(TArrayView<const FVector> Points, TArray<FVector>& OutVertices, int32 MaxVertices = 0);
+};
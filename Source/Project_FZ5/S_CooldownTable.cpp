@@ -0,0 +1,17 @@
+#include "S_CooldownTable.h"
+
+
+void FS_CooldownTable::StartAction(Action InAction, float Now, float Duration, float Cooldown)
+{
+	CurrentAction = InAction;
+	ActionEnd = Now + Duration;
+	ActionReady[InAction] = Now + Duration + Cooldown;
+}
+
+void FS_CooldownTable::StopAction(Action InAction, float Now, float Cooldown)
+{
+	if (GetAction(Now) == InAction)
+		ActionEnd = Now;
+
+	ActionReady[InAction] = FMath::Min(ActionReady[InAction], Now + Cooldown);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum State { NEUTRAL, DASH, SLIDE, WALLRUN, WALLCLIMB, WALLJUMP };
+
+enum Action { NONE, SWITCH, SLASH, SHOOT, PARRY, GEAR };
+
+/*
+ * World times at which the states and actions of a pawn are available again, and the action in progress.
+ * Checks are a comparison with the current time, no timer is armed. The owning client and the server each keep
+ * their own, the server only to check what the client sends it.
+ */
+struct PROJECT_FZ5_API FS_CooldownTable
+{
+	static constexpr int32 NumStates = WALLJUMP + 1;
+	static constexpr int32 NumActions = GEAR + 1;
+
+	/* Ready time of a slot held until it is released. */
+	static constexpr float Locked = TNumericLimits<float>::Max();
+
+private:
+	float StateReady[NumStates] = {};
+	float ActionReady[NumActions] = {};
+
+	Action CurrentAction = NONE;
+	float ActionEnd = 0.f;
+
+public:
+	bool IsStateReady(State InState, float Now) const { return Now >= StateReady[InState]; }
+	bool IsActionReady(Action InAction, float Now) const { return Now >= ActionReady[InAction]; }
+	Action GetAction(float Now) const { return Now < ActionEnd ? CurrentAction : NONE; }
+
+	/* Unavailable until released. */
+	void LockState(State InState) { StateReady[InState] = Locked; }
+
+	/* Available right away. */
+	void ResetState(State InState) { StateReady[InState] = 0.f; }
+
+	/* Available after Cooldown, or earlier when it already was going to be. */
+	void ReleaseState(State InState, float Now, float Cooldown) { StateReady[InState] = FMath::Min(StateReady[InState], Now + Cooldown); }
+
+	/* In progress for Duration, then available again after Cooldown. */
+	void StartAction(Action InAction, float Now, float Duration, float Cooldown);
+
+	/* Ends the action when it is in progress, then available again after Cooldown at the latest. */
+	void StopAction(Action InAction, float Now, float Cooldown);
+};
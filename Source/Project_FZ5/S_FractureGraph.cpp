@@ -0,0 +1,100 @@
+#include "S_FractureGraph.h"
+#include "GeometryCollection/GeometryCollection.h"
+#include "GeometryCollection/GeometryCollectionAlgo.h"
+#include "GeometryCollection/GeometryCollectionObject.h"
+
+
+TSharedPtr<FS_FractureGraph> FS_FractureGraph::Build(const UGeometryCollection& Asset)
+{
+	const TSharedPtr<FGeometryCollection, ESPMode::ThreadSafe> Collection = Asset.GetGeometryCollection();
+	if (!Collection) return nullptr;
+
+	const int32 NumBones = Collection->NumElements(FGeometryCollection::TransformGroup);
+	if (NumBones == 0) return nullptr;
+
+	TSharedPtr<FS_FractureGraph> Graph = MakeShared<FS_FractureGraph>();
+	GeometryCollectionAlgo::GlobalMatrices(Collection->Transform, Collection->Parent, Graph->RestTransforms);
+
+	Graph->Parents.SetNum(NumBones);
+	Graph->Levels.SetNum(NumBones);
+	Graph->Centers.SetNum(NumBones);
+	for (int32 Bone = 0; Bone < NumBones; Bone++)
+	{
+		Graph->Parents[Bone] = Collection->Parent[Bone];
+
+		int32 Level = 0;
+		for (int32 Parent = Collection->Parent[Bone]; Parent != INDEX_NONE; Parent = Collection->Parent[Parent]) Level++;
+		Graph->Levels[Bone] = Level;
+
+		const int32 Geometry = Collection->TransformToGeometryIndex[Bone];
+		Graph->Centers[Bone] = Geometry >= 0 && Geometry < Collection->BoundingBox.Num() ? Collection->BoundingBox[Geometry].GetCenter() : FVector::ZeroVector;
+	}
+
+	auto IsLeaf = [&Collection](int32 Bone) { return Collection->Children[Bone].Num() == 0; };
+
+	// Proximity is written by the fracture tools per geometry, each pair is kept once.
+	if (const TManagedArray<TSet<int32>>* Proximity = Collection->FindAttribute<TSet<int32>>(TEXT("Proximity"), FGeometryCollection::GeometryGroup))
+	{
+		for (int32 Geometry = 0; Geometry < Proximity->Num(); Geometry++)
+		{
+			const int32 Bone = Collection->TransformIndex[Geometry];
+			for (const int32 OtherGeometry : (*Proximity)[Geometry])
+			{
+				const int32 OtherBone = Collection->TransformIndex[OtherGeometry];
+				if (Bone < OtherBone && IsLeaf(Bone) && IsLeaf(OtherBone)) Graph->Edges.Emplace(Bone, OtherBone);
+			}
+		}
+	}
+
+	// Without proximity, the leaves of a cluster are taken as touching each other.
+	if (Graph->Edges.Num() == 0)
+	{
+		for (int32 Bone = 0; Bone < NumBones; Bone++)
+		{
+			TArray<int32> Leaves;
+			for (const int32 Child : Collection->Children[Bone])
+			{
+				if (IsLeaf(Child)) Leaves.Add(Child);
+			}
+
+			for (int32 A = 0; A < Leaves.Num(); A++)
+			{
+				for (int32 B = A + 1; B < Leaves.Num(); B++) Graph->Edges.Emplace(Leaves[A], Leaves[B]);
+			}
+		}
+	}
+
+	return Graph;
+}
+
+void FS_FractureGraph::FindCut(const FPlane& Plane, TArrayView<const FTransform> BoneTransforms, TArray<int32>& OutClusters) const
+{
+	const TArrayView<const FTransform> Transforms = BoneTransforms.Num() == GetNumBones() ? BoneTransforms : MakeArrayView(RestTransforms);
+
+	TBitArray<> Marked(false, GetNumBones());
+	for (const int32 Cluster : OutClusters) Marked[Cluster] = true;
+
+	for (const TPair<int32, int32>& Edge : Edges)
+	{
+		const bool bFrontA = Plane.PlaneDot(Transforms[Edge.Key].TransformPosition(Centers[Edge.Key])) >= 0.f;
+		const bool bFrontB = Plane.PlaneDot(Transforms[Edge.Value].TransformPosition(Centers[Edge.Value])) >= 0.f;
+		if (bFrontA == bFrontB) continue;
+
+		// The lowest cluster holding both pieces, and every cluster above it, must let go of their children.
+		int32 A = Parents[Edge.Key];
+		int32 B = Parents[Edge.Value];
+		while (A != B && A != INDEX_NONE && B != INDEX_NONE)
+		{
+			if (Levels[A] >= Levels[B]) A = Parents[A];
+			else B = Parents[B];
+		}
+
+		for (int32 Cluster = A == B ? A : INDEX_NONE; Cluster != INDEX_NONE && !Marked[Cluster]; Cluster = Parents[Cluster])
+		{
+			Marked[Cluster] = true;
+			OutClusters.Add(Cluster);
+		}
+	}
+
+	OutClusters.Sort([this](int32 A, int32 B) { return Levels[A] < Levels[B]; });
+}
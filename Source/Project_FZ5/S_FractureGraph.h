@@ -0,0 +1,34 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UGeometryCollection;
+
+/*
+ * Cluster hierarchy and contacts of a pre-fractured geometry collection, read once per asset. A cut crumbles the
+ * clusters holding together two touching pieces on either side of its plane, every other cluster stays whole.
+ */
+struct FS_FractureGraph
+{
+	// Per bone of the collection.
+	TArray<int32> Parents;
+	TArray<int32> Levels;
+	TArray<FTransform> RestTransforms;
+
+	// Center of the geometry of each bone in its own space, only meaningful for the leaves.
+	TArray<FVector> Centers;
+
+	// Pairs of touching leaves, from the proximity of the collection or its siblings when it has none.
+	TArray<TPair<int32, int32>> Edges;
+
+	static TSharedPtr<FS_FractureGraph> Build(const UGeometryCollection& Asset);
+
+	/*
+	 * Clusters to crumble for Plane, in component space, to separate the pieces on its two sides, parents first.
+	 * BoneTransforms are the component space transforms of the bones, the rest pose when empty.
+	 */
+	void FindCut(const FPlane& Plane, TArrayView<const FTransform> BoneTransforms, TArray<int32>& OutClusters) const;
+
+	int32 GetNumBones() const { return Parents.Num(); }
+	SIZE_T GetAllocatedSize() const { return Parents.GetAllocatedSize() + Levels.GetAllocatedSize() + RestTransforms.GetAllocatedSize() + Centers.GetAllocatedSize() + Edges.GetAllocatedSize(); }
+};
@@ -0,0 +1,81 @@
+#include "S_Fragment.h"
+#include "S_SlicedMesh.h"
+#include "S_RenderBudget.h"
+#include "Project_FZ5.h"
+#include "ProceduralMeshComponent.h"
+
+
+AS_Fragment::AS_Fragment()
+{
+	ProceduralMesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("ProceduralMesh"));
+	ProceduralMesh->bUseComplexAsSimpleCollision = false;
+	ProceduralMesh->bUseAsyncCooking = true;
+	RootComponent = ProceduralMesh;
+
+	SimplifiedMesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("SimplifiedMesh"));
+	SimplifiedMesh->SetupAttachment(ProceduralMesh);
+	SimplifiedMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SimplifiedMesh->SetGenerateOverlapEvents(false);
+	SimplifiedMesh->SetVisibility(false);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void AS_Fragment::Activate(AS_SlicedMesh* InSource, const FTransform& Transform)
+{
+	Source = InSource;
+
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+}
+
+void AS_Fragment::Deactivate()
+{
+	Source.Reset();
+
+	// Drop the geometry and the physics state, the component and the actor are kept for the next slice.
+	ProceduralMesh->SetSimulatePhysics(false);
+	ProceduralMesh->ClearAllMeshSections();
+	ProceduralMesh->ClearCollisionConvexMeshes();
+	ProceduralMesh->EmptyOverrideMaterials();
+	ProceduralMesh->SetWorldScale3D(FVector::OneVector);
+	ClearSimplified();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+bool AS_Fragment::BuildSimplified(int32 Resolution)
+{
+	if (bHasSimplified) return SimplifiedMesh->GetNumSections() > 0;
+	bHasSimplified = true;
+
+	const FBox LocalBox = ProceduralMesh->CalcBounds(FTransform::Identity).GetBox();
+	if (!LocalBox.IsValid || Resolution <= 0) return false;
+
+	const float CellSize = LocalBox.GetSize().GetMax() / Resolution;
+	for (int32 SectionIndex = 0; SectionIndex < ProceduralMesh->GetNumSections(); SectionIndex++)
+	{
+		FProcMeshSection Simplified;
+		if (const FProcMeshSection* Section = ProceduralMesh->GetProcMeshSection(SectionIndex))
+			FS_RenderBudget::Simplify(*Section, CellSize, Simplified);
+
+		// Sections keep their index even when empty, so the materials line up.
+		SimplifiedMesh->SetProcMeshSection(SectionIndex, Simplified);
+#if FZ5_WITH_CLIENT_VISUALS
+		SimplifiedMesh->SetMaterial(SectionIndex, ProceduralMesh->GetMaterial(SectionIndex));
+#endif
+	}
+
+	return SimplifiedMesh->GetNumSections() > 0;
+}
+
+void AS_Fragment::ClearSimplified()
+{
+	bHasSimplified = false;
+	SimplifiedMesh->SetVisibility(false);
+	SimplifiedMesh->ClearAllMeshSections();
+	SimplifiedMesh->EmptyOverrideMaterials();
+}
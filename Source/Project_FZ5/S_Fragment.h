@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "S_Fragment.generated.h"
+
+class AS_SlicedMesh;
+class UProceduralMeshComponent;
+
+/* A sliced piece of an AS_SlicedMesh, recycled through the fragment subsystem. */
+UCLASS(NotPlaceable, Transient)
+class PROJECT_FZ5_API AS_Fragment : public AActor
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
+	UProceduralMeshComponent* ProceduralMesh;
+
+	/* Coarser copy of the geometry drawn in place of it when far away, never collides nor gets sliced. */
+	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
+	UProceduralMeshComponent* SimplifiedMesh;
+
+	bool bHasSimplified = false;
+
+	TWeakObjectPtr<AS_SlicedMesh> Source;
+
+public:
+	AS_Fragment();
+
+	UProceduralMeshComponent* GetMesh() const { return ProceduralMesh; }
+	UProceduralMeshComponent* GetSimplifiedMesh() const { return SimplifiedMesh; }
+	AS_SlicedMesh* GetSource() const { return Source.Get(); }
+	bool IsActive() const { return Source.IsValid(); }
+
+	/* Take the fragment out of the pool as a piece of InSource. */
+	void Activate(AS_SlicedMesh* InSource, const FTransform& Transform);
+
+	/* Hide, stop and empty the fragment before it goes back to the pool. */
+	void Deactivate();
+
+	/* Build the simplified copy of the geometry with Resolution cells along its largest side, false when nothing is left of it. */
+	bool BuildSimplified(int32 Resolution);
+
+	/* Hide and drop the simplified copy, once the geometry it was built from changed. */
+	void ClearSimplified();
+};
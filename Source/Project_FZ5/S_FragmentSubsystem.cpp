@@ -0,0 +1,599 @@
+#include "S_FragmentSubsystem.h"
+#include "S_Fragment.h"
+#include "S_SlicedMesh.h"
+#include "S_SliceIndex.h"
+#include "S_SliceSubsystem.h"
+#include "S_LagCompensation.h"
+#include "S_SignificanceSubsystem.h"
+#include "S_SliceMemory.h"
+#include "Project_FZ5.h"
+#include "ProceduralMeshComponent.h"
+#include "Algo/Count.h"
+#include "Algo/SortBy.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "RHI.h"
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live fragments"), STAT_FZ5_LiveFragments, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Baked fragments"), STAT_FZ5_BakedFragments, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled fragments"), STAT_FZ5_PooledFragments, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Culled fragments"), STAT_FZ5_CulledFragments, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Simplified fragments"), STAT_FZ5_SimplifiedFragments, STATGROUP_FZ5);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Render budget scale"), STAT_FZ5_RenderBudgetScale, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Fragment budget"), STAT_FZ5_FragmentBudget, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Fragment render budget"), STAT_FZ5_RenderBudget, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<int32> CVarFragmentBudget(
+	TEXT("fz5.Fragments.Budget"),
+	256,
+	TEXT("Maximum number of live simulated fragments, the lowest priority ones fade out above it."));
+
+static TAutoConsoleVariable<int32> CVarFragmentPoolPrewarm(
+	TEXT("fz5.Fragments.PoolPrewarm"),
+	32,
+	TEXT("Number of fragment actors spawned in the pool when the world begins play."));
+
+static TAutoConsoleVariable<float> CVarFragmentFadeTime(
+	TEXT("fz5.Fragments.FadeTime"),
+	0.5f,
+	TEXT("Seconds taken by an evicted fragment to shrink away."));
+
+static TAutoConsoleVariable<float> CVarDebrisBakeDelay(
+	TEXT("fz5.Debris.BakeDelay"),
+	1.0f,
+	TEXT("Seconds a fragment must stay asleep before it is baked into the debris of its source, negative to never bake."));
+
+static TAutoConsoleVariable<int32> CVarRenderBudget(
+	TEXT("fz5.Render.Budget"),
+	1,
+	TEXT("Cull, unshadow and simplify the fragments by their size on screen, 0 draws all of them in full."));
+
+static TAutoConsoleVariable<float> CVarRenderTargetGpuMs(
+	TEXT("fz5.Render.TargetGpuMs"),
+	0.f,
+	TEXT("GPU frame time the screen size thresholds are scaled to meet, 0 keeps them as set."));
+
+static TAutoConsoleVariable<float> CVarRenderCullScreenSize(
+	TEXT("fz5.Render.CullScreenSize"),
+	0.005f,
+	TEXT("Screen size under which a fragment is not drawn."));
+
+static TAutoConsoleVariable<float> CVarRenderCullVolume(
+	TEXT("fz5.Render.CullVolume"),
+	125.f,
+	TEXT("Bounds volume in cubic cm under which a fragment is not drawn."));
+
+static TAutoConsoleVariable<float> CVarRenderShadowScreenSize(
+	TEXT("fz5.Render.ShadowScreenSize"),
+	0.05f,
+	TEXT("Screen size under which a fragment casts no shadow."));
+
+static TAutoConsoleVariable<float> CVarRenderLumenScreenSize(
+	TEXT("fz5.Render.LumenScreenSize"),
+	0.03f,
+	TEXT("Screen size under which a fragment is left out of Lumen and distance field lighting."));
+
+static TAutoConsoleVariable<float> CVarRenderSimplifyScreenSize(
+	TEXT("fz5.Render.SimplifyScreenSize"),
+	0.1f,
+	TEXT("Screen size under which a pooled fragment is drawn from its simplified copy."));
+
+static TAutoConsoleVariable<int32> CVarRenderSimplifyTriangles(
+	TEXT("fz5.Render.SimplifyTriangles"),
+	500,
+	TEXT("Triangles a fragment must have before it gets a simplified copy."));
+
+static TAutoConsoleVariable<int32> CVarRenderSimplifyResolution(
+	TEXT("fz5.Render.SimplifyResolution"),
+	8,
+	TEXT("Cells along the largest side of a fragment its simplified copy is clustered into."));
+
+// Seconds a piece is watched for cooks of its hulls finishing, the longest cooks take a few frames.
+static constexpr float CookWatchTime = 2.f;
+
+
+void US_FragmentSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const int32 PrewarmCount = CVarFragmentPoolPrewarm.GetValueOnGameThread();
+	for (int32 Index = FreeFragments.Num(); Index < PrewarmCount; Index++)
+	{
+		if (AS_Fragment* Fragment = SpawnFragment())
+			FreeFragments.Add(Fragment);
+	}
+}
+
+void US_FragmentSubsystem::Deinitialize()
+{
+	FreeFragments.Empty();
+	LiveFragments.Empty();
+	PendingCooks.Empty();
+	NumFading = 0;
+	NumBaked = 0;
+	NumCulled = 0;
+	NumSimplified = 0;
+
+	Super::Deinitialize();
+}
+
+TStatId US_FragmentSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_FragmentSubsystem, STATGROUP_Tickables);
+}
+
+AS_Fragment* US_FragmentSubsystem::SpawnFragment()
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	return GetWorld()->SpawnActor<AS_Fragment>(AS_Fragment::StaticClass(), FTransform::Identity, SpawnParameters);
+}
+
+AS_Fragment* US_FragmentSubsystem::AcquireFragment(AS_SlicedMesh* Source, const FTransform& Transform)
+{
+	AS_Fragment* Fragment = nullptr;
+	while (!Fragment && FreeFragments.Num() > 0)
+	{
+		Fragment = FreeFragments.Pop(false);
+		if (!IsValid(Fragment)) Fragment = nullptr;
+	}
+
+	if (!Fragment) Fragment = SpawnFragment();
+	if (Fragment) Fragment->Activate(Source, Transform);
+	return Fragment;
+}
+
+void US_FragmentSubsystem::RegisterFragment(UProceduralMeshComponent* Mesh)
+{
+	if (!Mesh) return;
+
+	FS_FragmentEntry* Entry = LiveFragments.FindByPredicate([Mesh](const FS_FragmentEntry& Other) { return Other.Mesh == Mesh; });
+	if (!Entry)
+	{
+		Entry = &LiveFragments.AddDefaulted_GetRef();
+		Entry->Mesh = Mesh;
+	}
+	else if (Entry->FadeTime >= 0.f)
+	{
+		// Sliced again while fading out, bring it back to full size where it was.
+		Mesh->SetWorldLocation(Entry->FadeLocation);
+		Mesh->SetWorldScale3D(Entry->FadeScale);
+		Entry->FadeTime = -1.f;
+		NumFading--;
+	}
+	else if (Entry->bBaked)
+	{
+		// Revived from the debris, its source has already made it visible and simulated again.
+		Entry->bBaked = false;
+		NumBaked--;
+	}
+
+	// A re-sliced fragment counts as new, with the volume of what is left of it.
+	const FVector Extent = Mesh->Bounds.BoxExtent;
+	Entry->SpawnTime = GetWorld()->GetTimeSeconds();
+	Entry->RestTime = 0.f;
+	Entry->Volume = 8.f * Extent.X * Extent.Y * Extent.Z;
+
+	Entry->NumTriangles = 0;
+	for (int32 SectionIndex = 0; SectionIndex < Mesh->GetNumSections(); SectionIndex++)
+	{
+		if (const FProcMeshSection* Section = Mesh->GetProcMeshSection(SectionIndex))
+			Entry->NumTriangles += Section->ProcIndexBuffer.Num() / 3;
+	}
+
+	// The simplified copy was built from the geometry before this slice.
+	Entry->bRenderApplied = false;
+	if (AS_Fragment* Fragment = Cast<AS_Fragment>(Mesh->GetOwner()))
+		Fragment->ClearSimplified();
+
+	if (US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>())
+		SliceIndex->Register(Mesh);
+
+	// Moving pieces can stand in the way of a shot fired in the past.
+	if (US_LagCompensation* LagCompensation = GetWorld()->GetSubsystem<US_LagCompensation>())
+		LagCompensation->Track(Mesh, ES_HitboxShape::Box, ES_HitboxOwner::Fragment);
+
+	if (US_SignificanceSubsystem* Significance = GetWorld()->GetSubsystem<US_SignificanceSubsystem>())
+		Significance->Register(Mesh, ES_SignificanceKind::Fragment);
+}
+
+void US_FragmentSubsystem::RemoveFragment(UProceduralMeshComponent* Mesh)
+{
+	if (!Mesh) return;
+
+	// The counts are taken again on the next tick.
+	LiveFragments.RemoveAllSwap([Mesh](const FS_FragmentEntry& Entry) { return Entry.Mesh == Mesh; });
+
+	if (US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>())
+		SliceIndex->Unregister(Mesh);
+
+	ReleaseFragment(Mesh);
+}
+
+void FS_PendingCook::Save(const UProceduralMeshComponent* InMesh)
+{
+	// Not simulating yet, it will be awake once it is.
+	bAwake = !InMesh->IsSimulatingPhysics() || InMesh->RigidBodyIsAwake();
+	LinearVelocity = InMesh->GetPhysicsLinearVelocity();
+	AngularVelocity = InMesh->GetPhysicsAngularVelocityInRadians();
+}
+
+void FS_PendingCook::Restore(UProceduralMeshComponent* InMesh) const
+{
+	if (!InMesh->IsSimulatingPhysics()) return;
+
+	if (bAwake)
+	{
+		InMesh->SetPhysicsLinearVelocity(LinearVelocity);
+		InMesh->SetPhysicsAngularVelocityInRadians(AngularVelocity);
+	}
+	else
+	{
+		InMesh->PutRigidBodyToSleep();
+	}
+}
+
+void US_FragmentSubsystem::WatchCook(UProceduralMeshComponent* Mesh)
+{
+	if (!Mesh) return;
+
+	FS_PendingCook* Cook = PendingCooks.FindByPredicate([Mesh](const FS_PendingCook& Other) { return Other.Mesh == Mesh; });
+	if (!Cook) Cook = &PendingCooks.AddDefaulted_GetRef();
+
+	// Saved now, a cook can be done before the next tick would have saved it.
+	Cook->Mesh = Mesh;
+	Cook->BodySetup = Mesh->ProcMeshBodySetup;
+	Cook->Time = 0.f;
+	Cook->Save(Mesh);
+}
+
+void US_FragmentSubsystem::RestoreCook(UProceduralMeshComponent* Mesh)
+{
+	FS_PendingCook* Cook = PendingCooks.FindByPredicate([Mesh](const FS_PendingCook& Other) { return Other.Mesh == Mesh; });
+	if (!Cook || !Mesh) return;
+
+	Cook->BodySetup = Mesh->ProcMeshBodySetup;
+	Cook->Restore(Mesh);
+}
+
+void US_FragmentSubsystem::UpdateCooks(float DeltaTime)
+{
+	for (int32 Index = PendingCooks.Num() - 1; Index >= 0; Index--)
+	{
+		FS_PendingCook& Cook = PendingCooks[Index];
+		UProceduralMeshComponent* Mesh = Cook.Mesh.Get();
+		Cook.Time += DeltaTime;
+		if (!Mesh || Cook.Time > CookWatchTime)
+		{
+			PendingCooks.RemoveAtSwap(Index);
+			continue;
+		}
+
+		// A finished cook swaps the body setup, then recreates the body at rest. Several may be queued on one mesh.
+		if (Mesh->ProcMeshBodySetup != Cook.BodySetup.Get())
+		{
+			Cook.BodySetup = Mesh->ProcMeshBodySetup;
+			Cook.Restore(Mesh);
+			continue;
+		}
+
+		// Still cooking, the body moves with the proxy box.
+		if (Mesh->IsSimulatingPhysics()) Cook.Save(Mesh);
+	}
+}
+
+void US_FragmentSubsystem::Tick(float DeltaTime)
+{
+	FZ5_SCOPE(FragmentBudget);
+
+	LiveFragments.RemoveAllSwap([](const FS_FragmentEntry& Entry) { return !Entry.Mesh.IsValid(); });
+	NumFading = Algo::CountIf(LiveFragments, [](const FS_FragmentEntry& Entry) { return Entry.FadeTime >= 0.f; });
+	NumBaked = Algo::CountIf(LiveFragments, [](const FS_FragmentEntry& Entry) { return Entry.bBaked; });
+
+	BakeSettled(DeltaTime);
+	EvictOverBudget();
+	UpdateFades(DeltaTime);
+	UpdateCooks(DeltaTime);
+	UpdateRenderBudget(DeltaTime);
+
+	SET_DWORD_STAT(STAT_FZ5_LiveFragments, GetNumLiveFragments());
+	SET_DWORD_STAT(STAT_FZ5_BakedFragments, GetNumBakedFragments());
+	SET_DWORD_STAT(STAT_FZ5_PooledFragments, GetNumPooledFragments());
+	SET_DWORD_STAT(STAT_FZ5_CulledFragments, NumCulled);
+	SET_DWORD_STAT(STAT_FZ5_SimplifiedFragments, NumSimplified);
+	SET_FLOAT_STAT(STAT_FZ5_RenderBudgetScale, RenderBudget.Scale);
+}
+
+void US_FragmentSubsystem::BakeSettled(float DeltaTime)
+{
+	const float BakeDelay = CVarDebrisBakeDelay.GetValueOnGameThread();
+	if (BakeDelay < 0.f) return;
+
+	const US_SliceSubsystem* SliceSubsystem = GetWorld()->GetSubsystem<US_SliceSubsystem>();
+	US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>();
+	US_LagCompensation* LagCompensation = GetWorld()->GetSubsystem<US_LagCompensation>();
+	TSet<AS_SlicedMesh*> DirtySources;
+
+	for (int32 Index = LiveFragments.Num() - 1; Index >= 0; Index--)
+	{
+		FS_FragmentEntry& Entry = LiveFragments[Index];
+		UProceduralMeshComponent* Mesh = Entry.Mesh.Get();
+		AS_SlicedMesh* Source = AS_SlicedMesh::FromComponent(Mesh);
+
+		// Baked pieces whose source is gone can never be drawn again.
+		if (Entry.bBaked)
+		{
+			if (Source) continue;
+			LiveFragments.RemoveAtSwap(Index);
+			NumBaked--;
+			ReleaseFragment(Mesh);
+			continue;
+		}
+
+		if (Entry.FadeTime >= 0.f) continue;
+
+		// A sleeping body has settled, an awake one or one about to be sliced starts over.
+		if (!Source || !Mesh->IsSimulatingPhysics() || Mesh->RigidBodyIsAwake() || (SliceSubsystem && SliceSubsystem->IsBusy(Mesh)))
+		{
+			Entry.RestTime = 0.f;
+			continue;
+		}
+
+		Entry.RestTime += DeltaTime;
+		if (Entry.RestTime < BakeDelay) continue;
+
+		if (AS_Fragment* Fragment = Cast<AS_Fragment>(Mesh->GetOwner()))
+			Fragment->ClearSimplified();
+
+		Source->BakeFragment(Mesh);
+		if (SliceIndex) SliceIndex->Unregister(Mesh);
+		if (LagCompensation) LagCompensation->Untrack(Mesh);
+		Entry.bBaked = true;
+		NumBaked++;
+		DirtySources.Add(Source);
+	}
+
+	// Pieces settling on the same frame are merged with a single rebuild per source.
+	for (AS_SlicedMesh* Source : DirtySources)
+	{
+		Source->RebuildDebris();
+	}
+}
+
+float US_FragmentSubsystem::GetPriority(const FS_FragmentEntry& Entry, const TArray<FVector>& PlayerLocations, double Now) const
+{
+	const FVector Location = Entry.Mesh->GetComponentLocation();
+
+	float ClosestDistance = PlayerLocations.Num() > 0 ? MAX_flt : 0.f;
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		ClosestDistance = FMath::Min(ClosestDistance, (float)FVector::Dist(Location, PlayerLocation));
+	}
+
+	const float Age = (float)(Now - Entry.SpawnTime);
+	return Entry.Volume / (1.f + Age / 10.f) / (1.f + ClosestDistance / 1000.f);
+}
+
+void US_FragmentSubsystem::EvictOverBudget()
+{
+	const int32 Excess = GetNumLiveFragments() - FMath::Max(0, CVarFragmentBudget.GetValueOnGameThread());
+
+	// Past the memory budget, enough fragments go early to pay it back, on top of the ones over the fragment budget.
+	US_SliceMemory* SliceMemory = GetWorld()->GetSubsystem<US_SliceMemory>();
+	const int32 MemoryEvictions = SliceMemory ? SliceMemory->ConsumeEvictions() : 0;
+
+	if (Excess <= 0 && MemoryEvictions <= 0) return;
+
+	TArray<FVector> PlayerLocations;
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		if (const APawn* Pawn = Iterator->Get() ? Iterator->Get()->GetPawn() : nullptr)
+			PlayerLocations.Add(Pawn->GetActorLocation());
+	}
+
+	// Rank the fragments that are not fading yet, the baked ones only pay back memory as they are not live.
+	const double Now = GetWorld()->GetTimeSeconds();
+	TArray<TPair<float, int32>> Candidates;
+	Candidates.Reserve(LiveFragments.Num());
+	for (int32 Index = 0; Index < LiveFragments.Num(); Index++)
+	{
+		const FS_FragmentEntry& Entry = LiveFragments[Index];
+		if (Entry.FadeTime < 0.f && (!Entry.bBaked || MemoryEvictions > 0))
+			Candidates.Emplace(GetPriority(Entry, PlayerLocations, Now), Index);
+	}
+
+	Algo::SortBy(Candidates, &TPair<float, int32>::Key);
+
+	// The lowest live ones go for the fragment budget, then the lowest of all that are left for the memory budget.
+	TArray<int32> Evicted;
+	for (int32 Rank = 0; Rank < Candidates.Num() && Evicted.Num() < Excess; Rank++)
+	{
+		if (!LiveFragments[Candidates[Rank].Value].bBaked) Evicted.Add(Candidates[Rank].Value);
+	}
+
+	const int32 NumLiveEvicted = Evicted.Num();
+	for (int32 Rank = 0; Rank < Candidates.Num() && Evicted.Num() < NumLiveEvicted + MemoryEvictions; Rank++)
+	{
+		Evicted.AddUnique(Candidates[Rank].Value);
+	}
+
+	US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>();
+	TSet<AS_SlicedMesh*> DirtySources;
+
+	for (const int32 Index : Evicted)
+	{
+		FS_FragmentEntry& Entry = LiveFragments[Index];
+		UProceduralMeshComponent* Mesh = Entry.Mesh.Get();
+
+		// Baked pieces are already hidden, they only leave the debris mesh and are released with the others below.
+		if (Entry.bBaked)
+		{
+			if (AS_SlicedMesh* Source = AS_SlicedMesh::FromComponent(Mesh))
+			{
+				Source->DropBakedFragment(Mesh);
+				DirtySources.Add(Source);
+			}
+			continue;
+		}
+
+		// The fragment stops interacting right away and only shrinks on screen.
+		Mesh->SetSimulatePhysics(false);
+		Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		if (SliceIndex) SliceIndex->Unregister(Mesh);
+		Entry.FadeTime = 0.f;
+		Entry.FadeScale = Mesh->GetComponentScale();
+		Entry.FadeLocation = Mesh->GetComponentLocation();
+		Entry.FadeCenter = Mesh->Bounds.Origin;
+		NumFading++;
+	}
+
+	// Highest index first, so a swap never moves an entry still to be removed.
+	Evicted.Sort(TGreater<int32>());
+	for (const int32 Index : Evicted)
+	{
+		if (!LiveFragments[Index].bBaked) continue;
+
+		UProceduralMeshComponent* Mesh = LiveFragments[Index].Mesh.Get();
+		LiveFragments.RemoveAtSwap(Index);
+		NumBaked--;
+		ReleaseFragment(Mesh);
+	}
+
+	for (AS_SlicedMesh* Source : DirtySources)
+	{
+		Source->RebuildDebris();
+	}
+}
+
+void US_FragmentSubsystem::UpdateFades(float DeltaTime)
+{
+	const float FadeDuration = FMath::Max(CVarFragmentFadeTime.GetValueOnGameThread(), KINDA_SMALL_NUMBER);
+
+	for (int32 Index = LiveFragments.Num() - 1; Index >= 0; Index--)
+	{
+		FS_FragmentEntry& Entry = LiveFragments[Index];
+		if (Entry.FadeTime < 0.f) continue;
+
+		UProceduralMeshComponent* Mesh = Entry.Mesh.Get();
+		Entry.FadeTime += DeltaTime;
+		if (Entry.FadeTime < FadeDuration)
+		{
+			// The pivot is the one of the sliced prop, far from most pieces. Shrink around the piece instead.
+			const float Alpha = 1.f - Entry.FadeTime / FadeDuration;
+			Mesh->SetWorldTransform(FTransform(Mesh->GetComponentQuat(), Entry.FadeCenter + (Entry.FadeLocation - Entry.FadeCenter) * Alpha, Entry.FadeScale * Alpha));
+			continue;
+		}
+
+		// Back to its size, the root mesh of a sliced actor is kept and sliced again after a restore.
+		Mesh->SetWorldLocation(Entry.FadeLocation);
+		Mesh->SetWorldScale3D(Entry.FadeScale);
+		LiveFragments.RemoveAtSwap(Index);
+		NumFading--;
+		ReleaseFragment(Mesh);
+	}
+}
+
+void US_FragmentSubsystem::UpdateRenderBudget(float DeltaTime)
+{
+	FZ5_SCOPE(RenderBudget);
+
+	NumCulled = 0;
+	NumSimplified = 0;
+
+#if FZ5_WITH_CLIENT_VISUALS
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer) return;
+
+	// Screen sizes are measured from the local view, worlds without one are left alone.
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const APlayerCameraManager* CameraManager = PlayerController ? PlayerController->PlayerCameraManager : nullptr;
+	if (!CameraManager) return;
+
+	const bool bEnabled = CVarRenderBudget.GetValueOnGameThread() != 0;
+
+	RenderBudget.Base.CullScreenSize = CVarRenderCullScreenSize.GetValueOnGameThread();
+	RenderBudget.Base.CullVolume = CVarRenderCullVolume.GetValueOnGameThread();
+	RenderBudget.Base.ShadowScreenSize = CVarRenderShadowScreenSize.GetValueOnGameThread();
+	RenderBudget.Base.LumenScreenSize = CVarRenderLumenScreenSize.GetValueOnGameThread();
+	RenderBudget.Base.SimplifyScreenSize = CVarRenderSimplifyScreenSize.GetValueOnGameThread();
+	RenderBudget.Base.SimplifyTriangles = CVarRenderSimplifyTriangles.GetValueOnGameThread();
+	RenderBudget.TargetGpuMs = CVarRenderTargetGpuMs.GetValueOnGameThread();
+
+	// The GPU time read here is the one of a frame or two ago, the smoothing of the budget absorbs the lag.
+	RenderBudget.Adapt(FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles()), DeltaTime);
+	const FS_RenderThresholds Thresholds = RenderBudget.GetThresholds();
+
+	const FVector ViewLocation = CameraManager->GetCameraLocation();
+	const float HalfFov = FMath::DegreesToRadians(CameraManager->GetFOVAngle() * 0.5f);
+
+	for (FS_FragmentEntry& Entry : LiveFragments)
+	{
+		if (Entry.bBaked || Entry.FadeTime >= 0.f) continue;
+
+		const FBoxSphereBounds& Bounds = Entry.Mesh->Bounds;
+		FS_RenderFragment Fragment;
+		Fragment.ScreenSize = FS_RenderBudget::GetScreenSize(Bounds.SphereRadius, FVector::Dist(ViewLocation, Bounds.Origin), HalfFov);
+		Fragment.Volume = Entry.Volume;
+		Fragment.NumTriangles = Entry.NumTriangles;
+
+		ApplyRenderDecision(Entry, bEnabled ? FS_RenderBudget::Decide(Fragment, Thresholds) : FS_RenderDecision());
+		NumCulled += Entry.RenderDecision.bVisible ? 0 : 1;
+		NumSimplified += Entry.RenderDecision.bSimplified ? 1 : 0;
+	}
+#endif
+}
+
+void US_FragmentSubsystem::ApplyRenderDecision(FS_FragmentEntry& Entry, const FS_RenderDecision& Decision)
+{
+	// Render state changes reach the render thread, only send the ones that differ.
+	if (Entry.bRenderApplied && Entry.RenderDecision == Decision) return;
+	Entry.RenderDecision = Decision;
+	Entry.bRenderApplied = true;
+
+	UProceduralMeshComponent* Mesh = Entry.Mesh.Get();
+	auto ApplyLighting = [&Decision](UPrimitiveComponent* Component)
+	{
+		Component->SetCastShadow(Decision.bCastShadow);
+		Component->SetAffectDynamicIndirectLighting(Decision.bAffectLumen);
+		Component->SetAffectDistanceFieldLighting(Decision.bAffectLumen);
+	};
+
+	// The root mesh of a sliced actor has no simplified copy and is drawn in full.
+	AS_Fragment* Fragment = Cast<AS_Fragment>(Mesh->GetOwner());
+	const bool bSimplified = Decision.bSimplified && Fragment && Fragment->BuildSimplified(CVarRenderSimplifyResolution.GetValueOnGameThread());
+
+	Mesh->SetVisibility(Decision.bVisible && !bSimplified);
+	ApplyLighting(Mesh);
+
+	if (Fragment)
+	{
+		Fragment->GetSimplifiedMesh()->SetVisibility(bSimplified);
+		ApplyLighting(Fragment->GetSimplifiedMesh());
+	}
+}
+
+void US_FragmentSubsystem::ReleaseFragment(UProceduralMeshComponent* Mesh)
+{
+	if (US_LagCompensation* LagCompensation = GetWorld()->GetSubsystem<US_LagCompensation>())
+		LagCompensation->Untrack(Mesh);
+
+	if (US_SignificanceSubsystem* Significance = GetWorld()->GetSubsystem<US_SignificanceSubsystem>())
+		Significance->Unregister(Mesh);
+
+	// Pooled fragments go back to the pool, the root mesh of a sliced actor is simply emptied.
+	if (AS_Fragment* Fragment = Cast<AS_Fragment>(Mesh->GetOwner()))
+	{
+		Fragment->Deactivate();
+		FreeFragments.Add(Fragment);
+	}
+	else if (AS_SlicedMesh* SlicedMesh = Cast<AS_SlicedMesh>(Mesh->GetOwner()))
+	{
+		SlicedMesh->SetupMesh(Mesh, false, false, false);
+		Mesh->ClearAllMeshSections();
+		Mesh->ClearCollisionConvexMeshes();
+	}
+}
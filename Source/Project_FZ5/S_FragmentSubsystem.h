@@ -0,0 +1,105 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_RenderBudget.h"
+#include "S_FragmentSubsystem.generated.h"
+
+class AS_Fragment;
+class AS_SlicedMesh;
+class UProceduralMeshComponent;
+class UBodySetup;
+
+/* A simulated piece of sliced geometry counted against the fragment budget. */
+struct FS_FragmentEntry
+{
+	TWeakObjectPtr<UProceduralMeshComponent> Mesh;
+	double SpawnTime = 0.0;
+	float Volume = 0.f;
+
+	// Fade out progress, negative while the fragment is alive, and the transform it shrinks from around its bounds center.
+	float FadeTime = -1.f;
+	FVector FadeScale = FVector::OneVector;
+	FVector FadeLocation = FVector::ZeroVector;
+	FVector FadeCenter = FVector::ZeroVector;
+
+	// Time the rigid body has been asleep, and whether it was then baked into its source debris.
+	float RestTime = 0.f;
+	bool bBaked = false;
+
+	// Render state last given to the mesh, applied again whenever the geometry changed.
+	int32 NumTriangles = 0;
+	FS_RenderDecision RenderDecision;
+	bool bRenderApplied = false;
+};
+
+/* A piece whose hulls are cooking, its body is recreated still once they are done and loses how it moved. */
+struct FS_PendingCook
+{
+	TWeakObjectPtr<UProceduralMeshComponent> Mesh;
+	TWeakObjectPtr<UBodySetup> BodySetup;
+	FVector LinearVelocity = FVector::ZeroVector;
+	FVector AngularVelocity = FVector::ZeroVector;
+	bool bAwake = true;
+	float Time = 0.f;
+
+	void Save(const UProceduralMeshComponent* InMesh);
+	void Restore(UProceduralMeshComponent* InMesh) const;
+};
+
+/* Pools fragment actors and keeps the number of live fragments under a global budget. */
+UCLASS()
+class PROJECT_FZ5_API US_FragmentSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<AS_Fragment*> FreeFragments;
+
+	TArray<FS_FragmentEntry> LiveFragments;
+	TArray<FS_PendingCook> PendingCooks;
+	int32 NumFading = 0;
+	int32 NumBaked = 0;
+
+	FS_RenderBudget RenderBudget;
+	int32 NumCulled = 0;
+	int32 NumSimplified = 0;
+
+	AS_Fragment* SpawnFragment();
+	void BakeSettled(float DeltaTime);
+	void EvictOverBudget();
+	void UpdateFades(float DeltaTime);
+	void UpdateCooks(float DeltaTime);
+	void UpdateRenderBudget(float DeltaTime);
+	void ApplyRenderDecision(FS_FragmentEntry& Entry, const FS_RenderDecision& Decision);
+	void ReleaseFragment(UProceduralMeshComponent* Mesh);
+
+	/* Lowest first: small, old and far away fragments are evicted before the others. */
+	float GetPriority(const FS_FragmentEntry& Entry, const TArray<FVector>& PlayerLocations, double Now) const;
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Take a fragment actor from the pool, spawning one when it is empty. */
+	AS_Fragment* AcquireFragment(AS_SlicedMesh* Source, const FTransform& Transform);
+
+	/* Count a simulated procedural mesh against the budget, once, or again after it was baked. */
+	void RegisterFragment(UProceduralMeshComponent* Mesh);
+
+	/* Save how Mesh moves now, before its body is recreated for a new cook of its hulls. */
+	void WatchCook(UProceduralMeshComponent* Mesh);
+
+	/* Give the saved motion back to the body of Mesh recreated right away, and to the ones of its cooks after. */
+	void RestoreCook(UProceduralMeshComponent* Mesh);
+
+	/* Stop counting Mesh and give it back to the pool right away, or empty it when it is the root of its sliceable. */
+	void RemoveFragment(UProceduralMeshComponent* Mesh);
+
+	int32 GetNumLiveFragments() const { return LiveFragments.Num() - NumFading - NumBaked; }
+	int32 GetNumBakedFragments() const { return NumBaked; }
+	int32 GetNumPooledFragments() const { return FreeFragments.Num(); }
+	const FS_RenderBudget& GetRenderBudget() const { return RenderBudget; }
+};
@@ -0,0 +1,149 @@
+#include "S_GeometryCache.h"
+#include "Project_FZ5.h"
+#include "KismetProceduralMeshLibrary.h"
+#include "Engine/StaticMesh.h"
+#include "GeometryCollection/GeometryCollectionObject.h"
+#include "PhysicsEngine/BodySetup.h"
+
+
+DECLARE_MEMORY_STAT(TEXT("Geometry cache"), STAT_FZ5_GeometryCacheMemory, STATGROUP_FZ5);
+
+void US_GeometryCache::Deinitialize()
+{
+	Entries.Empty();
+	FractureGraphs.Empty();
+	SET_MEMORY_STAT(STAT_FZ5_GeometryCacheMemory, 0);
+
+	Super::Deinitialize();
+}
+
+TSharedPtr<const FS_SliceGeometry> US_GeometryCache::FindOrBuild(UStaticMesh* StaticMesh, int32 LOD)
+{
+	if (!StaticMesh) return nullptr;
+
+	const TPair<TObjectKey<UStaticMesh>, int32> Key(StaticMesh, LOD);
+	if (const TSharedPtr<const FS_SliceGeometry>* Geometry = Entries.Find(Key))
+		return *Geometry;
+
+	LLM_SCOPE_BYTAG(FZ5_SourceGeometry);
+	TSharedPtr<const FS_SliceGeometry> Geometry = Build(StaticMesh, LOD);
+	if (Geometry) Entries.Add(Key, Geometry);
+	SET_MEMORY_STAT(STAT_FZ5_GeometryCacheMemory, GetAllocatedSize());
+	return Geometry;
+}
+
+TSharedPtr<const FS_FractureGraph> US_GeometryCache::FindOrBuildFracture(UGeometryCollection* Collection)
+{
+	if (!Collection) return nullptr;
+
+	if (const TSharedPtr<const FS_FractureGraph>* Graph = FractureGraphs.Find(Collection))
+		return *Graph;
+
+	LLM_SCOPE_BYTAG(FZ5_SourceGeometry);
+	TSharedPtr<const FS_FractureGraph> Graph = FS_FractureGraph::Build(*Collection);
+	if (Graph) FractureGraphs.Add(Collection, Graph);
+	SET_MEMORY_STAT(STAT_FZ5_GeometryCacheMemory, GetAllocatedSize());
+	return Graph;
+}
+
+void US_GeometryCache::Trim()
+{
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (It->Value.IsUnique()) It.RemoveCurrent();
+	}
+
+	for (auto It = FractureGraphs.CreateIterator(); It; ++It)
+	{
+		if (It->Value.IsUnique()) It.RemoveCurrent();
+	}
+
+	SET_MEMORY_STAT(STAT_FZ5_GeometryCacheMemory, GetAllocatedSize());
+}
+
+SIZE_T US_GeometryCache::GetAllocatedSize() const
+{
+	SIZE_T Size = Entries.GetAllocatedSize();
+	for (const auto& Entry : Entries)
+	{
+		for (const FS_SliceSection& Section : Entry.Value->Sections)
+		{
+			Size += Section.GetAllocatedSize();
+		}
+	}
+
+	Size += FractureGraphs.GetAllocatedSize();
+	for (const auto& Entry : FractureGraphs)
+	{
+		Size += Entry.Value->GetAllocatedSize();
+	}
+	return Size;
+}
+
+TSharedPtr<const FS_SliceGeometry> US_GeometryCache::Build(UStaticMesh* StaticMesh, int32 LOD)
+{
+	if (!StaticMesh->GetRenderData() || !StaticMesh->GetRenderData()->LODResources.IsValidIndex(LOD)) return nullptr;
+
+	TSharedPtr<FS_SliceGeometry> Geometry = MakeShared<FS_SliceGeometry>();
+
+	// Same source data as CopyProceduralMeshFromStaticMeshComponent, read once per mesh instead of once per actor.
+	const int32 NumSections = StaticMesh->GetNumSections(LOD);
+	Geometry->Sections.SetNum(NumSections);
+	Geometry->MaterialIndices.SetNum(NumSections);
+
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FProcMeshTangent> Tangents;
+	FProcMeshSection Section;
+
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		UKismetProceduralMeshLibrary::GetSectionFromStaticMesh(StaticMesh, LOD, SectionIndex, Vertices, Triangles, Normals, UVs, Tangents);
+
+		Section.Reset();
+		Section.ProcVertexBuffer.Reserve(Vertices.Num());
+		for (int32 VertexIndex = 0; VertexIndex < Vertices.Num(); VertexIndex++)
+		{
+			FProcMeshVertex& Vertex = Section.ProcVertexBuffer.AddDefaulted_GetRef();
+			Vertex.Position = Vertices[VertexIndex];
+			Vertex.Normal = Normals.IsValidIndex(VertexIndex) ? Normals[VertexIndex] : FVector::UpVector;
+			Vertex.Tangent = Tangents.IsValidIndex(VertexIndex) ? Tangents[VertexIndex] : FProcMeshTangent();
+			Vertex.UV0 = UVs.IsValidIndex(VertexIndex) ? UVs[VertexIndex] : FVector2D::ZeroVector;
+			Vertex.Color = FColor::White;
+			Section.SectionLocalBox += Vertex.Position;
+		}
+
+		Section.ProcIndexBuffer.Reserve(Triangles.Num());
+		for (const int32 Index : Triangles)
+		{
+			Section.ProcIndexBuffer.Add(Index);
+		}
+
+		Geometry->Sections[SectionIndex].FromProcMeshSection(Section);
+		Geometry->MaterialIndices[SectionIndex] = StaticMesh->GetRenderData()->LODResources[LOD].Sections[SectionIndex].MaterialIndex;
+	}
+
+	// Boxes are turned into hulls as well, basic shapes like the default cube only have a box.
+	if (const UBodySetup* BodySetup = StaticMesh->GetBodySetup())
+	{
+		for (const FKConvexElem& Convex : BodySetup->AggGeom.ConvexElems)
+		{
+			Geometry->ConvexHulls.Add(Convex.VertexData);
+		}
+
+		for (const FKBoxElem& Box : BodySetup->AggGeom.BoxElems)
+		{
+			const FTransform BoxTransform = Box.GetTransform();
+			TArray<FVector>& Hull = Geometry->ConvexHulls.AddDefaulted_GetRef();
+			for (int32 Corner = 0; Corner < 8; Corner++)
+			{
+				const FVector Local(Corner & 1 ? Box.X : -Box.X, Corner & 2 ? Box.Y : -Box.Y, Corner & 4 ? Box.Z : -Box.Z);
+				Hull.Add(BoxTransform.TransformPosition(Local * 0.5));
+			}
+		}
+	}
+
+	return Geometry;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "S_SliceKernel.h"
+#include "S_FractureGraph.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_GeometryCache.generated.h"
+
+class UStaticMesh;
+class UGeometryCollection;
+
+/*
+ * Slicing geometry of static meshes, shared by every sliceable using the same mesh and LOD until it is first cut,
+ * and the fracture graphs of the geometry collections the sliceables break into.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_GeometryCache : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	TMap<TPair<TObjectKey<UStaticMesh>, int32>, TSharedPtr<const FS_SliceGeometry>> Entries;
+	TMap<TObjectKey<UGeometryCollection>, TSharedPtr<const FS_FractureGraph>> FractureGraphs;
+
+	static TSharedPtr<const FS_SliceGeometry> Build(UStaticMesh* StaticMesh, int32 LOD);
+
+public:
+	virtual void Deinitialize() override;
+
+	/* Geometry of a static mesh LOD, read from its render data the first time it is asked for. */
+	TSharedPtr<const FS_SliceGeometry> FindOrBuild(UStaticMesh* StaticMesh, int32 LOD);
+
+	/* Fracture graph of a geometry collection, built from its rest collection the first time it is asked for. */
+	TSharedPtr<const FS_FractureGraph> FindOrBuildFracture(UGeometryCollection* Collection);
+
+	/* Drop the entries nothing but the cache refers to, called by the memory subsystem close to its budget. */
+	void Trim();
+
+	int32 GetNumEntries() const { return Entries.Num(); }
+	SIZE_T GetAllocatedSize() const;
+};
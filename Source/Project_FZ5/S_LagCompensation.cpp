@@ -0,0 +1,505 @@
+#include "S_LagCompensation.h"
+#include "Project_FZ5.h"
+#include "Async/ParallelFor.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Lag compensation record"), STAT_FZ5_LagRecord, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Lag compensation shots"), STAT_FZ5_LagShots, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Rewound shots"), STAT_FZ5_RewoundShots, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Lag compensated hitboxes"), STAT_FZ5_LagHitboxes, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Lag compensation history"), STAT_FZ5_LagMemory, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<float> CVarLagMaxRewind(
+	TEXT("fz5.Lag.MaxRewind"),
+	0.5f,
+	TEXT("Longest rewind in seconds, older shots are tested at the oldest frame. Read when the history is allocated."));
+
+static TAutoConsoleVariable<float> CVarLagRecordRate(
+	TEXT("fz5.Lag.RecordRate"),
+	60.f,
+	TEXT("Frames recorded per second at most. Read when the history is allocated."));
+
+static TAutoConsoleVariable<int32> CVarLagMaxHitboxes(
+	TEXT("fz5.Lag.MaxHitboxes"),
+	128,
+	TEXT("Hitboxes of players recorded per frame, kept for them alone. Read when the history is allocated."));
+
+static TAutoConsoleVariable<int32> CVarLagMaxFragmentHitboxes(
+	TEXT("fz5.Lag.MaxFragmentHitboxes"),
+	128,
+	TEXT("Hitboxes of moving fragments recorded per frame, on top of the ones of the players. Read when the history is allocated."));
+
+static TAutoConsoleVariable<int32> CVarLagParallel(
+	TEXT("fz5.Lag.Parallel"),
+	1,
+	TEXT("Resolve the shots of a frame on worker threads, 0 to resolve them on the game thread."));
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarLagDebug(
+	TEXT("fz5.Lag.Debug"),
+	0,
+	TEXT("Draw the resolved shots and the rewound hitbox they hit."));
+#endif
+
+// Shots starting further than this from their shooter are dropped.
+static constexpr float MaxShotOffset = 1000.f;
+
+// The world trace steps over tracked components, which are tested where they were instead.
+static constexpr int32 MaxWorldTraces = 4;
+
+
+void US_LagCompensation::Deinitialize()
+{
+	SlotComponents.Empty();
+	SlotShapes.Empty();
+	SlotLocalBounds.Empty();
+	FreeSlots.Empty();
+	FreeFragmentSlots.Empty();
+	Slots.Empty();
+	Hitboxes.Empty();
+	FrameTimes.Empty();
+	PendingShots.Empty();
+	Results.Empty();
+	OnShotResolved.Clear();
+	NumFrames = 0;
+
+	SET_MEMORY_STAT(STAT_FZ5_LagMemory, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId US_LagCompensation::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_LagCompensation, STATGROUP_Tickables);
+}
+
+bool US_LagCompensation::IsServer() const
+{
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+SIZE_T US_LagCompensation::GetAllocatedSize() const
+{
+	return Hitboxes.GetAllocatedSize() + FrameTimes.GetAllocatedSize() + SlotComponents.GetAllocatedSize() + SlotShapes.GetAllocatedSize()
+		+ SlotLocalBounds.GetAllocatedSize() + FreeSlots.GetAllocatedSize() + FreeFragmentSlots.GetAllocatedSize() + Slots.GetAllocatedSize();
+}
+
+void US_LagCompensation::FreeSlot(int32 Slot)
+{
+	SlotComponents[Slot] = nullptr;
+	(Slot < NumPawnSlots ? FreeSlots : FreeFragmentSlots).Add(Slot);
+}
+
+bool US_LagCompensation::Track(UPrimitiveComponent* Component, ES_HitboxShape Shape, ES_HitboxOwner Owner)
+{
+	if (!Component || !IsServer()) return false;
+
+	if (MaxSlots == 0)
+	{
+		// Allocated for the first tracked component, so never on a client. Sized once, the memory and
+		// the cost of a rewind do not grow past the hitbox limits whatever the number of players and fragments.
+		const float RecordRate = FMath::Max(1.f, CVarLagRecordRate.GetValueOnGameThread());
+		MaxFrames = FMath::CeilToInt(FMath::Max(0.f, CVarLagMaxRewind.GetValueOnGameThread()) * RecordRate) + 2;
+		NumPawnSlots = FMath::Max(1, CVarLagMaxHitboxes.GetValueOnGameThread());
+		MaxSlots = NumPawnSlots + FMath::Max(0, CVarLagMaxFragmentHitboxes.GetValueOnGameThread());
+
+		Hitboxes.SetNum(MaxFrames * MaxSlots);
+		FrameTimes.SetNumZeroed(MaxFrames);
+		SlotComponents.SetNum(MaxSlots);
+		SlotShapes.SetNum(MaxSlots);
+		SlotLocalBounds.SetNum(MaxSlots);
+		for (int32 Slot = MaxSlots - 1; Slot >= 0; Slot--)
+		{
+			(Slot < NumPawnSlots ? FreeSlots : FreeFragmentSlots).Add(Slot);
+		}
+
+		SET_MEMORY_STAT(STAT_FZ5_LagMemory, GetAllocatedSize());
+	}
+
+	int32 Slot = INDEX_NONE;
+	if (const int32* Found = Slots.Find(Component))
+	{
+		// Tracked again after a slice, with its new bounds.
+		Slot = *Found;
+	}
+	else
+	{
+		// Fragments have slots of their own, however many there are a player joining late is always rewound.
+		TArray<int32>& Free = Owner == ES_HitboxOwner::Pawn ? FreeSlots : FreeFragmentSlots;
+		if (Free.Num() == 0) return false;
+
+		Slot = Free.Pop(false);
+		Slots.Add(Component, Slot);
+		SlotComponents[Slot] = Component;
+
+		// Not there on the frames recorded before.
+		for (int32 Frame = 0; Frame < MaxFrames; Frame++)
+		{
+			Hitboxes[Frame * MaxSlots + Slot] = FS_Hitbox();
+		}
+	}
+
+	SlotShapes[Slot] = Shape;
+	SlotLocalBounds[Slot] = Component->CalcBounds(FTransform::Identity).GetBox();
+
+	SET_DWORD_STAT(STAT_FZ5_LagHitboxes, Slots.Num());
+	return true;
+}
+
+void US_LagCompensation::Untrack(UPrimitiveComponent* Component)
+{
+	int32 Slot = INDEX_NONE;
+	if (!Slots.RemoveAndCopyValue(Component, Slot)) return;
+
+	FreeSlot(Slot);
+
+	SET_DWORD_STAT(STAT_FZ5_LagHitboxes, Slots.Num());
+}
+
+void US_LagCompensation::QueueShot(const FS_Shot& Shot)
+{
+	const AActor* Shooter = Shot.Shooter.Get();
+	if (!Shooter || !IsServer() || Shot.Distance <= 0.f) return;
+
+	if (FVector::DistSquared(Shot.Start, Shooter->GetActorLocation()) > FMath::Square(MaxShotOffset))
+	{
+		UE_LOG(LogFZ5, Verbose, TEXT("Lag compensation: shot of %s dropped, it starts too far from it"), *Shooter->GetName());
+		return;
+	}
+
+	// A client cannot claim to have fired in the future, nor further back than the history.
+	const float Now = GetWorld()->GetTimeSeconds();
+	FS_Shot& Queued = PendingShots.Add_GetRef(Shot);
+	Queued.Direction = Shot.Direction.GetSafeNormal();
+	Queued.Time = FMath::Clamp(Shot.Time, Now - CVarLagMaxRewind.GetValueOnGameThread(), Now);
+
+	if (Queued.Direction.IsZero()) PendingShots.Pop(false);
+}
+
+void US_LagCompensation::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (MaxSlots == 0 && PendingShots.Num() == 0) return;
+
+	RecordTime -= DeltaTime;
+	if (MaxSlots > 0 && RecordTime <= 0.f)
+	{
+		RecordTime = 1.f / FMath::Max(1.f, CVarLagRecordRate.GetValueOnGameThread());
+		Record();
+	}
+
+	ResolveShots();
+}
+
+void US_LagCompensation::Record()
+{
+	FZ5_SCOPE(LagRecord);
+
+	int32 Frame = 0;
+	if (NumFrames < MaxFrames)
+	{
+		Frame = (FirstFrame + NumFrames) % MaxFrames;
+		NumFrames++;
+	}
+	else
+	{
+		Frame = FirstFrame;
+		FirstFrame = (FirstFrame + 1) % MaxFrames;
+	}
+
+	FrameTimes[Frame] = GetWorld()->GetTimeSeconds();
+	FS_Hitbox* FrameHitboxes = &Hitboxes[Frame * MaxSlots];
+
+	for (int32 Slot = 0; Slot < MaxSlots; Slot++)
+	{
+		FS_Hitbox& Hitbox = FrameHitboxes[Slot];
+		const UPrimitiveComponent* Component = SlotComponents[Slot].Get();
+		if (!Component)
+		{
+			// Destroyed without being untracked, a player leaving for one.
+			if (!SlotComponents[Slot].IsExplicitlyNull())
+			{
+				for (auto It = Slots.CreateIterator(); It; ++It)
+				{
+					if (It.Value() != Slot) continue;
+
+					It.RemoveCurrent();
+					break;
+				}
+
+				FreeSlot(Slot);
+				SET_DWORD_STAT(STAT_FZ5_LagHitboxes, Slots.Num());
+			}
+
+			Hitbox = FS_Hitbox();
+			continue;
+		}
+
+		const FTransform& Transform = Component->GetComponentTransform();
+		Hitbox.Rotation = FQuat4f(Transform.GetRotation());
+
+		if (SlotShapes[Slot] == ES_HitboxShape::Capsule)
+		{
+			const UCapsuleComponent* Capsule = CastChecked<UCapsuleComponent>(Component);
+			Hitbox.Center = Transform.GetLocation();
+			Hitbox.Extent = FVector3f(Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleHalfHeight());
+		}
+		else
+		{
+			const FBox& Bounds = SlotLocalBounds[Slot];
+			Hitbox.Center = Transform.TransformPosition(Bounds.GetCenter());
+			Hitbox.Extent = FVector3f(Bounds.GetExtent() * Transform.GetScale3D().GetAbs());
+		}
+	}
+}
+
+bool US_LagCompensation::Rewind(int32 Slot, float Time, FS_Hitbox& OutHitbox) const
+{
+	if (NumFrames == 0) return false;
+
+	// Last frame recorded at or before Time, found by bisection over the ring from oldest to newest.
+	int32 Low = 0;
+	int32 High = NumFrames - 1;
+	while (Low < High)
+	{
+		const int32 Middle = (Low + High + 1) / 2;
+		if (FrameTimes[(FirstFrame + Middle) % MaxFrames] <= Time) Low = Middle;
+		else High = Middle - 1;
+	}
+
+	const FS_Hitbox& Before = GetHitbox(Low, Slot);
+	const FS_Hitbox& After = GetHitbox(FMath::Min(Low + 1, NumFrames - 1), Slot);
+	const bool bBefore = !Before.Extent.IsZero();
+	const bool bAfter = !After.Extent.IsZero();
+
+	if (!bBefore || !bAfter || Low == NumFrames - 1)
+	{
+		if (!bBefore && !bAfter) return false;
+
+		OutHitbox = bBefore ? Before : After;
+		return true;
+	}
+
+	const float TimeBefore = FrameTimes[(FirstFrame + Low) % MaxFrames];
+	const float TimeAfter = FrameTimes[(FirstFrame + Low + 1) % MaxFrames];
+	const float Alpha = TimeAfter > TimeBefore ? FMath::Clamp((Time - TimeBefore) / (TimeAfter - TimeBefore), 0.f, 1.f) : 1.f;
+
+	OutHitbox.Center = FMath::Lerp(Before.Center, After.Center, (double)Alpha);
+	OutHitbox.Rotation = FQuat4f::Slerp(Before.Rotation, After.Rotation, Alpha);
+	OutHitbox.Extent = FMath::Lerp(Before.Extent, After.Extent, Alpha);
+	return true;
+}
+
+bool US_LagCompensation::RayHitbox(const FS_Hitbox& Hitbox, ES_HitboxShape Shape, const FVector& Start, const FVector& Direction, float MaxDistance, float& OutDistance, FVector& OutNormal)
+{
+	// In the space of the hitbox, centered and axis aligned.
+	const FQuat Rotation(Hitbox.Rotation);
+	const FVector P = Rotation.UnrotateVector(Start - Hitbox.Center);
+	const FVector D = Rotation.UnrotateVector(Direction);
+	const FVector E(Hitbox.Extent);
+
+	double Best = MaxDistance;
+	FVector BestNormal = FVector::ZeroVector;
+
+	if (Shape == ES_HitboxShape::Box)
+	{
+		double Near = 0.0;
+		double Far = MaxDistance;
+		int32 Axis = INDEX_NONE;
+		double Sign = 0.0;
+
+		for (int32 Index = 0; Index < 3; Index++)
+		{
+			if (FMath::Abs(D[Index]) < UE_SMALL_NUMBER)
+			{
+				if (FMath::Abs(P[Index]) > E[Index]) return false;
+				continue;
+			}
+
+			double T1 = (-E[Index] - P[Index]) / D[Index];
+			double T2 = (E[Index] - P[Index]) / D[Index];
+			double EntrySign = -1.0;
+			if (T1 > T2)
+			{
+				Swap(T1, T2);
+				EntrySign = 1.0;
+			}
+
+			if (T1 > Near)
+			{
+				Near = T1;
+				Axis = Index;
+				Sign = EntrySign;
+			}
+			Far = FMath::Min(Far, T2);
+			if (Near > Far) return false;
+		}
+
+		Best = Near;
+		if (Axis != INDEX_NONE) BestNormal[Axis] = Sign;
+		else BestNormal = -D;
+	}
+	else
+	{
+		const double Radius = E.X;
+		const double HalfSegment = FMath::Max(0.0, E.Z - Radius);
+		bool bHit = false;
+
+		// The side of the cylinder, then the two spheres closing it.
+		const double A = D.X * D.X + D.Y * D.Y;
+		if (A > UE_SMALL_NUMBER)
+		{
+			const double B = P.X * D.X + P.Y * D.Y;
+			const double C = P.X * P.X + P.Y * P.Y - Radius * Radius;
+			const double Discriminant = B * B - A * C;
+			if (Discriminant >= 0.0)
+			{
+				const double T = FMath::Max(0.0, (-B - FMath::Sqrt(Discriminant)) / A);
+				const FVector Point = P + D * T;
+				if (T <= Best && FMath::Abs(Point.Z) <= HalfSegment && (C > 0.0 || T == 0.0))
+				{
+					Best = T;
+					BestNormal = C > 0.0 ? FVector(Point.X, Point.Y, 0.0).GetSafeNormal() : -D;
+					bHit = true;
+				}
+			}
+		}
+
+		for (const double CapZ : { -HalfSegment, HalfSegment })
+		{
+			const FVector M = P - FVector(0.0, 0.0, CapZ);
+			const double B = FVector::DotProduct(M, D);
+			const double C = M.SizeSquared() - Radius * Radius;
+			if (C > 0.0 && B > 0.0) continue;
+
+			const double Discriminant = B * B - C;
+			if (Discriminant < 0.0) continue;
+
+			const double T = FMath::Max(0.0, -B - FMath::Sqrt(Discriminant));
+			if (T > Best) continue;
+
+			Best = T;
+			BestNormal = C > 0.0 ? (M + D * T).GetSafeNormal() : -D;
+			bHit = true;
+		}
+
+		if (!bHit) return false;
+	}
+
+	if (Best > MaxDistance) return false;
+
+	OutDistance = Best;
+	OutNormal = Rotation.RotateVector(BestNormal);
+	return true;
+}
+
+void US_LagCompensation::ResolveShot(const FS_Shot& Shot, FS_ShotResult& OutResult) const
+{
+	const AActor* Shooter = Shot.Shooter.Get();
+	OutResult.Shooter = Shot.Shooter;
+	OutResult.Start = Shot.Start;
+
+	float BestDistance = Shot.Distance;
+	const FVector End = Shot.Start + Shot.Direction * Shot.Distance;
+
+	// The world as it is now, stepping over what is tested in the past below.
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(FZ5LagCompensation), false, Shooter);
+	for (int32 Trace = 0; Trace < MaxWorldTraces; Trace++)
+	{
+		FHitResult Hit;
+		if (!GetWorld()->LineTraceSingleByChannel(Hit, Shot.Start, End, ECC_Visibility, Params)) break;
+
+		UPrimitiveComponent* Component = Hit.GetComponent();
+		if (Component && Slots.Contains(Component))
+		{
+			Params.AddIgnoredComponent(Component);
+			continue;
+		}
+
+		BestDistance = Hit.Distance;
+		OutResult.Component = Component;
+		OutResult.Location = Hit.ImpactPoint;
+		OutResult.Normal = Hit.ImpactNormal;
+		OutResult.Distance = Hit.Distance;
+		OutResult.bHit = true;
+		break;
+	}
+
+	// Every tracked hitbox, where it was when the shooter fired.
+	for (int32 Slot = 0; Slot < MaxSlots; Slot++)
+	{
+		const UPrimitiveComponent* Component = SlotComponents[Slot].Get();
+		if (!Component || Component->GetOwner() == Shooter) continue;
+
+		FS_Hitbox Hitbox;
+		if (!Rewind(Slot, Shot.Time, Hitbox)) continue;
+
+		// Cheap rejection on the sphere around the hitbox.
+		if (FMath::PointDistToSegmentSquared(Hitbox.Center, Shot.Start, Shot.Start + Shot.Direction * BestDistance) > Hitbox.Extent.SizeSquared())
+			continue;
+
+		float Distance = 0.f;
+		FVector Normal;
+		if (!RayHitbox(Hitbox, SlotShapes[Slot], Shot.Start, Shot.Direction, BestDistance, Distance, Normal)) continue;
+
+		BestDistance = Distance;
+		OutResult.Component = SlotComponents[Slot];
+		OutResult.Location = Shot.Start + Shot.Direction * Distance;
+		OutResult.Normal = Normal;
+		OutResult.Distance = Distance;
+		OutResult.bHit = true;
+		OutResult.bRewound = true;
+	}
+
+	if (!OutResult.bHit)
+		OutResult.Location = End;
+}
+
+void US_LagCompensation::ResolveShots()
+{
+	if (PendingShots.Num() == 0) return;
+
+	{
+		FZ5_SCOPE(LagShots);
+		INC_DWORD_STAT_BY(STAT_FZ5_RewoundShots, PendingShots.Num());
+
+		Results.Reset();
+		Results.SetNum(PendingShots.Num());
+
+		const EParallelForFlags Flags = CVarLagParallel.GetValueOnGameThread() ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+		ParallelFor(TEXT("FZ5LagShots"), PendingShots.Num(), 4, [this](int32 Index)
+		{
+			ResolveShot(PendingShots[Index], Results[Index]);
+		}, Flags);
+	}
+	PendingShots.Reset();
+
+	for (const FS_ShotResult& Result : Results)
+	{
+#if !UE_BUILD_SHIPPING
+		if (CVarLagDebug.GetValueOnGameThread())
+			DrawDebugLine(GetWorld(), Result.Start, Result.Location, Result.bRewound ? FColor::Red : (Result.bHit ? FColor::Blue : FColor::Green), false, 1.f, 0, 2.f);
+#endif
+
+		OnShotResolved.Broadcast(Result);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs LagStatsCommand(
+	TEXT("fz5.Lag.Stats"),
+	TEXT("Log the tracked hitboxes, the recorded history and its memory."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (const US_LagCompensation* LagCompensation = World ? World->GetSubsystem<US_LagCompensation>() : nullptr)
+		{
+			UE_LOG(LogFZ5, Display, TEXT("Lag compensation: %d hitboxes, %.3f s of history, %.1f KB"),
+				LagCompensation->GetNumTracked(), LagCompensation->GetHistoryLength(), LagCompensation->GetAllocatedSize() / 1024.0);
+		}
+	}));
+#endif
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_LagCompensation.generated.h"
+
+class UPrimitiveComponent;
+
+enum class ES_HitboxShape : uint8 { Capsule, Box };
+
+/* Which pool of slots a hitbox takes, fragments can never take the slot of a player. */
+enum class ES_HitboxOwner : uint8 { Pawn, Fragment };
+
+/* Where a tracked component was on one recorded frame, zero extent when it was not tracked yet. */
+struct FS_Hitbox
+{
+	FVector Center = FVector::ZeroVector;
+	FQuat4f Rotation = FQuat4f::Identity;
+
+	// Half size of the box, or radius in X and Y and half height in Z for a capsule.
+	FVector3f Extent = FVector3f::ZeroVector;
+};
+
+/* A shot fired at Time on the server clock, as seen by its shooter. */
+struct FS_Shot
+{
+	TWeakObjectPtr<AActor> Shooter;
+	FVector Start = FVector::ZeroVector;
+	FVector Direction = FVector::ForwardVector;
+	float Distance = 0.f;
+	float Time = 0.f;
+};
+
+struct FS_ShotResult
+{
+	TWeakObjectPtr<AActor> Shooter;
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	FVector Start = FVector::ZeroVector;
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::ZeroVector;
+	float Distance = 0.f;
+	bool bHit = false;
+
+	// Hit a tracked component where it was at the time of the shot, rather than the world as it is now.
+	bool bRewound = false;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FS_OnShotResolved, const FS_ShotResult&);
+
+/*
+ * Server side history of the hitboxes of the players and moving fragments, recorded at a fixed rate in a ring
+ * of frames sized once for the longest rewind. Shots queued during a frame are resolved together on worker threads
+ * against the hitboxes interpolated at their time, and against the world as it is for everything else.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_LagCompensation : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	// One slot per tracked component, reused once it is untracked. The players have the first NumPawnSlots.
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> SlotComponents;
+	TArray<ES_HitboxShape> SlotShapes;
+	TArray<FBox> SlotLocalBounds;
+	TArray<int32> FreeSlots;
+	TArray<int32> FreeFragmentSlots;
+	int32 NumPawnSlots = 0;
+	TMap<TObjectKey<UPrimitiveComponent>, int32> Slots;
+
+	// Ring of recorded frames, MaxSlots hitboxes each, oldest at FirstFrame.
+	TArray<FS_Hitbox> Hitboxes;
+	TArray<float> FrameTimes;
+	int32 FirstFrame = 0;
+	int32 NumFrames = 0;
+	int32 MaxFrames = 0;
+	int32 MaxSlots = 0;
+	float RecordTime = 0.f;
+
+	TArray<FS_Shot> PendingShots;
+	TArray<FS_ShotResult> Results;
+
+	bool IsServer() const;
+	void Record();
+	void ResolveShots();
+	void FreeSlot(int32 Slot);
+
+	const FS_Hitbox& GetHitbox(int32 Frame, int32 Slot) const { return Hitboxes[((FirstFrame + Frame) % MaxFrames) * MaxSlots + Slot]; }
+
+	/* Hitbox of Slot interpolated at Time, false when it was not tracked then. */
+	bool Rewind(int32 Slot, float Time, FS_Hitbox& OutHitbox) const;
+	void ResolveShot(const FS_Shot& Shot, FS_ShotResult& OutResult) const;
+
+	static bool RayHitbox(const FS_Hitbox& Hitbox, ES_HitboxShape Shape, const FVector& Start, const FVector& Direction, float MaxDistance, float& OutDistance, FVector& OutNormal);
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Record the hitbox of Component every frame from now on, false when every slot of its owner is taken or on a client. */
+	bool Track(UPrimitiveComponent* Component, ES_HitboxShape Shape, ES_HitboxOwner Owner);
+	void Untrack(UPrimitiveComponent* Component);
+
+	/* Queue a shot, resolved with the others at the end of the frame. */
+	void QueueShot(const FS_Shot& Shot);
+
+	/* Broadcast on the game thread for every resolved shot. */
+	FS_OnShotResolved OnShotResolved;
+
+	int32 GetNumTracked() const { return Slots.Num(); }
+	float GetHistoryLength() const { return NumFrames > 1 ? FrameTimes[(FirstFrame + NumFrames - 1) % MaxFrames] - FrameTimes[FirstFrame] : 0.f; }
+	SIZE_T GetAllocatedSize() const;
+};
@@ -0,0 +1,471 @@
+#include "S_MovementComponent.h"
+#include "S_QueryService.h"
+#include "Project_FZ5.h"
+
+#include "GameFramework/Character.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Custom movement"), STAT_FZ5_CustomMovement, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Wall run trace"), STAT_FZ5_WallRunTrace, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Wall climb trace"), STAT_FZ5_WallClimbTrace, STATGROUP_FZ5);
+
+#pragma region SAVED MOVE...
+/* A move of the owning client, with the requests it sent and the state it started from. */
+class FS_SavedMove : public FSavedMove_Character
+{
+	typedef FSavedMove_Character Super;
+
+	bool bWantsToDash = false;
+	bool bWantsToSlide = false;
+	bool bWantsToWallMove = false;
+	bool bWantsToReleaseWall = false;
+
+	float DashTimeLeft = 0.f;
+	FVector DashDirection = FVector::ForwardVector;
+	float WallTimeLeft = 0.f;
+	float WallSpeed = 0.f;
+	float WallJumpTimeLeft = 0.f;
+	TWeakObjectPtr<AActor> WallActor;
+	FVector WallNormal = FVector::ZeroVector;
+	TWeakObjectPtr<AActor> LastWallActor;
+	FVector LastWallNormal = FVector::ZeroVector;
+	bool bWallReset = false;
+
+public:
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* Character) override;
+};
+
+void FS_SavedMove::Clear()
+{
+	Super::Clear();
+
+	bWantsToDash = false;
+	bWantsToSlide = false;
+	bWantsToWallMove = false;
+	bWantsToReleaseWall = false;
+
+	DashTimeLeft = 0.f;
+	DashDirection = FVector::ForwardVector;
+	WallTimeLeft = 0.f;
+	WallSpeed = 0.f;
+	WallJumpTimeLeft = 0.f;
+	WallActor.Reset();
+	WallNormal = FVector::ZeroVector;
+	LastWallActor.Reset();
+	LastWallNormal = FVector::ZeroVector;
+	bWallReset = false;
+}
+
+uint8 FS_SavedMove::GetCompressedFlags() const
+{
+	uint8 Flags = Super::GetCompressedFlags();
+
+	if (bWantsToDash) Flags |= FLAG_Custom_0;
+	if (bWantsToSlide) Flags |= FLAG_Custom_1;
+	if (bWantsToWallMove) Flags |= FLAG_Custom_2;
+	if (bWantsToReleaseWall) Flags |= FLAG_Custom_3;
+
+	return Flags;
+}
+
+bool FS_SavedMove::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const
+{
+	// A dash or wall request must reach the server in a move of its own.
+	const FS_SavedMove* Other = static_cast<const FS_SavedMove*>(NewMove.Get());
+	if (bWantsToDash || bWantsToWallMove || bWantsToReleaseWall || GetCompressedFlags() != Other->GetCompressedFlags())
+		return false;
+
+	return Super::CanCombineWith(NewMove, Character, MaxDelta);
+}
+
+void FS_SavedMove::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	const US_MovementComponent* Movement = CastChecked<US_MovementComponent>(Character->GetCharacterMovement());
+
+	bWantsToDash = Movement->bWantsToDash;
+	bWantsToSlide = Movement->bWantsToSlide;
+	bWantsToWallMove = Movement->bWantsToWallMove;
+	bWantsToReleaseWall = Movement->bWantsToReleaseWall;
+
+	DashTimeLeft = Movement->DashTimeLeft;
+	DashDirection = Movement->DashDirection;
+	WallTimeLeft = Movement->WallTimeLeft;
+	WallSpeed = Movement->WallSpeed;
+	WallJumpTimeLeft = Movement->WallJumpTimeLeft;
+	WallActor = Movement->WallActor;
+	WallNormal = Movement->WallNormal;
+	LastWallActor = Movement->LastWallActor;
+	LastWallNormal = Movement->LastWallNormal;
+	bWallReset = Movement->bWallReset;
+}
+
+void FS_SavedMove::PrepMoveFor(ACharacter* Character)
+{
+	Super::PrepMoveFor(Character);
+
+	// The requests come back through the compressed flags, only the state is restored here.
+	US_MovementComponent* Movement = CastChecked<US_MovementComponent>(Character->GetCharacterMovement());
+
+	Movement->DashTimeLeft = DashTimeLeft;
+	Movement->DashDirection = DashDirection;
+	Movement->WallTimeLeft = WallTimeLeft;
+	Movement->WallSpeed = WallSpeed;
+	Movement->WallJumpTimeLeft = WallJumpTimeLeft;
+	Movement->WallActor = WallActor;
+	Movement->WallNormal = WallNormal;
+	Movement->LastWallActor = LastWallActor;
+	Movement->LastWallNormal = LastWallNormal;
+	Movement->bWallReset = bWallReset;
+}
+
+class FS_NetworkPredictionData_Client : public FNetworkPredictionData_Client_Character
+{
+public:
+	FS_NetworkPredictionData_Client(const UCharacterMovementComponent& ClientMovement)
+		: FNetworkPredictionData_Client_Character(ClientMovement)
+	{
+	}
+
+	virtual FSavedMovePtr AllocateNewMove() override
+	{
+		return FSavedMovePtr(new FS_SavedMove());
+	}
+};
+
+FNetworkPredictionData_Client* US_MovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		US_MovementComponent* MutableThis = const_cast<US_MovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FS_NetworkPredictionData_Client(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void US_MovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsToDash = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+	bWantsToSlide = (Flags & FSavedMove_Character::FLAG_Custom_1) != 0;
+	bWantsToWallMove = (Flags & FSavedMove_Character::FLAG_Custom_2) != 0;
+	bWantsToReleaseWall = (Flags & FSavedMove_Character::FLAG_Custom_3) != 0;
+}
+#pragma endregion
+
+#pragma region WALL...
+bool US_MovementComponent::TraceWall(ES_QueryProbe Probe, const FVector& Direction, FHitResult& OutHit) const
+{
+	const FVector Start = UpdatedComponent->GetComponentLocation();
+	const FVector End = Start + Direction * WallCheckDistance;
+
+	// Read from the batch traced where the character stood at the start of the frame.
+	if (US_QueryService* QueryService = GetWorld()->GetSubsystem<US_QueryService>())
+		return QueryService->Trace(CharacterOwner, Probe, Start, End, OutHit);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(FZ5WallTrace), false, CharacterOwner);
+	return GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, Params);
+}
+
+bool US_MovementComponent::IsLastWall(const FHitResult& Hit) const
+{
+	return Hit.GetActor() == LastWallActor.Get() && Hit.ImpactNormal == LastWallNormal;
+}
+
+FVector US_MovementComponent::GetWallRunDirection(FHitResult& OutHit) const
+{
+	FZ5_SCOPE(WallRunTrace);
+
+	const FVector Forward = UpdatedComponent->GetForwardVector();
+	const FVector Right = UpdatedComponent->GetRightVector();
+
+	// The right side is only checked when there is no wall on the left.
+	if (!TraceWall(ES_QueryProbe::WallLeft, -Right, OutHit) && !TraceWall(ES_QueryProbe::WallRight, Right, OutHit))
+		return FVector::ZeroVector;
+
+	if (IsLastWall(OutHit))
+		return FVector::ZeroVector;
+
+	const float Dot = FVector::DotProduct(OutHit.ImpactNormal, Forward);
+	if (Dot >= -0.1f || Dot <= -0.7f)
+		return FVector::ZeroVector;
+
+	FVector WallVector = FVector::CrossProduct(OutHit.ImpactNormal, FVector::UpVector);
+	WallVector.Normalize();
+	return (FVector::DotProduct(WallVector, Forward) > 0.f) ? WallVector : -WallVector;
+}
+
+FVector US_MovementComponent::GetWallClimbDirection(FHitResult& OutHit) const
+{
+	FZ5_SCOPE(WallClimbTrace);
+
+	const FVector Forward = UpdatedComponent->GetForwardVector();
+
+	if (TraceWall(ES_QueryProbe::WallForward, Forward, OutHit) && FVector::DotProduct(OutHit.ImpactNormal, Forward) <= -0.7f)
+		return FVector::UpVector;
+
+	return FVector::ZeroVector;
+}
+
+bool US_MovementComponent::CanWallJump() const
+{
+	FHitResult WallHit;
+	return IsWallRunning() || IsWallClimbing() || (bWallReset && !GetWallClimbDirection(WallHit).IsZero());
+}
+
+bool US_MovementComponent::CanWallRun() const
+{
+	// Not out of a dash along the ground. A dash gets no input, it moves along the one it started with.
+	FHitResult WallHit;
+	return (IsMoving() || IsDashing()) && !(IsDashing() && CurrentFloor.IsWalkableFloor()) && !GetWallRunDirection(WallHit).IsZero();
+}
+
+bool US_MovementComponent::CanWallClimb() const
+{
+	FHitResult WallHit;
+	return IsMoving() && IsMovingOnGround() && !GetWallClimbDirection(WallHit).IsZero();
+}
+#pragma endregion
+
+#pragma region STATES...
+void US_MovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	WallJumpTimeLeft = FMath::Max(0.f, WallJumpTimeLeft - DeltaSeconds);
+
+	if (bWantsToReleaseWall && (IsWallRunning() || IsWallClimbing()))
+		SetMovementMode(MOVE_Falling);
+
+	if (bWantsToWallMove)
+	{
+		if (CanWallJump())
+		{
+			StartWallJump();
+		}
+		else if (CanWallRun())
+		{
+			WallSpeed = (Velocity.Size2D() < MaxWalkSpeed) ? WallRunSpeed : Velocity.Size2D();
+			WallTimeLeft = MaxWallRunTime;
+			bWallReset = false;
+			JumpOntoWall();
+			SetMovementMode(MOVE_Custom, CMOVE_WALLRUN);
+		}
+		else if (CanWallClimb())
+		{
+			WallTimeLeft = MaxWallClimbTime;
+			bWallReset = false;
+			JumpOntoWall();
+			SetMovementMode(MOVE_Custom, CMOVE_WALLCLIMB);
+		}
+	}
+
+	if (bWantsToDash && !IsDashing())
+		StartDash();
+
+	// One move per request, the slide is held instead.
+	bWantsToDash = false;
+	bWantsToWallMove = false;
+	bWantsToReleaseWall = false;
+}
+
+void US_MovementComponent::StartDash()
+{
+	// Dashing out of a wall jump allows another one from the next wall faced.
+	if (IsWallJumping())
+	{
+		bWallReset = true;
+		WallJumpTimeLeft = 0.f;
+	}
+
+	// Along the input, forward when there is none.
+	DashDirection = FVector(Acceleration.X, Acceleration.Y, 0.f).GetSafeNormal();
+	if (DashDirection.IsZero())
+		DashDirection = UpdatedComponent->GetForwardVector().GetSafeNormal2D();
+
+	DashTimeLeft = DashTime;
+	Velocity.Z = 0.f;
+	SetMovementMode(MOVE_Custom, CMOVE_DASH);
+}
+
+void US_MovementComponent::StartWallJump()
+{
+	if (!IsWallRunning() && !IsWallClimbing())
+	{
+		FHitResult WallHit;
+		GetWallClimbDirection(WallHit);
+		WallActor = WallHit.GetActor();
+		WallNormal = WallHit.ImpactNormal;
+	}
+
+	if (bWallReset) Velocity = FVector::UpVector * WallResetJumpSpeed;
+	else Velocity.Z = 0.f;
+
+	bWallReset = false;
+	WallJumpTimeLeft = WallJumpTime;
+	StopWallMove();
+
+	FVector JumpDir = WallNormal + FVector::UpVector;
+	JumpDir.Normalize();
+	AddImpulse(JumpDir * WallForce);
+}
+
+void US_MovementComponent::JumpOntoWall()
+{
+	if (IsMovingOnGround())
+		Velocity.Z = FMath::Max(Velocity.Z, JumpZVelocity);
+}
+
+void US_MovementComponent::StopWallMove()
+{
+	LastWallActor = WallActor;
+	LastWallNormal = WallNormal;
+	SetMovementMode(MOVE_Falling);
+}
+
+void US_MovementComponent::ProcessLanded(const FHitResult& Hit, float RemainingTime, int32 Iterations)
+{
+	// The floor becomes the last wall, so the one left before can be run on again.
+	LastWallActor = Hit.GetActor();
+	LastWallNormal = Hit.ImpactNormal;
+	bWallReset = false;
+
+	Super::ProcessLanded(Hit, RemainingTime, Iterations);
+}
+
+float US_MovementComponent::GetMaxBrakingDeceleration() const
+{
+	return IsSliding() ? SlideDeceleration : Super::GetMaxBrakingDeceleration();
+}
+#pragma endregion
+
+#pragma region PHYSICS...
+void US_MovementComponent::PhysCustom(float DeltaTime, int32 Iterations)
+{
+	FZ5_SCOPE(CustomMovement);
+
+	Super::PhysCustom(DeltaTime, Iterations);
+
+	switch (CustomMovementMode)
+	{
+	case CMOVE_DASH:
+		PhysDash(DeltaTime, Iterations);
+		break;
+	case CMOVE_WALLRUN:
+		PhysWallRun(DeltaTime, Iterations);
+		break;
+	case CMOVE_WALLCLIMB:
+		PhysWallClimb(DeltaTime, Iterations);
+		break;
+	default:
+		SetMovementMode(MOVE_Falling);
+		break;
+	}
+}
+
+void US_MovementComponent::MoveAlong(float DeltaTime)
+{
+	const FVector Delta = Velocity * DeltaTime;
+	FHitResult Hit;
+	SafeMoveUpdatedComponent(Delta, UpdatedComponent->GetComponentQuat(), true, Hit);
+
+	if (Hit.IsValidBlockingHit())
+	{
+		HandleImpact(Hit, DeltaTime, Delta);
+		SlideAlongSurface(Delta, 1.f - Hit.Time, Hit.Normal, Hit, true);
+	}
+}
+
+void US_MovementComponent::EndCustomMovement(float DeltaTime, int32 Iterations)
+{
+	FFindFloorResult Floor;
+	FindFloor(UpdatedComponent->GetComponentLocation(), Floor, false);
+	SetMovementMode(Floor.IsWalkableFloor() ? MOVE_Walking : MOVE_Falling);
+	StartNewPhysics(DeltaTime, Iterations);
+}
+
+void US_MovementComponent::PhysDash(float DeltaTime, int32 Iterations)
+{
+	const float MoveTime = FMath::Min(DeltaTime, DashTimeLeft);
+	DashTimeLeft -= MoveTime;
+
+	// Flat at the dash speed, still falling when in the air.
+	const float VerticalSpeed = CurrentFloor.IsWalkableFloor() ? 0.f : Velocity.Z + GetGravityZ() * MoveTime;
+	Velocity = DashDirection * DashSpeed + FVector::UpVector * VerticalSpeed;
+	MoveAlong(MoveTime);
+
+	FindFloor(UpdatedComponent->GetComponentLocation(), CurrentFloor, false);
+	if (CurrentFloor.IsWalkableFloor())
+		AdjustFloorHeight();
+
+	if (DashTimeLeft <= 0.f)
+		EndCustomMovement(DeltaTime - MoveTime, Iterations);
+}
+
+void US_MovementComponent::PhysWallRun(float DeltaTime, int32 Iterations)
+{
+	FHitResult WallHit;
+	const FVector Direction = GetWallRunDirection(WallHit);
+	if (Direction.IsZero() || WallTimeLeft <= 0.f)
+	{
+		StopWallMove();
+		StartNewPhysics(DeltaTime, Iterations);
+		return;
+	}
+
+	WallActor = WallHit.GetActor();
+	WallNormal = WallHit.ImpactNormal;
+
+	const float MoveTime = FMath::Min(DeltaTime, WallTimeLeft);
+	WallTimeLeft -= MoveTime;
+
+	// Along the wall, rising speed fades with gravity but the character never falls while running.
+	const float VerticalSpeed = FMath::Max(0.f, Velocity.Z + GetGravityZ() * MoveTime);
+	Velocity = Direction * WallSpeed + FVector::UpVector * VerticalSpeed;
+
+	// Pressed into the wall, so it follows the wall when it curves away.
+	if (Mass > 0.f)
+		Velocity -= WallNormal * (WallForce / Mass * MoveTime);
+	MoveAlong(MoveTime);
+
+	if (WallTimeLeft <= 0.f)
+	{
+		StopWallMove();
+		StartNewPhysics(DeltaTime - MoveTime, Iterations);
+	}
+}
+
+void US_MovementComponent::PhysWallClimb(float DeltaTime, int32 Iterations)
+{
+	FHitResult WallHit;
+	const FVector Direction = GetWallClimbDirection(WallHit);
+	if (Direction.IsZero() || WallTimeLeft <= 0.f)
+	{
+		SetMovementMode(MOVE_Falling);
+		StartNewPhysics(DeltaTime, Iterations);
+		return;
+	}
+
+	WallActor = WallHit.GetActor();
+	WallNormal = WallHit.ImpactNormal;
+
+	const float MoveTime = FMath::Min(DeltaTime, WallTimeLeft);
+	WallTimeLeft -= MoveTime;
+
+	Velocity = Direction * WallClimbSpeed;
+	MoveAlong(MoveTime);
+
+	if (WallTimeLeft <= 0.f)
+	{
+		SetMovementMode(MOVE_Falling);
+		StartNewPhysics(DeltaTime - MoveTime, Iterations);
+	}
+}
+#pragma endregion
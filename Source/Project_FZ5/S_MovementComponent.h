@@ -0,0 +1,119 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "S_MovementComponent.generated.h"
+
+enum class ES_QueryProbe : uint8;
+
+enum CustomMovementMode { CMOVE_NONE, CMOVE_DASH, CMOVE_WALLRUN, CMOVE_WALLCLIMB };
+
+/*
+ * Character movement with the dash and the wall moves of the player as custom movement modes.
+ * Requests travel in the compressed flags of the saved moves and the timers are saved with them,
+ * so a move gives the same result on the owning client, on the server and when replayed after a correction.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_MovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+	friend class FS_SavedMove;
+
+	/* Requests of the owning client, dash and wall moves are consumed by the next move. */
+	bool bWantsToDash = false;
+	bool bWantsToSlide = false;
+	bool bWantsToWallMove = false;
+	bool bWantsToReleaseWall = false;
+
+	/* Predicted state, restored from the saved moves before they are replayed. */
+	float DashTimeLeft = 0.f;
+	FVector DashDirection = FVector::ForwardVector;
+	float WallTimeLeft = 0.f;
+	float WallSpeed = 0.f;
+	float WallJumpTimeLeft = 0.f;
+	TWeakObjectPtr<AActor> WallActor;
+	FVector WallNormal = FVector::ZeroVector;
+
+	/* The wall left last cannot be run on again before landing, a dash out of a wall jump allows one more wall jump. */
+	TWeakObjectPtr<AActor> LastWallActor;
+	FVector LastWallNormal = FVector::ZeroVector;
+	bool bWallReset = false;
+
+	bool IsMoving() const { return !Acceleration.IsNearlyZero(); }
+	bool TraceWall(ES_QueryProbe Probe, const FVector& Direction, FHitResult& OutHit) const;
+	bool IsLastWall(const FHitResult& Hit) const;
+
+	/* Direction along the wall on either side of the character, zero when there is none to run on. */
+	FVector GetWallRunDirection(FHitResult& OutHit) const;
+
+	/* Up when facing a wall steep enough to climb, zero otherwise. */
+	FVector GetWallClimbDirection(FHitResult& OutHit) const;
+
+	void StartDash();
+	void StartWallJump();
+
+	/* A wall run or climb started from the ground jumps onto the wall. */
+	void JumpOntoWall();
+
+	/* Falls off the wall moved along, which becomes the last wall. */
+	void StopWallMove();
+
+	/* Back to walking or falling depending on the floor, once a custom move is over. */
+	void EndCustomMovement(float DeltaTime, int32 Iterations);
+
+	void MoveAlong(float DeltaTime);
+	void PhysDash(float DeltaTime, int32 Iterations);
+	void PhysWallRun(float DeltaTime, int32 Iterations);
+	void PhysWallClimb(float DeltaTime, int32 Iterations);
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Dash")
+	float DashSpeed = 3000.f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Dash")
+	float DashTime = 0.2f;
+
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Slide")
+	float SlideDeceleration = 500.f;
+
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float WallCheckDistance = 100.f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float MaxWallRunTime = 1.5f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float MaxWallClimbTime = 1.f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float WallClimbSpeed = 600.f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float WallRunSpeed = 600.f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float WallJumpTime = 0.3f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float WallForce = 1000.f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement: Wall")
+	float WallResetJumpSpeed = 600.f;
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual void PhysCustom(float DeltaTime, int32 Iterations) override;
+	virtual void ProcessLanded(const FHitResult& Hit, float RemainingTime, int32 Iterations) override;
+	virtual float GetMaxBrakingDeceleration() const override;
+
+	/* Input of the owning client. */
+	void RequestDash() { bWantsToDash = true; }
+	void RequestWallMove() { bWantsToWallMove = true; }
+	void RequestWallRelease() { bWantsToReleaseWall = true; }
+	void SetSliding(bool bSliding) { bWantsToSlide = bSliding; }
+
+	bool IsDashing() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_DASH; }
+	bool IsWallRunning() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_WALLRUN; }
+	bool IsWallClimbing() const { return MovementMode == MOVE_Custom && CustomMovementMode == CMOVE_WALLCLIMB; }
+	bool IsWallJumping() const { return WallJumpTimeLeft > 0.f; }
+	bool IsSliding() const { return bWantsToSlide && IsMovingOnGround(); }
+
+	/* What a wall move request would start, checked by the client before sending it and by the move itself. */
+	bool CanWallJump() const;
+	bool CanWallRun() const;
+	bool CanWallClimb() const;
+};
@@ -1,4 +1,13 @@
 #include "S_Player.h"
+#include "S_SliceIndex.h"
+#include "S_MovementComponent.h"
+#include "S_QueryService.h"
+#include "S_LagCompensation.h"
+#include "S_SliceSubsystem.h"
+#include "S_FragmentSubsystem.h"
+#include "S_SignificanceSubsystem.h"
+#include "S_SliceProxies.h"
+#include "Project_FZ5.h"
 
 #include "Kismet/KismetMathLibrary.h"
 #include "Kismet/KismetSystemLibrary.h"
@@ -11,13 +20,35 @@
 #include "Components/InputComponent.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "Components/CapsuleComponent.h"
 #include "DrawDebugHelpers.h"
+#include "Engine/Engine.h"
 
 
-AS_Player::AS_Player()
+DECLARE_CYCLE_STAT(TEXT("OnAttack"), STAT_FZ5_OnAttack, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("OnAttack candidates"), STAT_FZ5_AttackCandidates, STATGROUP_FZ5);
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarDebugStats(
+    TEXT("fz5.Debug.Stats"),
+    0,
+    TEXT("Show the player flags, slicing and fragment counts on screen."));
+
+static TAutoConsoleVariable<float> CVarDebugStatsInterval(
+    TEXT("fz5.Debug.StatsInterval"),
+    0.25f,
+    TEXT("Seconds between two refreshes of the on-screen debug stats."));
+#endif
+
+
+AS_Player::AS_Player(const FObjectInitializer& ObjectInitializer)
+    : Super(ObjectInitializer.SetDefaultSubobjectClass<US_MovementComponent>(ACharacter::CharacterMovementComponentName))
 {
     PrimaryActorTick.bCanEverTick = true;
 
+    // Created in every build, Blueprints attach to them and read them. A dedicated server only never ticks them.
     SpringArm = CreateDefaultSubobject<USpringArmComponent>(TEXT("SpringArm"));
     SpringArm->SetupAttachment(RootComponent);
     SpringArm->TargetArmLength = 300.0f;
@@ -45,10 +76,23 @@ AS_Player::AS_Player()
     ////////////////////////////////////////////////////////////////
 }
 
+void AS_Player::PreRegisterAllComponents()
+{
+    Super::PreRegisterAllComponents();
+
+    // Nobody looks through the camera of a dedicated server, its arm does not need to trace every frame.
+    if (GetNetMode() == NM_DedicatedServer)
+    {
+        if (SpringArm) SpringArm->PrimaryComponentTick.bStartWithTickEnabled = false;
+        if (Camera) Camera->PrimaryComponentTick.bStartWithTickEnabled = false;
+    }
+}
+
 void AS_Player::BeginPlay()
 {
     Super::BeginPlay();
 
+#if FZ5_WITH_CLIENT_VISUALS
     if (APlayerController* PlayerController = Cast<APlayerController>(GetController()))
     {
         if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
@@ -56,114 +100,99 @@ void AS_Player::BeginPlay()
             Subsystem->AddMappingContext(PlayerMappingContext, 0);
         }
     }
+#endif
 
     IsMoving = false;
 
-    IsDashUp = true;
-    IsSlideUp = true;
-    IsWallRunUp = true;
-
-    IsGearUp = true;
-    IsShootUp = true;
-    IsSlashUp = true;
-    IsParryUp = true;
-    IsSwitchUp = true;
+    item = SWORD;
 
-    WallReset = false;
+    Player = CastChecked<US_MovementComponent>(GetCharacterMovement());
+    ApplyMovementTuning();
 
-    item = SWORD;
-    state = NEUTRAL;
-    action = NONE;
+    // Hit tests of the shots rewind the capsule of every player, on the server only.
+    if (HasAuthority())
+        if (US_LagCompensation* LagCompensation = GetWorld()->GetSubsystem<US_LagCompensation>())
+            LagCompensation->Track(GetCapsuleComponent(), ES_HitboxShape::Capsule, ES_HitboxOwner::Pawn);
 
-    Player = GetCharacterMovement();
+    // Far and unseen players tick less often.
+    if (US_SignificanceSubsystem* Significance = GetWorld()->GetSubsystem<US_SignificanceSubsystem>())
+        Significance->Register(GetCapsuleComponent(), ES_SignificanceKind::Pawn);
 
     initialRotation = SlicingPlane->GetRelativeRotation();
 }
 
-#pragma region ENUM...
-void AS_Player::ResetAction()
+void AS_Player::ApplyMovementTuning()
 {
-    action = NONE;
+    Player->DashSpeed = DashSpeed;
+    Player->DashTime = DashingTime;
+    Player->SlideDeceleration = SlideDeceleration;
+    Player->WallCheckDistance = WallCheckDistance;
+    Player->MaxWallRunTime = MaxWallRunTime;
+    Player->MaxWallClimbTime = MaxWallClimbTime;
+    Player->WallJumpTime = WallJumpTime;
+    Player->WallForce = WallForce;
+
+    if (Deceleration > 0.f)
+        Player->BrakingDecelerationWalking = Deceleration;
+
+    // Simulated proxies never check walls nor aim, a dedicated server does not aim with its idle camera.
+    if (GetLocalRole() != ROLE_SimulatedProxy)
+        if (US_QueryService* QueryService = GetWorld()->GetSubsystem<US_QueryService>())
+            QueryService->Register(this, WallCheckDistance, GetNetMode() != NM_DedicatedServer ? Camera : nullptr, ShootCheckDistance);
 }
 
-void AS_Player::AllowState(State request)
+State AS_Player::GetState() const
 {
-    switch (request)
-    {
-    case DASH:
-        IsDashUp = true;
-        break;
-    case SLIDE:
-        IsSlideUp = true;
-        break;
-    case WALLRUN:
-        IsWallRunUp = true;
-        break;
-    default:
-        break;
-    }
+    if (Player->IsDashing()) return DASH;
+    if (Player->IsWallRunning()) return WALLRUN;
+    if (Player->IsWallClimbing()) return WALLCLIMB;
+    if (Player->IsWallJumping()) return WALLJUMP;
+    if (Player->IsSliding()) return SLIDE;
+    return NEUTRAL;
 }
 
-void AS_Player::AllowAction(Action request)
+#pragma region INVENTORY...
+void AS_Player::TakeSword(const FInputActionValue& Value)
 {
-    switch (request)
-    {
-    case SWITCH:
-        IsSwitchUp = true;
-        break;
-    case SLASH:
-        IsSlashUp = true;
-        break;
-    case SHOOT:
-        IsShootUp = true;
-        break;
-    case PARRY:
-        IsParryUp = true;
-        break;
-    case GEAR:
-        IsGearUp = true;
-        break;
-    default:
-        break;
-    }
+    SetItem(SWORD);
 }
 
-void AS_Player::AddStateCooldown(State State, float Cooldown)
+void AS_Player::TakeGun1(const FInputActionValue& Value)
 {
-    FTimerHandle NewHandler;
-    FTimerDelegate NewDelegate = FTimerDelegate::CreateUObject(this, &AS_Player::AllowState, State);
-    GetWorld()->GetTimerManager().SetTimer(NewHandler, NewDelegate, Cooldown, false);
+    SetItem(GUN);
 }
 
-void AS_Player::AddActionCooldown(Action Action, float Cooldown)
+void AS_Player::TakeGun2(const FInputActionValue& Value)
 {
-    FTimerHandle NewHandler;
-    FTimerDelegate NewDelegate = FTimerDelegate::CreateUObject(this, &AS_Player::AllowAction, Action);
-    GetWorld()->GetTimerManager().SetTimer(NewHandler, NewDelegate, Cooldown, false);
+    SetItem(GUN);
 }
-#pragma endregion
 
-#pragma region INVENTORY...
-void AS_Player::TakeSword(const FInputActionValue& Value)
+void AS_Player::SetItem(Item InItem)
 {
-    item = SWORD;
+    item = InItem;
+    SetAimProbe(item == GUN);
+
+    if (!HasAuthority())
+        ServerSetItem((uint8)InItem);
 }
 
-void AS_Player::TakeGun1(const FInputActionValue& Value)
+void AS_Player::ServerSetItem_Implementation(uint8 InItem)
 {
-    item = GUN;
+    if (InItem <= UTIL) SetItem((Item)InItem);
 }
 
-void AS_Player::TakeGun2(const FInputActionValue& Value)
+void AS_Player::SetAimProbe(bool bEnabled)
 {
-    item = GUN;
+    if (US_QueryService* QueryService = GetWorld()->GetSubsystem<US_QueryService>())
+        QueryService->SetAimEnabled(this, bEnabled);
 }
 #pragma endregion
 
 #pragma region CONDITIONS...
 bool AS_Player::CanDash()
 {
-    return item == SWORD && (state == NEUTRAL || !IsSlashUp) && IsDashUp && IsParryUp;
+    const float Now = GetWorld()->GetTimeSeconds();
+    return item == SWORD && (GetState() == NEUTRAL || !Cooldowns.IsActionReady(SLASH, Now)) && Cooldowns.IsStateReady(DASH, Now) && Cooldowns.IsActionReady(PARRY, Now);
 }
 
 bool AS_Player::CanSlide()
@@ -173,32 +202,19 @@ bool AS_Player::CanSlide()
 
 bool AS_Player::CanParry()
 {
-    return item == SWORD && state != DASH && IsParryUp && state != WALLJUMP;
+    const State CurrentState = GetState();
+    return item == SWORD && CurrentState != DASH && Cooldowns.IsActionReady(PARRY, GetWorld()->GetTimeSeconds()) && CurrentState != WALLJUMP;
 }
 
 bool AS_Player::CanShoot()
 {
-    return item == GUN && IsShootUp;
+    return item == GUN && Cooldowns.IsActionReady(SHOOT, GetWorld()->GetTimeSeconds());
 }
 
 bool AS_Player::CanSlash()
 {
-    return item == SWORD && IsSlashUp && action != PARRY && IsParryUp;
-}
-
-bool AS_Player::CanWallRun()
-{
-    return IsMoving && GetWallRunDirection() != FVector::ZeroVector && !(state == DASH && Player->IsMovingOnGround());
-}
-
-bool AS_Player::CanWallJump()
-{
-    return state == WALLRUN || state == WALLCLIMB || (WallReset && GetWallClimbDirection() != FVector::ZeroVector);
-}
-
-bool AS_Player::CanWallClimb()
-{
-    return IsMoving && GetWallClimbDirection() != FVector::ZeroVector && Player->IsMovingOnGround();
+    const float Now = GetWorld()->GetTimeSeconds();
+    return item == SWORD && Cooldowns.IsActionReady(SLASH, Now) && Cooldowns.GetAction(Now) != PARRY && Cooldowns.IsActionReady(PARRY, Now);
 }
 #pragma endregion
 
@@ -213,7 +229,8 @@ void AS_Player::Move(const FInputActionValue& Value)
     MoveDir = Value.Get<FVector2D>();
     MoveDir.Normalize();
 
-    if (state == NEUTRAL)
+    // The dash takes the input it starts with, none is fed to the moves after that.
+    if (GetState() == NEUTRAL)
     {
         Yaw = FRotator(0.f, Controller->GetControlRotation().Yaw, 0.f);
         AddMovementInput(FRotationMatrix(Yaw).GetUnitAxis(EAxis::X), MoveDir.Y);
@@ -244,48 +261,19 @@ void AS_Player::Dash(const FInputActionValue& Value)
 {
     if (CanDash())
     {
-        AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this] { OnAttack(); });
-
-        if (state == WALLJUMP) WallReset = true;
-
-        state = DASH;
-        IsDashUp = false;
-        GetWorld()->GetTimerManager().SetTimer(DashHandler, this, &AS_Player::StopDash, DashingTime);
-
-        Player->Velocity.Z = 0.f;
-
-        if (Player->IsMovingOnGround())
-            Player->SetJumpAllowed(false);
-
-        FVector Vec = (GetActorForwardVector() * MoveDir.Y + GetActorRightVector() * MoveDir.X) * DashSpeed;
-        DashVelocity = FVector(Vec.X, Vec.Y, 1.f);
-
-        Player->BrakingDecelerationWalking = 0.f;
+        OnAttack();
+        Cooldowns.LockState(DASH);
+        Player->RequestDash();
     }
     else if (CanSlide())
     {
-        state = SLIDE;
-        Player->BrakingDecelerationWalking = SlideDeceleration;
+        Player->SetSliding(true);
     }
 }
 
-void AS_Player::StopDash()
-{
-    if (state == DASH) state = NEUTRAL;
-    Player->BrakingDecelerationWalking = Deceleration;
-    Player->SetJumpAllowed(true);
-
-    AddStateCooldown(DASH, DashCooldown);
-}
-
 void AS_Player::SlideCancel()
 {
-    if (state == SLIDE)
-    {
-        state = NEUTRAL;
-        Player->BrakingDecelerationWalking = Deceleration;
-        Player->SetJumpAllowed(true);
-    }
+    Player->SetSliding(false);
 }
 #pragma endregion
 
@@ -293,23 +281,12 @@ void AS_Player::SlideCancel()
 void AS_Player::Parry(const FInputActionValue& Value)
 {
     if (CanParry())
-    {
-        action = PARRY;
-        IsParryUp = false;
-        GetWorld()->GetTimerManager().SetTimer(ParryHandler, this, &AS_Player::StopParry, ParryingTime);
-    }
-}
-
-void AS_Player::StopParry()
-{
-    if (action == PARRY) action = NONE;
-    AddActionCooldown(PARRY, ParryCooldown);
+        Cooldowns.StartAction(PARRY, GetWorld()->GetTimeSeconds(), ParryingTime, ParryCooldown);
 }
 
 void AS_Player::ParryCancel()
 {
-    ParryHandler.Invalidate();
-    StopParry();
+    Cooldowns.StopAction(PARRY, GetWorld()->GetTimeSeconds(), ParryCooldown);
 }
 #pragma endregion
 
@@ -318,33 +295,32 @@ void AS_Player::Attack(const FInputActionValue& Value)
 {
     if (CanSlash())
     {
-        AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [this] { OnAttack(); });
-        action = SLASH;
-        IsDashUp = true;
-        IsSlashUp = false;
-        GetWorld()->GetTimerManager().SetTimer(SlashHandler, this, &AS_Player::StopSlash, SlashingTime);
+        OnAttack();
+        Cooldowns.StartAction(SLASH, GetWorld()->GetTimeSeconds(), SlashingTime, SlashCooldown);
+        Cooldowns.ResetState(DASH);
     }
     else if (CanShoot())
     {
-        action = SLASH;
-        IsShootUp = false;
-        GetWorld()->GetTimerManager().SetTimer(ShootHandler, this, &AS_Player::StopShoot, ShootingTime);
+        Cooldowns.StartAction(SHOOT, GetWorld()->GetTimeSeconds(), ShootingTime, ShootCooldown);
 
         TraceCameraToTarget();
     }
 
-    StopWallRun();
-    StopWallClimb();
+    if (Player->IsWallRunning() || Player->IsWallClimbing())
+        Player->RequestWallRelease();
 }
 
 void AS_Player::TraceCameraToTarget()
 {
+#if FZ5_WITH_CLIENT_VISUALS
+    const FVector Start = Camera->GetComponentLocation();
+    const FVector Direction = Camera->GetForwardVector();
+
     FHitResult Hit;
-    FVector Start = Camera->GetComponentLocation();
-    FCollisionQueryParams Params;
-    Params.AddIgnoredActor(this);
+    const FVector End = Start + Direction * ShootCheckDistance;
+    US_QueryService* QueryService = GetWorld()->GetSubsystem<US_QueryService>();
 
-    if (GetWorld()->LineTraceSingleByChannel(Hit, Start, Start + Camera->GetForwardVector() * ShootCheckDistance, ECC_Visibility, Params) && Hit.Distance > SpringArm->TargetArmLength)
+    if (QueryService && QueryService->Trace(this, ES_QueryProbe::Aim, Start, End, Hit) && Hit.Distance > SpringArm->TargetArmLength)
     {
         if (Hit.GetComponent()->ComponentHasTag("Destructible"))
             DrawDebugLine(GetWorld(), SpringArm->GetComponentLocation() - (FVector::ZAxisVector * 50.0f), Hit.Location, FColor(0, 0, 255), false, 1, 0, 10);
@@ -353,198 +329,122 @@ void AS_Player::TraceCameraToTarget()
         else
             DrawDebugLine(GetWorld(), SpringArm->GetComponentLocation() - (FVector::ZAxisVector * 50.0f), Hit.Location, FColor(0, 255, 0), false, 1, 0, 10);
     }
+#else
+    // No camera on the dedicated server, the promoted bots shoot from their eyes.
+    const FVector Start = GetPawnViewLocation();
+    const FVector Direction = GetBaseAimRotation().Vector();
+#endif
+
+    // The local trace is only feedback, the server decides what was hit.
+    if (HasAuthority())
+        QueueShot(Start, Direction, GetWorld()->GetTimeSeconds());
+    else
+        ServerShoot(Start, Direction, GetRenderedServerTime());
 }
 
-void AS_Player::StopSlash()
+float AS_Player::GetRenderedServerTime() const
 {
-    if (action == SLASH) action = NONE;
-    AddActionCooldown(SLASH, SlashCooldown);
+    const AGameStateBase* GameState = GetWorld()->GetGameState();
+    if (!GameState) return GetWorld()->GetTimeSeconds();
+
+    // The other players reached this client half a round trip ago, and are drawn smoothed toward that since.
+    const float HalfPing = GetPlayerState() ? GetPlayerState()->GetPingInMilliseconds() * 0.0005f : 0.f;
+    return (float)GameState->GetServerWorldTimeSeconds() - HalfPing - Player->NetworkSimulatedSmoothLocationTime;
 }
 
-void AS_Player::StopShoot()
+void AS_Player::ServerShoot_Implementation(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, float Time)
 {
-    if (action == SHOOT) action = NONE;
-    AddActionCooldown(SHOOT, ShootCooldown);
+    // Checked again here, a client could send shots without the gun or faster than it fires.
+    const float Now = GetWorld()->GetTimeSeconds();
+    if (item != GUN || !Cooldowns.IsActionReady(SHOOT, Now + MaxShotEarly)) return;
+
+    Cooldowns.StartAction(SHOOT, Now, ShootingTime, ShootCooldown);
+    QueueShot(Start, Direction, Time);
+}
+
+void AS_Player::QueueShot(const FVector& Start, const FVector& Direction, float Time)
+{
+    US_LagCompensation* LagCompensation = GetWorld()->GetSubsystem<US_LagCompensation>();
+    if (!LagCompensation) return;
+
+    FS_Shot Shot;
+    Shot.Shooter = this;
+    Shot.Start = Start;
+    Shot.Direction = Direction;
+    Shot.Distance = ShootCheckDistance;
+    Shot.Time = Time;
+    LagCompensation->QueueShot(Shot);
 }
 #pragma endregion
 
 #pragma region JUMP INPUT...
 void AS_Player::JumpButton(const FInputActionValue& Value)
 {
-    if (CanWallJump())
-    {
-        StopWallRun();
-        StopWallClimb();
-        state = WALLJUMP;
-        if (WallReset) Player->Velocity = FVector::UpVector * 600.f;
-        else Player->Velocity.Z = 0.f;
-        IsDashUp = false;
-        WallReset = false;
-        LastWallHit = WallHit;
-        FVector JumpDir = WallHit.ImpactNormal + FVector::UpVector;
-        JumpDir.Normalize();
-        Player->AddImpulse(JumpDir * WallForce);
-        GetWorld()->GetTimerManager().SetTimer(WallJumpHandler, this, &AS_Player::StopWallJump, WallJumpTime);
-    }
-    else if (CanWallRun())
+    // The movement component picks the wall move itself, the same way on the server, and jumps onto the wall from the ground.
+    if (Player->CanWallJump())
     {
-        state = WALLRUN;
-        IsDashUp = true;
-        WallReset = false;
-        GetWorld()->GetTimerManager().SetTimer(WallRunHandler, this, &AS_Player::StopWallRun, MaxWallRunTime);
-
-        if (Player->Velocity.Size2D() < Player->MaxWalkSpeed)
-            WallVelocity = 600.f;
-        else
-            WallVelocity = Player->Velocity.Size2D();
+        Cooldowns.LockState(DASH);
+        Cooldowns.ReleaseState(DASH, GetWorld()->GetTimeSeconds(), WallJumpTime);
     }
-    else if (CanWallClimb())
+    else if (Player->CanWallRun())
     {
-        state = WALLCLIMB;
-        WallReset = false;
-        GetWorld()->GetTimerManager().SetTimer(WallClimbHandler, this, &AS_Player::StopWallClimb, MaxWallClimbTime);
-
-        WallVelocity = 600.f;
+        Cooldowns.ResetState(DASH);
     }
-
-    if (CanJump())
-        Jump();
-}
-
-void AS_Player::StopWallJump()
-{
-    if (state == WALLJUMP) 
+    else if (!Player->CanWallClimb())
     {
-        state = NEUTRAL;
-        IsDashUp = true;
+        if (CanJump())
+            Jump();
+        return;
     }
-}
 
-void AS_Player::StopWallRun()
-{
-    if (state == WALLRUN) state = NEUTRAL;
-}
-
-void AS_Player::StopWallClimb()
-{
-    if (state == WALLCLIMB) state = NEUTRAL;
+    Player->RequestWallMove();
 }
 #pragma endregion
 
-#pragma region WALLRIDE...
-FVector AS_Player::SetWallVector()
+void AS_Player::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
 {
-    FVector WallVector = FVector::CrossProduct(WallHit.ImpactNormal, FVector::UpVector);
-    WallVector.Normalize();
-    return (FVector::DotProduct(WallVector, GetActorForwardVector()) > 0) ? WallVector : -WallVector;
+    Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+
+    // Not again for the moves replayed after a correction.
+    if (PrevMovementMode == MOVE_Custom && PreviousCustomMode == CMOVE_DASH && IsLocallyControlled() && !bClientUpdating)
+        Cooldowns.ReleaseState(DASH, GetWorld()->GetTimeSeconds(), DashCooldown);
 }
 
-FVector AS_Player::GetWallRunDirection()
+void AS_Player::Tick(float DeltaTime)
 {
-    FVector PlayerLocation = GetActorLocation();
-    FCollisionQueryParams Params;
-    Params.AddIgnoredActor(this);
-
-    if (GetWorld()->LineTraceSingleByChannel(WallHit, PlayerLocation, PlayerLocation - GetActorRightVector() * WallCheckDistance, ECC_Visibility, Params))
-    {
-        if (WallHit.GetActor() == LastWallHit.GetActor() && WallHit.ImpactNormal == LastWallHit.ImpactNormal)
-            return FVector::ZeroVector;
-
-        float dot = FVector::DotProduct(WallHit.ImpactNormal, GetActorForwardVector());
-        if (dot < -0.1f && dot > -0.7f)
-            return SetWallVector();
-    }
-    else if (GetWorld()->LineTraceSingleByChannel(WallHit, PlayerLocation, PlayerLocation + GetActorRightVector() * WallCheckDistance, ECC_Visibility, Params))
-    {
-        if (WallHit.GetActor() == LastWallHit.GetActor() && WallHit.ImpactNormal == LastWallHit.ImpactNormal)
-            return FVector::ZeroVector;
-
-        float dot = FVector::DotProduct(WallHit.ImpactNormal, GetActorForwardVector());
-        if (dot < -0.1f && dot > -0.7f)
-            return SetWallVector();
-    }
-
-    return FVector::ZeroVector;
+    Super::Tick(DeltaTime);
+    DrawDebugStats(DeltaTime);
 }
 
-FVector AS_Player::GetWallClimbDirection()
+void AS_Player::DrawDebugStats(float DeltaTime)
 {
-    FVector PlayerLocation = GetActorLocation();
+#if !UE_BUILD_SHIPPING
+    if (!CVarDebugStats.GetValueOnGameThread() || !GEngine || !IsLocallyControlled()) return;
 
-    FCollisionQueryParams Params;
-    Params.AddIgnoredActor(this);
+    // Refreshed a few times per second only, the text is kept on screen until the next refresh.
+    DebugStatsTime -= DeltaTime;
+    if (DebugStatsTime > 0.f) return;
 
-    if (GetWorld()->LineTraceSingleByChannel(WallHit, PlayerLocation, PlayerLocation + GetActorForwardVector() * WallCheckDistance, ECC_Visibility, Params))
-        if (FVector::DotProduct(WallHit.ImpactNormal, GetActorForwardVector()) <= -0.7f)
-            return FVector::UpVector;
+    const float Interval = FMath::Max(0.f, CVarDebugStatsInterval.GetValueOnGameThread());
+    DebugStatsTime = Interval;
 
-    return FVector::ZeroVector;
-}
-#pragma endregion
+    FString Text = FString::Printf(TEXT("Dash %d  Slide %d  Parry %d  Shoot %d  Slash %d"), CanDash(), CanSlide(), CanParry(), CanShoot(), CanSlash());
 
-void AS_Player::UpdateStates(float DeltaTime)
-{
-    if (state == DASH)
+    if (const US_SliceSubsystem* SliceSubsystem = GetWorld()->GetSubsystem<US_SliceSubsystem>())
     {
-        Player->Velocity = Player->Velocity * FVector::UpVector + DashVelocity * FVector(1, 1, 0);
+        const FS_SliceFrameStats& SliceStats = SliceSubsystem->GetFrameStats();
+        Text += FString::Printf(TEXT("\nSlices: %d queued, %d in flight, %d committed in %.2f ms"),
+            SliceStats.Queued, SliceStats.InFlight, SliceStats.Committed, SliceStats.CommitTime * 1000.0);
     }
-    else if (state == WALLRUN)
-    {
-        FVector Dir = GetWallRunDirection();
-        if (Dir == FVector::ZeroVector)
-        {
-            LastWallHit = WallHit;
-            WallRunHandler.Invalidate();
-            StopWallRun();
-            return;
-        }
-
-        FVector NewVelocity = Dir * WallVelocity;
-        NewVelocity.Z = (Player->Velocity.Z <= 0.f) ? 0.f : Player->Velocity.Z;
-        Player->Velocity = NewVelocity;
 
-        Player->AddForce(-WallHit.ImpactNormal * WallForce);
-    }
-    else if (state == WALLCLIMB)
+    if (const US_FragmentSubsystem* FragmentSubsystem = GetWorld()->GetSubsystem<US_FragmentSubsystem>())
     {
-        FVector Dir = GetWallClimbDirection();
-        if (Dir == FVector::ZeroVector)
-        {
-            WallRunHandler.Invalidate();
-            StopWallClimb();
-            return;
-        }
-
-        Player->Velocity = Dir * WallVelocity;
+        Text += FString::Printf(TEXT("\nFragments: %d live, %d baked, %d pooled"),
+            FragmentSubsystem->GetNumLiveFragments(), FragmentSubsystem->GetNumBakedFragments(), FragmentSubsystem->GetNumPooledFragments());
     }
-}
 
-void AS_Player::Landed(const FHitResult& Hit)
-{
-    Super::Landed(Hit);
-    LastWallHit = Hit;
-    WallReset = false;
-}
-
-void AS_Player::Tick(float DeltaTime)
-{
-    Super::Tick(DeltaTime);
-    UpdateStates(DeltaTime);
-    
-    if (!CanDash()) { UE_LOG(LogTemp, Warning, TEXT("----")); }
-    else { UE_LOG(LogTemp, Warning, TEXT("Dash")); }
-
-    if (!CanSlide()) { UE_LOG(LogTemp, Warning, TEXT("-----")); }
-    else { UE_LOG(LogTemp, Warning, TEXT("Slide")); }
-
-    if (!CanParry()) { UE_LOG(LogTemp, Warning, TEXT("-----")); }
-    else { UE_LOG(LogTemp, Warning, TEXT("Parry")); }
-
-    if (!CanShoot()) { UE_LOG(LogTemp, Warning, TEXT("-----")); }
-    else { UE_LOG(LogTemp, Warning, TEXT("Shoot")); }
-
-    if (!CanSlash()) { UE_LOG(LogTemp, Warning, TEXT("-----")); }
-    else { UE_LOG(LogTemp, Warning, TEXT("Slash")); }
+    GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), Interval + 0.1f, FColor::Cyan, Text);
+#endif
 }
 
 void AS_Player::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -571,33 +471,47 @@ void AS_Player::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 
 void AS_Player::OnAttack()
 {
-    TimerHandles.Empty();
-    TArray<UPrimitiveComponent*> OverlappedComponents = {};
-    UKismetSystemLibrary::ComponentOverlapComponents(SlicingPlane, SlicingPlane->GetComponentTransform(),
-        { UEngineTypes::ConvertToObjectType(ECC_WorldStatic) }, nullptr, {}, OverlappedComponents);
+    FZ5_SCOPE(OnAttack);
+
+    // Slices are made on the server and replayed by the clients, nothing is cut here ahead of it.
+    const FVector PlanePosition = SlicingPlane->GetComponentLocation();
+    const FVector PlaneNormal = SlicingPlane->GetUpVector();
+    if (HasAuthority())
+        SliceAlong(PlanePosition, PlaneNormal);
+    else
+        ServerSlice(PlanePosition, PlaneNormal);
+}
+
+void AS_Player::ServerSlice_Implementation(FVector_NetQuantize10 PlanePosition, FVector_NetQuantizeNormal PlaneNormal)
+{
+    // The slicing plane is attached to the player, a cut far from it is not one it could have made.
+    if (FVector::DistSquared(PlanePosition, SlicingPlane->GetComponentLocation()) > FMath::Square(MaxSliceError)) return;
 
-    for (UPrimitiveComponent* Component : OverlappedComponents)
+    SliceAlong(PlanePosition, PlaneNormal);
+}
+
+void AS_Player::SliceAlong(const FVector& PlanePosition, const FVector& PlaneNormal)
+{
+    US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>();
+    if (!SliceIndex) return;
+
+    // Any point of the slicing plane defines the cut, the index only returns the sliceables it goes through.
+    const FBox QueryBox = SlicingPlane->Bounds.GetBox().ShiftBy(PlanePosition - SlicingPlane->GetComponentLocation());
+    const FPlane Plane(PlanePosition, PlaneNormal);
+
+    // Instanced props the plane goes through get their own mesh back first, the index only knows those.
+    if (US_SliceProxies* SliceProxies = GetWorld()->GetSubsystem<US_SliceProxies>())
+        SliceProxies->PromoteAlong(QueryBox, Plane);
+
+    TArray<UPrimitiveComponent*> Candidates;
+    SliceIndex->QueryPlane(QueryBox, Plane, Candidates);
+    INC_DWORD_STAT_BY(STAT_FZ5_AttackCandidates, Candidates.Num());
+
+    for (UPrimitiveComponent* Component : Candidates)
     {
-        UProceduralMeshComponent* ProceduralMesh = Cast<UProceduralMeshComponent>(Component);
-        if (!ProceduralMesh || !ProceduralMesh->IsValidLowLevel()) continue;
-        AS_SlicedMesh* SliceableMesh = Cast<AS_SlicedMesh>(Component->GetOwner());
-        if (!SliceableMesh || !SliceableMesh->IsValidLowLevel()) continue;
-
-        const FVector CamLocation = SlicingPlane->GetComponentLocation();// FirstPersonCameraComponent->GetComponentLocation();
-        const FVector CamUpVector = SlicingPlane->GetUpVector();// FirstPersonCameraComponent->GetUpVector();
-        const FVector ProcMeshLoc = ProceduralMesh->GetComponentLocation();
-        const FVector ProcMeshLocPlane = UKismetMathLibrary::ProjectPointOnToPlane(ProcMeshLoc, CamLocation, CamUpVector);
-
-        FHitResult HitResult;
-        TArray<AActor*> CollisionQuery;
-        CollisionQuery.Add(this);
-        UKismetSystemLibrary::LineTraceSingle(GetWorld(), CamLocation, ProcMeshLocPlane, TraceTypeQuery1, false, CollisionQuery, EDrawDebugTrace::Type::None, HitResult, true);
-        if (!HitResult.IsValidBlockingHit()) continue;
-
-        //FTimerHandle Handle;
-        //GetWorldTimerManager().SetTimer(Handle, [=]() { SliceableMesh->Slice(ProceduralMesh, HitResult.ImpactPoint, CamUpVector); }, 0.6f, false);
-        SliceableMesh->Slice(ProceduralMesh, HitResult.ImpactPoint, CamUpVector);
-
-        //TimerHandles.Add(Handle);
+        AS_SlicedMesh* SliceableMesh = AS_SlicedMesh::FromComponent(Component);
+        if (!SliceableMesh) continue;
+
+        SliceableMesh->Slice(Component, PlanePosition, PlaneNormal);
     }
 }
\ No newline at end of file
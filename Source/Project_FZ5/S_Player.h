@@ -1,7 +1,7 @@
 #pragma once
 #include "CoreMinimal.h"
-#include "Async/Async.h"
 #include "S_SlicedMesh.h"
+#include "S_CooldownTable.h"
 #include "InputActionValue.h"
 #include "Engine/EngineTypes.h"
 #include "ProceduralMeshComponent.h"
@@ -13,18 +13,21 @@ class UInputMappingContext;
 class USpringArmComponent;
 class UCameraComponent;
 class UInputAction;
+class US_MovementComponent;
 
 enum Item { SWORD, GUN, HEAL, UTIL };
 
-enum State { NEUTRAL, DASH, SLIDE, WALLRUN, WALLCLIMB, WALLJUMP };
-
-enum Action { NONE, SWITCH, SLASH, SHOOT, PARRY, GEAR };
-
 UCLASS()
 class PROJECT_FZ5_API AS_Player : public ACharacter
 {
 	GENERATED_BODY()
 
+	// Drives the input handlers of simulated players.
+	friend class US_BenchmarkCommandlet;
+	// Promoted bots are driven the same way, with the tuning of the bot class.
+	friend class US_BotSubsystem;
+	friend struct FS_BotTuning;
+
 	/* Slicing plane object (invisible) */
 
 	//UPROPERTY(VisibleAnywhere)
@@ -33,8 +36,6 @@ class PROJECT_FZ5_API AS_Player : public ACharacter
 	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
 	UStaticMeshComponent* SlicingPlane;
 
-	TArray<FTimerHandle> TimerHandles;
-
 	FRotator initialRotation;
 
 	//////////////////////////////////////////
@@ -86,72 +87,66 @@ class PROJECT_FZ5_API AS_Player : public ACharacter
 
 	bool IsMoving;
 
-	bool IsDashUp;
-	bool IsSlideUp;
-	bool IsWallRunUp;
+	Item item;
+
+	/* Cooldowns of the dash and the actions, and the action in progress. */
+	FS_CooldownTable Cooldowns;
 
-	bool IsGearUp;
-	bool IsShootUp;
-	bool IsSlashUp;
-	bool IsParryUp;
-	bool IsSwitchUp;
+	FRotator Yaw;
+	FVector2D MoveDir;
 
-	bool WallReset;
+	US_MovementComponent* Player;
 
-	float WallVelocity;
+	/* The movement state lives in the movement component, predicted on the owning client. */
+	State GetState() const;
 
-	Item item;
-	State state;
-	Action action;
+	/* The tuning stays on the blueprint, the movement component and the wall probes get a copy of it. */
+	void ApplyMovementTuning();
 
-	FRotator Yaw;
-	FVector2D MoveDir;
-	FVector DashVelocity;
-
-	FHitResult WallHit;
-	FHitResult LastWallHit;
-
-	FTimerHandle DashHandler;
-	FTimerHandle ParryHandler;
-	FTimerHandle ShootHandler;
-	FTimerHandle SlashHandler;
-	FTimerHandle SwitchHandler;
-	FTimerHandle WallRunHandler;
-	FTimerHandle WallJumpHandler;
-	FTimerHandle WallClimbHandler;
-
-	UCharacterMovementComponent* Player;
-
-	void UpdateStates(float DeltaTime);
-	void AllowState(State State);
-	void AllowAction(Action Action);
-	void AddStateCooldown(State State, float Cooldown);
-	void AddActionCooldown(Action Action, float Cooldown);
-
-	void StopDash();
-	void StopSlash();
-	void StopShoot();
-	void StopParry();
-	void StopWallRun();
-	void StopWallJump();
-	void StopWallClimb();
+	/* Seconds until the on-screen debug stats are refreshed. */
+	float DebugStatsTime = 0.f;
+	void DrawDebugStats(float DeltaTime);
 
 	bool CanDash();
 	bool CanSlide();
 	bool CanParry();
 	bool CanShoot();
 	bool CanSlash();
-	bool CanWallRun();
-	bool CanWallJump();
-	bool CanWallClimb();
-
-	void ResetAction();
 
 	void TraceCameraToTarget();
 
-	FVector SetWallVector();
-	FVector GetWallRunDirection();
-	FVector GetWallClimbDirection();
+	/* Server time of the other players as this client draws them, the time its shots are rewound to. */
+	float GetRenderedServerTime() const;
+
+	/* Resolved by the lag compensation against the hitboxes as the shooter saw them at Time, on the server clock. */
+	UFUNCTION(Server, Reliable)
+	void ServerShoot(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, float Time);
+
+	/* How much earlier than the server cooldown a shot may arrive, the RPCs of two shots can come in closer than they were sent. */
+	static constexpr float MaxShotEarly = 0.05f;
+
+	void QueueShot(const FVector& Start, const FVector& Direction, float Time);
+
+	/* Sent by a client attacking, the server checks the plane against where it sees the player before slicing. */
+	UFUNCTION(Server, Reliable)
+	void ServerSlice(FVector_NetQuantize10 PlanePosition, FVector_NetQuantizeNormal PlaneNormal);
+
+	/* Distance the slicing plane of a client may be from the one the server sees. */
+	static constexpr float MaxSliceError = 300.f;
+
+	void SliceAlong(const FVector& PlanePosition, const FVector& PlaneNormal);
+
+	/* Picked on the owning client, the server checks the shots against it. */
+	void SetItem(Item InItem);
+
+	UFUNCTION(Server, Reliable)
+	void ServerSetItem(uint8 InItem);
+
+	/* The aim probe is only batched while holding the gun. */
+	void SetAimProbe(bool bEnabled);
+
+public:
+	virtual void PreRegisterAllComponents() override;
 
 protected:
 	virtual void BeginPlay() override;
@@ -193,10 +188,10 @@ protected:
 	void JumpButton(const FInputActionValue& Value);
 
 public:
-	AS_Player();
+	AS_Player(const FObjectInitializer& ObjectInitializer);
 
 	virtual void Tick(float DeltaTime) override;
-	virtual void Landed(const FHitResult& Hit) override;
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode = 0) override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	void OnAttack();
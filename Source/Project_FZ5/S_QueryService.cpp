@@ -0,0 +1,180 @@
+#include "S_QueryService.h"
+#include "Project_FZ5.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Async/ParallelFor.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Query batch"), STAT_FZ5_QueryBatch, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched probes"), STAT_FZ5_BatchedProbes, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Probes read from the batch"), STAT_FZ5_ProbeHits, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Probes traced again"), STAT_FZ5_ProbeTraces, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<int32> CVarQueryParallel(
+	TEXT("fz5.Query.Parallel"),
+	1,
+	TEXT("Trace the probe batch on worker threads, 0 to trace it on the game thread."));
+
+static TAutoConsoleVariable<float> CVarQueryTolerance(
+	TEXT("fz5.Query.Tolerance"),
+	0.01f,
+	TEXT("Distance a probe may move from the batched one and still read its result."));
+
+
+void US_QueryService::Deinitialize()
+{
+	Entries.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId US_QueryService::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_QueryService, STATGROUP_Tickables);
+}
+
+void US_QueryService::Register(const AActor* Owner, float WallDistance, const USceneComponent* AimComponent, float AimDistance)
+{
+	if (!Owner) return;
+
+	FS_QueryEntry& Entry = Entries.FindOrAdd(Owner);
+	Entry.Owner = Owner;
+	Entry.AimComponent = AimComponent;
+	Entry.WallDistance = WallDistance;
+	Entry.AimDistance = AimDistance;
+}
+
+void US_QueryService::Unregister(const AActor* Owner)
+{
+	Entries.Remove(Owner);
+}
+
+void US_QueryService::SetAimEnabled(const AActor* Owner, bool bEnabled)
+{
+	if (FS_QueryEntry* Entry = Entries.Find(Owner))
+	{
+		Entry->bAim = bEnabled;
+		if (!bEnabled) Entry->Results[(int32)ES_QueryProbe::Aim].bValid = false;
+	}
+}
+
+void US_QueryService::SetWallsEnabled(const AActor* Owner, bool bEnabled)
+{
+	if (FS_QueryEntry* Entry = Entries.Find(Owner))
+		Entry->bWalls = bEnabled;
+}
+
+bool US_QueryService::TraceProbe(const UWorld* World, const AActor* Owner, const FVector& Start, const FVector& End, FHitResult& OutHit)
+{
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(FZ5Probe), false, Owner);
+	return World->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, Params);
+}
+
+bool US_QueryService::Trace(const AActor* Owner, ES_QueryProbe Probe, const FVector& Start, const FVector& End, FHitResult& OutHit)
+{
+	FS_QueryEntry* Entry = Entries.Find(Owner);
+	if (!Entry)
+	{
+		INC_DWORD_STAT(STAT_FZ5_ProbeTraces);
+		return TraceProbe(GetWorld(), Owner, Start, End, OutHit);
+	}
+
+	FS_QueryResult& Result = Entry->Results[(int32)Probe];
+	const float Tolerance = CVarQueryTolerance.GetValueOnGameThread();
+
+	if (!Result.bValid || !Result.Start.Equals(Start, Tolerance) || !Result.End.Equals(End, Tolerance))
+	{
+		// Moved since the batch, traced now and kept for the next checks of the frame.
+		INC_DWORD_STAT(STAT_FZ5_ProbeTraces);
+		Result.Start = Start;
+		Result.End = End;
+		Result.bHit = TraceProbe(GetWorld(), Owner, Start, End, Result.Hit);
+		Result.bValid = true;
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_FZ5_ProbeHits);
+	}
+
+	OutHit = Result.Hit;
+	return Result.bHit;
+}
+
+void US_QueryService::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TraceBatch();
+}
+
+void US_QueryService::TraceBatch()
+{
+	FZ5_SCOPE(QueryBatch);
+
+	struct FProbe
+	{
+		const AActor* Owner;
+		FS_QueryResult* Result;
+	};
+
+	// Segments are set up on the game thread, only the traces run on the workers.
+	TArray<FProbe> Probes;
+	Probes.Reserve(Entries.Num() * (int32)ES_QueryProbe::Num);
+
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		FS_QueryEntry& Entry = It.Value();
+		const AActor* Owner = Entry.Owner.Get();
+		const USceneComponent* Root = Owner ? Owner->GetRootComponent() : nullptr;
+		if (!Root)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		const FVector Location = Root->GetComponentLocation();
+		const FVector Right = Root->GetRightVector() * Entry.WallDistance;
+
+		auto AddProbe = [&](ES_QueryProbe Probe, const FVector& Start, const FVector& End)
+		{
+			FS_QueryResult& Result = Entry.Results[(int32)Probe];
+			Result.Start = Start;
+			Result.End = End;
+			Probes.Add({ Owner, &Result });
+		};
+
+		if (Entry.bWalls)
+		{
+			AddProbe(ES_QueryProbe::WallLeft, Location, Location - Right);
+			AddProbe(ES_QueryProbe::WallRight, Location, Location + Right);
+			AddProbe(ES_QueryProbe::WallForward, Location, Location + Root->GetForwardVector() * Entry.WallDistance);
+		}
+		else
+		{
+			Entry.Results[(int32)ES_QueryProbe::WallLeft].bValid = false;
+			Entry.Results[(int32)ES_QueryProbe::WallRight].bValid = false;
+			Entry.Results[(int32)ES_QueryProbe::WallForward].bValid = false;
+		}
+
+		const USceneComponent* AimComponent = Entry.AimComponent.Get();
+		if (Entry.bAim && AimComponent)
+		{
+			const FVector AimLocation = AimComponent->GetComponentLocation();
+			AddProbe(ES_QueryProbe::Aim, AimLocation, AimLocation + AimComponent->GetForwardVector() * Entry.AimDistance);
+		}
+		else
+		{
+			Entry.Results[(int32)ES_QueryProbe::Aim].bValid = false;
+		}
+	}
+
+	const UWorld* World = GetWorld();
+	ParallelFor(Probes.Num(), [&](int32 Index)
+	{
+		FS_QueryResult& Result = *Probes[Index].Result;
+		Result.bHit = TraceProbe(World, Probes[Index].Owner, Result.Start, Result.End, Result.Hit);
+		Result.bValid = true;
+	}, !CVarQueryParallel.GetValueOnGameThread());
+
+	INC_DWORD_STAT_BY(STAT_FZ5_BatchedProbes, Probes.Num());
+}
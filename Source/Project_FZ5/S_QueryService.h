@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_QueryService.generated.h"
+
+enum class ES_QueryProbe : uint8 { WallLeft, WallRight, WallForward, Aim, Num };
+
+/* A probe traced for one actor, with the segment it was traced along. */
+struct FS_QueryResult
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	FHitResult Hit;
+	bool bHit = false;
+	bool bValid = false;
+};
+
+/* The probes of one actor, traced from its root and its aim component. */
+struct FS_QueryEntry
+{
+	TWeakObjectPtr<const AActor> Owner;
+	TWeakObjectPtr<const USceneComponent> AimComponent;
+	float WallDistance = 0.f;
+	float AimDistance = 0.f;
+	bool bAim = false;
+	bool bWalls = true;
+	FS_QueryResult Results[(int32)ES_QueryProbe::Num];
+};
+
+/*
+ * Wall and aim probes of the players, traced in one batch on worker threads at the end of each frame,
+ * from where the players stand when the next one starts. The checks and moves of that frame read the batch,
+ * and only trace again, once per probe, after moving away from it.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_QueryService : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	TMap<TObjectKey<AActor>, FS_QueryEntry> Entries;
+
+	static bool TraceProbe(const UWorld* World, const AActor* Owner, const FVector& Start, const FVector& End, FHitResult& OutHit);
+	void TraceBatch();
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Trace the wall probes of Owner every frame, and its aim probe once enabled. */
+	void Register(const AActor* Owner, float WallDistance, const USceneComponent* AimComponent = nullptr, float AimDistance = 0.f);
+	void Unregister(const AActor* Owner);
+	void SetAimEnabled(const AActor* Owner, bool bEnabled);
+
+	/* Leave the wall probes of Owner out of the batch, its wall checks trace on demand meanwhile. */
+	void SetWallsEnabled(const AActor* Owner, bool bEnabled);
+
+	/* Line trace on the visibility channel ignoring Owner, answered from the batch when it traced the same segment. */
+	bool Trace(const AActor* Owner, ES_QueryProbe Probe, const FVector& Start, const FVector& End, FHitResult& OutHit);
+
+	int32 GetNumEntries() const { return Entries.Num(); }
+};
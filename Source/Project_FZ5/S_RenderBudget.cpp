@@ -0,0 +1,100 @@
+#include "S_RenderBudget.h"
+#include "ProceduralMeshComponent.h"
+
+
+void FS_RenderBudget::Adapt(float GpuMs, float DeltaTime)
+{
+	if (TargetGpuMs <= 0.f || GpuMs <= 0.f) return;
+
+	// A few frames of smoothing, a single hitch must not hide half of the pieces.
+	SmoothedGpuMs = SmoothedGpuMs > 0.f ? FMath::Lerp(SmoothedGpuMs, GpuMs, 0.1f) : GpuMs;
+
+	// Dead band under the target, so the thresholds do not swing around it.
+	if (SmoothedGpuMs > TargetGpuMs)
+		Scale *= 1.f + AdaptRate * DeltaTime;
+	else if (SmoothedGpuMs < TargetGpuMs * 0.85f)
+		Scale /= 1.f + AdaptRate * DeltaTime;
+
+	Scale = FMath::Clamp(Scale, MinScale, MaxScale);
+}
+
+FS_RenderThresholds FS_RenderBudget::GetThresholds() const
+{
+	FS_RenderThresholds Thresholds = Base;
+	Thresholds.CullScreenSize *= Scale;
+	Thresholds.ShadowScreenSize *= Scale;
+	Thresholds.LumenScreenSize *= Scale;
+	Thresholds.SimplifyScreenSize *= Scale;
+	return Thresholds;
+}
+
+FS_RenderDecision FS_RenderBudget::Decide(const FS_RenderFragment& Fragment, const FS_RenderThresholds& Thresholds)
+{
+	FS_RenderDecision Decision;
+	Decision.bVisible = Fragment.ScreenSize >= Thresholds.CullScreenSize && Fragment.Volume >= Thresholds.CullVolume;
+	Decision.bCastShadow = Decision.bVisible && Fragment.ScreenSize >= Thresholds.ShadowScreenSize;
+	Decision.bAffectLumen = Decision.bVisible && Fragment.ScreenSize >= Thresholds.LumenScreenSize;
+	Decision.bSimplified = Decision.bVisible && Fragment.NumTriangles > Thresholds.SimplifyTriangles && Fragment.ScreenSize < Thresholds.SimplifyScreenSize;
+	return Decision;
+}
+
+float FS_RenderBudget::GetScreenSize(float BoundsRadius, float Distance, float HalfFovRadians)
+{
+	const float HalfWidth = FMath::Max(Distance * FMath::Tan(HalfFovRadians), 1.f);
+	return BoundsRadius / HalfWidth;
+}
+
+void FS_RenderBudget::Simplify(const FProcMeshSection& Section, float CellSize, FProcMeshSection& OutSection)
+{
+	OutSection.Reset();
+	if (CellSize <= 0.f) return;
+
+	// One vertex per occupied cell, at the average of the vertices falling in it.
+	TMap<FIntVector, int32> Cells;
+	TArray<int32> Remap;
+	TArray<int32> Counts;
+	Remap.SetNumUninitialized(Section.ProcVertexBuffer.Num());
+
+	for (int32 VertexIndex = 0; VertexIndex < Section.ProcVertexBuffer.Num(); VertexIndex++)
+	{
+		const FProcMeshVertex& Vertex = Section.ProcVertexBuffer[VertexIndex];
+		const FIntVector Cell(FMath::FloorToInt(Vertex.Position.X / CellSize), FMath::FloorToInt(Vertex.Position.Y / CellSize), FMath::FloorToInt(Vertex.Position.Z / CellSize));
+
+		int32& NewIndex = Cells.FindOrAdd(Cell, INDEX_NONE);
+		if (NewIndex == INDEX_NONE)
+		{
+			NewIndex = OutSection.ProcVertexBuffer.Add(Vertex);
+			Counts.Add(1);
+		}
+		else
+		{
+			FProcMeshVertex& Merged = OutSection.ProcVertexBuffer[NewIndex];
+			Merged.Position += Vertex.Position;
+			Merged.Normal += Vertex.Normal;
+			Counts[NewIndex]++;
+		}
+		Remap[VertexIndex] = NewIndex;
+	}
+
+	for (int32 VertexIndex = 0; VertexIndex < OutSection.ProcVertexBuffer.Num(); VertexIndex++)
+	{
+		FProcMeshVertex& Vertex = OutSection.ProcVertexBuffer[VertexIndex];
+		Vertex.Position /= Counts[VertexIndex];
+		Vertex.Normal = Vertex.Normal.GetSafeNormal();
+		OutSection.SectionLocalBox += Vertex.Position;
+	}
+
+	for (int32 Index = 0; Index + 2 < Section.ProcIndexBuffer.Num(); Index += 3)
+	{
+		const uint32 A = Remap[Section.ProcIndexBuffer[Index]];
+		const uint32 B = Remap[Section.ProcIndexBuffer[Index + 1]];
+		const uint32 C = Remap[Section.ProcIndexBuffer[Index + 2]];
+		if (A == B || B == C || C == A) continue;
+
+		OutSection.ProcIndexBuffer.Add(A);
+		OutSection.ProcIndexBuffer.Add(B);
+		OutSection.ProcIndexBuffer.Add(C);
+	}
+
+	OutSection.bSectionVisible = Section.bSectionVisible;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FProcMeshSection;
+
+/* Screen sizes are the bounds radius over the half width of the view at the distance of the piece. */
+struct FS_RenderThresholds
+{
+	float CullScreenSize = 0.005f;
+	float CullVolume = 125.f;
+	float ShadowScreenSize = 0.05f;
+	float LumenScreenSize = 0.03f;
+	float SimplifyScreenSize = 0.1f;
+	int32 SimplifyTriangles = 500;
+};
+
+/* What the renderer gets to know about a fragment. */
+struct FS_RenderFragment
+{
+	float ScreenSize = 0.f;
+	float Volume = 0.f;
+	int32 NumTriangles = 0;
+};
+
+struct FS_RenderDecision
+{
+	bool bVisible = true;
+	bool bCastShadow = true;
+	bool bAffectLumen = true;
+	bool bSimplified = false;
+
+	bool operator==(const FS_RenderDecision& Other) const
+	{
+		return bVisible == Other.bVisible && bCastShadow == Other.bCastShadow && bAffectLumen == Other.bAffectLumen && bSimplified == Other.bSimplified;
+	}
+	bool operator!=(const FS_RenderDecision& Other) const { return !(*this == Other); }
+};
+
+/*
+ * Render cost of the fragments, free of any UObject access so it runs headless. The screen size thresholds are scaled
+ * up while the measured GPU time is over its target, and back down once it has room again.
+ */
+struct FS_RenderBudget
+{
+	FS_RenderThresholds Base;
+
+	float TargetGpuMs = 0.f;
+	float MinScale = 0.5f;
+	float MaxScale = 8.f;
+
+	// Fraction by which the scale moves per second of being over or under target.
+	float AdaptRate = 1.f;
+
+	float Scale = 1.f;
+	float SmoothedGpuMs = 0.f;
+
+	/* Feed the GPU time of the last frame, no adaptation without a target. */
+	void Adapt(float GpuMs, float DeltaTime);
+
+	FS_RenderThresholds GetThresholds() const;
+
+	static FS_RenderDecision Decide(const FS_RenderFragment& Fragment, const FS_RenderThresholds& Thresholds);
+
+	static float GetScreenSize(float BoundsRadius, float Distance, float HalfFovRadians);
+
+	/* Merge the vertices of Section sharing a cell of CellSize and drop the triangles that collapse. */
+	static void Simplify(const FProcMeshSection& Section, float CellSize, FProcMeshSection& OutSection);
+};
@@ -0,0 +1,101 @@
+#include "S_RenderBudget.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Plain data in and out, so these run headless: -nullrhi -ExecCmds="Automation RunTests FZ5.RenderBudget".
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FS_RenderBudgetDecideTest, "FZ5.RenderBudget.Decide",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FS_RenderBudgetDecideTest::RunTest(const FString& Parameters)
+{
+	const FS_RenderThresholds Thresholds;
+
+	auto Decide = [&Thresholds](float ScreenSize, float Volume, int32 NumTriangles)
+	{
+		FS_RenderFragment Fragment;
+		Fragment.ScreenSize = ScreenSize;
+		Fragment.Volume = Volume;
+		Fragment.NumTriangles = NumTriangles;
+		return FS_RenderBudget::Decide(Fragment, Thresholds);
+	};
+
+	FS_RenderDecision Decision = Decide(0.5f, 1000.f, 100);
+	TestTrue(TEXT("Big piece is visible"), Decision.bVisible);
+	TestTrue(TEXT("Big piece casts shadows"), Decision.bCastShadow);
+	TestTrue(TEXT("Big piece affects Lumen"), Decision.bAffectLumen);
+	TestFalse(TEXT("Big piece is not simplified"), Decision.bSimplified);
+
+	Decision = Decide(Thresholds.CullScreenSize * 0.5f, 1000.f, 100);
+	TestFalse(TEXT("Piece under the cull screen size is hidden"), Decision.bVisible);
+	TestFalse(TEXT("Hidden piece casts no shadow"), Decision.bCastShadow);
+	TestFalse(TEXT("Hidden piece does not affect Lumen"), Decision.bAffectLumen);
+	TestFalse(TEXT("Hidden piece is not simplified"), Decision.bSimplified);
+
+	TestFalse(TEXT("Piece under the cull volume is hidden"), Decide(0.5f, Thresholds.CullVolume * 0.5f, 100).bVisible);
+	TestTrue(TEXT("Piece at the cull screen size is visible"), Decide(Thresholds.CullScreenSize, 1000.f, 100).bVisible);
+
+	// Between the Lumen and the shadow thresholds.
+	Decision = Decide((Thresholds.LumenScreenSize + Thresholds.ShadowScreenSize) * 0.5f, 1000.f, 100);
+	TestTrue(TEXT("Mid piece is visible"), Decision.bVisible);
+	TestFalse(TEXT("Mid piece casts no shadow"), Decision.bCastShadow);
+	TestTrue(TEXT("Mid piece affects Lumen"), Decision.bAffectLumen);
+
+	Decision = Decide((Thresholds.CullScreenSize + Thresholds.LumenScreenSize) * 0.5f, 1000.f, 100);
+	TestTrue(TEXT("Small piece is visible"), Decision.bVisible);
+	TestFalse(TEXT("Small piece casts no shadow"), Decision.bCastShadow);
+	TestFalse(TEXT("Small piece does not affect Lumen"), Decision.bAffectLumen);
+
+	// The LOD only goes to dense pieces small on screen.
+	const float SimplifySize = Thresholds.SimplifyScreenSize * 0.8f;
+	TestTrue(TEXT("Dense small piece is simplified"), Decide(SimplifySize, 1000.f, Thresholds.SimplifyTriangles + 1).bSimplified);
+	TestFalse(TEXT("Light small piece is not simplified"), Decide(SimplifySize, 1000.f, Thresholds.SimplifyTriangles).bSimplified);
+	TestFalse(TEXT("Dense big piece is not simplified"), Decide(Thresholds.SimplifyScreenSize, 1000.f, Thresholds.SimplifyTriangles + 1).bSimplified);
+
+	TestEqual(TEXT("Screen size is the radius over the half width"), FS_RenderBudget::GetScreenSize(50.f, 1000.f, PI / 4.f), 0.05f, KINDA_SMALL_NUMBER);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FS_RenderBudgetAdaptTest, "FZ5.RenderBudget.Adapt",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FS_RenderBudgetAdaptTest::RunTest(const FString& Parameters)
+{
+	auto Run = [](FS_RenderBudget& Budget, float GpuMs, float Seconds)
+	{
+		for (float Time = 0.f; Time < Seconds; Time += 0.1f) Budget.Adapt(GpuMs, 0.1f);
+	};
+
+	FS_RenderBudget Budget;
+	Run(Budget, 20.f, 1.f);
+	TestEqual(TEXT("No adaptation without a target"), Budget.Scale, 1.f);
+
+	// Over target, the thresholds grow and pieces that were drawn get culled.
+	Budget.TargetGpuMs = 10.f;
+	Run(Budget, 20.f, 1.f);
+	TestTrue(TEXT("Scale grows over target"), Budget.Scale > 1.f);
+
+	FS_RenderFragment Fragment;
+	Fragment.ScreenSize = Budget.Base.CullScreenSize * 1.05f;
+	Fragment.Volume = 1000.f;
+	TestTrue(TEXT("Piece is visible at the base thresholds"), FS_RenderBudget::Decide(Fragment, Budget.Base).bVisible);
+	TestFalse(TEXT("Piece is culled at the scaled thresholds"), FS_RenderBudget::Decide(Fragment, Budget.GetThresholds()).bVisible);
+
+	Run(Budget, 20.f, 60.f);
+	TestEqual(TEXT("Scale stops at its maximum"), Budget.Scale, Budget.MaxScale);
+
+	// Inside the dead band nothing moves, under it the thresholds come back down.
+	Budget.SmoothedGpuMs = 9.f;
+	const float Scale = Budget.Scale;
+	Run(Budget, 9.f, 1.f);
+	TestEqual(TEXT("Scale holds in the dead band"), Budget.Scale, Scale);
+
+	Run(Budget, 5.f, 1.f);
+	TestTrue(TEXT("Scale shrinks under target"), Budget.Scale < Scale);
+
+	Run(Budget, 5.f, 60.f);
+	TestEqual(TEXT("Scale stops at its minimum"), Budget.Scale, Budget.MinScale);
+	return true;
+}
+
+#endif
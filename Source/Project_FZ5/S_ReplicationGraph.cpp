@@ -0,0 +1,184 @@
+#include "S_ReplicationGraph.h"
+#include "S_Player.h"
+#include "S_SlicedMesh.h"
+#include "Project_FZ5.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Replicate actors"), STAT_FZ5_ReplicateActors, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Net connections"), STAT_FZ5_NetConnections, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<float> CVarNetGridCellSize(
+	TEXT("fz5.Net.GridCellSize"),
+	10000.f,
+	TEXT("Size in cm of the cells of the replication grid, read when the net driver starts."));
+
+static TAutoConsoleVariable<float> CVarNetGridExtent(
+	TEXT("fz5.Net.GridExtent"),
+	100000.f,
+	TEXT("Distance from the origin the replication grid starts at, read when the net driver starts."));
+
+static TAutoConsoleVariable<float> CVarNetPlayerCullDistance(
+	TEXT("fz5.Net.PlayerCullDistance"),
+	15000.f,
+	TEXT("Distance past which a player is not replicated to a connection."));
+
+static TAutoConsoleVariable<float> CVarNetSliceableCullDistance(
+	TEXT("fz5.Net.SliceableCullDistance"),
+	20000.f,
+	TEXT("Distance past which the slices and fragment snapshots of a sliceable are not sent to a connection."));
+
+
+void US_ReplicationGraph::SetClassInfo(UClass* Class, float CullDistance)
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+	FClassReplicationInfo ClassInfo;
+	ClassInfo.SetCullDistanceSquared(FMath::Square(CullDistance));
+	ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+	GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+}
+
+void US_ReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Subclasses read the closest listed parent, blueprints of the player included.
+	ClassRouting.Reset();
+	ClassRouting.Add(AReplicationGraphDebugActor::StaticClass(), ES_NetRouting::NotRouted);
+	ClassRouting.Add(ALevelScriptActor::StaticClass(), ES_NetRouting::NotRouted);
+	ClassRouting.Add(APlayerController::StaticClass(), ES_NetRouting::NotRouted);
+	ClassRouting.Add(AInfo::StaticClass(), ES_NetRouting::AlwaysRelevant);
+	ClassRouting.Add(AS_Player::StaticClass(), ES_NetRouting::SpatializeDynamic);
+	ClassRouting.Add(AS_SlicedMesh::StaticClass(), ES_NetRouting::SpatializeDormancy);
+
+	const AActor* ActorCDO = AActor::StaticClass()->GetDefaultObject<AActor>();
+	SetClassInfo(AActor::StaticClass(), FMath::Sqrt(ActorCDO->NetCullDistanceSquared));
+	SetClassInfo(AS_Player::StaticClass(), CVarNetPlayerCullDistance.GetValueOnGameThread());
+	SetClassInfo(AS_SlicedMesh::StaticClass(), CVarNetSliceableCullDistance.GetValueOnGameThread());
+}
+
+ES_NetRouting US_ReplicationGraph::GetRouting(UClass* Class)
+{
+	if (const ES_NetRouting* Routing = ClassRouting.Find(Class)) return *Routing;
+
+	for (UClass* Parent = Class->GetSuperClass(); Parent; Parent = Parent->GetSuperClass())
+	{
+		if (const ES_NetRouting* Routing = ClassRouting.Find(Parent))
+			return ClassRouting.Add(Class, *Routing);
+	}
+
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+	ES_NetRouting Routing = ES_NetRouting::SpatializeDynamic;
+	if (ActorCDO->bAlwaysRelevant) Routing = ES_NetRouting::AlwaysRelevant;
+	else if (ActorCDO->bOnlyRelevantToOwner) Routing = ES_NetRouting::NotRouted;
+
+	return ClassRouting.Add(Class, Routing);
+}
+
+void US_ReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = CVarNetGridCellSize.GetValueOnGameThread();
+	GridNode->SpatialBias = FVector2D(-CVarNetGridExtent.GetValueOnGameThread());
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void US_ReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* ConnectionManager)
+{
+	Super::InitConnectionGraphNodes(ConnectionManager);
+
+	// The player controller and the view target of the connection.
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ConnectionNode, ConnectionManager);
+}
+
+void US_ReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetRouting(ActorInfo.Class))
+	{
+	case ES_NetRouting::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		Stats.AlwaysRelevantActors++;
+		break;
+	case ES_NetRouting::SpatializeStatic:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		Stats.SpatializedActors++;
+		break;
+	case ES_NetRouting::SpatializeDynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		Stats.SpatializedActors++;
+		break;
+	case ES_NetRouting::SpatializeDormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		Stats.SpatializedActors++;
+		break;
+	default:
+		break;
+	}
+}
+
+void US_ReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetRouting(ActorInfo.Class))
+	{
+	case ES_NetRouting::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		Stats.AlwaysRelevantActors--;
+		break;
+	case ES_NetRouting::SpatializeStatic:
+		GridNode->RemoveActor_Static(ActorInfo);
+		Stats.SpatializedActors--;
+		break;
+	case ES_NetRouting::SpatializeDynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		Stats.SpatializedActors--;
+		break;
+	case ES_NetRouting::SpatializeDormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		Stats.SpatializedActors--;
+		break;
+	default:
+		break;
+	}
+}
+
+int32 US_ReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	FZ5_SCOPE(ReplicateActors);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+	Stats.ReplicateTime = FPlatformTime::Seconds() - StartTime;
+	Stats.Connections = Connections.Num();
+
+	SET_DWORD_STAT(STAT_FZ5_NetConnections, Stats.Connections);
+	return Result;
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs NetGraphStatsCommand(
+	TEXT("fz5.Net.GraphStats"),
+	TEXT("Log the connections and actors of the replication graph, and the time of its last frame."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		const US_ReplicationGraph* Graph = NetDriver ? Cast<US_ReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+		if (!Graph)
+		{
+			UE_LOG(LogFZ5, Display, TEXT("No replication graph, run it on a server with ReplicationDriverClassName set."));
+			return;
+		}
+
+		const FS_NetGraphStats& Stats = Graph->GetStats();
+		UE_LOG(LogFZ5, Display, TEXT("Replication graph: %d connections, %d always relevant and %d spatialized actors, %.3f ms last frame"),
+			Stats.Connections, Stats.AlwaysRelevantActors, Stats.SpatializedActors, Stats.ReplicateTime * 1000.0);
+	}));
+#endif
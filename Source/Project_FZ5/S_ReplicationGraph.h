@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "S_ReplicationGraph.generated.h"
+
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_GridSpatialization2D;
+
+/* How the actors of a class reach the connections. */
+enum class ES_NetRouting : uint8
+{
+	// Owner only actors, gathered by the node of their connection.
+	NotRouted,
+	AlwaysRelevant,
+	SpatializeStatic,
+	SpatializeDynamic,
+
+	// Static in the grid while dormant, dynamic while awake, like the sliceables between their first slice and the rest of their pieces.
+	SpatializeDormancy,
+};
+
+/* Actors routed by the graph, and its last frame on the server. */
+struct FS_NetGraphStats
+{
+	int32 Connections = 0;
+	int32 AlwaysRelevantActors = 0;
+	int32 SpatializedActors = 0;
+	double ReplicateTime = 0.0;
+};
+
+/*
+ * Replication graph of the project: players and sliceables in a 2D grid, so each connection only gathers the cells
+ * around its viewer, and the game state in a list every connection gets. Sliceables stay dormant until they are cut.
+ * Measured on a -server -nullrhi instance with clients launched as -nullrhi -nosound, with stat FZ5 and fz5.Net.GraphStats.
+ */
+UCLASS(Transient)
+class PROJECT_FZ5_API US_ReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	/* Routing of every class met so far, resolved from its closest listed parent. */
+	TMap<UClass*, ES_NetRouting> ClassRouting;
+
+	FS_NetGraphStats Stats;
+
+	ES_NetRouting GetRouting(UClass* Class);
+	void SetClassInfo(UClass* Class, float CullDistance);
+
+public:
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* ConnectionManager) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	const FS_NetGraphStats& GetStats() const { return Stats; }
+};
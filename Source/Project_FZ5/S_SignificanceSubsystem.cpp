@@ -0,0 +1,355 @@
+#include "S_SignificanceSubsystem.h"
+#include "S_Player.h"
+#include "S_QueryService.h"
+#include "Project_FZ5.h"
+#include "Async/ParallelFor.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Significance"), STAT_FZ5_Significance, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance high"), STAT_FZ5_SignificanceHigh, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance medium"), STAT_FZ5_SignificanceMedium, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance low"), STAT_FZ5_SignificanceLow, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance dormant"), STAT_FZ5_SignificanceDormant, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Idle pawns"), STAT_FZ5_IdlePawns, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<int32> CVarSignificanceEnabled(
+	TEXT("fz5.Significance.Enabled"),
+	1,
+	TEXT("Lower the tick rate of the pawns and the physics fidelity of the fragments far from every player."));
+
+static TAutoConsoleVariable<int32> CVarSignificanceParallel(
+	TEXT("fz5.Significance.Parallel"),
+	1,
+	TEXT("Score on worker threads, 0 to score on the game thread."));
+
+static TAutoConsoleVariable<float> CVarSignificanceHighScore(
+	TEXT("fz5.Significance.HighScore"),
+	0.05f,
+	TEXT("Score, bounds radius over distance, over which a component runs at full rate."));
+
+static TAutoConsoleVariable<float> CVarSignificanceMediumScore(
+	TEXT("fz5.Significance.MediumScore"),
+	0.01f,
+	TEXT("Score over which a component is of medium significance."));
+
+static TAutoConsoleVariable<float> CVarSignificanceLowScore(
+	TEXT("fz5.Significance.LowScore"),
+	0.002f,
+	TEXT("Score over which a component is of low significance, dormant under it."));
+
+static TAutoConsoleVariable<float> CVarSignificanceOffViewScale(
+	TEXT("fz5.Significance.OffViewScale"),
+	0.25f,
+	TEXT("Factor on the score of what is outside of the view of every player."));
+
+static TAutoConsoleVariable<float> CVarSignificanceMediumTickInterval(
+	TEXT("fz5.Significance.MediumTickInterval"),
+	0.033f,
+	TEXT("Tick interval of the pawns of medium significance."));
+
+static TAutoConsoleVariable<float> CVarSignificanceLowTickInterval(
+	TEXT("fz5.Significance.LowTickInterval"),
+	0.1f,
+	TEXT("Tick interval of the pawns of low significance."));
+
+static TAutoConsoleVariable<float> CVarSignificanceDormantTickInterval(
+	TEXT("fz5.Significance.DormantTickInterval"),
+	0.25f,
+	TEXT("Tick interval of the dormant pawns."));
+
+static TAutoConsoleVariable<float> CVarSignificanceSleepSpeed(
+	TEXT("fz5.Significance.SleepSpeed"),
+	20.f,
+	TEXT("Speed under which a fragment of low significance is put to sleep, four times that for dormant ones."));
+
+static TAutoConsoleVariable<float> CVarSignificanceIdleSpeed(
+	TEXT("fz5.Significance.IdleSpeed"),
+	10.f,
+	TEXT("Speed under which a neutral pawn below high significance skips its batched wall probes."));
+
+
+void US_SignificanceSubsystem::Deinitialize()
+{
+	Entries.Empty();
+	Viewers.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId US_SignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_SignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void US_SignificanceSubsystem::Register(UPrimitiveComponent* Component, ES_SignificanceKind Kind, float Relevance)
+{
+	if (!Component) return;
+
+	FS_SignificanceEntry* Entry = Entries.FindByPredicate([Component](const FS_SignificanceEntry& Other) { return Other.Component == Component; });
+	if (!Entry)
+	{
+		Entry = &Entries.AddDefaulted_GetRef();
+		Entry->Component = Component;
+	}
+	else
+	{
+		// A fragment sliced again comes back at full fidelity until the next pass says otherwise.
+		Entry->Level = ES_Significance::High;
+		if (Entry->Kind == ES_SignificanceKind::Pawn)
+			ApplyPawn(*Entry);
+		else
+			ApplyFragment(*Entry);
+	}
+
+	Entry->Kind = Kind;
+	Entry->Relevance = Relevance;
+}
+
+void US_SignificanceSubsystem::Unregister(UPrimitiveComponent* Component)
+{
+	const int32 Index = Entries.IndexOfByPredicate([Component](const FS_SignificanceEntry& Other) { return Other.Component == Component; });
+	if (Index == INDEX_NONE) return;
+
+	FS_SignificanceEntry& Entry = Entries[Index];
+	Entry.Level = ES_Significance::High;
+	if (Entry.Component.IsValid())
+	{
+		if (Entry.Kind == ES_SignificanceKind::Pawn)
+			ApplyPawn(Entry);
+		else
+			ApplyFragment(Entry);
+	}
+
+	Entries.RemoveAtSwap(Index);
+}
+
+float US_SignificanceSubsystem::Score(const FVector& Location, float Radius, float Relevance, TArrayView<const FS_SignificanceViewer> Viewers, float OffViewScale)
+{
+	Radius = FMath::Max(Radius, 1.f);
+
+	float Best = 0.f;
+	for (const FS_SignificanceViewer& Viewer : Viewers)
+	{
+		const FVector ToLocation = Location - Viewer.Location;
+		const float Distance = ToLocation.Size();
+		float ViewerScore = Radius / FMath::Max(Distance, Radius);
+
+		// Within its own radius of the viewer a component is in view whatever the direction.
+		if (Distance > Radius && FVector::DotProduct(ToLocation / Distance, Viewer.Direction) < Viewer.CosHalfFov)
+			ViewerScore *= OffViewScale;
+
+		Best = FMath::Max(Best, ViewerScore);
+	}
+
+	return Best * (1.f + Relevance);
+}
+
+ES_Significance US_SignificanceSubsystem::GetLevel(float Score, float HighScore, float MediumScore, float LowScore)
+{
+	if (Score >= HighScore) return ES_Significance::High;
+	if (Score >= MediumScore) return ES_Significance::Medium;
+	if (Score >= LowScore) return ES_Significance::Low;
+	return ES_Significance::Dormant;
+}
+
+void US_SignificanceSubsystem::GatherViewers()
+{
+	Viewers.Reset();
+
+	// Every player controller counts, on a server those of the remote players too.
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (!PlayerController) continue;
+
+		FVector Location;
+		FRotator Rotation;
+		PlayerController->GetPlayerViewPoint(Location, Rotation);
+
+		// The view is wider than the horizontal field of view, a margin keeps the corners in.
+		const float Fov = PlayerController->PlayerCameraManager ? PlayerController->PlayerCameraManager->GetFOVAngle() : 90.f;
+		FS_SignificanceViewer& Viewer = Viewers.AddDefaulted_GetRef();
+		Viewer.Location = Location;
+		Viewer.Direction = Rotation.Vector();
+		Viewer.CosHalfFov = FMath::Cos(FMath::DegreesToRadians(FMath::Min(Fov * 0.5f + 15.f, 90.f)));
+	}
+}
+
+void US_SignificanceSubsystem::Snapshot(FS_SignificanceEntry& Entry) const
+{
+	const UPrimitiveComponent* Component = Entry.Component.Get();
+	Entry.Location = Component->Bounds.Origin;
+	Entry.Radius = Component->Bounds.SphereRadius;
+	Entry.bAlwaysHigh = false;
+	Entry.bIdleCandidate = false;
+
+	if (Entry.Kind != ES_SignificanceKind::Pawn) return;
+
+	const APawn* Pawn = Cast<APawn>(Component->GetOwner());
+	if (!Pawn) return;
+
+	// What the local player controls is always at full rate.
+	Entry.bAlwaysHigh = Pawn->IsLocallyControlled();
+
+	const float IdleSpeed = CVarSignificanceIdleSpeed.GetValueOnGameThread();
+	if (const AS_Player* Player = Cast<AS_Player>(Pawn))
+		Entry.bIdleCandidate = Player->GetState() == NEUTRAL && Player->GetVelocity().SizeSquared() < FMath::Square(IdleSpeed);
+}
+
+void US_SignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	FZ5_SCOPE(Significance);
+
+	Entries.RemoveAllSwap([](const FS_SignificanceEntry& Entry) { return !Entry.Component.IsValid(); });
+
+	if (!CVarSignificanceEnabled.GetValueOnGameThread())
+	{
+		RestoreAll();
+		return;
+	}
+
+	// Without anybody to look, as in a server with no player yet, nothing is less significant than the rest.
+	GatherViewers();
+	if (Viewers.Num() == 0 || Entries.Num() == 0) return;
+
+	for (FS_SignificanceEntry& Entry : Entries)
+		Snapshot(Entry);
+
+	const float OffViewScale = CVarSignificanceOffViewScale.GetValueOnGameThread();
+	const float HighScore = CVarSignificanceHighScore.GetValueOnGameThread();
+	const float MediumScore = CVarSignificanceMediumScore.GetValueOnGameThread();
+	const float LowScore = CVarSignificanceLowScore.GetValueOnGameThread();
+
+	const EParallelForFlags Flags = CVarSignificanceParallel.GetValueOnGameThread() ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+	ParallelFor(TEXT("FZ5Significance"), Entries.Num(), 64, [this, OffViewScale, HighScore, MediumScore, LowScore](int32 Index)
+	{
+		FS_SignificanceEntry& Entry = Entries[Index];
+		Entry.Score = Score(Entry.Location, Entry.Radius, Entry.Relevance, Viewers, OffViewScale);
+		Entry.Level = Entry.bAlwaysHigh ? ES_Significance::High : GetLevel(Entry.Score, HighScore, MediumScore, LowScore);
+	}, Flags);
+
+	FMemory::Memzero(NumLevels);
+	NumIdle = 0;
+
+	for (FS_SignificanceEntry& Entry : Entries)
+	{
+		if (Entry.Kind == ES_SignificanceKind::Pawn)
+			ApplyPawn(Entry);
+		else
+			ApplyFragment(Entry);
+
+		NumLevels[(int32)Entry.Level]++;
+		NumIdle += Entry.bIdle;
+	}
+
+	SET_DWORD_STAT(STAT_FZ5_SignificanceHigh, NumLevels[(int32)ES_Significance::High]);
+	SET_DWORD_STAT(STAT_FZ5_SignificanceMedium, NumLevels[(int32)ES_Significance::Medium]);
+	SET_DWORD_STAT(STAT_FZ5_SignificanceLow, NumLevels[(int32)ES_Significance::Low]);
+	SET_DWORD_STAT(STAT_FZ5_SignificanceDormant, NumLevels[(int32)ES_Significance::Dormant]);
+	SET_DWORD_STAT(STAT_FZ5_IdlePawns, NumIdle);
+}
+
+void US_SignificanceSubsystem::ApplyPawn(FS_SignificanceEntry& Entry)
+{
+	APawn* Pawn = Cast<APawn>(Entry.Component->GetOwner());
+	if (!Pawn) return;
+
+	// A neutral pawn standing still has no wall to find, its wall checks trace on demand when it moves again.
+	const bool bIdle = Entry.bIdleCandidate && Entry.Level != ES_Significance::High;
+	if (bIdle != Entry.bIdle)
+	{
+		Entry.bIdle = bIdle;
+		if (US_QueryService* QueryService = GetWorld()->GetSubsystem<US_QueryService>())
+			QueryService->SetWallsEnabled(Pawn, !bIdle);
+	}
+
+	if (Entry.Level == Entry.AppliedLevel) return;
+	Entry.AppliedLevel = Entry.Level;
+
+	float TickInterval = 0.f;
+	switch (Entry.Level)
+	{
+	case ES_Significance::Medium: TickInterval = CVarSignificanceMediumTickInterval.GetValueOnGameThread(); break;
+	case ES_Significance::Low: TickInterval = CVarSignificanceLowTickInterval.GetValueOnGameThread(); break;
+	case ES_Significance::Dormant: TickInterval = CVarSignificanceDormantTickInterval.GetValueOnGameThread(); break;
+	default: break;
+	}
+
+	Pawn->SetActorTickInterval(TickInterval);
+
+	// The movement of a player's own pawn, on its client or on the server, is stepped by its moves and stays at full rate.
+	const bool bOwnMovement = Pawn->IsLocallyControlled() || (Pawn->HasAuthority() && Pawn->IsPlayerControlled());
+	if (UPawnMovementComponent* Movement = Pawn->GetMovementComponent())
+		Movement->SetComponentTickInterval(bOwnMovement ? 0.f : TickInterval);
+}
+
+void US_SignificanceSubsystem::ApplyFragment(FS_SignificanceEntry& Entry)
+{
+	UPrimitiveComponent* Component = Entry.Component.Get();
+
+	// Pieces baked into the debris or back in the pool have no body to lower.
+	if (!Component->IsSimulatingPhysics())
+	{
+		Entry.AppliedLevel = ES_Significance::High;
+		return;
+	}
+
+	if (Entry.Level != Entry.AppliedLevel)
+	{
+		// Hit events are only worth their cost where a player can see or hear them.
+		Component->SetNotifyRigidBodyCollision(Entry.Level == ES_Significance::High);
+		Entry.AppliedLevel = Entry.Level;
+	}
+
+	// Far pieces that barely move are put to rest instead of jittering until they settle on their own.
+	if (Entry.Level >= ES_Significance::Low && Component->RigidBodyIsAwake())
+	{
+		const float SleepSpeed = CVarSignificanceSleepSpeed.GetValueOnGameThread() * (Entry.Level == ES_Significance::Dormant ? 4.f : 1.f);
+		if (Component->GetPhysicsLinearVelocity().SizeSquared() < FMath::Square(SleepSpeed))
+			Component->PutRigidBodyToSleep();
+	}
+}
+
+void US_SignificanceSubsystem::RestoreAll()
+{
+	for (FS_SignificanceEntry& Entry : Entries)
+	{
+		Entry.Level = ES_Significance::High;
+		Entry.bIdleCandidate = false;
+		if (Entry.Kind == ES_SignificanceKind::Pawn)
+			ApplyPawn(Entry);
+		else
+			ApplyFragment(Entry);
+	}
+
+	FMemory::Memzero(NumLevels);
+	NumLevels[(int32)ES_Significance::High] = Entries.Num();
+	NumIdle = 0;
+}
+
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs SignificanceStatsCommand(
+	TEXT("fz5.Significance.Stats"),
+	TEXT("Log how many pawns and fragments are at each significance."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const US_SignificanceSubsystem* Significance = World ? World->GetSubsystem<US_SignificanceSubsystem>() : nullptr;
+		if (!Significance) return;
+
+		UE_LOG(LogFZ5, Display, TEXT("%d scored: %d high, %d medium, %d low, %d dormant, %d idle pawns"),
+			Significance->GetNumEntries(),
+			Significance->GetNumAtLevel(ES_Significance::High),
+			Significance->GetNumAtLevel(ES_Significance::Medium),
+			Significance->GetNumAtLevel(ES_Significance::Low),
+			Significance->GetNumAtLevel(ES_Significance::Dormant),
+			Significance->GetNumIdle());
+	}));
+#endif
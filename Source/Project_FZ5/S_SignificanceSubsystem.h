@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_SignificanceSubsystem.generated.h"
+
+class UPrimitiveComponent;
+
+enum class ES_SignificanceKind : uint8 { Pawn, Fragment };
+
+enum class ES_Significance : uint8 { High, Medium, Low, Dormant };
+
+/* Where a player looks from, gathered on the game thread before the scores are computed. */
+struct FS_SignificanceViewer
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Direction = FVector::ForwardVector;
+	float CosHalfFov = 0.5f;
+};
+
+struct FS_SignificanceEntry
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	ES_SignificanceKind Kind = ES_SignificanceKind::Pawn;
+
+	// Snapshot taken on the game thread, the only part read by the parallel pass.
+	FVector Location = FVector::ZeroVector;
+	float Radius = 0.f;
+	float Relevance = 0.f;
+	bool bAlwaysHigh = false;
+	bool bIdleCandidate = false;
+
+	// Written by the parallel pass.
+	float Score = 1.f;
+	ES_Significance Level = ES_Significance::High;
+
+	// Last state applied to the component.
+	ES_Significance AppliedLevel = ES_Significance::High;
+	bool bIdle = false;
+};
+
+/*
+ * Scores the pawns and fragments by how close and how much in view of a player they are, once per frame in one
+ * parallel pass, and lowers the tick rate of the pawns and the physics fidelity of the fragments nobody looks at.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_SignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	TArray<FS_SignificanceEntry> Entries;
+	TArray<FS_SignificanceViewer> Viewers;
+
+	int32 NumLevels[4] = { 0, 0, 0, 0 };
+	int32 NumIdle = 0;
+
+	void GatherViewers();
+	void Snapshot(FS_SignificanceEntry& Entry) const;
+
+	void ApplyPawn(FS_SignificanceEntry& Entry);
+	void ApplyFragment(FS_SignificanceEntry& Entry);
+
+	/* Put every component back to full rate, used when the subsystem gets disabled. */
+	void RestoreAll();
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Score Component from now on, Relevance adds to its score as a fraction of it. Registering again resets it to High. */
+	void Register(UPrimitiveComponent* Component, ES_SignificanceKind Kind, float Relevance = 0.f);
+	void Unregister(UPrimitiveComponent* Component);
+
+	/* Bounds radius over the distance to the nearest viewer, scaled down outside of the view cones. */
+	static float Score(const FVector& Location, float Radius, float Relevance, TArrayView<const FS_SignificanceViewer> Viewers, float OffViewScale);
+
+	static ES_Significance GetLevel(float Score, float HighScore, float MediumScore, float LowScore);
+
+	int32 GetNumEntries() const { return Entries.Num(); }
+	int32 GetNumAtLevel(ES_Significance Level) const { return NumLevels[(int32)Level]; }
+	int32 GetNumIdle() const { return NumIdle; }
+};
@@ -0,0 +1,180 @@
+#include "S_SliceArchive.h"
+#include "S_SlicedMesh.h"
+#include "Project_FZ5.h"
+#include "Engine/World.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Slice restore"), STAT_FZ5_SliceRestore, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Archived sliceables"), STAT_FZ5_ArchivedSliceables, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Restoring sliceables"), STAT_FZ5_RestoringSliceables, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Archived slice records"), STAT_FZ5_ArchivedSliceMemory, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<int32> CVarStreamArchive(
+	TEXT("fz5.Stream.Archive"),
+	1,
+	TEXT("Keep the slices of the sliceables streamed out with their cell and replay them when it streams back in."));
+
+static TAutoConsoleVariable<float> CVarStreamRestoreBudgetMs(
+	TEXT("fz5.Stream.RestoreBudgetMs"),
+	1.f,
+	TEXT("Game thread time per frame spent queuing the slices of the sliceables streaming back in."));
+
+static TAutoConsoleVariable<int32> CVarStreamRestoreSlices(
+	TEXT("fz5.Stream.RestoreSlices"),
+	8,
+	TEXT("Slices queued per frame for each sliceable streaming back in, the slice subsystem commits them within its own budget."));
+
+
+void FS_SliceRecord::Write(const FS_SliceRecord& Record, TArray<uint8>& OutData)
+{
+	OutData.Reset();
+
+	TArray<uint8> Log;
+	FS_SliceLog::Write(Record.Events, Log);
+
+	FBitWriter Bits(0, true);
+	for (const FS_FragmentSnapshot& Piece : Record.Pieces)
+	{
+		bool bSuccess = true;
+		const_cast<FS_FragmentSnapshot&>(Piece).NetSerialize(Bits, nullptr, bSuccess);
+	}
+
+	uint8 RecordVersion = Version;
+	uint32 NumPieces = Record.Pieces.Num();
+	uint32 NumBits = Bits.GetNumBits();
+	FMemoryWriter Writer(OutData);
+	Writer << RecordVersion << Log << NumPieces << NumBits;
+	Writer.Serialize(Bits.GetData(), Bits.GetNumBytes());
+}
+
+bool FS_SliceRecord::Read(const TArray<uint8>& Data, FS_SliceRecord& OutRecord)
+{
+	OutRecord.Events.Reset();
+	OutRecord.Pieces.Reset();
+
+	uint8 RecordVersion = 0;
+	FMemoryReader Reader(Data);
+	Reader << RecordVersion;
+	if (Reader.IsError() || RecordVersion != Version) return false;
+
+	TArray<uint8> Log;
+	uint32 NumPieces = 0;
+	uint32 NumBits = 0;
+	Reader << Log << NumPieces << NumBits;
+
+	const int32 NumBytes = (int32)((NumBits + 7) / 8);
+	if (Reader.IsError() || NumBytes != Data.Num() - (int32)Reader.Tell() || NumPieces > NumBits / FS_FragmentSnapshot::MinBits) return false;
+	if (!FS_SliceLog::Read(Log, OutRecord.Events)) return false;
+
+	FBitReader Bits(const_cast<uint8*>(Data.GetData()) + Reader.Tell(), NumBits);
+	OutRecord.Pieces.Reserve(FMath::Min<uint32>(NumPieces, 64));
+	for (uint32 Index = 0; Index < NumPieces; Index++)
+	{
+		FS_FragmentSnapshot Piece;
+		bool bSuccess = true;
+		Piece.NetSerialize(Bits, nullptr, bSuccess);
+		if (!bSuccess || Bits.IsError()) return false;
+
+		OutRecord.Pieces.Add(Piece);
+	}
+
+	return true;
+}
+
+void US_SliceArchive::Deinitialize()
+{
+	Records.Empty();
+	Restoring.Empty();
+	ArchivedBytes = 0;
+
+	Super::Deinitialize();
+}
+
+TStatId US_SliceArchive::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_SliceArchive, STATGROUP_Tickables);
+}
+
+void US_SliceArchive::Save(AS_SlicedMesh* Source)
+{
+	if (!Source || !CVarStreamArchive.GetValueOnGameThread()) return;
+
+	FS_SliceRecord Record;
+	Source->SaveSlices(Record);
+	if (Record.Events.Num() == 0) return;
+
+	TArray<uint8>& Data = Records.FindOrAdd(Source->GetFName());
+	ArchivedBytes -= Data.Num();
+	FS_SliceRecord::Write(Record, Data);
+	Data.Shrink();
+	ArchivedBytes += Data.Num();
+}
+
+void US_SliceArchive::Restore(AS_SlicedMesh* Source)
+{
+	if (!Source) return;
+
+	TArray<uint8> Data;
+	if (!Records.RemoveAndCopyValue(Source->GetFName(), Data)) return;
+	ArchivedBytes -= Data.Num();
+
+	FS_SliceRecord Record;
+	if (!FS_SliceRecord::Read(Data, Record))
+	{
+		UE_LOG(LogFZ5, Warning, TEXT("%s: cannot read its slice record of %d bytes"), *Source->GetName(), Data.Num());
+		return;
+	}
+
+	Source->BeginRestore(MoveTemp(Record));
+	Restoring.AddUnique(Source);
+}
+
+void US_SliceArchive::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SET_DWORD_STAT(STAT_FZ5_ArchivedSliceables, Records.Num());
+	SET_DWORD_STAT(STAT_FZ5_RestoringSliceables, Restoring.Num());
+	SET_MEMORY_STAT(STAT_FZ5_ArchivedSliceMemory, ArchivedBytes);
+
+	if (Restoring.Num() == 0) return;
+
+	FZ5_SCOPE(SliceRestore);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = CVarStreamRestoreBudgetMs.GetValueOnGameThread() / 1000.0;
+	const int32 MaxSlices = FMath::Max(1, CVarStreamRestoreSlices.GetValueOnGameThread());
+
+	// At least one sliceable moves forward every frame, the others wait for the next one once over budget.
+	for (int32 Index = 0; Index < Restoring.Num();)
+	{
+		AS_SlicedMesh* Source = Restoring[Index].Get();
+		if (!Source || Source->StepRestore(MaxSlices))
+		{
+			Restoring.RemoveAt(Index);
+			continue;
+		}
+
+		Index++;
+		if (FPlatformTime::Seconds() - StartTime > Budget) break;
+	}
+}
+
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs StreamStatsCommand(
+	TEXT("fz5.Stream.Stats"),
+	TEXT("Log the slice records kept for the sliceables streamed out."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const US_SliceArchive* SliceArchive = World ? World->GetSubsystem<US_SliceArchive>() : nullptr;
+		if (!SliceArchive) return;
+
+		UE_LOG(LogFZ5, Display, TEXT("%d sliceables archived in %lld bytes, %d restoring"),
+			SliceArchive->GetNumRecords(), SliceArchive->GetArchivedBytes(), SliceArchive->GetNumRestoring());
+	}));
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_SliceReplication.h"
+#include "S_SliceArchive.generated.h"
+
+class AS_SlicedMesh;
+
+/* What is left of a sliceable once its cell unloads: its slice log and where each of its pieces was. */
+struct FS_SliceRecord
+{
+	/* Bumped whenever the layout below changes, older records are dropped rather than misread. */
+	static constexpr uint8 Version = 1;
+
+	TArray<FS_SliceEvent> Events;
+
+	/* Pieces still alive at the save, the ones at rest with no velocity. */
+	TArray<FS_FragmentSnapshot> Pieces;
+
+	/* The compressed slice log followed by the quantized pieces. */
+	static void Write(const FS_SliceRecord& Record, TArray<uint8>& OutData);
+	static bool Read(const TArray<uint8>& Data, FS_SliceRecord& OutRecord);
+};
+
+/*
+ * Keeps the slice records of the sliceables streamed out with their World Partition cell, and replays them a few
+ * slices per frame once the cell streams back in. Only the records of the unloaded sliceables are held here, as bytes.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_SliceArchive : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/* Records by actor name, stable across the streaming of a World Partition cell. */
+	TMap<FName, TArray<uint8>> Records;
+	int64 ArchivedBytes = 0;
+
+	TArray<TWeakObjectPtr<AS_SlicedMesh>> Restoring;
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Keep the slices of Source, which is about to stream out. */
+	void Save(AS_SlicedMesh* Source);
+
+	/* Start replaying the slices kept for Source, if any, when it streams back in. */
+	void Restore(AS_SlicedMesh* Source);
+
+	int32 GetNumRecords() const { return Records.Num(); }
+	int64 GetArchivedBytes() const { return ArchivedBytes; }
+	int32 GetNumRestoring() const { return Restoring.Num(); }
+};
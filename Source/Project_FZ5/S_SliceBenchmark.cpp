@@ -0,0 +1,337 @@
+#include "S_SliceBenchmark.h"
+#include "S_SliceKernel.h"
+#include "S_CapBuilder.h"
+#include "Project_FZ5.h"
+#include "KismetProceduralMeshLibrary.h"
+#include "Engine/World.h"
+
+
+static const FVector BenchmarkPlaneNormal = FVector(0.3f, 0.2f, 1.f).GetSafeNormal();
+
+FProcMeshSection FS_SliceBenchmark::MakeSphere(int32 NumTriangles, float Radius)
+{
+	const int32 Rings = FMath::Max(2, FMath::CeilToInt(FMath::Sqrt(NumTriangles / 4.f)));
+	const int32 Segments = Rings * 2;
+
+	FProcMeshSection Section;
+	Section.ProcVertexBuffer.Reserve((Rings + 1) * (Segments + 1));
+	Section.ProcIndexBuffer.Reserve(Rings * Segments * 6);
+
+	for (int32 Ring = 0; Ring <= Rings; Ring++)
+	{
+		const float Theta = PI * Ring / Rings;
+		for (int32 Segment = 0; Segment <= Segments; Segment++)
+		{
+			const float Phi = 2.f * PI * Segment / Segments;
+			const FVector Normal(FMath::Sin(Theta) * FMath::Cos(Phi), FMath::Sin(Theta) * FMath::Sin(Phi), FMath::Cos(Theta));
+
+			FProcMeshVertex& Vertex = Section.ProcVertexBuffer.AddDefaulted_GetRef();
+			Vertex.Position = Normal * Radius;
+			Vertex.Normal = Normal;
+			Vertex.Tangent = FProcMeshTangent(FVector(-FMath::Sin(Phi), FMath::Cos(Phi), 0.f), false);
+			Vertex.UV0 = FVector2D((float)Segment / Segments, (float)Ring / Rings);
+			Section.SectionLocalBox += Vertex.Position;
+		}
+	}
+
+	for (int32 Ring = 0; Ring < Rings; Ring++)
+	{
+		for (int32 Segment = 0; Segment < Segments; Segment++)
+		{
+			const uint32 A = Ring * (Segments + 1) + Segment;
+			const uint32 B = A + Segments + 1;
+			Section.ProcIndexBuffer.Append({ A, B, A + 1, A + 1, B, B + 1 });
+		}
+	}
+
+	return Section;
+}
+
+double FS_SliceBenchmark::TimeKernel(const FProcMeshSection& Section, int32 Iterations)
+{
+	FS_SliceInput Input;
+	Input.Reset(1);
+	Input.Sections[0].FromProcMeshSection(Section);
+	Input.Plane = FPlane(FVector::ZeroVector, BenchmarkPlaneNormal);
+
+	// The first slice warms up the output and scratch buffers, like a pooled job would be.
+	FS_SliceOutput Output;
+	FS_SliceKernel::Slice(Input, Output);
+
+	TArray<double> Samples;
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		FS_SliceKernel::Slice(Input, Output);
+		Samples.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+	return Median(Samples);
+}
+
+double FS_SliceBenchmark::TimeEngine(UWorld* World, const FProcMeshSection& Section, int32 Iterations)
+{
+	if (!World) return 0.0;
+
+	AActor* Owner = World->SpawnActor<AActor>();
+	if (!Owner) return 0.0;
+
+	TArray<double> Samples;
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		UProceduralMeshComponent* ProcMesh = NewObject<UProceduralMeshComponent>(Owner);
+		ProcMesh->SetProcMeshSection(0, Section);
+
+		UProceduralMeshComponent* OtherHalf = nullptr;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		UKismetProceduralMeshLibrary::SliceProceduralMesh(ProcMesh, FVector::ZeroVector, BenchmarkPlaneNormal, true, OtherHalf,
+			EProcMeshSliceCapOption::CreateNewSectionForCap, nullptr);
+		Samples.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+
+		if (OtherHalf) OtherHalf->DestroyComponent();
+		ProcMesh->DestroyComponent();
+	}
+
+	Owner->Destroy();
+	return Median(Samples);
+}
+
+TArray<FPlane> FS_SliceBenchmark::MakePlanes(int32 NumPlanes, float Radius)
+{
+	FRandomStream Random(NumPlanes);
+
+	TArray<FPlane> Planes;
+	for (int32 PlaneIndex = 0; PlaneIndex < NumPlanes; PlaneIndex++)
+	{
+		Planes.Emplace(Random.GetUnitVector() * Random.FRandRange(0.f, Radius * 0.4f), Random.GetUnitVector());
+	}
+	return Planes;
+}
+
+double FS_SliceBenchmark::TimeMultiKernel(const FProcMeshSection& Section, const TArray<FPlane>& Planes, int32 Iterations)
+{
+	FS_SliceInput Input;
+	Input.Reset(1);
+	Input.Sections[0].FromProcMeshSection(Section);
+	Input.MaxHullVertices = 32;
+
+	FS_MultiSliceOutput Output;
+	FS_SliceKernel::SliceMulti(Input, Planes, Output);
+
+	TArray<double> Samples;
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		FS_SliceKernel::SliceMulti(Input, Planes, Output);
+		Samples.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+	return Median(Samples);
+}
+
+double FS_SliceBenchmark::TimeChainedKernel(const FProcMeshSection& Section, const TArray<FPlane>& Planes, int32 Iterations)
+{
+	// Each piece is snapshot again before its next slice, the way the slice subsystem does it.
+	auto SliceChain = [&Section, &Planes]()
+	{
+		TArray<TArray<FProcMeshSection>> Pieces;
+		Pieces.Add({ Section });
+
+		FS_SliceInput Input;
+		FS_SliceOutput Output;
+		Input.MaxHullVertices = 32;
+
+		for (const FPlane& Plane : Planes)
+		{
+			TArray<TArray<FProcMeshSection>> NextPieces;
+			for (const TArray<FProcMeshSection>& Piece : Pieces)
+			{
+				Input.Reset(Piece.Num());
+				for (int32 SectionIndex = 0; SectionIndex < Piece.Num(); SectionIndex++)
+				{
+					Input.Sections[SectionIndex].FromProcMeshSection(Piece[SectionIndex]);
+				}
+				Input.Plane = Plane;
+
+				FS_SliceKernel::Slice(Input, Output);
+				if (!Output.bSliced)
+				{
+					NextPieces.Add(Piece);
+					continue;
+				}
+
+				TArray<FProcMeshSection>& Kept = NextPieces.Add_GetRef(Output.KeptSections);
+				Kept.Add(Output.KeptCap);
+				TArray<FProcMeshSection>& Other = NextPieces.Add_GetRef(Output.OtherSections);
+				Other.Add(Output.OtherCap);
+			}
+			Pieces = MoveTemp(NextPieces);
+		}
+	};
+
+	SliceChain();
+
+	TArray<double> Samples;
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		SliceChain();
+		Samples.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+	return Median(Samples);
+}
+
+TArray<FUtilEdge3D> FS_SliceBenchmark::MakeCrossSection(int32 NumEdges, double& OutArea)
+{
+	const int32 NumOuter = FMath::Max(6, NumEdges / 2) & ~1;
+	const int32 NumInner = FMath::Max(3, NumEdges - NumOuter);
+
+	// The star points alternate between two radii, every other corner being reflex. The hole stays inside the inner radius.
+	TArray<FVector> Outer;
+	for (int32 Index = 0; Index < NumOuter; Index++)
+	{
+		const double Angle = 2.0 * UE_DOUBLE_PI * Index / NumOuter;
+		const double Radius = Index % 2 == 0 ? 50.0 : 30.0;
+		Outer.Emplace(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.0);
+	}
+
+	TArray<FVector> Inner;
+	for (int32 Index = 0; Index < NumInner; Index++)
+	{
+		const double Angle = 2.0 * UE_DOUBLE_PI * Index / NumInner;
+		Inner.Emplace(FMath::Cos(Angle) * 15.0, FMath::Sin(Angle) * 15.0, 0.0);
+	}
+
+	auto GetLoopArea = [](const TArray<FVector>& Loop)
+	{
+		double Area = 0.0;
+		for (int32 Index = 0; Index < Loop.Num(); Index++)
+		{
+			const FVector& A = Loop[Index];
+			const FVector& B = Loop[(Index + 1) % Loop.Num()];
+			Area += A.X * B.Y - A.Y * B.X;
+		}
+		return FMath::Abs(Area) * 0.5;
+	};
+	OutArea = GetLoopArea(Outer) - GetLoopArea(Inner);
+
+	FRandomStream Random(NumEdges);
+	TArray<FUtilEdge3D> Edges;
+	for (const TArray<FVector>* Loop : { &Outer, &Inner })
+	{
+		for (int32 Index = 0; Index < Loop->Num(); Index++)
+		{
+			FUtilEdge3D& Edge = Edges.AddDefaulted_GetRef();
+			Edge.V0 = (*Loop)[Index];
+			Edge.V1 = (*Loop)[(Index + 1) % Loop->Num()];
+			if (Random.FRand() < 0.5f) Swap(Edge.V0, Edge.V1);
+		}
+	}
+
+	for (int32 Index = Edges.Num() - 1; Index > 0; Index--)
+	{
+		Edges.Swap(Index, Random.RandRange(0, Index));
+	}
+	return Edges;
+}
+
+double FS_SliceBenchmark::TimeCap(const TArray<FUtilEdge3D>& Edges, bool bGeomTools, int32 Iterations, FProcMeshSection& OutCap)
+{
+	const FPlane Plane(FVector::ZeroVector, FVector::UpVector);
+
+	TArray<double> Samples;
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+	{
+		OutCap.Reset();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		if (bGeomTools) FS_CapBuilder::BuildWithGeomTools(Edges, Plane, 64.f, OutCap);
+		else FS_CapBuilder::Build(Edges, Plane, 64.f, OutCap);
+		Samples.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+	return Median(Samples);
+}
+
+double FS_SliceBenchmark::GetArea(const FProcMeshSection& Section)
+{
+	double Area = 0.0;
+	for (int32 Index = 0; Index + 2 < Section.ProcIndexBuffer.Num(); Index += 3)
+	{
+		const FVector& A = Section.ProcVertexBuffer[Section.ProcIndexBuffer[Index]].Position;
+		const FVector& B = Section.ProcVertexBuffer[Section.ProcIndexBuffer[Index + 1]].Position;
+		const FVector& C = Section.ProcVertexBuffer[Section.ProcIndexBuffer[Index + 2]].Position;
+		Area += ((B - A) ^ (C - A)).Size() * 0.5;
+	}
+	return Area;
+}
+
+double FS_SliceBenchmark::Median(TArray<double>& Samples)
+{
+	if (Samples.Num() == 0) return 0.0;
+
+	Samples.Sort();
+	return Samples[Samples.Num() / 2];
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs BenchSliceKernelCommand(
+	TEXT("fz5.Bench.SliceKernel"),
+	TEXT("Compare the project slice kernel with SliceProceduralMesh. Arguments: [Triangles=10000] [Iterations=20]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumTriangles = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+		const int32 Iterations = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 20);
+
+		const FProcMeshSection Sphere = FS_SliceBenchmark::MakeSphere(NumTriangles);
+		const double KernelMs = FS_SliceBenchmark::TimeKernel(Sphere, Iterations);
+		const double EngineMs = FS_SliceBenchmark::TimeEngine(World, Sphere, Iterations);
+
+		UE_LOG(LogFZ5, Display, TEXT("Slice of %d triangles: kernel %.3f ms, engine %.3f ms, speedup x%.2f"),
+			Sphere.ProcIndexBuffer.Num() / 3, KernelMs, EngineMs, KernelMs > 0.0 ? EngineMs / KernelMs : 0.0);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchMultiSliceCommand(
+	TEXT("fz5.Bench.MultiSlice"),
+	TEXT("Compare a slice by N planes at once with N chained slices, for N from 2 to 8. Arguments: [Triangles=10000] [Iterations=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumTriangles = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10000;
+		const int32 Iterations = FMath::Max(1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 10);
+
+		const FProcMeshSection Sphere = FS_SliceBenchmark::MakeSphere(NumTriangles);
+		for (int32 NumPlanes = 2; NumPlanes <= 8; NumPlanes++)
+		{
+			const TArray<FPlane> Planes = FS_SliceBenchmark::MakePlanes(NumPlanes);
+			const double MultiMs = FS_SliceBenchmark::TimeMultiKernel(Sphere, Planes, Iterations);
+			const double ChainedMs = FS_SliceBenchmark::TimeChainedKernel(Sphere, Planes, Iterations);
+
+			UE_LOG(LogFZ5, Display, TEXT("%d planes through %d triangles: multi %.3f ms, chained %.3f ms, speedup x%.2f"),
+				NumPlanes, Sphere.ProcIndexBuffer.Num() / 3, MultiMs, ChainedMs, MultiMs > 0.0 ? ChainedMs / MultiMs : 0.0);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs BenchCapCommand(
+	TEXT("fz5.Bench.Cap"),
+	TEXT("Compare the project cap builder with the engine path on a concave cross-section with a hole, from 10 to 10000 edges. Arguments: [Iterations=10]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Iterations = FMath::Max(1, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10);
+
+		// The area shows which path filled the hole, or left part of the star open.
+		for (const int32 NumEdges : { 10, 100, 1000, 10000 })
+		{
+			double Area = 0.0;
+			const TArray<FUtilEdge3D> Edges = FS_SliceBenchmark::MakeCrossSection(NumEdges, Area);
+
+			FProcMeshSection ProjectCap;
+			FProcMeshSection EngineCap;
+			const double ProjectMs = FS_SliceBenchmark::TimeCap(Edges, false, Iterations, ProjectCap);
+			const double EngineMs = FS_SliceBenchmark::TimeCap(Edges, true, Iterations, EngineCap);
+
+			UE_LOG(LogFZ5, Display, TEXT("Cap of %d edges: project %.3f ms, %d triangles, %.1f%% of the area; engine %.3f ms, %d triangles, %.1f%% of the area; speedup x%.2f"),
+				Edges.Num(), ProjectMs, ProjectCap.ProcIndexBuffer.Num() / 3, FS_SliceBenchmark::GetArea(ProjectCap) / Area * 100.0,
+				EngineMs, EngineCap.ProcIndexBuffer.Num() / 3, FS_SliceBenchmark::GetArea(EngineCap) / Area * 100.0, ProjectMs > 0.0 ? EngineMs / ProjectMs : 0.0);
+		}
+	}));
+#endif
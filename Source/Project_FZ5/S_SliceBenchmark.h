@@ -0,0 +1,41 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GeomTools.h"
+#include "ProceduralMeshComponent.h"
+
+/* Slicing timings shared by the benchmark console commands. */
+struct FS_SliceBenchmark
+{
+	/* UV sphere with at least NumTriangles triangles, with normals, tangents and UVs. */
+	static FProcMeshSection MakeSphere(int32 NumTriangles, float Radius = 50.f);
+
+	/* Median milliseconds to slice Section in half with the project kernel. */
+	static double TimeKernel(const FProcMeshSection& Section, int32 Iterations);
+
+	/* Median milliseconds to slice Section in half with UKismetProceduralMeshLibrary::SliceProceduralMesh. */
+	static double TimeEngine(UWorld* World, const FProcMeshSection& Section, int32 Iterations);
+
+	/* The same planes going through a sphere of the given radius on every run, so the results can be compared. */
+	static TArray<FPlane> MakePlanes(int32 NumPlanes, float Radius = 50.f);
+
+	/* Median milliseconds to cut Section by all the planes in a single multi-plane slice. */
+	static double TimeMultiKernel(const FProcMeshSection& Section, const TArray<FPlane>& Planes, int32 Iterations);
+
+	/* Median milliseconds to cut Section by one plane after the other, every piece being sliced again by the next plane. */
+	static double TimeChainedKernel(const FProcMeshSection& Section, const TArray<FPlane>& Planes, int32 Iterations);
+
+	/*
+	 * Cut edges of a tube through a concave prop on the XY plane: a star with a round hole, NumEdges edges in total,
+	 * shuffled and flipped at random like the edges of a real slice come.
+	 */
+	static TArray<FUtilEdge3D> MakeCrossSection(int32 NumEdges, double& OutArea);
+
+	/* Median milliseconds to cap the cross-section with the project builder, or the engine path with bGeomTools. */
+	static double TimeCap(const TArray<FUtilEdge3D>& Edges, bool bGeomTools, int32 Iterations, FProcMeshSection& OutCap);
+
+	/* Area covered by the triangles of a section, overlapping ones counting twice. */
+	static double GetArea(const FProcMeshSection& Section);
+
+	static double Median(TArray<double>& Samples);
+};
@@ -0,0 +1,213 @@
+#include "S_SliceIndex.h"
+#include "Components/PrimitiveComponent.h"
+
+
+static TAutoConsoleVariable<float> CVarSliceIndexCellSize(
+	TEXT("fz5.SliceIndex.CellSize"),
+	400.0f,
+	TEXT("Size of the cells of the slicing broad phase grid, read when the world starts."));
+
+static TAutoConsoleVariable<int32> CVarSliceIndexMaxCells(
+	TEXT("fz5.SliceIndex.MaxCellsPerEntry"),
+	64,
+	TEXT("Components overlapping more cells than this are kept out of the grid and tested by every query."));
+
+
+void US_SliceIndex::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	CellSize = FMath::Max(CVarSliceIndexCellSize.GetValueOnGameThread(), 1.f);
+}
+
+void US_SliceIndex::Deinitialize()
+{
+	for (FS_SliceIndexEntry& Entry : Entries)
+	{
+		if (Entry.Component.IsValid()) Entry.Component->TransformUpdated.Remove(Entry.TransformHandle);
+	}
+
+	Entries.Empty();
+	EntryIds.Empty();
+	Cells.Empty();
+	OversizedEntries.Empty();
+	DirtyEntries.Empty();
+
+	Super::Deinitialize();
+}
+
+FIntVector US_SliceIndex::ToCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void US_SliceIndex::Register(UPrimitiveComponent* Component)
+{
+	if (!Component) return;
+
+	if (const int32* EntryId = EntryIds.Find(Component))
+	{
+		Refresh(*EntryId);
+		return;
+	}
+
+	const int32 EntryId = Entries.Add(FS_SliceIndexEntry());
+	FS_SliceIndexEntry& Entry = Entries[EntryId];
+	Entry.Component = Component;
+	Entry.Key = Component;
+	Entry.TransformHandle = Component->TransformUpdated.AddUObject(this, &US_SliceIndex::OnTransformUpdated);
+	EntryIds.Add(Component, EntryId);
+
+	Entry.Bounds = Component->Bounds.GetBox();
+	Link(EntryId);
+}
+
+void US_SliceIndex::Unregister(UPrimitiveComponent* Component)
+{
+	if (const int32* EntryId = EntryIds.Find(Component))
+		Remove(*EntryId);
+}
+
+void US_SliceIndex::Remove(int32 EntryId)
+{
+	FS_SliceIndexEntry& Entry = Entries[EntryId];
+	if (Entry.Component.IsValid()) Entry.Component->TransformUpdated.Remove(Entry.TransformHandle);
+
+	Unlink(EntryId);
+	DirtyEntries.Remove(EntryId);
+	EntryIds.Remove(Entry.Key);
+	Entries.RemoveAt(EntryId);
+}
+
+void US_SliceIndex::Link(int32 EntryId)
+{
+	FS_SliceIndexEntry& Entry = Entries[EntryId];
+	Entry.MinCell = ToCell(Entry.Bounds.Min);
+	Entry.MaxCell = ToCell(Entry.Bounds.Max);
+
+	const FIntVector Span = Entry.MaxCell - Entry.MinCell + FIntVector(1);
+	Entry.bOversized = (int64)Span.X * Span.Y * Span.Z > CVarSliceIndexMaxCells.GetValueOnGameThread();
+	if (Entry.bOversized)
+	{
+		OversizedEntries.Add(EntryId);
+		return;
+	}
+
+	for (int32 Z = Entry.MinCell.Z; Z <= Entry.MaxCell.Z; Z++)
+		for (int32 Y = Entry.MinCell.Y; Y <= Entry.MaxCell.Y; Y++)
+			for (int32 X = Entry.MinCell.X; X <= Entry.MaxCell.X; X++)
+				Cells.FindOrAdd(FIntVector(X, Y, Z)).Add(EntryId);
+}
+
+void US_SliceIndex::Unlink(int32 EntryId)
+{
+	const FS_SliceIndexEntry& Entry = Entries[EntryId];
+	if (Entry.bOversized)
+	{
+		OversizedEntries.RemoveSwap(EntryId);
+		return;
+	}
+
+	for (int32 Z = Entry.MinCell.Z; Z <= Entry.MaxCell.Z; Z++)
+	{
+		for (int32 Y = Entry.MinCell.Y; Y <= Entry.MaxCell.Y; Y++)
+		{
+			for (int32 X = Entry.MinCell.X; X <= Entry.MaxCell.X; X++)
+			{
+				const FIntVector Cell(X, Y, Z);
+				TArray<int32>* CellEntries = Cells.Find(Cell);
+				if (!CellEntries) continue;
+
+				CellEntries->RemoveSwap(EntryId);
+				if (CellEntries->Num() == 0) Cells.Remove(Cell);
+			}
+		}
+	}
+}
+
+void US_SliceIndex::Refresh(int32 EntryId)
+{
+	FS_SliceIndexEntry& Entry = Entries[EntryId];
+	Entry.Bounds = Entry.Component->Bounds.GetBox();
+
+	// Most moves stay within the same cells, only the bounds change then.
+	if (!Entry.bOversized && ToCell(Entry.Bounds.Min) == Entry.MinCell && ToCell(Entry.Bounds.Max) == Entry.MaxCell) return;
+
+	Unlink(EntryId);
+	Link(EntryId);
+}
+
+void US_SliceIndex::OnTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (const int32* EntryId = EntryIds.Find(Cast<UPrimitiveComponent>(Component)))
+		DirtyEntries.Add(*EntryId);
+}
+
+void US_SliceIndex::FlushDirty()
+{
+	for (const int32 EntryId : DirtyEntries)
+	{
+		if (Entries[EntryId].Component.IsValid()) Refresh(EntryId);
+	}
+	DirtyEntries.Reset();
+}
+
+void US_SliceIndex::QueryPlane(const FBox& Region, const FPlane& Plane, TArray<UPrimitiveComponent*>& OutComponents)
+{
+	FlushDirty();
+
+	// Every entry is tested once, even when it spans several of the visited cells.
+	QueryStamp++;
+	const FVector AbsNormal = Plane.GetNormal().GetAbs();
+	TArray<int32, TInlineAllocator<16>> StaleEntries;
+
+	auto TestEntry = [&](int32 EntryId)
+	{
+		FS_SliceIndexEntry& Entry = Entries[EntryId];
+		if (Entry.QueryStamp == QueryStamp) return;
+		Entry.QueryStamp = QueryStamp;
+
+		UPrimitiveComponent* Component = Entry.Component.Get();
+		if (!Component)
+		{
+			StaleEntries.Add(EntryId);
+			return;
+		}
+
+		if (!Entry.Bounds.Intersect(Region) || !Component->IsCollisionEnabled()) return;
+
+		FVector Center, Extent;
+		Entry.Bounds.GetCenterAndExtents(Center, Extent);
+		if (FMath::Abs(Plane.PlaneDot(Center)) <= FVector::DotProduct(Extent, AbsNormal))
+			OutComponents.Add(Component);
+	};
+
+	const FIntVector MinCell = ToCell(Region.Min);
+	const FIntVector MaxCell = ToCell(Region.Max);
+	for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+			{
+				if (const TArray<int32>* CellEntries = Cells.Find(FIntVector(X, Y, Z)))
+				{
+					for (const int32 EntryId : *CellEntries)
+					{
+						TestEntry(EntryId);
+					}
+				}
+			}
+		}
+	}
+
+	for (const int32 EntryId : OversizedEntries)
+	{
+		TestEntry(EntryId);
+	}
+
+	for (const int32 EntryId : StaleEntries)
+	{
+		Remove(EntryId);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_SliceIndex.generated.h"
+
+class USceneComponent;
+class UPrimitiveComponent;
+
+/* A sliceable component known to the index, with the grid cells its bounds were last inserted in. */
+struct FS_SliceIndexEntry
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	TObjectKey<UPrimitiveComponent> Key;
+	FBox Bounds = FBox(ForceInit);
+	FIntVector MinCell = FIntVector::ZeroValue;
+	FIntVector MaxCell = FIntVector::ZeroValue;
+	bool bOversized = false;
+	uint32 QueryStamp = 0;
+	FDelegateHandle TransformHandle;
+};
+
+/* Uniform grid over the bounds of sliceable meshes and their fragments, the broad phase of slicing. */
+UCLASS()
+class PROJECT_FZ5_API US_SliceIndex : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	TSparseArray<FS_SliceIndexEntry> Entries;
+	TMap<TObjectKey<UPrimitiveComponent>, int32> EntryIds;
+	TMap<FIntVector, TArray<int32>> Cells;
+
+	/* Entries spanning too many cells, tested by every query instead. */
+	TArray<int32> OversizedEntries;
+
+	/* Entries that moved since the last query, relinked lazily. */
+	TSet<int32> DirtyEntries;
+
+	float CellSize = 400.f;
+	uint32 QueryStamp = 0;
+
+	void Link(int32 EntryId);
+	void Unlink(int32 EntryId);
+	void Remove(int32 EntryId);
+	void Refresh(int32 EntryId);
+	void FlushDirty();
+	void OnTransformUpdated(USceneComponent* Component, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	FIntVector ToCell(const FVector& Location) const;
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/* Track a component, or refresh its bounds when its geometry changed. */
+	void Register(UPrimitiveComponent* Component);
+	void Unregister(UPrimitiveComponent* Component);
+
+	/* Components whose bounds overlap Region and are cut by Plane. */
+	void QueryPlane(const FBox& Region, const FPlane& Plane, TArray<UPrimitiveComponent*>& OutComponents);
+
+	int32 GetNumEntries() const { return Entries.Num(); }
+	int32 GetNumCells() const { return Cells.Num(); }
+};
@@ -0,0 +1,921 @@
+#include "S_SliceKernel.h"
+#include "S_ConvexHull.h"
+#include "S_CapBuilder.h"
+#include "Project_FZ5.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+#pragma region SECTION...
+void FS_SliceSection::Reset()
+{
+	PositionX.Reset();
+	PositionY.Reset();
+	PositionZ.Reset();
+	Normals.Reset();
+	Tangents.Reset();
+	FlipTangentY.Reset();
+	UVs.Reset();
+	Colors.Reset();
+	Indices.Reset();
+	Bounds = FBox(ForceInit);
+}
+
+void FS_SliceSection::Reserve(int32 NumVertices, int32 NumIndices)
+{
+	PositionX.Reserve(NumVertices);
+	PositionY.Reserve(NumVertices);
+	PositionZ.Reserve(NumVertices);
+	Normals.Reserve(NumVertices);
+	Tangents.Reserve(NumVertices);
+	FlipTangentY.Reserve(NumVertices);
+	UVs.Reserve(NumVertices);
+	Colors.Reserve(NumVertices);
+	Indices.Reserve(NumIndices);
+}
+
+void FS_SliceSection::FromProcMeshSection(const FProcMeshSection& Section)
+{
+	Reset();
+	Reserve(Section.ProcVertexBuffer.Num(), Section.ProcIndexBuffer.Num());
+
+	for (const FProcMeshVertex& Vertex : Section.ProcVertexBuffer)
+	{
+		PositionX.Add((float)Vertex.Position.X);
+		PositionY.Add((float)Vertex.Position.Y);
+		PositionZ.Add((float)Vertex.Position.Z);
+		Normals.Add((FVector3f)Vertex.Normal);
+		Tangents.Add((FVector3f)Vertex.Tangent.TangentX);
+		FlipTangentY.Add(Vertex.Tangent.bFlipTangentY);
+		UVs.Add((FVector2f)Vertex.UV0);
+		Colors.Add(Vertex.Color);
+	}
+
+	Indices.Append(Section.ProcIndexBuffer);
+	Bounds = Section.SectionLocalBox;
+}
+
+SIZE_T FS_SliceSection::GetAllocatedSize() const
+{
+	return PositionX.GetAllocatedSize() + PositionY.GetAllocatedSize() + PositionZ.GetAllocatedSize() + Normals.GetAllocatedSize() + Tangents.GetAllocatedSize()
+		+ FlipTangentY.GetAllocatedSize() + UVs.GetAllocatedSize() + Colors.GetAllocatedSize() + Indices.GetAllocatedSize();
+}
+
+FProcMeshVertex FS_SliceSection::GetVertex(int32 Index) const
+{
+	FProcMeshVertex Vertex;
+	Vertex.Position = FVector(PositionX[Index], PositionY[Index], PositionZ[Index]);
+	Vertex.Normal = (FVector)Normals[Index];
+	Vertex.Tangent = FProcMeshTangent((FVector)Tangents[Index], FlipTangentY[Index]);
+	Vertex.Color = Colors[Index];
+	Vertex.UV0 = (FVector2D)UVs[Index];
+	return Vertex;
+}
+
+FProcMeshVertex FS_SliceSection::LerpVertex(int32 Index0, int32 Index1, float Alpha) const
+{
+	FProcMeshVertex Vertex;
+	Vertex.Position = FVector(
+		FMath::Lerp(PositionX[Index0], PositionX[Index1], Alpha),
+		FMath::Lerp(PositionY[Index0], PositionY[Index1], Alpha),
+		FMath::Lerp(PositionZ[Index0], PositionZ[Index1], Alpha));
+	Vertex.Normal = (FVector)FMath::Lerp(Normals[Index0], Normals[Index1], Alpha);
+	Vertex.Tangent.TangentX = (FVector)FMath::Lerp(Tangents[Index0], Tangents[Index1], Alpha);
+	Vertex.Color.R = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Colors[Index0].R), float(Colors[Index1].R), Alpha)), 0, 255);
+	Vertex.Color.G = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Colors[Index0].G), float(Colors[Index1].G), Alpha)), 0, 255);
+	Vertex.Color.B = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Colors[Index0].B), float(Colors[Index1].B), Alpha)), 0, 255);
+	Vertex.Color.A = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Colors[Index0].A), float(Colors[Index1].A), Alpha)), 0, 255);
+	Vertex.UV0 = (FVector2D)FMath::Lerp(UVs[Index0], UVs[Index1], Alpha);
+	return Vertex;
+}
+
+void FS_SliceInput::Reset(int32 NumSections)
+{
+	Sections.SetNum(NumSections);
+	for (FS_SliceSection& Section : Sections) Section.Reset();
+	ConvexHulls.Reset();
+	SharedGeometry.Reset();
+}
+
+static SIZE_T GetHullsAllocatedSize(const TArray<TArray<FVector>>& Hulls)
+{
+	SIZE_T Size = Hulls.GetAllocatedSize();
+	for (const TArray<FVector>& Hull : Hulls) Size += Hull.GetAllocatedSize();
+	return Size;
+}
+
+static SIZE_T GetSectionAllocatedSize(const FProcMeshSection& Section)
+{
+	return Section.ProcVertexBuffer.GetAllocatedSize() + Section.ProcIndexBuffer.GetAllocatedSize();
+}
+
+SIZE_T FS_SliceInput::GetAllocatedSize() const
+{
+	// The shared geometry belongs to the cache, only the copies are counted.
+	SIZE_T Size = Sections.GetAllocatedSize() + GetHullsAllocatedSize(ConvexHulls);
+	for (const FS_SliceSection& Section : Sections) Size += Section.GetAllocatedSize();
+	return Size;
+}
+
+void FS_SliceOutput::Reset(int32 NumSections)
+{
+	auto ResetSection = [](FProcMeshSection& Section)
+	{
+		Section.ProcVertexBuffer.Reset();
+		Section.ProcIndexBuffer.Reset();
+		Section.SectionLocalBox = FBox(ForceInit);
+
+		// Sliced pieces only collide through their hulls, no triangle mesh is cooked for them.
+		Section.bEnableCollision = false;
+	};
+
+	KeptSections.SetNum(NumSections);
+	OtherSections.SetNum(NumSections);
+	for (FProcMeshSection& Section : KeptSections) ResetSection(Section);
+	for (FProcMeshSection& Section : OtherSections) ResetSection(Section);
+	ResetSection(KeptCap);
+	ResetSection(OtherCap);
+
+	KeptConvexHulls.Reset();
+	OtherConvexHulls.Reset();
+	bSliced = false;
+}
+
+SIZE_T FS_SliceOutput::GetAllocatedSize() const
+{
+	SIZE_T Size = KeptSections.GetAllocatedSize() + OtherSections.GetAllocatedSize() + GetSectionAllocatedSize(KeptCap) + GetSectionAllocatedSize(OtherCap)
+		+ GetHullsAllocatedSize(KeptConvexHulls) + GetHullsAllocatedSize(OtherConvexHulls);
+	for (const FProcMeshSection& Section : KeptSections) Size += GetSectionAllocatedSize(Section);
+	for (const FProcMeshSection& Section : OtherSections) Size += GetSectionAllocatedSize(Section);
+	return Size;
+}
+
+SIZE_T FS_MultiSliceOutput::GetAllocatedSize() const
+{
+	SIZE_T Size = Cells.GetAllocatedSize();
+	for (const FS_SliceCell& Cell : Cells)
+	{
+		Size += Cell.Sections.GetAllocatedSize() + GetSectionAllocatedSize(Cell.Cap) + GetHullsAllocatedSize(Cell.ConvexHulls);
+		for (const FProcMeshSection& Section : Cell.Sections) Size += GetSectionAllocatedSize(Section);
+	}
+	return Size;
+}
+#pragma endregion
+
+#pragma region KERNEL...
+void FS_SliceKernel::Slice(const FS_SliceInput& Input, FS_SliceOutput& Output)
+{
+	const FPlane& Plane = Input.Plane;
+	const TArray<FS_SliceSection>& Sections = Input.GetSections();
+	const TArray<TArray<FVector>>& ConvexHulls = Input.GetConvexHulls();
+	const int32 NumSections = Sections.Num();
+	Output.Reset(NumSections);
+
+	static thread_local TArray<FUtilEdge3D> ClipEdges;
+	ClipEdges.Reset();
+
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		const FS_SliceSection& Section = Sections[SectionIndex];
+		if (Section.IsEmpty()) continue;
+
+		// Sections totally on one side of the plane are moved as a whole.
+		const int32 BoxCompare = BoxPlaneCompare(Section.Bounds, Plane);
+		if (BoxCompare == 1)
+		{
+			CopySection(Section, Output.KeptSections[SectionIndex]);
+			continue;
+		}
+		if (BoxCompare == -1)
+		{
+			CopySection(Section, Output.OtherSections[SectionIndex]);
+			Output.bSliced = true;
+			continue;
+		}
+
+		SliceSection(Section, Plane, Output.KeptSections[SectionIndex], Output.OtherSections[SectionIndex], ClipEdges);
+		Output.bSliced = true;
+	}
+
+	// Build the cap of both halves from the edges cut on the plane.
+	if (ClipEdges.Num() > 0)
+	{
+		LLM_SCOPE_BYTAG(FZ5_CapGeometry);
+		BuildCap(ClipEdges, Plane, Input.CapUVScale, Input.CapSimplifyTolerance, Output.KeptCap);
+
+		FProcMeshSection& OtherCap = Output.OtherCap;
+		OtherCap.ProcVertexBuffer.Reserve(Output.KeptCap.ProcVertexBuffer.Num());
+		for (FProcMeshVertex OtherCapVert : Output.KeptCap.ProcVertexBuffer)
+		{
+			OtherCapVert.Normal *= -1.f;
+			OtherCapVert.Tangent.TangentX *= -1.f;
+			OtherCap.ProcVertexBuffer.Add(OtherCapVert);
+			OtherCap.SectionLocalBox += OtherCapVert.Position;
+		}
+
+		// Flip the winding of the other cap.
+		const TArray<uint32>& CapIndices = Output.KeptCap.ProcIndexBuffer;
+		OtherCap.ProcIndexBuffer.Reserve(CapIndices.Num());
+		for (int32 IndexIdx = 0; IndexIdx + 2 < CapIndices.Num(); IndexIdx += 3)
+		{
+			OtherCap.ProcIndexBuffer.Add(CapIndices[IndexIdx + 0]);
+			OtherCap.ProcIndexBuffer.Add(CapIndices[IndexIdx + 2]);
+			OtherCap.ProcIndexBuffer.Add(CapIndices[IndexIdx + 1]);
+		}
+	}
+
+	// Slice the simple collision of both halves, or wrap each half in a hull when the mesh has none.
+	if (ConvexHulls.Num() == 0)
+	{
+		if (!Output.bSliced) return;
+		BuildSectionsHull(Output.KeptSections, Output.KeptCap, Input.MaxHullVertices, Output.KeptConvexHulls);
+		BuildSectionsHull(Output.OtherSections, Output.OtherCap, Input.MaxHullVertices, Output.OtherConvexHulls);
+		return;
+	}
+
+	for (const TArray<FVector>& Hull : ConvexHulls)
+	{
+		TArray<FVector> KeptHull;
+		SliceConvexHull(Hull, Plane, Input.MaxHullVertices, KeptHull);
+		if (KeptHull.Num() >= 4) Output.KeptConvexHulls.Add(MoveTemp(KeptHull));
+
+		TArray<FVector> OtherHull;
+		SliceConvexHull(Hull, Plane.Flip(), Input.MaxHullVertices, OtherHull);
+		if (OtherHull.Num() >= 4) Output.OtherConvexHulls.Add(MoveTemp(OtherHull));
+	}
+}
+
+int32 FS_SliceKernel::ComputeDistances(const FS_SliceSection& Section, const FPlane& Plane, float* OutDistances)
+{
+	const int32 NumVerts = Section.Num();
+	const float* RESTRICT X = Section.PositionX.GetData();
+	const float* RESTRICT Y = Section.PositionY.GetData();
+	const float* RESTRICT Z = Section.PositionZ.GetData();
+
+	const float PlaneX = (float)Plane.X;
+	const float PlaneY = (float)Plane.Y;
+	const float PlaneZ = (float)Plane.Z;
+	const float PlaneW = (float)Plane.W;
+
+	int32 NumInFront = 0;
+	int32 Index = 0;
+
+#if defined(__AVX2__)
+	{
+		const __m256 NX = _mm256_set1_ps(PlaneX);
+		const __m256 NY = _mm256_set1_ps(PlaneY);
+		const __m256 NZ = _mm256_set1_ps(PlaneZ);
+		const __m256 NW = _mm256_set1_ps(PlaneW);
+		const __m256 Zero = _mm256_setzero_ps();
+
+		for (; Index + 8 <= NumVerts; Index += 8)
+		{
+			__m256 Distance = _mm256_mul_ps(_mm256_loadu_ps(X + Index), NX);
+			Distance = _mm256_add_ps(Distance, _mm256_mul_ps(_mm256_loadu_ps(Y + Index), NY));
+			Distance = _mm256_add_ps(Distance, _mm256_mul_ps(_mm256_loadu_ps(Z + Index), NZ));
+			Distance = _mm256_sub_ps(Distance, NW);
+			_mm256_storeu_ps(OutDistances + Index, Distance);
+			NumInFront += FMath::CountBits((uint64)_mm256_movemask_ps(_mm256_cmp_ps(Distance, Zero, _CMP_GT_OQ)));
+		}
+	}
+#endif
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS
+	{
+		const VectorRegister4Float NX = VectorSetFloat1(PlaneX);
+		const VectorRegister4Float NY = VectorSetFloat1(PlaneY);
+		const VectorRegister4Float NZ = VectorSetFloat1(PlaneZ);
+		const VectorRegister4Float NW = VectorSetFloat1(PlaneW);
+
+		for (; Index + 4 <= NumVerts; Index += 4)
+		{
+			VectorRegister4Float Distance = VectorMultiply(VectorLoad(X + Index), NX);
+			Distance = VectorMultiplyAdd(VectorLoad(Y + Index), NY, Distance);
+			Distance = VectorMultiplyAdd(VectorLoad(Z + Index), NZ, Distance);
+			Distance = VectorSubtract(Distance, NW);
+			VectorStore(Distance, OutDistances + Index);
+			NumInFront += FMath::CountBits((uint64)VectorMaskBits(VectorCompareGT(Distance, VectorZeroFloat())));
+		}
+	}
+#endif
+
+	// Scalar tail, and the whole section on platforms without vector intrinsics.
+	for (; Index < NumVerts; Index++)
+	{
+		OutDistances[Index] = X[Index] * PlaneX + Y[Index] * PlaneY + Z[Index] * PlaneZ - PlaneW;
+		NumInFront += OutDistances[Index] > 0.f;
+	}
+
+	return NumInFront;
+}
+
+void FS_SliceKernel::SliceSection(const FS_SliceSection& Section, const FPlane& Plane, FProcMeshSection& OutKept, FProcMeshSection& OutOther, TArray<FUtilEdge3D>& OutClipEdges)
+{
+	// Per thread scratch buffers, reused by every slice running on the thread.
+	static thread_local TArray<float> Distances;
+	static thread_local TArray<int32> BaseToSlicedVert;
+
+	const int32 NumVerts = Section.Num();
+	Distances.SetNumUninitialized(NumVerts, false);
+	BaseToSlicedVert.SetNumUninitialized(NumVerts, false);
+
+	const int32 NumInFront = ComputeDistances(Section, Plane, Distances.GetData());
+
+	// Count the output of both halves first so each buffer is allocated once.
+	const uint32* Indices = Section.Indices.GetData();
+	const int32 NumIndices = Section.Indices.Num() - Section.Indices.Num() % 3;
+
+	int32 NumKeptIndices = 0;
+	int32 NumOtherIndices = 0;
+	int32 NumClipped = 0;
+	for (int32 BaseIndex = 0; BaseIndex < NumIndices; BaseIndex += 3)
+	{
+		const int32 NumKeptCorners = (Distances[Indices[BaseIndex]] > 0.f) + (Distances[Indices[BaseIndex + 1]] > 0.f) + (Distances[Indices[BaseIndex + 2]] > 0.f);
+		NumKeptIndices += NumKeptCorners == 3 ? 3 : NumKeptCorners == 2 ? 6 : NumKeptCorners == 1 ? 3 : 0;
+		NumOtherIndices += NumKeptCorners == 0 ? 3 : NumKeptCorners == 1 ? 6 : NumKeptCorners == 2 ? 3 : 0;
+		NumClipped += NumKeptCorners == 1 || NumKeptCorners == 2;
+	}
+
+	OutKept.ProcVertexBuffer.Reserve(NumInFront + NumClipped * 2);
+	OutKept.ProcIndexBuffer.Reserve(NumKeptIndices);
+	OutOther.ProcVertexBuffer.Reserve(NumVerts - NumInFront + NumClipped * 2);
+	OutOther.ProcIndexBuffer.Reserve(NumOtherIndices);
+	OutClipEdges.Reserve(OutClipEdges.Num() + NumClipped);
+
+	// Sort the vertices on each side of the plane.
+	for (int32 BaseVertIndex = 0; BaseVertIndex < NumVerts; BaseVertIndex++)
+	{
+		FProcMeshSection& Target = Distances[BaseVertIndex] > 0.f ? OutKept : OutOther;
+		const FProcMeshVertex& Vertex = Target.ProcVertexBuffer.Add_GetRef(Section.GetVertex(BaseVertIndex));
+		BaseToSlicedVert[BaseVertIndex] = Target.ProcVertexBuffer.Num() - 1;
+		Target.SectionLocalBox += Vertex.Position;
+	}
+
+	// Keep, move or clip each triangle.
+	for (int32 BaseIndex = 0; BaseIndex < NumIndices; BaseIndex += 3)
+	{
+		const int32 BaseV[3] = { (int32)Indices[BaseIndex], (int32)Indices[BaseIndex + 1], (int32)Indices[BaseIndex + 2] };
+		const bool bKept[3] = { Distances[BaseV[0]] > 0.f, Distances[BaseV[1]] > 0.f, Distances[BaseV[2]] > 0.f };
+
+		if (bKept[0] && bKept[1] && bKept[2])
+		{
+			for (int32 i = 0; i < 3; i++) OutKept.ProcIndexBuffer.Add(BaseToSlicedVert[BaseV[i]]);
+			continue;
+		}
+		if (!bKept[0] && !bKept[1] && !bKept[2])
+		{
+			for (int32 i = 0; i < 3; i++) OutOther.ProcIndexBuffer.Add(BaseToSlicedVert[BaseV[i]]);
+			continue;
+		}
+
+		int32 FinalVerts[4];
+		int32 NumFinalVerts = 0;
+		int32 OtherFinalVerts[4];
+		int32 NumOtherFinalVerts = 0;
+
+		FUtilEdge3D NewClipEdge;
+		int32 ClippedEdges = 0;
+
+		for (int32 ThisVert = 0; ThisVert < 3; ThisVert++)
+		{
+			if (bKept[ThisVert]) FinalVerts[NumFinalVerts++] = BaseToSlicedVert[BaseV[ThisVert]];
+			else OtherFinalVerts[NumOtherFinalVerts++] = BaseToSlicedVert[BaseV[ThisVert]];
+
+			// Add the intersection when the edge crosses the plane.
+			const int32 NextVert = (ThisVert + 1) % 3;
+			if (bKept[ThisVert] == bKept[NextVert]) continue;
+
+			const float ThisDist = Distances[BaseV[ThisVert]];
+			const float NextDist = Distances[BaseV[NextVert]];
+			const float Alpha = FMath::Clamp(-ThisDist / (NextDist - ThisDist), 0.0f, 1.0f);
+			const FProcMeshVertex InterpVert = Section.LerpVertex(BaseV[ThisVert], BaseV[NextVert], Alpha);
+
+			FinalVerts[NumFinalVerts++] = OutKept.ProcVertexBuffer.Add(InterpVert);
+			OutKept.SectionLocalBox += InterpVert.Position;
+			OtherFinalVerts[NumOtherFinalVerts++] = OutOther.ProcVertexBuffer.Add(InterpVert);
+			OutOther.SectionLocalBox += InterpVert.Position;
+
+			if (ClippedEdges == 0) NewClipEdge.V0 = InterpVert.Position;
+			else NewClipEdge.V1 = InterpVert.Position;
+			ClippedEdges++;
+		}
+
+		// Fan triangulate the clipped polygons.
+		for (int32 VertexIndex = 2; VertexIndex < NumFinalVerts; VertexIndex++)
+		{
+			OutKept.ProcIndexBuffer.Add(FinalVerts[0]);
+			OutKept.ProcIndexBuffer.Add(FinalVerts[VertexIndex - 1]);
+			OutKept.ProcIndexBuffer.Add(FinalVerts[VertexIndex]);
+		}
+		for (int32 VertexIndex = 2; VertexIndex < NumOtherFinalVerts; VertexIndex++)
+		{
+			OutOther.ProcIndexBuffer.Add(OtherFinalVerts[0]);
+			OutOther.ProcIndexBuffer.Add(OtherFinalVerts[VertexIndex - 1]);
+			OutOther.ProcIndexBuffer.Add(OtherFinalVerts[VertexIndex]);
+		}
+
+		if (ClippedEdges == 2) OutClipEdges.Add(NewClipEdge);
+	}
+
+	// Drop the vertices of a side that ended up without triangles.
+	if (OutKept.ProcIndexBuffer.Num() == 0) OutKept.ProcVertexBuffer.Reset();
+	if (OutOther.ProcIndexBuffer.Num() == 0) OutOther.ProcVertexBuffer.Reset();
+}
+
+void FS_SliceKernel::CopySection(const FS_SliceSection& Section, FProcMeshSection& OutSection)
+{
+	OutSection.ProcVertexBuffer.Reserve(Section.Num());
+	for (int32 VertexIndex = 0; VertexIndex < Section.Num(); VertexIndex++)
+	{
+		OutSection.ProcVertexBuffer.Add(Section.GetVertex(VertexIndex));
+	}
+
+	OutSection.ProcIndexBuffer.Append(Section.Indices);
+	OutSection.SectionLocalBox = Section.Bounds;
+}
+
+int32 FS_SliceKernel::BoxPlaneCompare(const FBox& Box, const FPlane& Plane)
+{
+	FVector BoxCenter, BoxExtents;
+	Box.GetCenterAndExtents(BoxCenter, BoxExtents);
+
+	const FVector::FReal BoxCenterDist = Plane.PlaneDot(BoxCenter);
+	const FVector::FReal BoxSize = FVector::BoxPushOut(Plane, BoxExtents);
+
+	if (BoxCenterDist > BoxSize) return 1;
+	if (BoxCenterDist < -BoxSize) return -1;
+	return 0;
+}
+
+void FS_SliceKernel::SliceConvexHull(const TArray<FVector>& Hull, const FPlane& Plane, int32 MaxVertices, TArray<FVector>& OutHull)
+{
+	LLM_SCOPE_BYTAG(FZ5_Collision);
+
+	// The clipped hull is spanned by the kept points and the plane crossings of every straddling pair.
+	static thread_local TArray<FVector> Cloud;
+	Cloud.Reset();
+
+	TArray<FVector::FReal, TInlineAllocator<32>> Distances;
+	Distances.SetNumUninitialized(Hull.Num());
+	for (int32 i = 0; i < Hull.Num(); i++)
+	{
+		Distances[i] = Plane.PlaneDot(Hull[i]);
+		if (Distances[i] >= 0.f) Cloud.Add(Hull[i]);
+	}
+
+	if (Cloud.Num() == Hull.Num())
+	{
+		OutHull = Hull;
+		return;
+	}
+
+	for (int32 i = 0; i < Hull.Num(); i++)
+	{
+		if (Distances[i] < 0.f) continue;
+		for (int32 j = 0; j < Hull.Num(); j++)
+		{
+			if (Distances[j] >= 0.f) continue;
+			const FVector::FReal Alpha = Distances[i] / (Distances[i] - Distances[j]);
+			Cloud.Add(FMath::Lerp(Hull[i], Hull[j], Alpha));
+		}
+	}
+
+	// Most of the crossings are inside, only the hull vertices are handed to the physics cooker.
+	FS_ConvexHull::Build(Cloud, OutHull, MaxVertices);
+}
+
+void FS_SliceKernel::BuildSectionsHull(const TArray<FProcMeshSection>& Sections, const FProcMeshSection& Cap, int32 MaxVertices, TArray<TArray<FVector>>& OutHulls)
+{
+	LLM_SCOPE_BYTAG(FZ5_Collision);
+
+	static thread_local TArray<FVector> Cloud;
+	Cloud.Reset();
+
+	for (const FProcMeshSection& Section : Sections)
+	{
+		for (const FProcMeshVertex& Vertex : Section.ProcVertexBuffer)
+		{
+			Cloud.Add(Vertex.Position);
+		}
+	}
+	for (const FProcMeshVertex& Vertex : Cap.ProcVertexBuffer)
+	{
+		Cloud.Add(Vertex.Position);
+	}
+
+	TArray<FVector> Hull;
+	if (FS_ConvexHull::Build(Cloud, Hull, MaxVertices)) OutHulls.Add(MoveTemp(Hull));
+}
+#pragma endregion
+
+#pragma region MULTI...
+/* Corner of a polygon being clipped by several planes. */
+struct FS_ClipVertex
+{
+	FProcMeshVertex Vertex;
+
+	// Index in the source section, none for the crossings added by the clipping.
+	int32 SourceIndex = INDEX_NONE;
+
+	// Bit P is set when the corner lies on plane P, an edge between two such corners is a cut edge of plane P.
+	uint32 OnPlanes = 0;
+};
+
+/* Convex piece of a triangle with the planes it still has to be clipped against. */
+struct FS_ClipPiece
+{
+	TArray<FS_ClipVertex, TInlineAllocator<3 + FS_SliceKernel::MaxPlanes>> Polygon;
+	uint32 Code = 0;
+	uint32 RemainingPlanes = 0;
+};
+
+/* Scratch state of a multi-plane slice, reused by every slice running on the thread. */
+struct FS_MultiSliceScratch
+{
+	int32 NumSections = 0;
+	TMap<uint32, int32> CellIndices;
+
+	// Cut edges on each plane, from the pieces in front of it only so every edge is there once.
+	TArray<TArray<FUtilEdge3D>> PlaneEdges;
+	FProcMeshSection PlaneCap;
+
+	// Distances of the vertices of a section to each plane, plane after plane.
+	TArray<float> Distances;
+	TArray<uint32> VertexCodes;
+	TArray<int32> VertexRemap;
+	TArray<FS_ClipPiece> Pieces;
+};
+
+static FProcMeshVertex LerpClipVertex(const FProcMeshVertex& Vertex0, const FProcMeshVertex& Vertex1, float Alpha)
+{
+	FProcMeshVertex Vertex;
+	Vertex.Position = FMath::Lerp(Vertex0.Position, Vertex1.Position, (FVector::FReal)Alpha);
+	Vertex.Normal = FMath::Lerp(Vertex0.Normal, Vertex1.Normal, (FVector::FReal)Alpha);
+	Vertex.Tangent.TangentX = FMath::Lerp(Vertex0.Tangent.TangentX, Vertex1.Tangent.TangentX, (FVector::FReal)Alpha);
+	Vertex.Tangent.bFlipTangentY = Vertex0.Tangent.bFlipTangentY;
+	Vertex.Color.R = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Vertex0.Color.R), float(Vertex1.Color.R), Alpha)), 0, 255);
+	Vertex.Color.G = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Vertex0.Color.G), float(Vertex1.Color.G), Alpha)), 0, 255);
+	Vertex.Color.B = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Vertex0.Color.B), float(Vertex1.Color.B), Alpha)), 0, 255);
+	Vertex.Color.A = FMath::Clamp(FMath::TruncToInt(FMath::Lerp(float(Vertex0.Color.A), float(Vertex1.Color.A), Alpha)), 0, 255);
+	Vertex.UV0 = FMath::Lerp(Vertex0.UV0, Vertex1.UV0, (FVector2D::FReal)Alpha);
+	return Vertex;
+}
+
+// Split the pieces by each of their remaining planes in turn, and hand every final piece to Emit with the code of its sides.
+template <typename DistanceFunc, typename EmitFunc>
+static void ClipPieces(TArray<FS_ClipPiece>& Pieces, DistanceFunc&& GetDistance, EmitFunc&& Emit)
+{
+	while (Pieces.Num() > 0)
+	{
+		FS_ClipPiece Piece = Pieces.Pop(false);
+		if (Piece.Polygon.Num() < 3) continue;
+
+		if (Piece.RemainingPlanes == 0)
+		{
+			Emit(Piece);
+			continue;
+		}
+
+		const int32 PlaneIndex = FMath::CountTrailingZeros(Piece.RemainingPlanes);
+		const uint32 PlaneBit = 1u << PlaneIndex;
+		Piece.RemainingPlanes &= ~PlaneBit;
+
+		float Distances[3 + FS_SliceKernel::MaxPlanes];
+		int32 NumInFront = 0;
+		for (int32 i = 0; i < Piece.Polygon.Num(); i++)
+		{
+			Distances[i] = GetDistance(Piece.Polygon[i], PlaneIndex);
+			NumInFront += Distances[i] > 0.f;
+		}
+
+		// Earlier planes may have left this piece on one side only.
+		if (NumInFront == 0 || NumInFront == Piece.Polygon.Num())
+		{
+			if (NumInFront > 0) Piece.Code |= PlaneBit;
+			Pieces.Add(MoveTemp(Piece));
+			continue;
+		}
+
+		FS_ClipPiece Front;
+		Front.Code = Piece.Code | PlaneBit;
+		Front.RemainingPlanes = Piece.RemainingPlanes;
+		FS_ClipPiece Back;
+		Back.Code = Piece.Code;
+		Back.RemainingPlanes = Piece.RemainingPlanes;
+
+		for (int32 i = 0; i < Piece.Polygon.Num(); i++)
+		{
+			const int32 Next = (i + 1) % Piece.Polygon.Num();
+			const bool bInFront = Distances[i] > 0.f;
+			(bInFront ? Front : Back).Polygon.Add(Piece.Polygon[i]);
+
+			if (bInFront == (Distances[Next] > 0.f)) continue;
+
+			// The crossing lies on this plane, and on any plane both ends of the edge were on.
+			FS_ClipVertex Crossing;
+			const float Alpha = FMath::Clamp(Distances[i] / (Distances[i] - Distances[Next]), 0.f, 1.f);
+			Crossing.Vertex = LerpClipVertex(Piece.Polygon[i].Vertex, Piece.Polygon[Next].Vertex, Alpha);
+			Crossing.OnPlanes = (Piece.Polygon[i].OnPlanes & Piece.Polygon[Next].OnPlanes) | PlaneBit;
+			Front.Polygon.Add(Crossing);
+			Back.Polygon.Add(Crossing);
+		}
+
+		Pieces.Add(MoveTemp(Front));
+		Pieces.Add(MoveTemp(Back));
+	}
+}
+
+void FS_SliceKernel::SliceMulti(const FS_SliceInput& Input, TArrayView<const FPlane> Planes, FS_MultiSliceOutput& Output)
+{
+	Output.Reset();
+
+	const TArray<FS_SliceSection>& Sections = Input.GetSections();
+	const int32 NumSections = Sections.Num();
+	const int32 NumPlanes = FMath::Min(Planes.Num(), MaxPlanes);
+	Planes = Planes.Slice(0, NumPlanes);
+	if (NumPlanes == 0) return;
+
+	static thread_local FS_MultiSliceScratch Scratch;
+	Scratch.NumSections = NumSections;
+	Scratch.CellIndices.Reset();
+	Scratch.PlaneEdges.SetNum(NumPlanes);
+	for (TArray<FUtilEdge3D>& Edges : Scratch.PlaneEdges) Edges.Reset();
+
+	for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+	{
+		const FS_SliceSection& Section = Sections[SectionIndex];
+		if (Section.IsEmpty()) continue;
+
+		// Planes missing the section put all of it on the same side, only the others need the vertices.
+		uint32 FrontPlanes = 0;
+		uint32 CrossingPlanes = 0;
+		for (int32 PlaneIndex = 0; PlaneIndex < NumPlanes; PlaneIndex++)
+		{
+			const int32 BoxCompare = BoxPlaneCompare(Section.Bounds, Planes[PlaneIndex]);
+			if (BoxCompare == 1) FrontPlanes |= 1u << PlaneIndex;
+			else if (BoxCompare == 0) CrossingPlanes |= 1u << PlaneIndex;
+		}
+
+		if (CrossingPlanes == 0)
+		{
+			const int32 CellIndex = FindOrAddCell(FrontPlanes, Scratch, Output);
+			CopySection(Section, Output.Cells[CellIndex].Sections[SectionIndex]);
+			continue;
+		}
+
+		SliceSectionMulti(Section, SectionIndex, Planes, FrontPlanes, CrossingPlanes, Scratch, Output);
+	}
+
+	if (Output.Cells.Num() < 2) return;
+
+	// Cap the whole cross-section of each plane once, then cut the cap by the other planes into the final cells.
+	for (int32 PlaneIndex = 0; PlaneIndex < NumPlanes; PlaneIndex++)
+	{
+		if (Scratch.PlaneEdges[PlaneIndex].Num() == 0) continue;
+
+		FProcMeshSection& PlaneCap = Scratch.PlaneCap;
+		PlaneCap.ProcVertexBuffer.Reset();
+		PlaneCap.ProcIndexBuffer.Reset();
+		PlaneCap.SectionLocalBox = FBox(ForceInit);
+		BuildCap(Scratch.PlaneEdges[PlaneIndex], Planes[PlaneIndex], Input.CapUVScale, Input.CapSimplifyTolerance, PlaneCap);
+
+		const uint32 PlaneBit = 1u << PlaneIndex;
+		uint32 FrontPlanes = 0;
+		uint32 CrossingPlanes = 0;
+		for (int32 OtherIndex = 0; OtherIndex < NumPlanes; OtherIndex++)
+		{
+			if (OtherIndex == PlaneIndex) continue;
+			const int32 BoxCompare = BoxPlaneCompare(PlaneCap.SectionLocalBox, Planes[OtherIndex]);
+			if (BoxCompare == 1) FrontPlanes |= 1u << OtherIndex;
+			else if (BoxCompare == 0) CrossingPlanes |= 1u << OtherIndex;
+		}
+
+		auto GetDistance = [&Planes](const FS_ClipVertex& Corner, int32 OtherIndex) { return (float)Planes[OtherIndex].PlaneDot(Corner.Vertex.Position); };
+
+		// The cap faces the cell in front of the plane, the cell behind gets it flipped.
+		// Cells inside the mesh between several planes only have caps, they are added here.
+		auto Emit = [&](const FS_ClipPiece& Piece)
+		{
+			for (const bool bFront : { true, false })
+			{
+				const int32 CellIndex = FindOrAddCell(bFront ? Piece.Code | PlaneBit : Piece.Code, Scratch, Output);
+				FProcMeshSection& Cap = Output.Cells[CellIndex].Cap;
+				const uint32 BaseIndex = Cap.ProcVertexBuffer.Num();
+				for (const FS_ClipVertex& Corner : Piece.Polygon)
+				{
+					FProcMeshVertex& Vertex = Cap.ProcVertexBuffer.Add_GetRef(Corner.Vertex);
+					if (!bFront)
+					{
+						Vertex.Normal = -Vertex.Normal;
+						Vertex.Tangent.TangentX = -Vertex.Tangent.TangentX;
+					}
+					Cap.SectionLocalBox += Vertex.Position;
+				}
+
+				for (int32 i = 2; i < Piece.Polygon.Num(); i++)
+				{
+					Cap.ProcIndexBuffer.Add(BaseIndex);
+					Cap.ProcIndexBuffer.Add(BaseIndex + (bFront ? i - 1 : i));
+					Cap.ProcIndexBuffer.Add(BaseIndex + (bFront ? i : i - 1));
+				}
+			}
+		};
+
+		const TArray<uint32>& CapIndices = PlaneCap.ProcIndexBuffer;
+		for (int32 BaseIndex = 0; BaseIndex + 2 < CapIndices.Num(); BaseIndex += 3)
+		{
+			Scratch.Pieces.Reset();
+			FS_ClipPiece& Triangle = Scratch.Pieces.AddDefaulted_GetRef();
+			Triangle.Code = FrontPlanes;
+			Triangle.RemainingPlanes = CrossingPlanes;
+			for (int32 i = 0; i < 3; i++)
+			{
+				Triangle.Polygon.AddDefaulted_GetRef().Vertex = PlaneCap.ProcVertexBuffer[CapIndices[BaseIndex + i]];
+			}
+
+			ClipPieces(Scratch.Pieces, GetDistance, Emit);
+		}
+	}
+
+	// Clip the simple collision by every plane, or wrap each cell in a hull when the mesh has none.
+	const TArray<TArray<FVector>>& ConvexHulls = Input.GetConvexHulls();
+	for (FS_SliceCell& Cell : Output.Cells)
+	{
+		if (ConvexHulls.Num() == 0)
+		{
+			BuildSectionsHull(Cell.Sections, Cell.Cap, Input.MaxHullVertices, Cell.ConvexHulls);
+			continue;
+		}
+
+		for (const TArray<FVector>& Hull : ConvexHulls)
+		{
+			TArray<FVector> CellHull = Hull;
+			TArray<FVector> ClippedHull;
+			for (int32 PlaneIndex = 0; PlaneIndex < NumPlanes && CellHull.Num() >= 4; PlaneIndex++)
+			{
+				const bool bInFront = (Cell.Code & (1u << PlaneIndex)) != 0;
+				ClippedHull.Reset();
+				SliceConvexHull(CellHull, bInFront ? Planes[PlaneIndex] : Planes[PlaneIndex].Flip(), Input.MaxHullVertices, ClippedHull);
+				Swap(CellHull, ClippedHull);
+			}
+
+			if (CellHull.Num() >= 4) Cell.ConvexHulls.Add(MoveTemp(CellHull));
+		}
+	}
+}
+
+int32 FS_SliceKernel::FindOrAddCell(uint32 Code, FS_MultiSliceScratch& Scratch, FS_MultiSliceOutput& Output)
+{
+	if (const int32* CellIndex = Scratch.CellIndices.Find(Code)) return *CellIndex;
+
+	const int32 CellIndex = Output.Cells.AddDefaulted();
+	FS_SliceCell& Cell = Output.Cells[CellIndex];
+	Cell.Code = Code;
+	Cell.Sections.SetNum(Scratch.NumSections);
+
+	// Like the halves of a single slice, the cells only collide through their hulls.
+	for (FProcMeshSection& Section : Cell.Sections) Section.bEnableCollision = false;
+	Cell.Cap.bEnableCollision = false;
+	Scratch.CellIndices.Add(Code, CellIndex);
+	return CellIndex;
+}
+
+void FS_SliceKernel::SliceSectionMulti(const FS_SliceSection& Section, int32 SectionIndex, TArrayView<const FPlane> Planes, uint32 FrontPlanes, uint32 CrossingPlanes, FS_MultiSliceScratch& Scratch, FS_MultiSliceOutput& Output)
+{
+	const int32 NumVerts = Section.Num();
+	const int32 NumPlanes = Planes.Num();
+
+	// Classify every vertex against the crossing planes once, a vertex code has a bit per plane it is in front of.
+	Scratch.Distances.SetNumUninitialized(NumPlanes * NumVerts, false);
+	Scratch.VertexCodes.SetNumUninitialized(NumVerts, false);
+	Scratch.VertexRemap.SetNumUninitialized(NumVerts, false);
+	for (int32 VertexIndex = 0; VertexIndex < NumVerts; VertexIndex++)
+	{
+		Scratch.VertexCodes[VertexIndex] = FrontPlanes;
+		Scratch.VertexRemap[VertexIndex] = INDEX_NONE;
+	}
+
+	for (int32 PlaneIndex = 0; PlaneIndex < NumPlanes; PlaneIndex++)
+	{
+		if (!(CrossingPlanes & (1u << PlaneIndex))) continue;
+
+		float* Distances = Scratch.Distances.GetData() + PlaneIndex * NumVerts;
+		ComputeDistances(Section, Planes[PlaneIndex], Distances);
+		for (int32 VertexIndex = 0; VertexIndex < NumVerts; VertexIndex++)
+		{
+			Scratch.VertexCodes[VertexIndex] |= (uint32)(Distances[VertexIndex] > 0.f) << PlaneIndex;
+		}
+	}
+
+	// A source vertex has a single code, so it is copied at most once, into the cell of that code.
+	uint32 LastCode = ~0u;
+	int32 LastCell = INDEX_NONE;
+	auto GetCell = [&](uint32 Code)
+	{
+		if (Code != LastCode)
+		{
+			LastCode = Code;
+			LastCell = FindOrAddCell(Code, Scratch, Output);
+		}
+		return LastCell;
+	};
+
+	auto GetSourceVertex = [&](FProcMeshSection& Target, int32 VertexIndex)
+	{
+		if (Scratch.VertexRemap[VertexIndex] == INDEX_NONE)
+		{
+			const FProcMeshVertex& Vertex = Target.ProcVertexBuffer.Add_GetRef(Section.GetVertex(VertexIndex));
+			Target.SectionLocalBox += Vertex.Position;
+			Scratch.VertexRemap[VertexIndex] = Target.ProcVertexBuffer.Num() - 1;
+		}
+		return (uint32)Scratch.VertexRemap[VertexIndex];
+	};
+
+	auto GetDistance = [&](const FS_ClipVertex& Corner, int32 PlaneIndex)
+	{
+		return Corner.SourceIndex != INDEX_NONE ? Scratch.Distances[PlaneIndex * NumVerts + Corner.SourceIndex] : (float)Planes[PlaneIndex].PlaneDot(Corner.Vertex.Position);
+	};
+
+	auto Emit = [&](const FS_ClipPiece& Piece)
+	{
+		FProcMeshSection& Target = Output.Cells[GetCell(Piece.Code)].Sections[SectionIndex];
+
+		uint32 PolygonIndices[3 + MaxPlanes];
+		for (int32 i = 0; i < Piece.Polygon.Num(); i++)
+		{
+			const FS_ClipVertex& Corner = Piece.Polygon[i];
+			if (Corner.SourceIndex != INDEX_NONE)
+			{
+				PolygonIndices[i] = GetSourceVertex(Target, Corner.SourceIndex);
+			}
+			else
+			{
+				PolygonIndices[i] = Target.ProcVertexBuffer.Add(Corner.Vertex);
+				Target.SectionLocalBox += Corner.Vertex.Position;
+			}
+
+			// Both ends on a plane the piece is in front of make a cut edge for the cap of that plane.
+			const FS_ClipVertex& Next = Piece.Polygon[(i + 1) % Piece.Polygon.Num()];
+			for (uint32 SharedPlanes = Corner.OnPlanes & Next.OnPlanes & Piece.Code; SharedPlanes; SharedPlanes &= SharedPlanes - 1)
+			{
+				FUtilEdge3D& Edge = Scratch.PlaneEdges[FMath::CountTrailingZeros(SharedPlanes)].AddDefaulted_GetRef();
+				Edge.V0 = Corner.Vertex.Position;
+				Edge.V1 = Next.Vertex.Position;
+			}
+		}
+
+		// The clipped pieces of a triangle are convex, a fan is enough.
+		for (int32 i = 2; i < Piece.Polygon.Num(); i++)
+		{
+			Target.ProcIndexBuffer.Add(PolygonIndices[0]);
+			Target.ProcIndexBuffer.Add(PolygonIndices[i - 1]);
+			Target.ProcIndexBuffer.Add(PolygonIndices[i]);
+		}
+	};
+
+	const uint32* Indices = Section.Indices.GetData();
+	const int32 NumIndices = Section.Indices.Num() - Section.Indices.Num() % 3;
+
+	for (int32 BaseIndex = 0; BaseIndex < NumIndices; BaseIndex += 3)
+	{
+		const int32 BaseV[3] = { (int32)Indices[BaseIndex], (int32)Indices[BaseIndex + 1], (int32)Indices[BaseIndex + 2] };
+		const uint32 AllCodes = Scratch.VertexCodes[BaseV[0]] & Scratch.VertexCodes[BaseV[1]] & Scratch.VertexCodes[BaseV[2]];
+		const uint32 AnyCodes = Scratch.VertexCodes[BaseV[0]] | Scratch.VertexCodes[BaseV[1]] | Scratch.VertexCodes[BaseV[2]];
+
+		// Most triangles are not cut at all and go to their cell as they are.
+		if (AllCodes == AnyCodes)
+		{
+			FProcMeshSection& Target = Output.Cells[GetCell(AllCodes)].Sections[SectionIndex];
+			for (int32 i = 0; i < 3; i++) Target.ProcIndexBuffer.Add(GetSourceVertex(Target, BaseV[i]));
+			continue;
+		}
+
+		// Clip the triangle by each plane its corners disagree on.
+		Scratch.Pieces.Reset();
+		FS_ClipPiece& Triangle = Scratch.Pieces.AddDefaulted_GetRef();
+		Triangle.Code = AllCodes;
+		Triangle.RemainingPlanes = AllCodes ^ AnyCodes;
+		for (int32 i = 0; i < 3; i++)
+		{
+			FS_ClipVertex& Corner = Triangle.Polygon.AddDefaulted_GetRef();
+			Corner.Vertex = Section.GetVertex(BaseV[i]);
+			Corner.SourceIndex = BaseV[i];
+		}
+
+		ClipPieces(Scratch.Pieces, GetDistance, Emit);
+	}
+}
+#pragma endregion
+
+#pragma region CAP...
+void FS_SliceKernel::BuildCap(const TArray<FUtilEdge3D>& ClipEdges, const FPlane& Plane, float UVScale, float SimplifyTolerance, FProcMeshSection& OutCap)
+{
+	LLM_SCOPE_BYTAG(FZ5_CapGeometry);
+
+	// Edges the project builder cannot close into loops are left to the engine path, as SliceProceduralMesh would cap them.
+	if (!FS_CapBuilder::Build(ClipEdges, Plane, UVScale, OutCap, SimplifyTolerance))
+		FS_CapBuilder::BuildWithGeomTools(ClipEdges, Plane, UVScale, OutCap);
+}
+#pragma endregion
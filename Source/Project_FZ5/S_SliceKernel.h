@@ -0,0 +1,136 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GeomTools.h"
+#include "ProceduralMeshComponent.h"
+
+/* Vertex streams of a mesh section, positions are split per axis for the vectorized plane tests. */
+struct FS_SliceSection
+{
+	TArray<float> PositionX;
+	TArray<float> PositionY;
+	TArray<float> PositionZ;
+	TArray<FVector3f> Normals;
+	TArray<FVector3f> Tangents;
+	TArray<bool> FlipTangentY;
+	TArray<FVector2f> UVs;
+	TArray<FColor> Colors;
+	TArray<uint32> Indices;
+	FBox Bounds = FBox(ForceInit);
+
+	int32 Num() const { return PositionX.Num(); }
+	bool IsEmpty() const { return Indices.Num() == 0 || PositionX.Num() == 0; }
+
+	/* Empty the streams but keep their allocations. */
+	void Reset();
+	void Reserve(int32 NumVertices, int32 NumIndices);
+
+	void FromProcMeshSection(const FProcMeshSection& Section);
+	SIZE_T GetAllocatedSize() const;
+	FProcMeshVertex GetVertex(int32 Index) const;
+	FProcMeshVertex LerpVertex(int32 Index0, int32 Index1, float Alpha) const;
+};
+
+/* Slicing geometry of a static mesh LOD, built once and never modified so any number of slices can read it. */
+struct FS_SliceGeometry
+{
+	TArray<FS_SliceSection> Sections;
+	TArray<TArray<FVector>> ConvexHulls;
+
+	// Material slot of the static mesh used by each section.
+	TArray<int32> MaterialIndices;
+};
+
+/* Geometry of a procedural mesh copied on the game thread, safe to read from any thread. */
+struct FS_SliceInput
+{
+	TArray<FS_SliceSection> Sections;
+	TArray<TArray<FVector>> ConvexHulls;
+
+	// Cached geometry sliced instead of the copied one when set, for meshes that were never cut.
+	TSharedPtr<const FS_SliceGeometry> SharedGeometry;
+
+	const TArray<FS_SliceSection>& GetSections() const { return SharedGeometry ? SharedGeometry->Sections : Sections; }
+	const TArray<TArray<FVector>>& GetConvexHulls() const { return SharedGeometry ? SharedGeometry->ConvexHulls : ConvexHulls; }
+
+	// Slicing plane in the local space of the mesh, the kept half is on the positive side.
+	FPlane Plane;
+
+	// Vertex limit of the sliced hulls, zero for no limit.
+	int32 MaxHullVertices = 0;
+
+	// Size in cm of a tile of the UVs projected on the caps.
+	float CapUVScale = 64.f;
+
+	// Distance in cm under which the outline points of the caps are dropped, zero for full detail caps.
+	float CapSimplifyTolerance = 0.f;
+
+	void Reset(int32 NumSections);
+	SIZE_T GetAllocatedSize() const;
+};
+
+/* Result of a slice, produced on a worker thread and committed on the game thread. */
+struct FS_SliceOutput
+{
+	// Both halves are indexed like the input sections, empty sections have no geometry on that side.
+	TArray<FProcMeshSection> KeptSections;
+	TArray<FProcMeshSection> OtherSections;
+	FProcMeshSection KeptCap;
+	FProcMeshSection OtherCap;
+
+	TArray<TArray<FVector>> KeptConvexHulls;
+	TArray<TArray<FVector>> OtherConvexHulls;
+
+	bool bSliced = false;
+
+	/* Empty the output but keep the allocations for the next slice. */
+	void Reset(int32 NumSections);
+	SIZE_T GetAllocatedSize() const;
+};
+
+/* One piece of a slice by several planes, on the same side of each of them. */
+struct FS_SliceCell
+{
+	// Bit P is set when the cell is in front of plane P.
+	uint32 Code = 0;
+
+	// Indexed like the input sections, the cap holds the cut faces of every plane bounding the cell.
+	TArray<FProcMeshSection> Sections;
+	FProcMeshSection Cap;
+	TArray<TArray<FVector>> ConvexHulls;
+};
+
+/* Result of a slice by several planes, one cell per combination of sides that has geometry. */
+struct FS_MultiSliceOutput
+{
+	TArray<FS_SliceCell> Cells;
+
+	void Reset() { Cells.Reset(); }
+	SIZE_T GetAllocatedSize() const;
+};
+
+struct FS_MultiSliceScratch;
+
+/* Plane slicing of procedural mesh sections, free of any UObject access. */
+struct FS_SliceKernel
+{
+	static constexpr int32 MaxPlanes = 16;
+
+	static void Slice(const FS_SliceInput& Input, FS_SliceOutput& Output);
+
+	/* Cut by all the planes in one pass over the geometry, the planes past MaxPlanes are ignored. Input.Plane is not used. */
+	static void SliceMulti(const FS_SliceInput& Input, TArrayView<const FPlane> Planes, FS_MultiSliceOutput& Output);
+
+	/* Signed distance of every vertex to the plane, returns the number of vertices in front of it. */
+	static int32 ComputeDistances(const FS_SliceSection& Section, const FPlane& Plane, float* OutDistances);
+
+private:
+	static void SliceSection(const FS_SliceSection& Section, const FPlane& Plane, FProcMeshSection& OutKept, FProcMeshSection& OutOther, TArray<FUtilEdge3D>& OutClipEdges);
+	static void SliceSectionMulti(const FS_SliceSection& Section, int32 SectionIndex, TArrayView<const FPlane> Planes, uint32 FrontPlanes, uint32 CrossingPlanes, FS_MultiSliceScratch& Scratch, FS_MultiSliceOutput& Output);
+	static int32 FindOrAddCell(uint32 Code, FS_MultiSliceScratch& Scratch, FS_MultiSliceOutput& Output);
+	static void CopySection(const FS_SliceSection& Section, FProcMeshSection& OutSection);
+	static int32 BoxPlaneCompare(const FBox& Box, const FPlane& Plane);
+	static void SliceConvexHull(const TArray<FVector>& Hull, const FPlane& Plane, int32 MaxVertices, TArray<FVector>& OutHull);
+	static void BuildSectionsHull(const TArray<FProcMeshSection>& Sections, const FProcMeshSection& Cap, int32 MaxVertices, TArray<TArray<FVector>>& OutHulls);
+	static void BuildCap(const TArray<FUtilEdge3D>& ClipEdges, const FPlane& Plane, float UVScale, float SimplifyTolerance, FProcMeshSection& OutCap);
+};
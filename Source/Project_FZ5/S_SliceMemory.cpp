@@ -0,0 +1,190 @@
+#include "S_SliceMemory.h"
+#include "S_SlicedMesh.h"
+#include "S_GeometryCache.h"
+#include "Project_FZ5.h"
+#include "Algo/SortBy.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Slice memory"), STAT_FZ5_SliceMemory, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Slice source geometry"), STAT_FZ5_SourceGeometryMemory, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Slice fragment geometry"), STAT_FZ5_FragmentGeometryMemory, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Slice cap geometry"), STAT_FZ5_CapGeometryMemory, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Slice collision"), STAT_FZ5_CollisionMemory, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Slice physics"), STAT_FZ5_PhysicsMemory, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Refused slices"), STAT_FZ5_RefusedSlices, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<float> CVarMemoryBudgetMB(
+	TEXT("fz5.Memory.BudgetMB"),
+	0.f,
+	TEXT("Hard budget in MB of the sliced geometry, its collision and physics, 0 for no budget."));
+
+static TAutoConsoleVariable<float> CVarMemorySoftRatio(
+	TEXT("fz5.Memory.SoftRatio"),
+	0.8f,
+	TEXT("Share of the budget past which the new caps and hulls are built with less detail."));
+
+static TAutoConsoleVariable<float> CVarMemoryCapSimplifyTolerance(
+	TEXT("fz5.Memory.CapSimplifyTolerance"),
+	2.f,
+	TEXT("Distance in cm under which the outline points of the caps are dropped past the soft share of the budget."));
+
+static TAutoConsoleVariable<int32> CVarMemoryReducedHullVertices(
+	TEXT("fz5.Memory.ReducedHullVertices"),
+	12,
+	TEXT("Vertex limit of the hulls of the pieces cut past the soft share of the budget."));
+
+static TAutoConsoleVariable<float> CVarMemoryUpdateInterval(
+	TEXT("fz5.Memory.UpdateInterval"),
+	1.f,
+	TEXT("Seconds between two sums of the memory of the sliced actors, longer than the fade out of the culled fragments."));
+
+
+void US_SliceMemory::Deinitialize()
+{
+	Sources.Empty();
+	Total = FS_SliceMemory();
+	Pressure = ES_SliceMemoryPressure::None;
+	PendingEvictions = 0;
+
+	Super::Deinitialize();
+}
+
+TStatId US_SliceMemory::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_SliceMemory, STATGROUP_Tickables);
+}
+
+void US_SliceMemory::AddSource(AS_SlicedMesh* Source)
+{
+	if (Source) Sources.AddUnique(Source);
+}
+
+int64 US_SliceMemory::GetBudget() const
+{
+	return (int64)(FMath::Max(0.f, CVarMemoryBudgetMB.GetValueOnGameThread()) * 1024.0 * 1024.0);
+}
+
+bool US_SliceMemory::CanSlice()
+{
+	if (Pressure != ES_SliceMemoryPressure::Over) return true;
+
+	NumRefused++;
+	SET_DWORD_STAT(STAT_FZ5_RefusedSlices, NumRefused);
+	return false;
+}
+
+float US_SliceMemory::GetCapSimplifyTolerance() const
+{
+	return Pressure != ES_SliceMemoryPressure::None ? FMath::Max(0.f, CVarMemoryCapSimplifyTolerance.GetValueOnGameThread()) : 0.f;
+}
+
+int32 US_SliceMemory::GetMaxHullVertices(int32 MaxHullVertices) const
+{
+	const int32 Reduced = CVarMemoryReducedHullVertices.GetValueOnGameThread();
+	if (Pressure == ES_SliceMemoryPressure::None || Reduced <= 0) return MaxHullVertices;
+
+	// Zero is no limit, the reduced one applies then too.
+	return MaxHullVertices > 0 ? FMath::Min(MaxHullVertices, Reduced) : Reduced;
+}
+
+int32 US_SliceMemory::ConsumeEvictions()
+{
+	const int32 Evictions = PendingEvictions;
+	PendingEvictions = 0;
+	return Evictions;
+}
+
+void US_SliceMemory::Tick(float DeltaTime)
+{
+	UpdateTime += DeltaTime;
+	if (UpdateTime < CVarMemoryUpdateInterval.GetValueOnGameThread()) return;
+	UpdateTime = 0.f;
+
+	Update();
+}
+
+void US_SliceMemory::Update()
+{
+	FZ5_SCOPE(SliceMemory);
+
+	Sources.RemoveAllSwap([](const TWeakObjectPtr<AS_SlicedMesh>& Source) { return !Source.IsValid(); });
+
+	Total = FS_SliceMemory();
+	for (const TWeakObjectPtr<AS_SlicedMesh>& Source : Sources)
+	{
+		Total += Source->GetMemoryUsage();
+	}
+
+	// Close to the budget, the geometry no slice in flight holds is dropped, the next cut of its mesh reads it again.
+	if (US_GeometryCache* GeometryCache = GetWorld()->GetSubsystem<US_GeometryCache>())
+	{
+		if (Pressure != ES_SliceMemoryPressure::None) GeometryCache->Trim();
+		Total.SourceGeometry += GeometryCache->GetAllocatedSize();
+	}
+
+	SET_MEMORY_STAT(STAT_FZ5_SourceGeometryMemory, Total.SourceGeometry);
+	SET_MEMORY_STAT(STAT_FZ5_FragmentGeometryMemory, Total.FragmentGeometry);
+	SET_MEMORY_STAT(STAT_FZ5_CapGeometryMemory, Total.CapGeometry);
+	SET_MEMORY_STAT(STAT_FZ5_CollisionMemory, Total.Collision);
+	SET_MEMORY_STAT(STAT_FZ5_PhysicsMemory, Total.Physics);
+
+	const int64 Budget = GetBudget();
+	const int64 Used = Total.GetTotal();
+	PendingEvictions = 0;
+
+	if (Budget <= 0 || Used <= Budget * FMath::Clamp(CVarMemorySoftRatio.GetValueOnGameThread(), 0.f, 1.f))
+	{
+		Pressure = ES_SliceMemoryPressure::None;
+		return;
+	}
+
+	if (Used <= Budget)
+	{
+		Pressure = ES_SliceMemoryPressure::Reduced;
+		return;
+	}
+
+	// The source geometry stays whatever is culled, the excess is paid back by pieces of the average size.
+	Pressure = ES_SliceMemoryPressure::Over;
+	const int64 PieceMemory = Used - Total.SourceGeometry;
+	if (Total.NumPieces > 0 && PieceMemory > 0)
+		PendingEvictions = (int32)FMath::DivideAndRoundUp(Used - Budget, FMath::Max<int64>(1, PieceMemory / Total.NumPieces));
+}
+
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs MemoryStatsCommand(
+	TEXT("fz5.Memory.Stats"),
+	TEXT("Log the memory of the sliced geometry against its budget, and the actors holding the most of it. Optional arg: number of actors."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const US_SliceMemory* SliceMemory = World ? World->GetSubsystem<US_SliceMemory>() : nullptr;
+		if (!SliceMemory) return;
+
+		static const TCHAR* PressureNames[] = { TEXT("none"), TEXT("reduced"), TEXT("over") };
+		const FS_SliceMemory& Total = SliceMemory->GetTotal();
+		constexpr double MB = 1024.0 * 1024.0;
+
+		UE_LOG(LogFZ5, Display, TEXT("%.2f / %.2f MB, pressure %s, %d refused slices"),
+			Total.GetTotal() / MB, SliceMemory->GetBudget() / MB, PressureNames[(int32)SliceMemory->GetPressure()], SliceMemory->GetNumRefused());
+		UE_LOG(LogFZ5, Display, TEXT("Source %.2f MB, fragments %.2f MB, caps %.2f MB, collision %.2f MB, physics %.2f MB, %d pieces of %d actors"),
+			Total.SourceGeometry / MB, Total.FragmentGeometry / MB, Total.CapGeometry / MB, Total.Collision / MB, Total.Physics / MB,
+			Total.NumPieces, SliceMemory->GetNumSources());
+
+		TArray<TPair<int64, const AS_SlicedMesh*>> Actors;
+		for (TActorIterator<AS_SlicedMesh> It(World); It; ++It)
+		{
+			const int64 Used = It->GetMemoryUsage().GetTotal();
+			if (Used > 0) Actors.Emplace(-Used, *It);
+		}
+		Algo::SortBy(Actors, &TPair<int64, const AS_SlicedMesh*>::Key);
+
+		const int32 NumLogged = FMath::Min(Actors.Num(), Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 5);
+		for (int32 Index = 0; Index < NumLogged; Index++)
+		{
+			UE_LOG(LogFZ5, Display, TEXT("  %s: %.2f MB"), *Actors[Index].Value->GetName(), -Actors[Index].Key / MB);
+		}
+	}));
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_SliceMemory.generated.h"
+
+class AS_SlicedMesh;
+
+/* Bytes held by sliced geometry, by the categories of the FZ5 low level memory tags. */
+struct FS_SliceMemory
+{
+	// Geometry read from the static meshes, shared by every actor of a mesh so only counted by the memory subsystem.
+	int64 SourceGeometry = 0;
+
+	// Vertex and index buffers of the pieces and the debris, the cut faces apart.
+	int64 FragmentGeometry = 0;
+	int64 CapGeometry = 0;
+
+	// Hulls and cooked shapes of the body setups, and the bodies simulated from them.
+	int64 Collision = 0;
+	int64 Physics = 0;
+
+	int32 NumPieces = 0;
+
+	int64 GetTotal() const { return SourceGeometry + FragmentGeometry + CapGeometry + Collision + Physics; }
+
+	FS_SliceMemory& operator+=(const FS_SliceMemory& Other)
+	{
+		SourceGeometry += Other.SourceGeometry;
+		FragmentGeometry += Other.FragmentGeometry;
+		CapGeometry += Other.CapGeometry;
+		Collision += Other.Collision;
+		Physics += Other.Physics;
+		NumPieces += Other.NumPieces;
+		return *this;
+	}
+};
+
+/* How far the sliced geometry is into its memory budget. */
+enum class ES_SliceMemoryPressure : uint8
+{
+	None,
+
+	// Past the soft share of the budget, the new caps and hulls are built with less detail.
+	Reduced,
+
+	// Past the budget, no new piece is cut and the lowest priority fragments are culled early.
+	Over,
+};
+
+/*
+ * Sums the memory of the sliced actors a few times per second and holds it under a hard budget, degrading the
+ * slices step by step rather than letting the pieces grow without bound.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_SliceMemory : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/* Actors cut at least once, the only ones holding memory of their own. */
+	TArray<TWeakObjectPtr<AS_SlicedMesh>> Sources;
+
+	FS_SliceMemory Total;
+	ES_SliceMemoryPressure Pressure = ES_SliceMemoryPressure::None;
+	float UpdateTime = 0.f;
+
+	/* Fragments to cull early to get back under the budget, taken by the fragment subsystem. */
+	int32 PendingEvictions = 0;
+	int32 NumRefused = 0;
+
+	void Update();
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Count the memory of Source from its first cut on. */
+	void AddSource(AS_SlicedMesh* Source);
+
+	/* Whether a new piece may be cut, counting the refusal when not. */
+	bool CanSlice();
+
+	/* Simplification of the caps and vertex limit of the hulls for the slices launched now. */
+	float GetCapSimplifyTolerance() const;
+	int32 GetMaxHullVertices(int32 MaxHullVertices) const;
+
+	/* Number of fragments to cull on top of the fragment budget, zero once taken. */
+	int32 ConsumeEvictions();
+
+	const FS_SliceMemory& GetTotal() const { return Total; }
+	ES_SliceMemoryPressure GetPressure() const { return Pressure; }
+	int64 GetBudget() const;
+	int32 GetNumSources() const { return Sources.Num(); }
+	int32 GetNumRefused() const { return NumRefused; }
+};
@@ -0,0 +1,157 @@
+#include "S_SliceProxies.h"
+#include "S_SlicedMesh.h"
+#include "Project_FZ5.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Proxy batches"), STAT_FZ5_ProxyBatches, STATGROUP_FZ5);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Proxy instances"), STAT_FZ5_ProxyInstances, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<int32> CVarProxiesEnabled(
+	TEXT("fz5.Proxies.Enabled"),
+	1,
+	TEXT("Draw the sliceables that were never cut as instances of one component per mesh, read when they are loaded."));
+
+
+void US_SliceProxies::Deinitialize()
+{
+	Batches.Empty();
+	Host = nullptr;
+	NumInstances = 0;
+
+	Super::Deinitialize();
+}
+
+bool US_SliceProxies::IsEnabled() const
+{
+	return CVarProxiesEnabled.GetValueOnGameThread() != 0 && GetWorld()->IsGameWorld();
+}
+
+FS_ProxyBatch* US_SliceProxies::FindOrAddBatch(const UStaticMeshComponent* Mesh)
+{
+	TArray<UMaterialInterface*> Materials;
+	for (int32 MaterialIndex = 0; MaterialIndex < Mesh->GetNumMaterials(); MaterialIndex++)
+	{
+		Materials.Add(Mesh->GetMaterial(MaterialIndex));
+	}
+
+	// A handful of distinct meshes per level, a search is enough.
+	FS_ProxyBatch* Batch = Batches.FindByPredicate([Mesh, &Materials](const FS_ProxyBatch& Other) { return Other.Mesh == Mesh->GetStaticMesh() && Other.Materials == Materials; });
+	if (Batch) return Batch;
+
+	if (!Host)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		Host = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParameters);
+		if (!Host) return nullptr;
+
+		USceneComponent* Root = NewObject<USceneComponent>(Host, TEXT("Root"));
+		Host->SetRootComponent(Root);
+		Root->RegisterComponent();
+	}
+
+	UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(Host);
+	Component->SetStaticMesh(Mesh->GetStaticMesh());
+#if FZ5_WITH_CLIENT_VISUALS
+	for (int32 MaterialIndex = 0; MaterialIndex < Materials.Num(); MaterialIndex++)
+	{
+		Component->SetMaterial(MaterialIndex, Materials[MaterialIndex]);
+	}
+#endif
+
+	// Collides like the static mesh of an untouched sliceable, one body per instance.
+	Component->SetCollisionProfileName(Mesh->GetCollisionProfileName());
+	Component->SetCollisionResponseToAllChannels(ECR_Block);
+	Component->SetGenerateOverlapEvents(false);
+	Component->CanCharacterStepUpOn = ECB_Yes;
+	Component->SetupAttachment(Host->GetRootComponent());
+	Component->RegisterComponent();
+
+	Batch = &Batches.AddDefaulted_GetRef();
+	Batch->Mesh = Mesh->GetStaticMesh();
+	Batch->Materials = MoveTemp(Materials);
+	Batch->Component = Component;
+
+	SET_DWORD_STAT(STAT_FZ5_ProxyBatches, Batches.Num());
+	return Batch;
+}
+
+bool US_SliceProxies::Add(AS_SlicedMesh* Source, const UStaticMeshComponent* Mesh, const FTransform& Transform)
+{
+	if (!Source || !Mesh || !Mesh->GetStaticMesh() || !IsEnabled()) return false;
+
+	FS_ProxyBatch* Batch = FindOrAddBatch(Mesh);
+	if (!Batch) return false;
+
+	const int32 InstanceIndex = Batch->Component->AddInstance(Transform, true);
+	if (Batch->Owners.Num() <= InstanceIndex) Batch->Owners.SetNum(InstanceIndex + 1);
+	Batch->Owners[InstanceIndex] = Source;
+
+	NumInstances++;
+	SET_DWORD_STAT(STAT_FZ5_ProxyInstances, NumInstances);
+	return true;
+}
+
+void US_SliceProxies::Remove(AS_SlicedMesh* Source)
+{
+	for (FS_ProxyBatch& Batch : Batches)
+	{
+		const int32 InstanceIndex = Batch.Owners.IndexOfByKey(Source);
+		if (InstanceIndex == INDEX_NONE) continue;
+
+		// Removing keeps the order of the other instances, the owners shift with them.
+		Batch.Component->RemoveInstance(InstanceIndex);
+		Batch.Owners.RemoveAt(InstanceIndex);
+		NumInstances--;
+		SET_DWORD_STAT(STAT_FZ5_ProxyInstances, NumInstances);
+		return;
+	}
+}
+
+void US_SliceProxies::PromoteAlong(const FBox& Region, const FPlane& Plane)
+{
+	TArray<AS_SlicedMesh*> Promoted;
+	for (const FS_ProxyBatch& Batch : Batches)
+	{
+		if (!Batch.Component->Bounds.GetBox().Intersect(Region)) continue;
+
+		const FBoxSphereBounds MeshBounds = Batch.Mesh->GetBounds();
+		for (const int32 InstanceIndex : Batch.Component->GetInstancesOverlappingBox(Region))
+		{
+			FTransform InstanceTransform;
+			if (!Batch.Owners.IsValidIndex(InstanceIndex) || !Batch.Component->GetInstanceTransform(InstanceIndex, InstanceTransform, true)) continue;
+
+			const FBoxSphereBounds Bounds = MeshBounds.TransformBy(InstanceTransform);
+			if (FMath::Abs(Plane.PlaneDot(Bounds.Origin)) > FVector::DotProduct(Bounds.BoxExtent, Plane.GetNormal().GetAbs())) continue;
+
+			if (AS_SlicedMesh* Owner = Batch.Owners[InstanceIndex].Get())
+				Promoted.Add(Owner);
+		}
+	}
+
+	// Gathered first, each promotion shifts the instances after it.
+	for (AS_SlicedMesh* Owner : Promoted)
+	{
+		Owner->LeaveProxy();
+		NumPromoted++;
+	}
+}
+
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs ProxiesStatsCommand(
+	TEXT("fz5.Proxies.Stats"),
+	TEXT("Log the instanced meshes drawing the sliceables that were never cut."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const US_SliceProxies* SliceProxies = World ? World->GetSubsystem<US_SliceProxies>() : nullptr;
+		if (!SliceProxies) return;
+
+		UE_LOG(LogFZ5, Display, TEXT("%d instances in %d batches, %d promoted"),
+			SliceProxies->GetNumInstances(), SliceProxies->GetNumBatches(), SliceProxies->GetNumPromoted());
+	}));
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_SliceProxies.generated.h"
+
+class AS_SlicedMesh;
+class UStaticMesh;
+class UStaticMeshComponent;
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+
+/* Untouched sliceables sharing a mesh and its materials, drawn and collided as the instances of one component. */
+USTRUCT()
+struct FS_ProxyBatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UStaticMesh* Mesh = nullptr;
+
+	UPROPERTY()
+	TArray<UMaterialInterface*> Materials;
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Component = nullptr;
+
+	/* Sliceable drawn by each instance, by instance index. */
+	TArray<TWeakObjectPtr<AS_SlicedMesh>> Owners;
+};
+
+/*
+ * Draws the sliceables that were never cut through one instanced static mesh per distinct mesh, their own static
+ * mesh is not even registered. A sliceable gets its static mesh back when a slice plane goes through its instance.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_SliceProxies : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	/* Local actor holding the instanced components, spawned with the first batch. */
+	UPROPERTY(Transient)
+	AActor* Host = nullptr;
+
+	UPROPERTY(Transient)
+	TArray<FS_ProxyBatch> Batches;
+
+	int32 NumInstances = 0;
+	int32 NumPromoted = 0;
+
+	FS_ProxyBatch* FindOrAddBatch(const UStaticMeshComponent* Mesh);
+
+public:
+	virtual void Deinitialize() override;
+
+	/* Whether the sliceables spawned in this world are drawn by instances until their first cut. */
+	bool IsEnabled() const;
+
+	/* Draw Source as an instance of the batch of Mesh at Transform, false when it must keep its own mesh. */
+	bool Add(AS_SlicedMesh* Source, const UStaticMeshComponent* Mesh, const FTransform& Transform);
+	void Remove(AS_SlicedMesh* Source);
+
+	/* Give back their own static mesh to the sliceables whose instance overlaps Region and is cut by Plane. */
+	void PromoteAlong(const FBox& Region, const FPlane& Plane);
+
+	int32 GetNumBatches() const { return Batches.Num(); }
+	int32 GetNumInstances() const { return NumInstances; }
+	int32 GetNumPromoted() const { return NumPromoted; }
+};
@@ -0,0 +1,314 @@
+#include "S_SliceReplication.h"
+#include "S_SlicedMesh.h"
+#include "Project_FZ5.h"
+#include "Engine/NetSerialization.h"
+#include "Engine/World.h"
+#include "Misc/Compression.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Slice event bits"), STAT_FZ5_SliceEventBits, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Fragment snapshot bits"), STAT_FZ5_SnapshotBits, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Fragment snapshots"), STAT_FZ5_FragmentSnapshots, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<float> CVarNetSnapshotRate(
+	TEXT("fz5.Net.SnapshotRate"),
+	4.f,
+	TEXT("Fragment snapshots sent per second by each sliceable, 0 to never sync the fragments."));
+
+static TAutoConsoleVariable<int32> CVarNetMaxSnapshots(
+	TEXT("fz5.Net.MaxSnapshots"),
+	8,
+	TEXT("Biggest simulated pieces of a sliceable sent in each of its snapshots."));
+
+static TAutoConsoleVariable<float> CVarNetSnapshotMinVolume(
+	TEXT("fz5.Net.SnapshotMinVolume"),
+	8000.f,
+	TEXT("Bounding volume in cm3 under which a piece is left to the physics of each client."));
+
+// Fixed point of the plane distances, a 16th of a centimeter.
+static constexpr double PlaneDistanceScale = 16.0;
+
+
+static void EncodeNormal(const FVector& Normal, uint16& OutX, uint16& OutY)
+{
+	// Folded onto the octahedron, then onto its top half.
+	const double L1 = FMath::Max(FMath::Abs(Normal.X) + FMath::Abs(Normal.Y) + FMath::Abs(Normal.Z), UE_SMALL_NUMBER);
+	double X = Normal.X / L1;
+	double Y = Normal.Y / L1;
+	if (Normal.Z < 0.0)
+	{
+		const double FoldedX = (1.0 - FMath::Abs(Y)) * (X >= 0.0 ? 1.0 : -1.0);
+		Y = (1.0 - FMath::Abs(X)) * (Y >= 0.0 ? 1.0 : -1.0);
+		X = FoldedX;
+	}
+
+	OutX = (uint16)FMath::Clamp(FMath::RoundToInt((X * 0.5 + 0.5) * MAX_uint16), 0, (int32)MAX_uint16);
+	OutY = (uint16)FMath::Clamp(FMath::RoundToInt((Y * 0.5 + 0.5) * MAX_uint16), 0, (int32)MAX_uint16);
+}
+
+static FVector DecodeNormal(uint16 InX, uint16 InY)
+{
+	double X = InX / (double)MAX_uint16 * 2.0 - 1.0;
+	double Y = InY / (double)MAX_uint16 * 2.0 - 1.0;
+	const double Z = 1.0 - FMath::Abs(X) - FMath::Abs(Y);
+	if (Z < 0.0)
+	{
+		const double UnfoldedX = (1.0 - FMath::Abs(Y)) * (X >= 0.0 ? 1.0 : -1.0);
+		Y = (1.0 - FMath::Abs(X)) * (Y >= 0.0 ? 1.0 : -1.0);
+		X = UnfoldedX;
+	}
+
+	return FVector(X, Y, Z).GetSafeNormal();
+}
+
+FPlane FS_SliceEvent::QuantizePlane(const FPlane& Plane)
+{
+	uint16 X = 0;
+	uint16 Y = 0;
+	EncodeNormal(Plane.GetNormal(), X, Y);
+	return FPlane(DecodeNormal(X, Y), FMath::RoundToInt(Plane.W * PlaneDistanceScale) / PlaneDistanceScale);
+}
+
+bool FS_SliceEvent::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// Indices and piece numbers are small, packed they mostly take a byte each.
+	uint32 PackedIndex = Index;
+	uint32 PackedPieceId = PieceId;
+	uint32 PackedFirstPieceId = FirstPieceId;
+	Ar.SerializeIntPacked(PackedIndex);
+	Ar.SerializeIntPacked(PackedPieceId);
+	Ar.SerializeIntPacked(PackedFirstPieceId);
+
+	uint8 MultiBit = bMulti ? 1 : 0;
+	Ar.SerializeBits(&MultiBit, 1);
+
+	uint32 NumPlanes = Planes.Num();
+	Ar.SerializeInt(NumPlanes, FS_SliceKernel::MaxPlanes + 1);
+
+	if (Ar.IsLoading())
+	{
+		Index = (int32)FMath::Min<uint32>(PackedIndex, MAX_int32);
+		PieceId = (int32)FMath::Min<uint32>(PackedPieceId, MAX_int32);
+		FirstPieceId = (int32)FMath::Min<uint32>(PackedFirstPieceId, MAX_int32);
+		bMulti = MultiBit != 0;
+		Planes.SetNum(FMath::Min<uint32>(NumPlanes, FS_SliceKernel::MaxPlanes));
+	}
+
+	for (FPlane& Plane : Planes)
+	{
+		uint16 X = 0;
+		uint16 Y = 0;
+		int32 Distance = 0;
+		if (Ar.IsSaving())
+		{
+			EncodeNormal(Plane.GetNormal(), X, Y);
+			Distance = FMath::RoundToInt(Plane.W * PlaneDistanceScale);
+		}
+
+		// Zigzag, so small distances of either sign stay small once packed.
+		uint32 PackedDistance = ((uint32)Distance << 1) ^ (uint32)(Distance >> 31);
+		Ar << X << Y;
+		Ar.SerializeIntPacked(PackedDistance);
+
+		if (Ar.IsLoading())
+		{
+			Distance = (int32)(PackedDistance >> 1) ^ -(int32)(PackedDistance & 1);
+			Plane = FPlane(DecodeNormal(X, Y), Distance / PlaneDistanceScale);
+		}
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FS_FragmentSnapshot::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 PackedPieceId = PieceId;
+	Ar.SerializeIntPacked(PackedPieceId);
+	if (Ar.IsLoading()) PieceId = (int32)FMath::Min<uint32>(PackedPieceId, MAX_int32);
+
+	bOutSuccess = SerializePackedVector<10, 27>(Location, Ar);
+	Rotation.SerializeCompressedShort(Ar);
+	bOutSuccess &= SerializePackedVector<1, 20>(LinearVelocity, Ar);
+	return true;
+}
+
+void FS_SliceLog::Write(const TArray<FS_SliceEvent>& Events, TArray<uint8>& OutData)
+{
+	OutData.Reset();
+	if (Events.Num() == 0) return;
+
+	FBitWriter Bits(0, true);
+	for (const FS_SliceEvent& Event : Events)
+	{
+		bool bSuccess = true;
+		const_cast<FS_SliceEvent&>(Event).NetSerialize(Bits, nullptr, bSuccess);
+	}
+
+	// Consecutive events repeat most of their bits, the indices and the normals of nearby cuts.
+	const int32 RawSize = Bits.GetNumBytes();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Oodle, RawSize);
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	uint8 bCompressed = FCompression::CompressMemory(NAME_Oodle, Compressed.GetData(), CompressedSize, Bits.GetData(), RawSize) && CompressedSize < RawSize;
+
+	uint32 NumEvents = Events.Num();
+	uint32 NumBits = Bits.GetNumBits();
+	FMemoryWriter Writer(OutData);
+	Writer << NumEvents << NumBits << bCompressed;
+	if (bCompressed)
+		Writer.Serialize(Compressed.GetData(), CompressedSize);
+	else
+		Writer.Serialize(Bits.GetData(), RawSize);
+}
+
+bool FS_SliceLog::Read(const TArray<uint8>& Data, TArray<FS_SliceEvent>& OutEvents)
+{
+	OutEvents.Reset();
+	if (Data.Num() == 0) return true;
+
+	uint32 NumEvents = 0;
+	uint32 NumBits = 0;
+	uint8 bCompressed = 0;
+	FMemoryReader Reader(Data);
+	Reader << NumEvents << NumBits << bCompressed;
+
+	const int32 RawSize = (int32)((NumBits + 7) / 8);
+	const int32 StoredSize = Data.Num() - (int32)Reader.Tell();
+	if (Reader.IsError() || RawSize > FS_SliceLog::MaxBytes || StoredSize <= 0 || NumEvents > NumBits / FS_SliceEvent::MinBits) return false;
+
+	TArray<uint8> Raw;
+	Raw.SetNumUninitialized(RawSize);
+	if (bCompressed)
+	{
+		if (!FCompression::UncompressMemory(NAME_Oodle, Raw.GetData(), RawSize, Data.GetData() + Reader.Tell(), StoredSize)) return false;
+	}
+	else
+	{
+		if (StoredSize != RawSize) return false;
+		FMemory::Memcpy(Raw.GetData(), Data.GetData() + Reader.Tell(), RawSize);
+	}
+
+	// Grown as the events decode, a count the bits do not back fails before it is allocated.
+	FBitReader Bits(Raw.GetData(), NumBits);
+	OutEvents.Reserve(FMath::Min<uint32>(NumEvents, 64));
+	for (uint32 Index = 0; Index < NumEvents; Index++)
+	{
+		FS_SliceEvent Event;
+		bool bSuccess = true;
+		Event.NetSerialize(Bits, nullptr, bSuccess);
+		if (!bSuccess || Bits.IsError()) return false;
+
+		OutEvents.Add(MoveTemp(Event));
+	}
+
+	return true;
+}
+
+void US_SliceReplication::Deinitialize()
+{
+	Sources.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId US_SliceReplication::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_SliceReplication, STATGROUP_Tickables);
+}
+
+void US_SliceReplication::AddSource(AS_SlicedMesh* Source)
+{
+	Sources.AddUnique(Source);
+}
+
+void US_SliceReplication::AddBits(int64 Bits)
+{
+	SecondBits[Second % UE_ARRAY_COUNT(SecondBits)] += Bits;
+}
+
+void US_SliceReplication::CountEvent(int64 Bits)
+{
+	Stats.Events++;
+	Stats.EventBits += Bits;
+	AddBits(Bits);
+	INC_DWORD_STAT_BY(STAT_FZ5_SliceEventBits, Bits);
+}
+
+void US_SliceReplication::CountSnapshots(int32 Num, int64 Bits)
+{
+	Stats.Snapshots += Num;
+	Stats.SnapshotBits += Bits;
+	AddBits(Bits);
+	INC_DWORD_STAT_BY(STAT_FZ5_SnapshotBits, Bits);
+}
+
+void US_SliceReplication::CountLog(int64 Bytes)
+{
+	Stats.LogBytes += Bytes;
+	AddBits(Bytes * 8);
+}
+
+int64 US_SliceReplication::GetBitsLastMinute() const
+{
+	int64 Bits = 0;
+	for (const int64 Value : SecondBits) Bits += Value;
+	return Bits;
+}
+
+void US_SliceReplication::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Seconds that went by without anything sent are cleared as the window moves over them.
+	const int32 NowSecond = FMath::FloorToInt(GetWorld()->GetTimeSeconds());
+	while (Second < NowSecond)
+	{
+		Second++;
+		SecondBits[Second % UE_ARRAY_COUNT(SecondBits)] = 0;
+	}
+
+	const float SnapshotRate = CVarNetSnapshotRate.GetValueOnGameThread();
+	if (Sources.Num() == 0 || SnapshotRate <= 0.f || GetWorld()->GetNetMode() == NM_Client) return;
+
+	SnapshotTime -= DeltaTime;
+	if (SnapshotTime > 0.f) return;
+	SnapshotTime = 1.f / SnapshotRate;
+
+	FZ5_SCOPE(FragmentSnapshots);
+
+	const int32 MaxSnapshots = CVarNetMaxSnapshots.GetValueOnGameThread();
+	const float MinVolume = CVarNetSnapshotMinVolume.GetValueOnGameThread();
+	for (int32 Index = Sources.Num() - 1; Index >= 0; Index--)
+	{
+		AS_SlicedMesh* Source = Sources[Index].Get();
+		if (!Source)
+		{
+			Sources.RemoveAtSwap(Index);
+			continue;
+		}
+
+		Source->SendFragmentSnapshots(MaxSnapshots, MinVolume);
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs SliceNetStatsCommand(
+	TEXT("fz5.Net.SliceStats"),
+	TEXT("Log the bits sent for slice events, fragment snapshots and slice logs, in total and over the last minute."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const US_SliceReplication* SliceReplication = World ? World->GetSubsystem<US_SliceReplication>() : nullptr;
+		if (!SliceReplication) return;
+
+		const FS_SliceNetStats& Stats = SliceReplication->GetStats();
+		UE_LOG(LogFZ5, Display, TEXT("Slice replication: %d events at %.1f bits, %d snapshots at %.1f bits, %.1f KB of logs, %.1f KB in the last minute"),
+			Stats.Events, Stats.Events > 0 ? (double)Stats.EventBits / Stats.Events : 0.0,
+			Stats.Snapshots, Stats.Snapshots > 0 ? (double)Stats.SnapshotBits / Stats.Snapshots : 0.0,
+			Stats.LogBytes / 1024.0, SliceReplication->GetBitsLastMinute() / 8.0 / 1024.0);
+	}));
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "S_SliceKernel.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_SliceReplication.generated.h"
+
+class AS_SlicedMesh;
+
+/*
+ * A committed slice, replayed by every client on its own copy of the piece. Pieces are numbered per sliceable,
+ * the root mesh being piece 0, and the planes are quantized in the local space of the piece before the slice
+ * runs on the server, so the same geometry comes out everywhere.
+ */
+USTRUCT()
+struct PROJECT_FZ5_API FS_SliceEvent
+{
+	GENERATED_BODY()
+
+	/* Position in the slice log of the sliceable. */
+	int32 Index = 0;
+
+	int32 PieceId = 0;
+
+	/* Number of the first new piece, the next ones follow in the order of the kernel output. */
+	int32 FirstPieceId = 0;
+
+	/* Sliced by SliceMulti, which keeps the biggest piece, rather than by Slice, which keeps the front one. */
+	bool bMulti = false;
+
+	TArray<FPlane, TInlineAllocator<4>> Planes;
+
+	/* Fewest bits of an encoded event: three packed bytes, the multi bit and the plane count. */
+	static constexpr uint32 MinBits = 3 * 8 + 2;
+
+	/* The plane as it reads once sent: octahedral normal on 2x16 bits, distance in 1/16 cm. */
+	static FPlane QuantizePlane(const FPlane& Plane);
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FS_SliceEvent> : public TStructOpsTypeTraitsBase2<FS_SliceEvent>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/* Where a piece the gameplay cares about is on the server, sent at a low rate. */
+USTRUCT()
+struct PROJECT_FZ5_API FS_FragmentSnapshot
+{
+	GENERATED_BODY()
+
+	int32 PieceId = 0;
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	FVector LinearVelocity = FVector::ZeroVector;
+
+	/* Fewest bits of an encoded snapshot: the packed piece byte, the rotation flags and a bit per vector. */
+	static constexpr uint32 MinBits = 8 + 3 + 2;
+
+	/* Location in 1/10 cm, rotation on 3x16 bits and velocity in whole cm/s. */
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FS_FragmentSnapshot> : public TStructOpsTypeTraitsBase2<FS_FragmentSnapshot>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/* Slice events of a sliceable encoded and compressed in one block, for the clients that join after them. */
+struct FS_SliceLog
+{
+	/* Largest log a joining client accepts. */
+	static constexpr int32 MaxBytes = 1 << 20;
+
+	static void Write(const TArray<FS_SliceEvent>& Events, TArray<uint8>& OutData);
+	static bool Read(const TArray<uint8>& Data, TArray<FS_SliceEvent>& OutEvents);
+};
+
+/* Bits sent by slice replication, totalled since the world started. */
+struct FS_SliceNetStats
+{
+	int32 Events = 0;
+	int64 EventBits = 0;
+	int32 Snapshots = 0;
+	int64 SnapshotBits = 0;
+	int64 LogBytes = 0;
+
+	int64 GetTotalBits() const { return EventBits + SnapshotBits + LogBytes * 8; }
+};
+
+/*
+ * Sends the snapshots of the simulated pieces of the sliceables that replicated a slice, and counts what slice
+ * replication costs, per event and over the last minute.
+ */
+UCLASS()
+class PROJECT_FZ5_API US_SliceReplication : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	TArray<TWeakObjectPtr<AS_SlicedMesh>> Sources;
+	float SnapshotTime = 0.f;
+
+	FS_SliceNetStats Stats;
+
+	// Bits sent during each of the last 60 seconds.
+	int64 SecondBits[60] = {};
+	int32 Second = 0;
+
+	void AddBits(int64 Bits);
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Send the snapshots of Source from now on, the server calls it for every sliceable recording a slice. */
+	void AddSource(AS_SlicedMesh* Source);
+
+	void CountEvent(int64 Bits);
+	void CountSnapshots(int32 Num, int64 Bits);
+	void CountLog(int64 Bytes);
+
+	const FS_SliceNetStats& GetStats() const { return Stats; }
+	int64 GetBitsLastMinute() const;
+};
@@ -0,0 +1,307 @@
+#include "S_SliceSubsystem.h"
+#include "S_SlicedMesh.h"
+#include "S_SliceReplication.h"
+#include "S_SliceMemory.h"
+#include "Project_FZ5.h"
+#include "ProceduralMeshComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued slices"), STAT_FZ5_SlicesQueued, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("In flight slices"), STAT_FZ5_SlicesInFlight, STATGROUP_FZ5);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Committed slices"), STAT_FZ5_SlicesCommitted, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Commit slices"), STAT_FZ5_CommitSlices, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Slice kernel"), STAT_FZ5_SliceKernel, STATGROUP_FZ5);
+DECLARE_MEMORY_STAT(TEXT("Idle slice jobs"), STAT_FZ5_SliceJobMemory, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<int32> CVarSliceJobPoolSize(
+	TEXT("fz5.Slice.JobPoolSize"),
+	8,
+	TEXT("Number of finished slice jobs kept with their buffers for reuse."));
+
+static TAutoConsoleVariable<float> CVarSliceCommitBudgetMs(
+	TEXT("fz5.Slice.CommitBudgetMs"),
+	2.0f,
+	TEXT("Game thread time per frame spent applying finished slices, at least one slice is always committed."));
+
+static TAutoConsoleVariable<int32> CVarSliceMaxHullVertices(
+	TEXT("fz5.Slice.MaxHullVertices"),
+	32,
+	TEXT("Vertex limit of the convex hulls built for sliced pieces, 0 for no limit."));
+
+
+void US_SliceSubsystem::Deinitialize()
+{
+	// Worker tasks point into the jobs, let them finish before freeing anything.
+	for (const TUniquePtr<FS_SliceJob>& Job : RunningJobs)
+	{
+		Job->Task.Wait();
+	}
+
+	RunningJobs.Empty();
+	QueuedJobs.Empty();
+	FreeJobs.Empty();
+	BusyTargets.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId US_SliceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(US_SliceSubsystem, STATGROUP_Tickables);
+}
+
+void US_SliceSubsystem::RequestSlice(AS_SlicedMesh* Owner, UProceduralMeshComponent* ProcMesh, FVector PlanePosition, FVector PlaneNormal)
+{
+	if (!Owner || !ProcMesh) return;
+
+	TUniquePtr<FS_SliceJob> Job = AllocateJob();
+	Job->Owner = Owner;
+	Job->Target = ProcMesh;
+	Job->PlanePosition = PlanePosition;
+	Job->PlaneNormal = PlaneNormal;
+
+	// The component may move before the job starts, so the plane is stored in its local space right away.
+	// Quantized as it is sent, the clients replaying the slice cut the same geometry.
+	const FTransform& ProcMeshToWorld = ProcMesh->GetComponentTransform();
+	const FVector LocalPlanePosition = ProcMeshToWorld.InverseTransformPosition(PlanePosition);
+	const FVector LocalPlaneNormal = ProcMeshToWorld.InverseTransformVectorNoScale(PlaneNormal).GetSafeNormal();
+	Job->Input.Plane = FS_SliceEvent::QuantizePlane(FPlane(LocalPlanePosition, LocalPlaneNormal));
+
+	QueuedJobs.Add(MoveTemp(Job));
+}
+
+void US_SliceSubsystem::RequestMultiSlice(AS_SlicedMesh* Owner, UProceduralMeshComponent* ProcMesh, TArrayView<const FPlane> Planes)
+{
+	if (!Owner || !ProcMesh || Planes.Num() == 0) return;
+
+	TUniquePtr<FS_SliceJob> Job = AllocateJob();
+	Job->Owner = Owner;
+	Job->Target = ProcMesh;
+
+	const FTransform& ProcMeshToWorld = ProcMesh->GetComponentTransform();
+	for (const FPlane& Plane : Planes.Slice(0, FMath::Min(Planes.Num(), FS_SliceKernel::MaxPlanes)))
+	{
+		const FVector LocalPlanePosition = ProcMeshToWorld.InverseTransformPosition(Plane.GetOrigin());
+		const FVector LocalPlaneNormal = ProcMeshToWorld.InverseTransformVectorNoScale(Plane.GetNormal()).GetSafeNormal();
+		Job->Planes.Add(FS_SliceEvent::QuantizePlane(FPlane(LocalPlanePosition, LocalPlaneNormal)));
+	}
+
+	QueuedJobs.Add(MoveTemp(Job));
+}
+
+void US_SliceSubsystem::RequestReplayedSlice(AS_SlicedMesh* Owner, UProceduralMeshComponent* ProcMesh, const FS_SliceEvent& Event)
+{
+	if (!Owner || !ProcMesh || Event.Planes.Num() == 0) return;
+
+	TUniquePtr<FS_SliceJob> Job = AllocateJob();
+	Job->Owner = Owner;
+	Job->Target = ProcMesh;
+	Job->FirstPieceId = Event.FirstPieceId;
+
+	if (Event.bMulti)
+	{
+		Job->Planes.Append(Event.Planes.GetData(), FMath::Min(Event.Planes.Num(), FS_SliceKernel::MaxPlanes));
+	}
+	else
+	{
+		// The world plane only pushes the pieces apart.
+		const FTransform& ProcMeshToWorld = ProcMesh->GetComponentTransform();
+		Job->Input.Plane = Event.Planes[0];
+		Job->PlaneNormal = ProcMeshToWorld.TransformVectorNoScale(Event.Planes[0].GetNormal());
+		Job->PlanePosition = ProcMeshToWorld.TransformPosition(Event.Planes[0].GetOrigin());
+	}
+
+	QueuedJobs.Add(MoveTemp(Job));
+}
+
+bool US_SliceSubsystem::IsBusy(const UProceduralMeshComponent* ProcMesh) const
+{
+	return BusyTargets.Contains(TWeakObjectPtr<UProceduralMeshComponent>(const_cast<UProceduralMeshComponent*>(ProcMesh)));
+}
+
+bool US_SliceSubsystem::HasPendingJobs(const AS_SlicedMesh* Owner) const
+{
+	auto IsOwnedBy = [Owner](const TUniquePtr<FS_SliceJob>& Job) { return Job->Owner.Get() == Owner; };
+	return QueuedJobs.ContainsByPredicate(IsOwnedBy) || RunningJobs.ContainsByPredicate(IsOwnedBy);
+}
+
+void US_SliceSubsystem::Tick(float DeltaTime)
+{
+	FrameStats = FS_SliceFrameStats();
+
+	// Commit finished jobs in request order, within the frame budget.
+	{
+		FZ5_SCOPE(CommitSlices);
+
+		const double StartTime = FPlatformTime::Seconds();
+		const double Budget = CVarSliceCommitBudgetMs.GetValueOnGameThread() / 1000.0;
+
+		for (int32 JobIndex = 0; JobIndex < RunningJobs.Num();)
+		{
+			if (!RunningJobs[JobIndex]->Task.IsCompleted())
+			{
+				JobIndex++;
+				continue;
+			}
+
+			if (FrameStats.Committed > 0 && FPlatformTime::Seconds() - StartTime > Budget) break;
+
+			TUniquePtr<FS_SliceJob> Job = MoveTemp(RunningJobs[JobIndex]);
+			RunningJobs.RemoveAt(JobIndex);
+			BusyTargets.Remove(Job->Target);
+
+			CommitJob(*Job);
+
+			// Replicated slices of the pieces this one made can go now.
+			if (AS_SlicedMesh* Owner = Job->Owner.Get()) Owner->DrainReplays();
+			ReleaseJob(MoveTemp(Job));
+			FrameStats.Committed++;
+		}
+
+		FrameStats.CommitTime = FPlatformTime::Seconds() - StartTime;
+	}
+
+	// Start the queued jobs whose component is not already being sliced.
+	for (int32 JobIndex = 0; JobIndex < QueuedJobs.Num();)
+	{
+		if (!QueuedJobs[JobIndex]->Target.IsValid() || !QueuedJobs[JobIndex]->Owner.IsValid())
+		{
+			AS_SlicedMesh* Owner = QueuedJobs[JobIndex]->Owner.Get();
+			ReleaseJob(MoveTemp(QueuedJobs[JobIndex]));
+			QueuedJobs.RemoveAt(JobIndex);
+
+			// The slices waiting on it are dropped rather than left waiting for good.
+			if (Owner) Owner->DrainReplays();
+			continue;
+		}
+
+		if (BusyTargets.Contains(QueuedJobs[JobIndex]->Target))
+		{
+			JobIndex++;
+			continue;
+		}
+
+		TUniquePtr<FS_SliceJob> Job = MoveTemp(QueuedJobs[JobIndex]);
+		QueuedJobs.RemoveAt(JobIndex);
+		LaunchJob(MoveTemp(Job));
+	}
+
+	FrameStats.Queued = QueuedJobs.Num();
+	FrameStats.InFlight = RunningJobs.Num();
+
+	SET_DWORD_STAT(STAT_FZ5_SlicesQueued, FrameStats.Queued);
+	SET_DWORD_STAT(STAT_FZ5_SlicesInFlight, FrameStats.InFlight);
+	SET_DWORD_STAT(STAT_FZ5_SlicesCommitted, FrameStats.Committed);
+
+#if STATS
+	// Running jobs are written by their worker, only the buffers at rest are counted.
+	SIZE_T JobMemory = 0;
+	for (const TUniquePtr<FS_SliceJob>& Job : FreeJobs) JobMemory += Job->GetAllocatedSize();
+	for (const TUniquePtr<FS_SliceJob>& Job : QueuedJobs) JobMemory += Job->GetAllocatedSize();
+	SET_MEMORY_STAT(STAT_FZ5_SliceJobMemory, JobMemory);
+#endif
+}
+
+TUniquePtr<FS_SliceJob> US_SliceSubsystem::AllocateJob()
+{
+	return FreeJobs.Num() > 0 ? FreeJobs.Pop(false) : MakeUnique<FS_SliceJob>();
+}
+
+void US_SliceSubsystem::ReleaseJob(TUniquePtr<FS_SliceJob> Job)
+{
+	if (FreeJobs.Num() >= CVarSliceJobPoolSize.GetValueOnGameThread()) return;
+
+	Job->Owner.Reset();
+	Job->Target.Reset();
+	Job->Input.SharedGeometry.Reset();
+	Job->Planes.Reset();
+	Job->FirstPieceId = INDEX_NONE;
+	Job->Task = UE::Tasks::FTask();
+	FreeJobs.Add(MoveTemp(Job));
+}
+
+void US_SliceSubsystem::LaunchJob(TUniquePtr<FS_SliceJob> Job)
+{
+	UProceduralMeshComponent* ProcMesh = Job->Target.Get();
+
+	// A sliceable that was never cut reads the cached geometry of its static mesh, nothing is copied.
+	// The pooled section buffers are left alone, they are ignored while shared geometry is set.
+	Job->Input.SharedGeometry = Job->Owner->GetSharedGeometry(ProcMesh);
+	if (!Job->Input.SharedGeometry)
+	{
+		// Snapshot the geometry in vertex streams and the simple collision on the game thread.
+		const int32 NumSections = ProcMesh->GetNumSections();
+		Job->Input.Reset(NumSections);
+		for (int32 SectionIndex = 0; SectionIndex < NumSections; SectionIndex++)
+		{
+			if (const FProcMeshSection* Section = ProcMesh->GetProcMeshSection(SectionIndex))
+				Job->Input.Sections[SectionIndex].FromProcMeshSection(*Section);
+		}
+
+		if (const UBodySetup* BodySetup = ProcMesh->GetBodySetup())
+		{
+			for (const FKConvexElem& Convex : BodySetup->AggGeom.ConvexElems)
+			{
+				Job->Input.ConvexHulls.Add(Convex.VertexData);
+			}
+		}
+	}
+
+	Job->Input.MaxHullVertices = FMath::Max(0, CVarSliceMaxHullVertices.GetValueOnGameThread());
+	Job->Input.CapUVScale = Job->Owner->GetInteriorUVScale();
+	Job->Input.CapSimplifyTolerance = 0.f;
+
+	// Close to the memory budget the pieces get simpler caps and hulls.
+	if (const US_SliceMemory* SliceMemory = GetWorld()->GetSubsystem<US_SliceMemory>())
+	{
+		Job->Input.MaxHullVertices = SliceMemory->GetMaxHullVertices(Job->Input.MaxHullVertices);
+		Job->Input.CapSimplifyTolerance = SliceMemory->GetCapSimplifyTolerance();
+	}
+
+	// The clip and hull math only reads the snapshot, so it runs on a worker.
+	FS_SliceJob* RawJob = Job.Get();
+	Job->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [RawJob]
+	{
+		FZ5_SCOPE(SliceKernel);
+		LLM_SCOPE_BYTAG(FZ5_FragmentGeometry);
+
+		if (RawJob->Planes.Num() > 0)
+			FS_SliceKernel::SliceMulti(RawJob->Input, RawJob->Planes, RawJob->MultiOutput);
+		else
+			FS_SliceKernel::Slice(RawJob->Input, RawJob->Output);
+	});
+
+	BusyTargets.Add(Job->Target);
+	RunningJobs.Add(MoveTemp(Job));
+}
+
+void US_SliceSubsystem::CommitJob(FS_SliceJob& Job)
+{
+	AS_SlicedMesh* Owner = Job.Owner.Get();
+	UProceduralMeshComponent* ProcMesh = Job.Target.Get();
+	if (!Owner || !ProcMesh) return;
+
+	// Numbered before the commit adds the new pieces.
+	const int32 PieceId = Owner->GetPieceId(ProcMesh);
+	const int32 FirstPieceId = Job.FirstPieceId != INDEX_NONE ? Job.FirstPieceId : Owner->GetNumPieces();
+	const bool bMulti = Job.Planes.Num() > 0;
+
+	const bool bSliced = bMulti
+		? Owner->CommitMultiSlice(ProcMesh, Job.MultiOutput, FirstPieceId)
+		: Owner->CommitSlice(ProcMesh, Job.Output, Job.PlaneNormal, FirstPieceId);
+
+	// Slices made on the server are replayed by the clients.
+	if (!bSliced || Job.FirstPieceId != INDEX_NONE || PieceId == INDEX_NONE || !Owner->HasAuthority()) return;
+
+	FS_SliceEvent Event;
+	Event.PieceId = PieceId;
+	Event.FirstPieceId = FirstPieceId;
+	Event.bMulti = bMulti;
+	if (bMulti)
+		Event.Planes.Append(Job.Planes);
+	else
+		Event.Planes.Add(Job.Input.Plane);
+
+	Owner->RecordSlice(Event);
+}
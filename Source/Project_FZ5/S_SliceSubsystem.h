@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "S_SliceKernel.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "S_SliceSubsystem.generated.h"
+
+class AS_SlicedMesh;
+class UProceduralMeshComponent;
+struct FS_SliceEvent;
+
+/* A slice waiting for, running on or coming back from a worker task. */
+struct FS_SliceJob
+{
+	TWeakObjectPtr<AS_SlicedMesh> Owner;
+	TWeakObjectPtr<UProceduralMeshComponent> Target;
+
+	FVector PlanePosition;
+	FVector PlaneNormal;
+
+	FS_SliceInput Input;
+	FS_SliceOutput Output;
+
+	// Planes in the local space of the target for a slice by several planes at once, empty for a single plane slice.
+	TArray<FPlane> Planes;
+	FS_MultiSliceOutput MultiOutput;
+
+	// Number of the first new piece for a slice replayed from the server, INDEX_NONE for a slice made here.
+	int32 FirstPieceId = INDEX_NONE;
+
+	UE::Tasks::FTask Task;
+
+	SIZE_T GetAllocatedSize() const { return Input.GetAllocatedSize() + Output.GetAllocatedSize() + Planes.GetAllocatedSize() + MultiOutput.GetAllocatedSize(); }
+};
+
+/* Slicing activity of the last frame. */
+struct FS_SliceFrameStats
+{
+	int32 Queued = 0;
+	int32 InFlight = 0;
+	int32 Committed = 0;
+	double CommitTime = 0.0;
+};
+
+UCLASS()
+class PROJECT_FZ5_API US_SliceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	TArray<TUniquePtr<FS_SliceJob>> QueuedJobs;
+	TArray<TUniquePtr<FS_SliceJob>> RunningJobs;
+
+	/* Committed jobs kept with their buffers, so slicing does not allocate once warmed up. */
+	TArray<TUniquePtr<FS_SliceJob>> FreeJobs;
+
+	/* Components with a running job, they must not be touched until it is committed. */
+	TSet<TWeakObjectPtr<UProceduralMeshComponent>> BusyTargets;
+
+	FS_SliceFrameStats FrameStats;
+
+	TUniquePtr<FS_SliceJob> AllocateJob();
+	void LaunchJob(TUniquePtr<FS_SliceJob> Job);
+	void CommitJob(FS_SliceJob& Job);
+	void ReleaseJob(TUniquePtr<FS_SliceJob> Job);
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Queue a slice of ProcMesh along a world space plane, applied on a later frame. */
+	void RequestSlice(AS_SlicedMesh* Owner, UProceduralMeshComponent* ProcMesh, FVector PlanePosition, FVector PlaneNormal);
+
+	/* Queue a slice of ProcMesh by several world space planes, cut in a single pass into every resulting piece. */
+	void RequestMultiSlice(AS_SlicedMesh* Owner, UProceduralMeshComponent* ProcMesh, TArrayView<const FPlane> Planes);
+
+	/* Queue a slice made on the server, its planes are already in the local space of ProcMesh. */
+	void RequestReplayedSlice(AS_SlicedMesh* Owner, UProceduralMeshComponent* ProcMesh, const FS_SliceEvent& Event);
+
+	bool IsBusy(const UProceduralMeshComponent* ProcMesh) const;
+
+	/* Whether a slice of a piece of Owner is queued or running. */
+	bool HasPendingJobs(const AS_SlicedMesh* Owner) const;
+
+	const FS_SliceFrameStats& GetFrameStats() const { return FrameStats; }
+};
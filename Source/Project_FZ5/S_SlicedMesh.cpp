@@ -1,6 +1,40 @@
 #include "S_SlicedMesh.h"
-#include "KismetProceduralMeshLibrary.h"
+#include "S_Fragment.h"
+#include "S_SliceSubsystem.h"
+#include "S_FragmentSubsystem.h"
+#include "S_GeometryCache.h"
+#include "S_SliceIndex.h"
+#include "S_SliceReplication.h"
+#include "S_SliceArchive.h"
+#include "S_SliceProxies.h"
+#include "S_SliceMemory.h"
+#include "Project_FZ5.h"
 #include "ProceduralMeshComponent.h"
+#include "GeometryCollection/GeometryCollectionComponent.h"
+#include "GeometryCollection/GeometryCollectionObject.h"
+#include "Engine/NetConnection.h"
+#include "Net/DataBunch.h"
+#include "Serialization/BitWriter.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Algo/BinarySearch.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Slice"), STAT_FZ5_Slice, STATGROUP_FZ5);
+DECLARE_CYCLE_STAT(TEXT("Commit slice"), STAT_FZ5_CommitSlice, STATGROUP_FZ5);
+
+static TAutoConsoleVariable<float> CVarDebrisWakeImpulse(
+	TEXT("fz5.Debris.WakeImpulse"),
+	500.0f,
+	TEXT("Impulse in kg cm/s a hit must give to the baked debris to bring its pieces back to simulation."));
+
+static TAutoConsoleVariable<float> CVarDebrisWakeRadius(
+	TEXT("fz5.Debris.WakeRadius"),
+	50.0f,
+	TEXT("Distance from a hit within which baked pieces are brought back to simulation."));
+
+// A replicated piece further than this from its snapshot is moved there, a closer one is pulled toward it.
+static constexpr float SnapshotTeleportDistance = 100.f;
+static constexpr float SnapshotCorrectionRate = 4.f;
 
 
 AS_SlicedMesh::AS_SlicedMesh()
@@ -9,6 +43,7 @@ AS_SlicedMesh::AS_SlicedMesh()
 	ProceduralMesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("ProceduralMesh"));
 	SetupMesh(ProceduralMesh, false, false, false);
 	ProceduralMesh->bUseComplexAsSimpleCollision = false;
+	ProceduralMesh->bUseAsyncCooking = true;
 	RootComponent = ProceduralMesh;
 
 	// Create a static mesh.
@@ -19,33 +54,337 @@ AS_SlicedMesh::AS_SlicedMesh()
 	// Use the default cube static mesh.
 	static ConstructorHelpers::FObjectFinder<UStaticMesh> DefaultCube(TEXT("/Engine/BasicShapes/Cube"));
 	StaticMesh->SetStaticMesh(DefaultCube.Object);
+
+	// Only slice events and fragment snapshots are sent, as RPCs, there is no property to check often.
+	// Dormant until the first slice, and again once every piece is at rest.
+	bReplicates = true;
+	NetUpdateFrequency = 1.f;
+	NetDormancy = DORM_Initial;
+}
+
+void AS_SlicedMesh::PreRegisterAllComponents()
+{
+	Super::PreRegisterAllComponents();
+
+	// An untouched prop is drawn by an instance, its own static mesh is only registered once it is about to be cut.
+	const US_SliceProxies* SliceProxies = GetWorld() ? GetWorld()->GetSubsystem<US_SliceProxies>() : nullptr;
+	StaticMesh->bAutoRegister = !(bInstanced && SliceProxies && SliceProxies->IsEnabled());
 }
 
 void AS_SlicedMesh::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// Copy the static mesh data to the procedural mesh.
+	// Keep the static mesh until the first slice, the procedural geometry is only built for actors that get cut.
 	ProceduralMesh->ClearAllMeshSections();
-	UKismetProceduralMeshLibrary::CopyProceduralMeshFromStaticMeshComponent(StaticMesh, 0, ProceduralMesh, true);
+	SetupMesh(ProceduralMesh, false, false, false);
+
+	Pieces.Reset();
+	Pieces.Add(ProceduralMesh);
+	PieceCapSections.Reset();
+	PieceCapSections.Add(0);
+
+	// The static mesh is not registered, its world transform is taken from the root.
+	US_SliceProxies* SliceProxies = GetWorld()->GetSubsystem<US_SliceProxies>();
+	bProxied = !StaticMesh->IsRegistered() && SliceProxies && SliceProxies->Add(this, StaticMesh, StaticMesh->GetRelativeTransform() * ProceduralMesh->GetComponentTransform());
+	if (!bProxied) RegisterStaticMesh();
+
+	// Streamed back in with its cell, the slices made before it streamed out are replayed.
+	if (HasAuthority())
+		if (US_SliceArchive* SliceArchive = GetWorld()->GetSubsystem<US_SliceArchive>())
+			SliceArchive->Restore(this);
+}
+
+void AS_SlicedMesh::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The whole batch goes with the world, one by one removals are only worth it while the world stays.
+	if (bProxied && (EndPlayReason == EEndPlayReason::RemovedFromWorld || EndPlayReason == EEndPlayReason::Destroyed))
+		if (US_SliceProxies* SliceProxies = GetWorld()->GetSubsystem<US_SliceProxies>())
+			SliceProxies->Remove(this);
+
+	// Streamed out with its cell, the slices are kept for when it streams back in and the pooled pieces go back to the pool.
+	if (EndPlayReason == EEndPlayReason::RemovedFromWorld)
+	{
+		if (HasAuthority())
+			if (US_SliceArchive* SliceArchive = GetWorld()->GetSubsystem<US_SliceArchive>())
+				SliceArchive->Save(this);
+
+		if (US_FragmentSubsystem* FragmentSubsystem = GetWorld()->GetSubsystem<US_FragmentSubsystem>())
+		{
+			for (int32 PieceId = 0; PieceId < Pieces.Num(); PieceId++)
+			{
+				UProceduralMeshComponent* Piece = GetPiece(PieceId);
+				if (Piece && Piece->GetOwner() != this) FragmentSubsystem->RemoveFragment(Piece);
+			}
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AS_SlicedMesh::LeaveProxy()
+{
+	if (!bProxied) return;
+	bProxied = false;
+
+	if (US_SliceProxies* SliceProxies = GetWorld()->GetSubsystem<US_SliceProxies>())
+		SliceProxies->Remove(this);
+
+	RegisterStaticMesh();
+}
+
+void AS_SlicedMesh::RegisterStaticMesh()
+{
+	if (!StaticMesh->IsRegistered()) StaticMesh->RegisterComponent();
+	SetupMesh(StaticMesh, true, true, false);
+
+	if (US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>())
+		SliceIndex->Register(StaticMesh);
+}
+
+TSharedPtr<const FS_SliceGeometry> AS_SlicedMesh::GetSharedGeometry(const UProceduralMeshComponent* ProcMesh) const
+{
+	if (bProcedural || ProcMesh != ProceduralMesh) return nullptr;
+
+	US_GeometryCache* GeometryCache = GetWorld()->GetSubsystem<US_GeometryCache>();
+	return GeometryCache ? GeometryCache->FindOrBuild(StaticMesh->GetStaticMesh(), 0) : nullptr;
+}
+
+void AS_SlicedMesh::ConvertToProcedural(const FS_SliceGeometry& Geometry)
+{
+	// Replayed slices reach pieces that were never promoted, on the clients or from the archive.
+	LeaveProxy();
+
+#if FZ5_WITH_CLIENT_VISUALS
+	// The sections are about to be set from the slice, only the materials of the static mesh are needed.
+	for (int32 SectionIndex = 0; SectionIndex < Geometry.MaterialIndices.Num(); SectionIndex++)
+	{
+		ProceduralMesh->SetMaterial(SectionIndex, StaticMesh->GetMaterial(Geometry.MaterialIndices[SectionIndex]));
+	}
+#endif
 
 	// Hide the static mesh and make the procedural mesh visible, tangible but not simulated.
 	SetupMesh(StaticMesh, false, false, false);
 	SetupMesh(ProceduralMesh, true, true, false);
+	bProcedural = true;
+
+	if (US_SliceMemory* SliceMemory = GetWorld()->GetSubsystem<US_SliceMemory>())
+		SliceMemory->AddSource(this);
+
+	if (US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>())
+	{
+		SliceIndex->Unregister(StaticMesh);
+		SliceIndex->Register(ProceduralMesh);
+	}
+}
+
+AS_SlicedMesh* AS_SlicedMesh::FromComponent(const UPrimitiveComponent* Component)
+{
+	if (!Component) return nullptr;
+
+	if (AS_Fragment* Fragment = Cast<AS_Fragment>(Component->GetOwner()))
+		return Fragment->GetSource();
+
+	return Cast<AS_SlicedMesh>(Component->GetOwner());
 }
 
-void AS_SlicedMesh::Slice(UProceduralMeshComponent* ProcMesh, FVector PlanePosition, FVector PlaneNormal)
+UProceduralMeshComponent* AS_SlicedMesh::GetSliceTarget(UPrimitiveComponent* Component, TArrayView<const FPlane> Planes, TArray<UProceduralMeshComponent*>& OutRevived)
 {
-	if (ProcMesh->GetOwner() != this) return;
+	// The static mesh stands for the procedural mesh until the first slice.
+	UProceduralMeshComponent* ProcMesh = Component == StaticMesh ? ProceduralMesh : Cast<UProceduralMeshComponent>(Component);
+
+	// Slicing the debris brings back the pieces a plane goes through, they are sliced instead.
+	if (ProcMesh && ProcMesh == DebrisMesh)
+	{
+		for (const TWeakObjectPtr<UProceduralMeshComponent>& Fragment : BakedFragments)
+		{
+			if (!Fragment.IsValid()) continue;
+			const FBoxSphereBounds& Bounds = Fragment->Bounds;
+			for (const FPlane& Plane : Planes)
+			{
+				if (FMath::Abs(Plane.PlaneDot(Bounds.Origin)) <= FVector::DotProduct(Bounds.BoxExtent, Plane.GetNormal().GetAbs()))
+				{
+					OutRevived.Add(Fragment.Get());
+					break;
+				}
+			}
+		}
+
+		if (OutRevived.Num() == 0) return nullptr;
+
+		for (UProceduralMeshComponent* Fragment : OutRevived)
+		{
+			ReviveFragment(Fragment);
+		}
+		RebuildDebris();
+		return nullptr;
+	}
+
+	return FromComponent(ProcMesh) == this ? ProcMesh : nullptr;
+}
+
+void AS_SlicedMesh::Slice(UPrimitiveComponent* Component, FVector PlanePosition, FVector PlaneNormal)
+{
+	// Clients only replay the slices of the server, their pieces would be numbered apart otherwise.
+	// So would the slices made while the archive is replayed.
+	if (GetLocalRole() != ROLE_Authority || bRestoring) return;
+
+	// Past the memory budget nothing more is cut, the pieces already there are culled early instead.
+	US_SliceMemory* SliceMemory = GetWorld()->GetSubsystem<US_SliceMemory>();
+	if (SliceMemory && !SliceMemory->CanSlice()) return;
+
+	FZ5_SCOPE(Slice);
 
-	const bool bIsGrounded = (ProcMesh == ProceduralMesh/* && !ProceduralMesh->IsSimulatingPhysics()*/);
+	const FPlane Plane(PlanePosition, PlaneNormal.GetSafeNormal());
 
-	// Slice the procedural mesh in half along the given plane.
-	UProceduralMeshComponent* NewProcMesh = nullptr;
-	UKismetProceduralMeshLibrary::SliceProceduralMesh(ProcMesh, PlanePosition, PlaneNormal, true, NewProcMesh,
-		EProcMeshSliceCapOption::CreateNewSectionForCap,
-		ProceduralMesh->GetMaterial(0));
-	if (!NewProcMesh || !NewProcMesh->IsValidLowLevel()) return;
+	if (IsFractureMode())
+	{
+		Fracture(MakeArrayView(&Plane, 1));
+		return;
+	}
+
+	TArray<UProceduralMeshComponent*> Revived;
+	UProceduralMeshComponent* ProcMesh = GetSliceTarget(Component, MakeArrayView(&Plane, 1), Revived);
+
+	for (UProceduralMeshComponent* Fragment : Revived)
+	{
+		Slice(Fragment, PlanePosition, PlaneNormal);
+	}
+
+	if (!ProcMesh) return;
+
+	if (US_SliceSubsystem* SliceSubsystem = GetWorld()->GetSubsystem<US_SliceSubsystem>())
+		SliceSubsystem->RequestSlice(this, ProcMesh, PlanePosition, PlaneNormal);
+}
+
+void AS_SlicedMesh::SliceMulti(UPrimitiveComponent* Component, TArrayView<const FPlane> Planes)
+{
+	if (GetLocalRole() != ROLE_Authority || bRestoring) return;
+
+	US_SliceMemory* SliceMemory = GetWorld()->GetSubsystem<US_SliceMemory>();
+	if (SliceMemory && !SliceMemory->CanSlice()) return;
+
+	FZ5_SCOPE(Slice);
+
+	if (IsFractureMode())
+	{
+		Fracture(Planes);
+		return;
+	}
+
+	TArray<UProceduralMeshComponent*> Revived;
+	UProceduralMeshComponent* ProcMesh = GetSliceTarget(Component, Planes, Revived);
+
+	for (UProceduralMeshComponent* Fragment : Revived)
+	{
+		SliceMulti(Fragment, Planes);
+	}
+
+	if (!ProcMesh) return;
+
+	if (US_SliceSubsystem* SliceSubsystem = GetWorld()->GetSubsystem<US_SliceSubsystem>())
+		SliceSubsystem->RequestMultiSlice(this, ProcMesh, Planes);
+}
+
+void AS_SlicedMesh::SetFractureCollection(UGeometryCollection* Collection)
+{
+	FractureCollection = Collection;
+	DestructionMode = Collection ? ES_DestructionMode::Fracture : ES_DestructionMode::Slice;
+}
+
+void AS_SlicedMesh::Fracture(TArrayView<const FPlane> Planes)
+{
+	// Sent like a slice of the root piece, the planes quantized in the space of the static mesh.
+	FS_SliceEvent Event;
+	Event.bMulti = Planes.Num() > 1;
+
+	const FTransform& MeshToWorld = StaticMesh->GetComponentTransform();
+	for (const FPlane& Plane : Planes.Slice(0, FMath::Min(Planes.Num(), FS_SliceKernel::MaxPlanes)))
+	{
+		const FVector LocalPlanePosition = MeshToWorld.InverseTransformPosition(Plane.GetOrigin());
+		const FVector LocalPlaneNormal = MeshToWorld.InverseTransformVectorNoScale(Plane.GetNormal()).GetSafeNormal();
+		Event.Planes.Add(FS_SliceEvent::QuantizePlane(FPlane(LocalPlanePosition, LocalPlaneNormal)));
+	}
+
+	ApplyFracture(Event.Planes);
+	RecordSlice(Event);
+}
+
+void AS_SlicedMesh::ApplyFracture(TArrayView<const FPlane> LocalPlanes)
+{
+	US_GeometryCache* GeometryCache = GetWorld()->GetSubsystem<US_GeometryCache>();
+	const TSharedPtr<const FS_FractureGraph> Graph = GeometryCache ? GeometryCache->FindOrBuildFracture(FractureCollection) : nullptr;
+	if (!Graph) return;
+
+	// The collection takes the place of the static mesh on the first cut, untouched props cost nothing to the solver.
+	if (!FractureComponent)
+	{
+		LeaveProxy();
+
+		FractureComponent = NewObject<UGeometryCollectionComponent>(this, TEXT("FractureCollection"));
+		FractureComponent->SetRestCollection(FractureCollection);
+		FractureComponent->SetupAttachment(StaticMesh);
+		FractureComponent->SetCollisionProfileName(StaticMesh->GetCollisionProfileName());
+		FractureComponent->RegisterComponent();
+
+		SetupMesh(StaticMesh, false, false, false);
+
+		if (US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>())
+		{
+			SliceIndex->Unregister(StaticMesh);
+			SliceIndex->Register(FractureComponent);
+		}
+	}
+
+	// Bones as they are now, the pieces released by the previous cuts have moved away from the rest pose.
+	TArray<FTransform> BoneTransforms;
+	const TArray<FMatrix>& Matrices = FractureComponent->GetGlobalMatrices();
+	if (Matrices.Num() == Graph->GetNumBones())
+	{
+		BoneTransforms.Reserve(Matrices.Num());
+		for (const FMatrix& Matrix : Matrices) BoneTransforms.Emplace(Matrix);
+	}
+
+	TArray<int32> Clusters;
+	for (const FPlane& Plane : LocalPlanes)
+	{
+		Graph->FindCut(Plane, BoneTransforms, Clusters);
+	}
+
+	// Parents first, a cluster only breaks once the one holding it has.
+	for (const int32 Cluster : Clusters)
+	{
+		FractureComponent->CrumbleCluster(Cluster);
+	}
+}
+
+bool AS_SlicedMesh::CommitSlice(UProceduralMeshComponent* ProcMesh, FS_SliceOutput& Output, FVector PlaneNormal, int32 FirstPieceId)
+{
+	FZ5_SCOPE(CommitSlice);
+
+	// The fragment may have been recycled while its slice was running.
+	if (FromComponent(ProcMesh) != this) return false;
+
+	auto HasGeometry = [](const FProcMeshSection& Section) { return Section.ProcIndexBuffer.Num() > 0; };
+	if (!Output.bSliced || !Output.KeptSections.ContainsByPredicate(HasGeometry) || !Output.OtherSections.ContainsByPredicate(HasGeometry)) return false;
+
+	US_FragmentSubsystem* FragmentSubsystem = GetWorld()->GetSubsystem<US_FragmentSubsystem>();
+	AS_Fragment* Fragment = FragmentSubsystem ? FragmentSubsystem->AcquireFragment(this, ProcMesh->GetComponentTransform()) : nullptr;
+	if (!Fragment) return false;
+
+	// The first slice of this actor is the one giving geometry to its procedural mesh, once nothing can fail anymore.
+	if (const TSharedPtr<const FS_SliceGeometry> SharedGeometry = GetSharedGeometry(ProcMesh))
+		ConvertToProcedural(*SharedGeometry);
+
+	UMaterialInterface* CapMaterial = InteriorMaterial ? InteriorMaterial : ProceduralMesh->GetMaterial(0);
+
+	// Move the geometry behind the plane to a pooled fragment, reading the materials before the sliced sections change.
+	UProceduralMeshComponent* NewProcMesh = Fragment->GetMesh();
+	SetPiece(FirstPieceId, NewProcMesh);
+	FillFragment(NewProcMesh, ProcMesh, Output.OtherSections, Output.OtherCap, Output.OtherConvexHulls, CapMaterial);
+
+	// Keep the geometry in front of the plane in the sliced procedural mesh.
+	KeepPiece(ProcMesh, Output.KeptSections, Output.KeptCap, Output.KeptConvexHulls, CapMaterial);
 
 	// Find the lower and higher parts of the sliced procedural mesh.
 	const FVector Pos1 = ProcMesh->GetComponentLocation();
@@ -53,27 +392,557 @@ void AS_SlicedMesh::Slice(UProceduralMeshComponent* ProcMesh, FVector PlanePosit
 	UProceduralMeshComponent* LowerProceduralMesh = (Pos1.Z <= Pos2.Z ? NewProcMesh : ProcMesh);
 	UProceduralMeshComponent* UpperProceduralMesh = (LowerProceduralMesh == ProcMesh ? NewProcMesh : ProcMesh);
 
-	// Make sure that a grounded procedural mesh slice stays grounded and non simulated.
-	//if (bIsGrounded)
-	//{
-	//	ProceduralMesh = LowerProceduralMesh;
-	//}
-	//else
-	//{
-	//	SetupMesh(LowerProceduralMesh, true, true, true);
-	//	LowerProceduralMesh->AddImpulse(/*{ 0, 0, 1000 }*/(-PlaneNormal / PlaneNormal.Size()) * 1000, NAME_None, true);
-	//}
-
 	// Enable simulation for the procedural meshes.
 	SetupMesh(LowerProceduralMesh, true, true, true);
-	LowerProceduralMesh->AddImpulse(/*{ 0, 0, 1000 }*/(-PlaneNormal / PlaneNormal.Size()) * 1000, NAME_None, true);
+	if (!PlaceRestoredPiece(LowerProceduralMesh))
+		LowerProceduralMesh->AddImpulse(/*{ 0, 0, 1000 }*/(-PlaneNormal / PlaneNormal.Size()) * 1000, NAME_None, true);
 
 	SetupMesh(UpperProceduralMesh, true, true, true);
-	UpperProceduralMesh->AddImpulse(/*{ 0, 0, 1000 }*/(PlaneNormal / PlaneNormal.Size()) * 1000, NAME_None, true);
+	if (!PlaceRestoredPiece(UpperProceduralMesh))
+		UpperProceduralMesh->AddImpulse(/*{ 0, 0, 1000 }*/(PlaneNormal / PlaneNormal.Size()) * 1000, NAME_None, true);
+
+	// Both halves now simulate and count against the fragment budget.
+	FragmentSubsystem->RegisterFragment(ProcMesh);
+	FragmentSubsystem->RegisterFragment(NewProcMesh);
+	return true;
+}
+
+bool AS_SlicedMesh::CommitMultiSlice(UProceduralMeshComponent* ProcMesh, FS_MultiSliceOutput& Output, int32 FirstPieceId)
+{
+	FZ5_SCOPE(CommitSlice);
+
+	// The fragment may have been recycled while its slice was running.
+	if (FromComponent(ProcMesh) != this) return false;
+
+	auto NumIndices = [](const FS_SliceCell& Cell)
+	{
+		int32 Num = Cell.Cap.ProcIndexBuffer.Num();
+		for (const FProcMeshSection& Section : Cell.Sections) Num += Section.ProcIndexBuffer.Num();
+		return Num;
+	};
+
+	// The biggest piece stays in the sliced mesh, every other one goes to a pooled fragment.
+	int32 KeptCell = INDEX_NONE;
+	int32 KeptIndices = 0;
+	int32 NumPieces = 0;
+	for (int32 CellIndex = 0; CellIndex < Output.Cells.Num(); CellIndex++)
+	{
+		const int32 CellIndices = NumIndices(Output.Cells[CellIndex]);
+		if (CellIndices == 0) continue;
+
+		NumPieces++;
+		if (CellIndices > KeptIndices)
+		{
+			KeptCell = CellIndex;
+			KeptIndices = CellIndices;
+		}
+	}
+
+	if (NumPieces < 2) return false;
+
+	US_FragmentSubsystem* FragmentSubsystem = GetWorld()->GetSubsystem<US_FragmentSubsystem>();
+	if (!FragmentSubsystem) return false;
+
+	// Numbered in cell order, even past a missing fragment.
+	TArray<TPair<int32, AS_Fragment*>> Fragments;
+	for (int32 CellIndex = 0; CellIndex < Output.Cells.Num(); CellIndex++)
+	{
+		if (CellIndex == KeptCell || NumIndices(Output.Cells[CellIndex]) == 0) continue;
+		Fragments.Emplace(CellIndex, FragmentSubsystem->AcquireFragment(this, ProcMesh->GetComponentTransform()));
+	}
+
+	// The first slice of this actor is the one giving geometry to its procedural mesh, once nothing can fail anymore.
+	if (const TSharedPtr<const FS_SliceGeometry> SharedGeometry = GetSharedGeometry(ProcMesh))
+		ConvertToProcedural(*SharedGeometry);
+
+	UMaterialInterface* CapMaterial = InteriorMaterial ? InteriorMaterial : ProceduralMesh->GetMaterial(0);
+	const FVector Center = ProcMesh->Bounds.Origin;
+
+	// Fill the fragments first, they read the materials of the sliced sections.
+	TArray<UProceduralMeshComponent*> NewPieces;
+	int32 PieceId = FirstPieceId;
+	for (const TPair<int32, AS_Fragment*>& Fragment : Fragments)
+	{
+		SetPiece(PieceId++, Fragment.Value ? Fragment.Value->GetMesh() : nullptr);
+		if (!Fragment.Value) continue;
+
+		const FS_SliceCell& Cell = Output.Cells[Fragment.Key];
+		FillFragment(Fragment.Value->GetMesh(), ProcMesh, Cell.Sections, Cell.Cap, Cell.ConvexHulls, CapMaterial);
+		NewPieces.Add(Fragment.Value->GetMesh());
+	}
+
+	const FS_SliceCell& Kept = Output.Cells[KeptCell];
+	KeepPiece(ProcMesh, Kept.Sections, Kept.Cap, Kept.ConvexHulls, CapMaterial);
+	NewPieces.Add(ProcMesh);
+
+	// Every piece is pushed away from the center of the mesh and counts against the fragment budget.
+	for (UProceduralMeshComponent* Piece : NewPieces)
+	{
+		SetupMesh(Piece, true, true, true);
+		if (!PlaceRestoredPiece(Piece))
+			Piece->AddImpulse((Piece->Bounds.Origin - Center).GetSafeNormal() * 1000, NAME_None, true);
+		FragmentSubsystem->RegisterFragment(Piece);
+	}
+	return true;
+}
+
+void AS_SlicedMesh::SetPiece(int32 PieceId, UProceduralMeshComponent* Piece)
+{
+	if (PieceId < 0) return;
+
+	// A pooled fragment coming back to this actor drops its previous number.
+	if (Piece)
+	{
+		for (TWeakObjectPtr<UProceduralMeshComponent>& Other : Pieces)
+		{
+			if (Other == Piece) Other.Reset();
+		}
+	}
+
+	if (PieceId >= Pieces.Num()) Pieces.SetNum(PieceId + 1);
+	Pieces[PieceId] = Piece;
+
+	// The sections are filled right after, cut faces included.
+	if (PieceId >= PieceCapSections.Num()) PieceCapSections.SetNumZeroed(PieceId + 1);
+	PieceCapSections[PieceId] = 0;
+}
+
+int32 AS_SlicedMesh::GetPieceId(const UPrimitiveComponent* Component) const
+{
+	// The static mesh stands for the root piece until the first slice.
+	if (Component == StaticMesh) return 0;
+	if (!Component || FromComponent(Component) != this) return INDEX_NONE;
+
+	return Pieces.IndexOfByPredicate([Component](const TWeakObjectPtr<UProceduralMeshComponent>& Piece) { return Piece.Get() == Component; });
+}
+
+UProceduralMeshComponent* AS_SlicedMesh::GetPiece(int32 PieceId) const
+{
+	UProceduralMeshComponent* Piece = Pieces.IsValidIndex(PieceId) ? Pieces[PieceId].Get() : nullptr;
+	return FromComponent(Piece) == this ? Piece : nullptr;
+}
+
+FS_SliceMemory AS_SlicedMesh::GetMemoryUsage() const
+{
+	FS_SliceMemory Memory;
+
+	auto AddMesh = [&Memory](UProceduralMeshComponent* Mesh, uint64 CapSections)
+	{
+		for (int32 SectionIndex = 0; SectionIndex < Mesh->GetNumSections(); SectionIndex++)
+		{
+			const FProcMeshSection* Section = Mesh->GetProcMeshSection(SectionIndex);
+			if (!Section) continue;
+
+			const int64 Size = Section->ProcVertexBuffer.GetAllocatedSize() + Section->ProcIndexBuffer.GetAllocatedSize();
+			if (SectionIndex < 64 && (CapSections & (1ull << SectionIndex))) Memory.CapGeometry += Size;
+			else Memory.FragmentGeometry += Size;
+		}
+
+		// Hulls with their cooked shapes, then the body instanced from them while it has physics state.
+		if (UBodySetup* BodySetup = Mesh->ProcMeshBodySetup)
+			Memory.Collision += BodySetup->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+
+		FResourceSizeEx BodySize(EResourceSizeMode::EstimatedTotal);
+		Mesh->BodyInstance.GetBodyInstanceResourceSizeEx(BodySize);
+		Memory.Physics += BodySize.GetTotalMemoryBytes();
+	};
+
+	// Nothing of its own before the first cut, the static mesh geometry is shared.
+	if (bProcedural)
+	{
+		for (int32 PieceId = 0; PieceId < Pieces.Num(); PieceId++)
+		{
+			UProceduralMeshComponent* Piece = GetPiece(PieceId);
+			if (!Piece) continue;
+
+			AddMesh(Piece, PieceCapSections.IsValidIndex(PieceId) ? PieceCapSections[PieceId] : 0);
+			Memory.NumPieces++;
+		}
+	}
+
+	// The merged debris mixes the cut faces with the rest.
+	if (DebrisMesh) AddMesh(DebrisMesh, 0);
+	return Memory;
+}
+
+void AS_SlicedMesh::RecordSlice(FS_SliceEvent& Event)
+{
+	Event.Index = SliceLog.Num();
+	SliceLog.Add(Event);
+
+	if (US_SliceReplication* SliceReplication = GetWorld()->GetSubsystem<US_SliceReplication>())
+	{
+		FBitWriter Bits(0, true);
+		bool bSuccess = true;
+		Event.NetSerialize(Bits, nullptr, bSuccess);
+		SliceReplication->CountEvent(Bits.GetNumBits());
+		SliceReplication->AddSource(this);
+	}
+
+	// A dormant actor has no channel to send the event through.
+	if (NetDormancy != DORM_Awake) SetNetDormancy(DORM_Awake);
+
+	if (GetNetMode() != NM_Standalone)
+		MulticastSlice(Event);
+}
+
+void AS_SlicedMesh::MulticastSlice_Implementation(const FS_SliceEvent& Event)
+{
+	if (!HasAuthority()) ReplaySlice(Event);
+}
+
+void AS_SlicedMesh::ReplaySlice(const FS_SliceEvent& Event)
+{
+	// Already replayed, or waiting, from the log received on join.
+	auto IsSameSlice = [&Event](const FS_SliceEvent& Other) { return Other.Index == Event.Index; };
+	if (Event.Index < NumReplayedSlices || PendingReplays.ContainsByPredicate(IsSameSlice)) return;
+
+	// Kept in log order, a piece is always made by an earlier slice than the ones cutting it.
+	PendingReplays.Insert(Event, Algo::UpperBoundBy(PendingReplays, Event.Index, &FS_SliceEvent::Index));
+	DrainReplays();
+}
+
+void AS_SlicedMesh::DrainReplays()
+{
+	const US_SliceSubsystem* SliceSubsystem = GetWorld()->GetSubsystem<US_SliceSubsystem>();
+
+	while (PendingReplays.Num() > 0)
+	{
+		// The piece comes out of a replayed slice still running, the next ones wait for its commit.
+		UProceduralMeshComponent* Piece = IsFractureMode() ? nullptr : GetPiece(PendingReplays[0].PieceId);
+		if (!IsFractureMode() && !Piece && SliceSubsystem && SliceSubsystem->HasPendingJobs(this)) return;
+
+		const FS_SliceEvent Event = PendingReplays[0];
+		PendingReplays.RemoveAt(0, 1, false);
+		NumReplayedSlices = FMath::Max(NumReplayedSlices, Event.Index + 1);
+
+		// The clusters released match the server, where the pieces fall is left to the physics of each machine.
+		if (IsFractureMode())
+		{
+			ApplyFracture(Event.Planes);
+			continue;
+		}
+
+		// Recycled here by the fragment budget, the slice is lost for this client.
+		if (!Piece) continue;
+
+		// Baking is local, the piece may be at rest in the debris here.
+		if (BakedFragments.Contains(Piece))
+		{
+			ReviveFragment(Piece);
+			RebuildDebris();
+		}
+
+		if (US_SliceSubsystem* Subsystem = GetWorld()->GetSubsystem<US_SliceSubsystem>())
+			Subsystem->RequestReplayedSlice(this, Piece, Event);
+	}
+}
+
+void AS_SlicedMesh::SaveSlices(FS_SliceRecord& OutRecord) const
+{
+	OutRecord.Events = SliceLog;
+	OutRecord.Pieces.Reset();
+
+	// Streamed out again before its restore finished, the pieces are still the ones it streamed in with.
+	if (bRestoring)
+	{
+		RestoredPieces.GenerateValueArray(OutRecord.Pieces);
+		return;
+	}
+
+	// Pieces emptied by the fragment budget have no sections left, they are not kept.
+	for (int32 PieceId = 0; PieceId < Pieces.Num(); PieceId++)
+	{
+		const UProceduralMeshComponent* Piece = GetPiece(PieceId);
+		if (!Piece || Piece->GetNumSections() == 0) continue;
+
+		FS_FragmentSnapshot& Snapshot = OutRecord.Pieces.AddDefaulted_GetRef();
+		Snapshot.PieceId = PieceId;
+		Snapshot.Location = Piece->GetComponentLocation();
+		Snapshot.Rotation = Piece->GetComponentRotation();
+		if (Piece->IsSimulatingPhysics() && Piece->RigidBodyIsAwake())
+			Snapshot.LinearVelocity = Piece->GetPhysicsLinearVelocity();
+	}
+}
+
+void AS_SlicedMesh::BeginRestore(FS_SliceRecord&& Record)
+{
+	// The log is whole right away, for the clients this actor becomes relevant to while it is replayed.
+	SliceLog = MoveTemp(Record.Events);
+	NumRestoredSlices = 0;
+	bRestoring = SliceLog.Num() > 0;
+
+	RestoredPieces.Reset();
+	for (const FS_FragmentSnapshot& Piece : Record.Pieces)
+	{
+		RestoredPieces.Add(Piece.PieceId, Piece);
+	}
+
+	if (!bRestoring) return;
+
+	if (US_SliceReplication* SliceReplication = GetWorld()->GetSubsystem<US_SliceReplication>())
+		SliceReplication->AddSource(this);
+
+	// Dormant since it streamed in, the clients need a channel to receive the log.
+	if (NetDormancy != DORM_Awake) SetNetDormancy(DORM_Awake);
+}
+
+bool AS_SlicedMesh::StepRestore(int32 MaxSlices)
+{
+	if (!bRestoring) return true;
+
+	const US_SliceSubsystem* SliceSubsystem = GetWorld()->GetSubsystem<US_SliceSubsystem>();
+	auto HasPendingJobs = [this, SliceSubsystem]() { return SliceSubsystem && SliceSubsystem->HasPendingJobs(this); };
+
+	for (int32 NumQueued = 0; NumQueued < MaxSlices && NumRestoredSlices < SliceLog.Num(); NumQueued++)
+	{
+		// The piece comes out of a slice still running, or never will when it was recycled before the save.
+		const FS_SliceEvent& Event = SliceLog[NumRestoredSlices];
+		if (!IsFractureMode() && !GetPiece(Event.PieceId) && HasPendingJobs()) return false;
+
+		ReplaySlice(Event);
+		NumRestoredSlices++;
+	}
+
+	if (NumRestoredSlices < SliceLog.Num() || HasPendingJobs()) return false;
+
+	FinishRestore();
+	return true;
+}
+
+void AS_SlicedMesh::FinishRestore()
+{
+	bRestoring = false;
+
+	// Pieces recycled before the save were only rebuilt for the slices made of them afterwards.
+	if (US_FragmentSubsystem* FragmentSubsystem = GetWorld()->GetSubsystem<US_FragmentSubsystem>())
+	{
+		for (int32 PieceId = 0; PieceId < Pieces.Num(); PieceId++)
+		{
+			UProceduralMeshComponent* Piece = GetPiece(PieceId);
+			if (Piece && Piece->GetNumSections() > 0 && !RestoredPieces.Contains(PieceId))
+				FragmentSubsystem->RemoveFragment(Piece);
+		}
+	}
+
+	RestoredPieces.Empty();
+}
+
+bool AS_SlicedMesh::PlaceRestoredPiece(UProceduralMeshComponent* Piece)
+{
+	if (!bRestoring) return false;
+
+	// Straight where it was rather than simulated again, asleep when it was at rest.
+	const FS_FragmentSnapshot* Snapshot = RestoredPieces.Find(GetPieceId(Piece));
+	if (Snapshot)
+		Piece->SetWorldLocationAndRotation(Snapshot->Location, Snapshot->Rotation, false, nullptr, ETeleportType::ResetPhysics);
+
+	if (Snapshot && !Snapshot->LinearVelocity.IsNearlyZero())
+		Piece->SetPhysicsLinearVelocity(Snapshot->LinearVelocity);
+	else
+		Piece->PutRigidBodyToSleep();
+
+	return true;
+}
+
+void AS_SlicedMesh::OnSerializeNewActor(FOutBunch& OutBunch)
+{
+	Super::OnSerializeNewActor(OutBunch);
+
+	// Built once for all the clients joining between two slices.
+	if (NumCompressedSlices != SliceLog.Num())
+	{
+		FS_SliceLog::Write(SliceLog, CompressedLog);
+		NumCompressedSlices = SliceLog.Num();
+	}
+
+	uint32 Size = CompressedLog.Num();
+	OutBunch.SerializeIntPacked(Size);
+	if (Size == 0) return;
+
+	OutBunch.Serialize(CompressedLog.GetData(), Size);
+
+	if (US_SliceReplication* SliceReplication = GetWorld()->GetSubsystem<US_SliceReplication>())
+		SliceReplication->CountLog(Size);
+}
+
+void AS_SlicedMesh::OnActorChannelOpen(FInBunch& InBunch, UNetConnection* Connection)
+{
+	Super::OnActorChannelOpen(InBunch, Connection);
+
+	uint32 Size = 0;
+	InBunch.SerializeIntPacked(Size);
+	if (Size == 0) return;
+
+	if (Size > FS_SliceLog::MaxBytes)
+	{
+		InBunch.SetError();
+		return;
+	}
+
+	TArray<uint8> Data;
+	Data.SetNumUninitialized(Size);
+	InBunch.Serialize(Data.GetData(), Size);
+	if (InBunch.IsError()) return;
+
+	TArray<FS_SliceEvent> Events;
+	if (!FS_SliceLog::Read(Data, Events))
+	{
+		UE_LOG(LogFZ5, Warning, TEXT("%s: cannot read the slice log of %u bytes"), *GetName(), Size);
+		return;
+	}
+
+	for (const FS_SliceEvent& Event : Events)
+	{
+		ReplaySlice(Event);
+	}
+}
+
+void AS_SlicedMesh::SendFragmentSnapshots(int32 MaxSnapshots, float MinVolume)
+{
+	// The biggest moving pieces, the ones a player can stand on or hide behind.
+	TArray<TPair<float, int32>> Candidates;
+	bool bAnyAwake = false;
+	for (int32 PieceId = 0; PieceId < Pieces.Num(); PieceId++)
+	{
+		const UProceduralMeshComponent* Piece = GetPiece(PieceId);
+		if (!Piece || !Piece->IsSimulatingPhysics() || !Piece->RigidBodyIsAwake()) continue;
+
+		bAnyAwake = true;
+		const FVector Size = Piece->Bounds.BoxExtent * 2.f;
+		const float Volume = Size.X * Size.Y * Size.Z;
+		if (Volume >= MinVolume) Candidates.Emplace(Volume, PieceId);
+	}
+
+	// Settled, nothing goes out until a slice or a hit on the debris wakes the actor.
+	if (SliceLog.Num() > 0 && bAnyAwake != (NetDormancy == DORM_Awake))
+		SetNetDormancy(bAnyAwake ? DORM_Awake : DORM_DormantAll);
+
+	if (MaxSnapshots <= 0 || Candidates.Num() == 0) return;
+
+	Candidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key > B.Key; });
+	Candidates.SetNum(FMath::Min(Candidates.Num(), MaxSnapshots), false);
+
+	TArray<FS_FragmentSnapshot> Snapshots;
+	FBitWriter Bits(0, true);
+	for (const TPair<float, int32>& Candidate : Candidates)
+	{
+		const UProceduralMeshComponent* Piece = GetPiece(Candidate.Value);
+		FS_FragmentSnapshot& Snapshot = Snapshots.AddDefaulted_GetRef();
+		Snapshot.PieceId = Candidate.Value;
+		Snapshot.Location = Piece->GetComponentLocation();
+		Snapshot.Rotation = Piece->GetComponentRotation();
+		Snapshot.LinearVelocity = Piece->GetPhysicsLinearVelocity();
+
+		bool bSuccess = true;
+		Snapshot.NetSerialize(Bits, nullptr, bSuccess);
+	}
+
+	if (US_SliceReplication* SliceReplication = GetWorld()->GetSubsystem<US_SliceReplication>())
+		SliceReplication->CountSnapshots(Snapshots.Num(), Bits.GetNumBits());
+
+	if (GetNetMode() != NM_Standalone)
+		MulticastFragmentSnapshots(Snapshots);
+}
+
+void AS_SlicedMesh::MulticastFragmentSnapshots_Implementation(const TArray<FS_FragmentSnapshot>& Snapshots)
+{
+	if (HasAuthority()) return;
+
+	for (const FS_FragmentSnapshot& Snapshot : Snapshots)
+	{
+		UProceduralMeshComponent* Piece = GetPiece(Snapshot.PieceId);
+		if (!Piece || !Piece->IsSimulatingPhysics()) continue;
+
+		const FVector Error = Snapshot.Location - Piece->GetComponentLocation();
+		if (Error.SizeSquared() > FMath::Square(SnapshotTeleportDistance))
+		{
+			Piece->SetWorldLocationAndRotation(Snapshot.Location, Snapshot.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+			Piece->SetPhysicsLinearVelocity(Snapshot.LinearVelocity);
+		}
+		else
+		{
+			Piece->SetPhysicsLinearVelocity(Snapshot.LinearVelocity + Error * SnapshotCorrectionRate);
+		}
+	}
+}
+
+void AS_SlicedMesh::FillFragment(UProceduralMeshComponent* Fragment, const UProceduralMeshComponent* Source, const TArray<FProcMeshSection>& Sections, const FProcMeshSection& Cap, const TArray<TArray<FVector>>& Hulls, UMaterialInterface* CapMaterial)
+{
+	// Cut faces of the source stay cut faces of the fragment, under their new section index.
+	const int32 SourceId = GetPieceId(Source);
+	const uint64 SourceCaps = PieceCapSections.IsValidIndex(SourceId) ? PieceCapSections[SourceId] : 0;
+	uint64 CapSections = 0;
+
+	int32 NewSectionIndex = 0;
+	for (int32 SectionIndex = 0; SectionIndex < Sections.Num(); SectionIndex++)
+	{
+		if (Sections[SectionIndex].ProcIndexBuffer.Num() == 0) continue;
+		{
+			LLM_SCOPE_BYTAG(FZ5_FragmentGeometry);
+			Fragment->SetProcMeshSection(NewSectionIndex, Sections[SectionIndex]);
+		}
+#if FZ5_WITH_CLIENT_VISUALS
+		Fragment->SetMaterial(NewSectionIndex, Source->GetMaterial(SectionIndex));
+#endif
+		if (SectionIndex < 64 && NewSectionIndex < 64 && (SourceCaps & (1ull << SectionIndex)))
+			CapSections |= 1ull << NewSectionIndex;
+		NewSectionIndex++;
+	}
+
+	if (Cap.ProcIndexBuffer.Num() > 0)
+	{
+		{
+			LLM_SCOPE_BYTAG(FZ5_CapGeometry);
+			Fragment->SetProcMeshSection(NewSectionIndex, Cap);
+		}
+		if (NewSectionIndex < 64) CapSections |= 1ull << NewSectionIndex;
+#if FZ5_WITH_CLIENT_VISUALS
+		Fragment->SetMaterial(NewSectionIndex, CapMaterial);
+#endif
+	}
+
+	Fragment->SetCollisionProfileName(Source->GetCollisionProfileName());
+	Fragment->SetCollisionEnabled(Source->GetCollisionEnabled());
+	Fragment->bUseComplexAsSimpleCollision = Source->bUseComplexAsSimpleCollision;
+	SetCollisionHulls(Fragment, Hulls);
+
+	const int32 FragmentId = GetPieceId(Fragment);
+	if (PieceCapSections.IsValidIndex(FragmentId)) PieceCapSections[FragmentId] = CapSections;
+}
+
+void AS_SlicedMesh::KeepPiece(UProceduralMeshComponent* ProcMesh, const TArray<FProcMeshSection>& Sections, const FProcMeshSection& Cap, const TArray<TArray<FVector>>& Hulls, UMaterialInterface* CapMaterial)
+{
+	for (int32 SectionIndex = 0; SectionIndex < Sections.Num(); SectionIndex++)
+	{
+		LLM_SCOPE_BYTAG(FZ5_FragmentGeometry);
+		if (Sections[SectionIndex].ProcIndexBuffer.Num() > 0)
+			ProcMesh->SetProcMeshSection(SectionIndex, Sections[SectionIndex]);
+		else
+			ProcMesh->ClearMeshSection(SectionIndex);
+	}
+
+	// The sections keep their index, only the new cap adds a cut face.
+	if (Cap.ProcIndexBuffer.Num() > 0)
+	{
+		LLM_SCOPE_BYTAG(FZ5_CapGeometry);
+		const int32 CapSectionIndex = ProcMesh->GetNumSections();
+		ProcMesh->SetProcMeshSection(CapSectionIndex, Cap);
+
+		const int32 PieceId = GetPieceId(ProcMesh);
+		if (PieceCapSections.IsValidIndex(PieceId) && CapSectionIndex < 64) PieceCapSections[PieceId] |= 1ull << CapSectionIndex;
+#if FZ5_WITH_CLIENT_VISUALS
+		ProcMesh->SetMaterial(CapSectionIndex, CapMaterial);
+#endif
+	}
+
+	SetCollisionHulls(ProcMesh, Hulls);
 }
 
 void AS_SlicedMesh::SetupMesh(UMeshComponent* Mesh, bool bVisible, bool bCollision, bool bSimulated)
 {
+	LLM_SCOPE_BYTAG(FZ5_Physics);
+
 	Mesh->SetVisibility(bVisible);
 	Mesh->CastShadow = bVisible;
 	Mesh->SetSimulatePhysics(bSimulated);
@@ -81,4 +950,193 @@ void AS_SlicedMesh::SetupMesh(UMeshComponent* Mesh, bool bVisible, bool bCollisi
 	Mesh->SetGenerateOverlapEvents(bCollision);
 	Mesh->SetCollisionResponseToAllChannels(bCollision ? ECR_Block : ECR_Ignore);
 	Mesh->CanCharacterStepUpOn = bCollision ? ECB_Yes : ECB_No;
+}
+
+void AS_SlicedMesh::SetCollisionHulls(UProceduralMeshComponent* Mesh, const TArray<TArray<FVector>>& Hulls)
+{
+	LLM_SCOPE_BYTAG(FZ5_Collision);
+
+	// Outside of game worlds the hulls are cooked right away.
+	if (!Mesh->bUseAsyncCooking || !GetWorld()->IsGameWorld())
+	{
+		Mesh->SetCollisionConvexMeshes(Hulls);
+		return;
+	}
+
+	// Until the hulls are cooked the body still has the shape from before the slice, a box around the new geometry
+	// stands in. Cooked right away by the component itself, and first, since doing so empties its queue of cooks.
+	const FBox LocalBox = Mesh->CalcBounds(FTransform::Identity).GetBox();
+
+	// Each new body starts at rest, the piece moves on as it did before the slice.
+	US_FragmentSubsystem* FragmentSubsystem = GetWorld()->GetSubsystem<US_FragmentSubsystem>();
+	if (FragmentSubsystem) FragmentSubsystem->WatchCook(Mesh);
+
+	if (LocalBox.IsValid)
+	{
+		TArray<FVector> Corners;
+		for (int32 Corner = 0; Corner < 8; Corner++)
+		{
+			Corners.Emplace(Corner & 1 ? LocalBox.Max.X : LocalBox.Min.X, Corner & 2 ? LocalBox.Max.Y : LocalBox.Min.Y, Corner & 4 ? LocalBox.Max.Z : LocalBox.Min.Z);
+		}
+
+		Mesh->bUseAsyncCooking = false;
+		Mesh->SetCollisionConvexMeshes({ Corners });
+		Mesh->bUseAsyncCooking = true;
+
+		if (FragmentSubsystem) FragmentSubsystem->RestoreCook(Mesh);
+	}
+
+	Mesh->SetCollisionConvexMeshes(Hulls);
+}
+
+void AS_SlicedMesh::BakeFragment(UProceduralMeshComponent* Fragment)
+{
+	// The piece is only hidden and frozen, its geometry stays for when it is revived.
+	SetupMesh(Fragment, false, false, false);
+	Fragment->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	BakedFragments.AddUnique(Fragment);
+}
+
+void AS_SlicedMesh::ReviveFragment(UProceduralMeshComponent* Fragment)
+{
+	BakedFragments.Remove(Fragment);
+
+	Fragment->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	SetupMesh(Fragment, true, true, true);
+
+	if (US_FragmentSubsystem* FragmentSubsystem = GetWorld()->GetSubsystem<US_FragmentSubsystem>())
+		FragmentSubsystem->RegisterFragment(Fragment);
+}
+
+void AS_SlicedMesh::ReviveDebris(const FVector& Location, float Radius)
+{
+	TArray<UProceduralMeshComponent*> Fragments;
+	for (const TWeakObjectPtr<UProceduralMeshComponent>& Fragment : BakedFragments)
+	{
+		if (Fragment.IsValid() && Fragment->Bounds.GetBox().ComputeSquaredDistanceToPoint(Location) <= Radius * Radius)
+			Fragments.Add(Fragment.Get());
+	}
+
+	if (Fragments.Num() == 0) return;
+
+	for (UProceduralMeshComponent* Fragment : Fragments)
+	{
+		ReviveFragment(Fragment);
+	}
+	RebuildDebris();
+}
+
+void AS_SlicedMesh::OnDebrisHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+{
+	// Characters walking on the debris do not push it, only real impacts wake it up.
+	if (NormalImpulse.Size() < CVarDebrisWakeImpulse.GetValueOnGameThread()) return;
+
+	ReviveDebris(Hit.ImpactPoint, CVarDebrisWakeRadius.GetValueOnGameThread());
+}
+
+void AS_SlicedMesh::RebuildDebris()
+{
+	LLM_SCOPE_BYTAG(FZ5_FragmentGeometry);
+
+	BakedFragments.RemoveAllSwap([](const TWeakObjectPtr<UProceduralMeshComponent>& Fragment) { return !Fragment.IsValid(); });
+
+	if (!DebrisMesh)
+	{
+		// The debris lives in world space, whatever the root does after being sliced.
+		DebrisMesh = NewObject<UProceduralMeshComponent>(this, TEXT("DebrisMesh"), RF_Transient);
+		DebrisMesh->bUseComplexAsSimpleCollision = false;
+		DebrisMesh->bUseAsyncCooking = true;
+		DebrisMesh->SetUsingAbsoluteLocation(true);
+		DebrisMesh->SetUsingAbsoluteRotation(true);
+		DebrisMesh->SetUsingAbsoluteScale(true);
+		DebrisMesh->SetupAttachment(ProceduralMesh);
+		DebrisMesh->SetCollisionProfileName(ProceduralMesh->GetCollisionProfileName());
+		DebrisMesh->OnComponentHit.AddDynamic(this, &AS_SlicedMesh::OnDebrisHit);
+		DebrisMesh->RegisterComponent();
+		DebrisMesh->SetRelativeTransform(FTransform::Identity);
+	}
+
+	// Pieces sharing a material share a section, so the whole pile costs one draw per material.
+	TArray<UMaterialInterface*> Materials;
+	TArray<FProcMeshSection> Sections;
+	TArray<TArray<FVector>> Boxes;
+
+	for (const TWeakObjectPtr<UProceduralMeshComponent>& Fragment : BakedFragments)
+	{
+		const FTransform& FragmentToWorld = Fragment->GetComponentTransform();
+		const FMatrix NormalToWorld = FragmentToWorld.ToInverseMatrixWithScale().GetTransposed();
+		const bool bMirrored = FragmentToWorld.GetDeterminant() < 0.f;
+
+		for (int32 SectionIndex = 0; SectionIndex < Fragment->GetNumSections(); SectionIndex++)
+		{
+			const FProcMeshSection* Section = Fragment->GetProcMeshSection(SectionIndex);
+			if (!Section || Section->ProcIndexBuffer.Num() == 0) continue;
+
+			UMaterialInterface* Material = Fragment->GetMaterial(SectionIndex);
+			int32 MergedIndex = Materials.Find(Material);
+			if (MergedIndex == INDEX_NONE)
+			{
+				MergedIndex = Materials.Add(Material);
+				Sections.AddDefaulted();
+			}
+
+			FProcMeshSection& Merged = Sections[MergedIndex];
+			const uint32 BaseIndex = Merged.ProcVertexBuffer.Num();
+			Merged.ProcVertexBuffer.Reserve(BaseIndex + Section->ProcVertexBuffer.Num());
+			for (FProcMeshVertex Vertex : Section->ProcVertexBuffer)
+			{
+				Vertex.Position = FragmentToWorld.TransformPosition(Vertex.Position);
+				Vertex.Normal = NormalToWorld.TransformVector(Vertex.Normal).GetSafeNormal();
+				Vertex.Tangent.TangentX = FragmentToWorld.TransformVector(Vertex.Tangent.TangentX).GetSafeNormal();
+				Merged.SectionLocalBox += Vertex.Position;
+				Merged.ProcVertexBuffer.Add(Vertex);
+			}
+
+			// A mirroring scale flips the winding, put it back so the faces stay outward.
+			const int32 FirstIndex = Merged.ProcIndexBuffer.Num();
+			Merged.ProcIndexBuffer.Reserve(FirstIndex + Section->ProcIndexBuffer.Num());
+			for (const uint32 Index : Section->ProcIndexBuffer)
+			{
+				Merged.ProcIndexBuffer.Add(BaseIndex + Index);
+			}
+			if (bMirrored)
+			{
+				for (int32 Index = FirstIndex; Index + 2 < Merged.ProcIndexBuffer.Num(); Index += 3)
+				{
+					Swap(Merged.ProcIndexBuffer[Index + 1], Merged.ProcIndexBuffer[Index + 2]);
+				}
+			}
+		}
+
+		// A box per piece is enough collision for something at rest.
+		FVector Corners[8];
+		Fragment->CalcBounds(FTransform::Identity).GetBox().GetVertices(Corners);
+		TArray<FVector>& Box = Boxes.AddDefaulted_GetRef();
+		for (const FVector& Corner : Corners)
+		{
+			Box.Add(FragmentToWorld.TransformPosition(Corner));
+		}
+	}
+
+	DebrisMesh->ClearAllMeshSections();
+	DebrisMesh->EmptyOverrideMaterials();
+	for (int32 SectionIndex = 0; SectionIndex < Sections.Num(); SectionIndex++)
+	{
+		DebrisMesh->SetProcMeshSection(SectionIndex, Sections[SectionIndex]);
+		DebrisMesh->SetMaterial(SectionIndex, Materials[SectionIndex]);
+	}
+	DebrisMesh->SetCollisionConvexMeshes(Boxes);
+
+	// Static and tangible, but still told about hits so it can wake up.
+	const bool bHasDebris = BakedFragments.Num() > 0;
+	SetupMesh(DebrisMesh, bHasDebris, bHasDebris, false);
+	DebrisMesh->SetNotifyRigidBodyCollision(bHasDebris);
+
+	if (US_SliceIndex* SliceIndex = GetWorld()->GetSubsystem<US_SliceIndex>())
+	{
+		if (bHasDebris)
+			SliceIndex->Register(DebrisMesh);
+		else
+			SliceIndex->Unregister(DebrisMesh);
+	}
 }
\ No newline at end of file
@@ -3,8 +3,27 @@
 #include "CoreMinimal.h"
 #include "ProceduralMeshComponent.h"
 #include "GameFramework/Actor.h"
+#include "S_SliceReplication.h"
 #include "S_SlicedMesh.generated.h"
 
+struct FS_SliceOutput;
+struct FS_MultiSliceOutput;
+struct FS_SliceGeometry;
+struct FS_SliceRecord;
+struct FS_SliceMemory;
+class UGeometryCollection;
+class UGeometryCollectionComponent;
+
+/* How a sliceable breaks. */
+UENUM()
+enum class ES_DestructionMode : uint8
+{
+	// Cut at runtime into procedural pieces, for simple props.
+	Slice,
+
+	// Broken along the cut from a pre-fractured geometry collection, for heavy props, no mesh math nor cooking at runtime.
+	Fracture,
+};
 
 UCLASS()
 class PROJECT_FZ5_API AS_SlicedMesh : public AActor
@@ -16,14 +35,183 @@ class PROJECT_FZ5_API AS_SlicedMesh : public AActor
 
 	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
 	UProceduralMeshComponent* ProceduralMesh = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = Destruction)
+	ES_DestructionMode DestructionMode = ES_DestructionMode::Slice;
+
+	/* Pre-fractured version of the static mesh, used in fracture mode. */
+	UPROPERTY(EditAnywhere, Category = Destruction, meta = (EditCondition = "DestructionMode == ES_DestructionMode::Fracture"))
+	UGeometryCollection* FractureCollection = nullptr;
+
+	/* Material of the cut faces, the first material of the mesh when not set. */
+	UPROPERTY(EditAnywhere, Category = Destruction)
+	UMaterialInterface* InteriorMaterial = nullptr;
+
+	/* Size in cm of a tile of the UVs projected on the cut faces. */
+	UPROPERTY(EditAnywhere, Category = Destruction, meta = (ClampMin = "1"))
+	float InteriorUVScale = 64.f;
+
+	/* Drawn and collided through an instanced mesh shared with the sliceables of the same mesh until the first cut. */
+	UPROPERTY(EditAnywhere, Category = Destruction)
+	bool bInstanced = true;
+
+	/* Whether an instance stands for the static mesh, which is not registered meanwhile. */
+	bool bProxied = false;
+
+	/* Draw the static mesh and make it tangible and sliceable, the way an untouched prop is. */
+	void RegisterStaticMesh();
+
+	/* Takes the place of the static mesh on the first cut in fracture mode. */
+	UPROPERTY(Transient)
+	UGeometryCollectionComponent* FractureComponent = nullptr;
+
+	bool IsFractureMode() const { return DestructionMode == ES_DestructionMode::Fracture && FractureCollection; }
+
+	/* Crumble the clusters holding pieces on both sides of planes in the space of the static mesh. */
+	void ApplyFracture(TArrayView<const FPlane> LocalPlanes);
+
+	/* Cut the geometry collection on the server and send the cut like a slice. */
+	void Fracture(TArrayView<const FPlane> Planes);
+
+	/* False until the first slice, the static mesh is drawn and collides in the meantime. */
+	bool bProcedural = false;
+
+	/* Pieces of this actor at rest, merged in world space with one section per material and no physics. */
+	UPROPERTY(Transient)
+	UProceduralMeshComponent* DebrisMesh = nullptr;
+
+	/* Hidden pieces drawn by the debris mesh, kept as they were so they can be revived. */
+	TArray<TWeakObjectPtr<UProceduralMeshComponent>> BakedFragments;
+
+	void ReviveFragment(UProceduralMeshComponent* Fragment);
+
+	/* Pieces by number, the same on the server and the clients, the root mesh first. Null once recycled. */
+	TArray<TWeakObjectPtr<UProceduralMeshComponent>> Pieces;
+
+	/* Sections of each piece that are cut faces, one bit per section and by piece number, for the memory accounting. */
+	TArray<uint64> PieceCapSections;
+
+	/* Every slice replicated by the server, in commit order. */
+	TArray<FS_SliceEvent> SliceLog;
+
+	/* Slices replayed by a client, from the log sent on join then from the live events. */
+	int32 NumReplayedSlices = 0;
+
+	/* Slices received but not replayed yet, in log order, waiting for a replayed slice still running to make their piece. */
+	TArray<FS_SliceEvent> PendingReplays;
+
+	/* The log as sent to joining clients, rebuilt when slices were added since. */
+	TArray<uint8> CompressedLog;
+	int32 NumCompressedSlices = 0;
+
+	void SetPiece(int32 PieceId, UProceduralMeshComponent* Piece);
+	void ReplaySlice(const FS_SliceEvent& Event);
+
+	/* Pieces by number as they were when the cell of this actor streamed out, while its slices are replayed. */
+	TMap<int32, FS_FragmentSnapshot> RestoredPieces;
+	int32 NumRestoredSlices = 0;
+	bool bRestoring = false;
+
+	/* Put a piece rebuilt from the archive back where it was instead of pushing it away, false when not restoring. */
+	bool PlaceRestoredPiece(UProceduralMeshComponent* Piece);
+	void FinishRestore();
+
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastSlice(const FS_SliceEvent& Event);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFragmentSnapshots(const TArray<FS_FragmentSnapshot>& Snapshots);
+
+	/* Procedural mesh a slice of Component applies to, after bringing back the baked pieces the planes go through when it is the debris. */
+	UProceduralMeshComponent* GetSliceTarget(UPrimitiveComponent* Component, TArrayView<const FPlane> Planes, TArray<UProceduralMeshComponent*>& OutRevived);
+
+	/* Give a pooled fragment a piece sliced off Source, with the materials and collision settings of Source. */
+	void FillFragment(UProceduralMeshComponent* Fragment, const UProceduralMeshComponent* Source, const TArray<FProcMeshSection>& Sections, const FProcMeshSection& Cap, const TArray<TArray<FVector>>& Hulls, UMaterialInterface* CapMaterial);
+
+	/* Replace the geometry of a sliced mesh by the piece it keeps. */
+	void KeepPiece(UProceduralMeshComponent* ProcMesh, const TArray<FProcMeshSection>& Sections, const FProcMeshSection& Cap, const TArray<TArray<FVector>>& Hulls, UMaterialInterface* CapMaterial);
+
+	/* Swap the static mesh for the procedural mesh, which is about to receive its first sliced geometry. */
+	void ConvertToProcedural(const FS_SliceGeometry& Geometry);
+
+	/* Cook the hulls of a mesh asynchronously, with a bounding box standing in for them meanwhile. */
+	void SetCollisionHulls(UProceduralMeshComponent* Mesh, const TArray<TArray<FVector>>& Hulls);
+
+	UFUNCTION()
+	void OnDebrisHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 	
 public:	
 	AS_SlicedMesh();
 
+	virtual void PreRegisterAllComponents() override;
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
-	void Slice(UProceduralMeshComponent* ProcMesh, FVector PlanePosition, FVector PlaneNormal);
+	/* Sliced actor a procedural mesh belongs to, either as its root or as a pooled fragment. */
+	static AS_SlicedMesh* FromComponent(const UPrimitiveComponent* Component);
+
+	/* The slice log, for clients the actor becomes relevant to, and its replay on their side. */
+	virtual void OnSerializeNewActor(FOutBunch& OutBunch) override;
+	virtual void OnActorChannelOpen(FInBunch& InBunch, UNetConnection* Connection) override;
+
+	/* Queue a slice of a mesh of this actor, the result is applied by the slice subsystem on a later frame. Server only once replicated. */
+	void Slice(UPrimitiveComponent* Component, FVector PlanePosition, FVector PlaneNormal);
+
+	/* Apply a finished slice, the new pieces being numbered from FirstPieceId. False when nothing was cut. */
+	bool CommitSlice(UProceduralMeshComponent* ProcMesh, FS_SliceOutput& Output, FVector PlaneNormal, int32 FirstPieceId);
+
+	/* Queue a slice by several world space planes at once, the mesh breaks into every piece they make. */
+	void SliceMulti(UPrimitiveComponent* Component, TArrayView<const FPlane> Planes);
+	bool CommitMultiSlice(UProceduralMeshComponent* ProcMesh, FS_MultiSliceOutput& Output, int32 FirstPieceId);
+
+	/* Number of the piece Component is, INDEX_NONE when it is not a piece of this actor. */
+	int32 GetPieceId(const UPrimitiveComponent* Component) const;
+	UProceduralMeshComponent* GetPiece(int32 PieceId) const;
+	int32 GetNumPieces() const { return Pieces.Num(); }
+	float GetInteriorUVScale() const { return InteriorUVScale; }
+
+	/* Memory held by the pieces and the debris of this actor, the cached source geometry aside. */
+	FS_SliceMemory GetMemoryUsage() const;
+
+	/* Take back the static mesh from the instance drawing it, before this actor gets cut. */
+	void LeaveProxy();
+
+	/* Replay the waiting slices whose piece is there now, called after each commit of a slice of this actor. */
+	void DrainReplays();
+
+	/* Log a slice committed on the server and send it to the clients. */
+	void RecordSlice(FS_SliceEvent& Event);
+
+	/* The slice log and the pieces of this actor, kept by the archive while its cell is streamed out. */
+	void SaveSlices(FS_SliceRecord& OutRecord) const;
+
+	/* Replay a record of the archive, a few slices per step. StepRestore is true once every piece is back. */
+	void BeginRestore(FS_SliceRecord&& Record);
+	bool StepRestore(int32 MaxSlices);
+	bool IsRestoring() const { return bRestoring; }
+
+	/* Break this actor from Collection rather than slicing it, before it begins play. Null goes back to slicing. */
+	void SetFractureCollection(UGeometryCollection* Collection);
+
+	/* Send where the biggest simulated pieces are to the clients. */
+	void SendFragmentSnapshots(int32 MaxSnapshots, float MinVolume);
 	void SetupMesh(UMeshComponent* Mesh, bool bVisible, bool bCollision, bool bSimulated);
+
+	/* Cached geometry to slice ProcMesh from, as long as it is the root of an actor that was never cut. */
+	TSharedPtr<const FS_SliceGeometry> GetSharedGeometry(const UProceduralMeshComponent* ProcMesh) const;
+
+	/* Hide a settled piece and draw it with the debris mesh from the next rebuild. */
+	void BakeFragment(UProceduralMeshComponent* Fragment);
+
+	/* Leave an evicted baked piece out of the debris mesh from the next rebuild. */
+	void DropBakedFragment(UProceduralMeshComponent* Fragment) { BakedFragments.Remove(Fragment); }
+
+	/* Bring the baked pieces close to Location back to simulation. */
+	void ReviveDebris(const FVector& Location, float Radius);
+
+	/* Merge the baked pieces into the debris mesh again. */
+	void RebuildDebris();
 };
\ No newline at end of file
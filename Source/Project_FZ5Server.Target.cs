@@ -0,0 +1,22 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+[SupportedPlatforms(UnrealPlatformClass.Server)]
+public class Project_FZ5ServerTarget : TargetRules
+{
+	public Project_FZ5ServerTarget( TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.V2;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_1;
+		ExtraModuleNames.Add("Project_FZ5");
+
+		// Headless match instances, many per host: keep the logs, leave out what only tools and players use.
+		bUseLoggingInShipping = true;
+		bBuildDeveloperTools = false;
+		bCompileCEF3 = false;
+		bWithPushModel = true;
+	}
+}